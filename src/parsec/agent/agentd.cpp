@@ -5,7 +5,6 @@
 
 #include "broker/impl.hpp"
 #include "crypto/sha256.h"
-#include "directory/impl.hpp"
 #include "format.hpp"
 #include "impl.hpp"
 #include "runners/evm/format.hpp"
@@ -70,8 +69,7 @@ auto main(int argc, char** argv) -> int {
         return 1;
     }
 
-    auto directory
-        = std::make_shared<cbdc::parsec::directory::impl>(shards.size());
+    auto directory = cbdc::parsec::make_directory(*cfg, shards.size());
     auto broker
         = std::make_shared<cbdc::parsec::broker::impl>(cfg->m_component_id,
                                                        shards,
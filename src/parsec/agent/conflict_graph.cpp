@@ -0,0 +1,50 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "conflict_graph.hpp"
+
+#include <set>
+
+namespace cbdc::parsec::agent {
+    auto conflict_graph::add(
+        const std::optional<broker::held_locks_set_type>& accesses)
+        -> std::vector<size_t> {
+        const auto idx = m_size++;
+        auto deps = std::set<size_t>();
+        if(m_barrier.has_value()) {
+            deps.insert(m_barrier.value());
+        }
+
+        if(!accesses.has_value()) {
+            deps.insert(m_since_barrier.begin(), m_since_barrier.end());
+            // Later transactions depend on this one, which depends on every
+            // earlier one, so the earlier accesses no longer matter.
+            m_barrier = idx;
+            m_since_barrier.clear();
+            m_keys.clear();
+            return {deps.begin(), deps.end()};
+        }
+
+        for(const auto& [key, locktype] : accesses.value()) {
+            auto& state = m_keys[key];
+            if(state.m_writer.has_value()) {
+                deps.insert(state.m_writer.value());
+            }
+            if(locktype == broker::lock_type::write) {
+                deps.insert(state.m_readers.begin(), state.m_readers.end());
+                state.m_writer = idx;
+                state.m_readers.clear();
+            } else {
+                state.m_readers.push_back(idx);
+            }
+        }
+        m_since_barrier.push_back(idx);
+        return {deps.begin(), deps.end()};
+    }
+
+    auto conflict_graph::size() const -> size_t {
+        return m_size;
+    }
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PARSEC_AGENT_CONFLICT_GRAPH_H_
+#define OPENCBDC_TX_SRC_PARSEC_AGENT_CONFLICT_GRAPH_H_
+
+#include "parsec/broker/interface.hpp"
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace cbdc::parsec::agent {
+    /// \brief Dependencies between the transactions of a batch.
+    ///
+    /// Transactions are added in batch order with the keys they access. A
+    /// transaction depends on each earlier transaction which writes a key
+    /// it accesses, and on each earlier transaction which accesses a key it
+    /// writes. Running every transaction only after the transactions it
+    /// depends on have finished runs each pair of conflicting transactions
+    /// in batch order, while transactions which do not conflict may run in
+    /// parallel. Not thread-safe.
+    class conflict_graph {
+      public:
+        /// Adds the next transaction of the batch.
+        /// \param accesses keys the transaction accesses and the type of
+        ///                 lock it needs on each, or std::nullopt if they
+        ///                 are unknown. A transaction with unknown accesses
+        ///                 depends on every earlier transaction, and every
+        ///                 later transaction depends on it.
+        /// \return indices of the earlier transactions the transaction
+        ///         depends on, in ascending order.
+        auto add(const std::optional<broker::held_locks_set_type>& accesses)
+            -> std::vector<size_t>;
+
+        /// Returns the number of transactions added so far.
+        /// \return number of transactions.
+        [[nodiscard]] auto size() const -> size_t;
+
+      private:
+        struct key_state {
+            /// Last transaction to write the key.
+            std::optional<size_t> m_writer;
+            /// Transactions which read the key since it was last written.
+            std::vector<size_t> m_readers;
+        };
+
+        std::unordered_map<broker::key_type,
+                           key_state,
+                           hashing::const_sip_hash<broker::key_type>>
+            m_keys;
+        /// Last transaction with unknown accesses.
+        std::optional<size_t> m_barrier;
+        /// Transactions added since m_barrier.
+        std::vector<size_t> m_since_barrier;
+        size_t m_size{};
+    };
+}
+
+#endif
@@ -0,0 +1,74 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "code_cache.hpp"
+
+#include <algorithm>
+
+namespace cbdc::parsec::agent::runner {
+    code_cache::code_cache(size_t max_entries)
+        : m_max_entries(max_entries) {}
+
+    auto code_cache::get(const broker::key_type& key)
+        -> std::optional<broker::value_type> {
+        std::unique_lock l(m_mut);
+        auto it = m_entries.find(key);
+        if(it == m_entries.end()) {
+            return std::nullopt;
+        }
+        m_lru.splice(m_lru.begin(), m_lru, it->second.m_lru);
+        return it->second.m_code;
+    }
+
+    auto code_cache::put(const broker::key_type& key,
+                         broker::value_type code,
+                         broker::ticket_number_type ticket_number) -> bool {
+        if(code.size() == 0 || m_max_entries == 0) {
+            return false;
+        }
+        std::unique_lock l(m_mut);
+        if(ticket_number < m_min_ticket_number) {
+            return false;
+        }
+        auto it = m_entries.find(key);
+        if(it != m_entries.end()) {
+            if(it->second.m_ticket_number < ticket_number) {
+                it->second.m_code = std::move(code);
+                it->second.m_ticket_number = ticket_number;
+            }
+            m_lru.splice(m_lru.begin(), m_lru, it->second.m_lru);
+            return true;
+        }
+        if(m_entries.size() == m_max_entries) {
+            m_entries.erase(m_lru.back());
+            m_lru.pop_back();
+        }
+        m_lru.push_front(key);
+        m_entries.emplace(
+            key,
+            entry{std::move(code), ticket_number, m_lru.begin()});
+        return true;
+    }
+
+    void code_cache::invalidate(const broker::key_type& key,
+                                broker::ticket_number_type ticket_number) {
+        std::unique_lock l(m_mut);
+        // Tickets which read the key earlier may still try to cache what
+        // they read, so refuse code from any earlier ticket. Deployments
+        // are rare enough that a per-key record is not worth keeping.
+        m_min_ticket_number = std::max(m_min_ticket_number, ticket_number);
+        auto it = m_entries.find(key);
+        if(it == m_entries.end()) {
+            return;
+        }
+        m_lru.erase(it->second.m_lru);
+        m_entries.erase(it);
+    }
+
+    auto code_cache::size() const -> size_t {
+        std::unique_lock l(m_mut);
+        return m_entries.size();
+    }
+}
@@ -0,0 +1,85 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PARSEC_AGENT_RUNNERS_EVM_CODE_CACHE_H_
+#define OPENCBDC_TX_SRC_PARSEC_AGENT_RUNNERS_EVM_CODE_CACHE_H_
+
+#include "parsec/broker/interface.hpp"
+
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace cbdc::parsec::agent::runner {
+    /// \brief Contract code shared between the EVM runners of an agent
+    ///        server.
+    ///
+    /// Contract code is only written when a contract is deployed, so code
+    /// which a ticket read from the shards while holding a lock stays valid
+    /// for later tickets. They can use it without locking the code key or
+    /// fetching it again. Each entry records the ticket which read it.
+    /// Invalidating a key removes its entry and stops the cache accepting
+    /// code read by any earlier ticket, as that code may predate the write.
+    /// Evicts the least recently used entry when full. Thread-safe.
+    class code_cache {
+      public:
+        /// Default maximum number of entries.
+        static constexpr size_t default_max_entries = 1024;
+
+        /// Constructor.
+        /// \param max_entries maximum number of entries to hold.
+        explicit code_cache(size_t max_entries);
+
+        /// Returns the code cached at the given key.
+        /// \param key code key.
+        /// \return serialized code, or std::nullopt if the key is not
+        ///         cached.
+        auto get(const broker::key_type& key)
+            -> std::optional<broker::value_type>;
+
+        /// Caches code read by a ticket. Empty code is not cached, as a
+        /// contract may later be deployed at the address.
+        /// \param key code key.
+        /// \param code serialized code.
+        /// \param ticket_number ticket which read the code while holding a
+        ///                      lock on the key.
+        /// \return true if the code was cached.
+        auto put(const broker::key_type& key,
+                 broker::value_type code,
+                 broker::ticket_number_type ticket_number) -> bool;
+
+        /// Removes the code cached at the given key because a ticket may
+        /// write it.
+        /// \param key code key.
+        /// \param ticket_number ticket which may write the key.
+        void invalidate(const broker::key_type& key,
+                        broker::ticket_number_type ticket_number);
+
+        /// Returns the number of cached entries.
+        /// \return number of entries.
+        [[nodiscard]] auto size() const -> size_t;
+
+      private:
+        struct entry {
+            broker::value_type m_code;
+            broker::ticket_number_type m_ticket_number{};
+            std::list<broker::key_type>::iterator m_lru;
+        };
+
+        mutable std::mutex m_mut;
+        size_t m_max_entries;
+        std::unordered_map<broker::key_type,
+                           entry,
+                           hashing::const_sip_hash<broker::key_type>>
+            m_entries;
+        /// Cached keys, most recently used first.
+        std::list<broker::key_type> m_lru;
+        /// Code read by tickets before this one is not cached.
+        broker::ticket_number_type m_min_ticket_number{};
+    };
+}
+
+#endif
@@ -18,6 +18,7 @@
 #include <evmc/hex.hpp>
 #include <evmone/evmone.h>
 #include <future>
+#include <mutex>
 
 namespace cbdc::parsec::agent::runner {
     evm_host::evm_host(std::shared_ptr<logging::log> log,
@@ -25,13 +26,15 @@ namespace cbdc::parsec::agent::runner {
                        evmc_tx_context tx_context,
                        evm_tx tx,
                        bool is_readonly_run,
-                       interface::ticket_number_type ticket_number)
+                       interface::ticket_number_type ticket_number,
+                       std::shared_ptr<code_cache> cache)
         : m_log(std::move(log)),
           m_try_lock_callback(std::move(try_lock_callback)),
           m_tx_context(tx_context),
           m_tx(std::move(tx)),
           m_is_readonly_run(is_readonly_run),
-          m_ticket_number(ticket_number) {
+          m_ticket_number(ticket_number),
+          m_code_cache(std::move(cache)) {
         m_receipt.m_tx = m_tx;
         m_receipt.m_ticket_number = m_ticket_number;
     }
@@ -52,6 +55,9 @@ namespace cbdc::parsec::agent::runner {
 
         auto it = m_accounts.find(addr);
         if(it != m_accounts.end() && (it->second.second || !write)) {
+            // The account may have been prefetched, so this may be its
+            // first access.
+            m_accessed_addresses.insert(addr);
             return it->second.first;
         }
 
@@ -68,12 +74,18 @@ namespace cbdc::parsec::agent::runner {
         }
 
         m_accessed_addresses.insert(addr);
-        auto& v = maybe_v.value();
-        if(v.size() == 0) {
+        return cache_account(addr, maybe_v.value(), write);
+    }
+
+    auto evm_host::cache_account(const evmc::address& addr,
+                                 const broker::value_type& value,
+                                 bool write) const
+        -> std::optional<evm_account> {
+        if(value.size() == 0) {
             m_accounts[addr] = {std::nullopt, write};
             return std::nullopt;
         }
-        auto maybe_acc = from_buffer<evm_account>(v);
+        auto maybe_acc = from_buffer<evm_account>(value);
         assert(maybe_acc.has_value());
         auto& acc = maybe_acc.value();
         m_accounts[addr] = {acc, write};
@@ -573,6 +585,129 @@ namespace cbdc::parsec::agent::runner {
         m_accounts[to] = {to_acc, !m_is_readonly_run};
     }
 
+    auto evm_host::prefetch_keys() const -> std::vector<prefetch_key> {
+        auto keys = std::vector<prefetch_key>();
+        if(m_tx.m_to.has_value() && !is_precompile(m_tx.m_to.value())) {
+            const auto& to = m_tx.m_to.value();
+            if(!evmc::is_zero(m_tx.m_value)
+               && m_accounts.find(to) == m_accounts.end()) {
+                keys.push_back({prefetch_kind::account,
+                                to,
+                                {},
+                                !m_is_readonly_run});
+            }
+            if(m_account_code.find(to) == m_account_code.end()
+               && !get_shared_code(to)) {
+                keys.push_back({prefetch_kind::code, to, {}, false});
+            }
+        }
+
+        auto slots = std::set<std::pair<evmc::address, evmc::bytes32>>();
+        for(const auto& entry : m_tx.m_access_list) {
+            if(is_precompile(entry.m_address)) {
+                continue;
+            }
+            for(const auto& slot : entry.m_storage_keys) {
+                if(!slots.emplace(entry.m_address, slot).second) {
+                    continue;
+                }
+                keys.push_back({prefetch_kind::storage,
+                                entry.m_address,
+                                slot,
+                                !m_is_readonly_run});
+            }
+        }
+        return keys;
+    }
+
+    void evm_host::cache_prefetched(const prefetch_key& key,
+                                    const broker::value_type& value) {
+        switch(key.m_kind) {
+            case prefetch_kind::account:
+                cache_account(key.m_addr, value, key.m_write);
+                break;
+            case prefetch_kind::code:
+                share_code(make_buffer(code_key{key.m_addr}),
+                           value,
+                           key.m_write);
+                cache_code(key.m_addr, value, key.m_write);
+                break;
+            case prefetch_kind::storage:
+                cache_storage(key.m_addr, key.m_slot, value, key.m_write);
+                break;
+        }
+    }
+
+    void evm_host::prefetch(const std::function<void()>& callback) {
+        auto keys = prefetch_keys();
+        if(keys.empty()) {
+            callback();
+            return;
+        }
+
+        m_log->trace(m_ticket_number, "prefetching", keys.size(), "keys");
+
+        // Lock results may arrive concurrently, so they update the cache
+        // under a mutex until the last one calls the callback.
+        struct prefetch_state {
+            std::mutex m_mut;
+            size_t m_pending{};
+        };
+        auto state = std::make_shared<prefetch_state>();
+        state->m_pending = keys.size();
+        for(size_t i = 0; i < keys.size(); i++) {
+            const auto& key = keys[i];
+            auto buf = cbdc::buffer();
+            switch(key.m_kind) {
+                case prefetch_kind::account:
+                    buf = make_buffer(key.m_addr);
+                    break;
+                case prefetch_kind::code:
+                    buf = make_buffer(code_key{key.m_addr});
+                    break;
+                case prefetch_kind::storage:
+                    buf = make_buffer(storage_key{key.m_addr, key.m_slot});
+                    break;
+            }
+            auto sent = m_try_lock_callback(
+                std::move(buf),
+                key.m_write ? broker::lock_type::write
+                            : broker::lock_type::read,
+                [this, state, key, callback](
+                    const broker::interface::try_lock_return_type& res) {
+                    {
+                        std::unique_lock l(state->m_mut);
+                        if(std::holds_alternative<broker::value_type>(res)) {
+                            cache_prefetched(
+                                key,
+                                std::get<broker::value_type>(res));
+                        } else {
+                            m_retry = true;
+                        }
+                        if(--state->m_pending != 0) {
+                            return;
+                        }
+                    }
+                    callback();
+                });
+            if(!sent) {
+                m_log->trace(m_ticket_number,
+                             "failed to make prefetch request, retrying");
+                auto done = [&]() {
+                    std::unique_lock l(state->m_mut);
+                    m_retry = true;
+                    // Requests which were not sent will never complete
+                    state->m_pending -= keys.size() - i;
+                    return state->m_pending == 0;
+                }();
+                if(done) {
+                    callback();
+                }
+                return;
+            }
+        }
+    }
+
     void evm_host::finalize(int64_t gas_left, int64_t gas_used) {
         if(!m_is_readonly_run) {
             auto maybe_acc = get_account(m_tx_context.tx_origin, true);
@@ -625,6 +760,7 @@ namespace cbdc::parsec::agent::runner {
             auto& m = it->second;
             auto itt = m.find(key);
             if(itt != m.end() && (itt->second.second || !write)) {
+                m_accessed_addresses.insert(addr);
                 return itt->second.first;
             }
         }
@@ -636,12 +772,19 @@ namespace cbdc::parsec::agent::runner {
         }
 
         m_accessed_addresses.insert(addr);
-        auto& v = maybe_v.value();
-        if(v.size() == 0) {
+        return cache_storage(addr, key, maybe_v.value(), write);
+    }
+
+    auto evm_host::cache_storage(const evmc::address& addr,
+                                 const evmc::bytes32& key,
+                                 const broker::value_type& value,
+                                 bool write) const
+        -> std::optional<evmc::bytes32> {
+        if(value.size() == 0) {
             m_account_storage[addr][key] = {std::nullopt, write};
             return std::nullopt;
         }
-        auto maybe_data = from_buffer<evmc::bytes32>(v);
+        auto maybe_data = from_buffer<evmc::bytes32>(value);
         assert(maybe_data.has_value());
         auto& data = maybe_data.value();
         m_account_storage[addr][key] = {data, write};
@@ -661,9 +804,15 @@ namespace cbdc::parsec::agent::runner {
 
         auto it = m_account_code.find(addr);
         if(it != m_account_code.end() && (it->second.second || !write)) {
+            m_accessed_addresses.insert(addr);
             return it->second.first;
         }
 
+        if(!write && get_shared_code(addr)) {
+            m_accessed_addresses.insert(addr);
+            return m_account_code[addr].first;
+        }
+
         auto elem_key = make_buffer(code_key{addr});
         auto maybe_v = get_key(elem_key, write);
         if(!maybe_v.has_value()) {
@@ -671,12 +820,44 @@ namespace cbdc::parsec::agent::runner {
         }
 
         m_accessed_addresses.insert(addr);
-        auto& v = maybe_v.value();
-        if(v.size() == 0) {
+        share_code(elem_key, maybe_v.value(), write);
+        return cache_code(addr, maybe_v.value(), write);
+    }
+
+    auto evm_host::get_shared_code(const evmc::address& addr) const -> bool {
+        if(!m_code_cache) {
+            return false;
+        }
+        auto maybe_v = m_code_cache->get(make_buffer(code_key{addr}));
+        if(!maybe_v.has_value()) {
+            return false;
+        }
+        cache_code(addr, maybe_v.value(), false);
+        return true;
+    }
+
+    void evm_host::share_code(const cbdc::buffer& key,
+                              const broker::value_type& value,
+                              bool write) const {
+        if(!m_code_cache) {
+            return;
+        }
+        if(write) {
+            m_code_cache->invalidate(key, m_ticket_number);
+            return;
+        }
+        m_code_cache->put(key, value, m_ticket_number);
+    }
+
+    auto evm_host::cache_code(const evmc::address& addr,
+                              const broker::value_type& value,
+                              bool write) const
+        -> std::optional<evm_account_code> {
+        if(value.size() == 0) {
             m_account_code[addr] = {std::nullopt, write};
             return std::nullopt;
         }
-        auto maybe_code = from_buffer<evm_account_code>(v);
+        auto maybe_code = from_buffer<evm_account_code>(value);
         assert(maybe_code.has_value());
         auto& code = maybe_code.value();
         m_account_code[addr] = {code, write};
@@ -6,6 +6,7 @@
 #ifndef OPENCBDC_TX_SRC_PARSEC_AGENT_EVM_HOST_H_
 #define OPENCBDC_TX_SRC_PARSEC_AGENT_EVM_HOST_H_
 
+#include "parsec/agent/runners/evm/code_cache.hpp"
 #include "parsec/agent/runners/evm/messages.hpp"
 #include "parsec/agent/runners/interface.hpp"
 #include "util/serialization/util.hpp"
@@ -31,12 +32,15 @@ namespace cbdc::parsec::agent::runner {
         /// \param tx transaction to execute.
         /// \param is_readonly_run true if no state changes should be applied.
         /// \param ticket_number ticket number for transaction.
+        /// \param cache contract code shared with other hosts, or nullptr
+        ///              to always fetch code from the shards.
         evm_host(std::shared_ptr<logging::log> log,
                  interface::try_lock_callback_type try_lock_callback,
                  evmc_tx_context tx_context,
                  evm_tx tx,
                  bool is_readonly_run,
-                 interface::ticket_number_type ticket_number);
+                 interface::ticket_number_type ticket_number,
+                 std::shared_ptr<code_cache> cache);
 
         [[nodiscard]] auto
         account_exists(const evmc::address& addr) const noexcept
@@ -124,6 +128,19 @@ namespace cbdc::parsec::agent::runner {
         /// \param acc account metadata.
         void insert_account(const evmc::address& addr, const evm_account& acc);
 
+        /// Requests locks on the state the transaction is known to access
+        /// before executing it, all at once, and caches the results so
+        /// that execution only waits for keys it could not predict. The
+        /// known state is the recipient's code, the recipient's account if
+        /// the transaction transfers value, and the storage slots in the
+        /// transaction's access list. Slots are write-locked unless this
+        /// is a read-only run, as a later upgrade from a read lock would
+        /// cost another round trip. Marks the transaction for retry if
+        /// any lock could not be acquired.
+        /// \param callback function to call once every request has
+        ///                 completed.
+        void prefetch(const std::function<void()>& callback);
+
         /// Finalizes the state updates resulting from the transaction.
         /// \param gas_left remaining unspent gas.
         /// \param gas_used total gas consumed by the transaction.
@@ -179,6 +196,58 @@ namespace cbdc::parsec::agent::runner {
 
         interface::ticket_number_type m_ticket_number;
 
+        std::shared_ptr<code_cache> m_code_cache;
+
+        /// Kinds of state fetched by \ref prefetch.
+        enum class prefetch_kind : uint8_t {
+            account,
+            code,
+            storage
+        };
+
+        /// State to fetch before execution.
+        struct prefetch_key {
+            prefetch_kind m_kind{};
+            evmc::address m_addr{};
+            /// Storage slot, if m_kind is storage.
+            evmc::bytes32 m_slot{};
+            bool m_write{};
+        };
+
+        /// Returns the state the transaction is known to access which is
+        /// not already cached. Caches any of it shared by other hosts.
+        [[nodiscard]] auto prefetch_keys() const -> std::vector<prefetch_key>;
+
+        /// Caches a value fetched by \ref prefetch.
+        void cache_prefetched(const prefetch_key& key,
+                              const broker::value_type& value);
+
+        /// Caches the account metadata stored at an account key.
+        auto cache_account(const evmc::address& addr,
+                           const broker::value_type& value,
+                           bool write) const -> std::optional<evm_account>;
+
+        /// Caches the value stored at a storage key.
+        auto cache_storage(const evmc::address& addr,
+                           const evmc::bytes32& key,
+                           const broker::value_type& value,
+                           bool write) const -> std::optional<evmc::bytes32>;
+
+        /// Caches the contract code shared by other hosts, if any.
+        /// \return true if the code was shared.
+        auto get_shared_code(const evmc::address& addr) const -> bool;
+
+        /// Shares contract code read from the shards with other hosts, or
+        /// stops sharing it if this host may write it.
+        void share_code(const cbdc::buffer& key,
+                        const broker::value_type& value,
+                        bool write) const;
+
+        /// Caches the contract code stored at a code key.
+        auto cache_code(const evmc::address& addr,
+                        const broker::value_type& value,
+                        bool write) const -> std::optional<evm_account_code>;
+
         [[nodiscard]] auto get_account(const evmc::address& addr,
                                        bool write) const
             -> std::optional<evm_account>;
@@ -6,6 +6,7 @@
 #include "http_server.hpp"
 
 #include "impl.hpp"
+#include "parsec/agent/conflict_graph.hpp"
 #include "parsec/agent/runners/evm/format.hpp"
 #include "parsec/agent/runners/evm/hash.hpp"
 #include "parsec/agent/runners/evm/impl.hpp"
@@ -15,6 +16,8 @@
 #include "util/common/hash.hpp"
 #include "util/serialization/format.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <future>
 
 using namespace cbdc::parsec::agent::runner;
@@ -26,17 +29,34 @@ namespace cbdc::parsec::agent::rpc {
                              const cbdc::parsec::config& cfg)
         : server_interface(std::move(broker), std::move(log), cfg),
           m_srv(std::move(srv)) {
+        if(m_cfg.m_evm_code_cache_size > 0) {
+            m_code_cache = std::make_shared<runner::code_cache>(
+                m_cfg.m_evm_code_cache_size);
+        }
         m_srv->register_handler_callback(
             [&](const std::string& method,
                 const Json::Value& params,
                 const server_type::result_callback_type& callback) {
                 return request_handler(method, params, callback);
             });
+        if(m_cfg.m_evm_batch_size > 0) {
+            m_batch_thread = std::thread([&]() {
+                run_batches();
+            });
+        }
     }
 
     http_server::~http_server() {
         m_log->trace("Agent server shutting down...");
         m_srv.reset();
+        {
+            std::unique_lock l(m_batch_mut);
+            m_batch_stop = true;
+        }
+        m_batch_cv.notify_all();
+        if(m_batch_thread.joinable()) {
+            m_batch_thread.join();
+        }
         m_log->trace("Shut down agent server");
     }
 
@@ -292,17 +312,31 @@ namespace cbdc::parsec::agent::rpc {
         }
         auto& tx = maybe_tx.value();
         auto runner_params = make_buffer(*tx);
+        res_cb = [callback, tx](const interface::exec_return_type&) {
+            auto txid = cbdc::make_buffer(tx_id(*tx));
+            auto ret = Json::Value();
+            ret["result"] = "0x" + txid.to_hex();
+            callback(ret);
+        };
+
+        if(m_cfg.m_evm_batch_size > 0) {
+            auto result_cb
+                = [callback, res_cb](const interface::exec_return_type& res) {
+                      handle_exec_result(callback, res_cb, res);
+                  };
+            {
+                std::unique_lock l(m_batch_mut);
+                m_pending.push_back({std::move(runner_params), result_cb});
+            }
+            m_batch_cv.notify_one();
+            return true;
+        }
 
         return exec_tx(callback,
                        runner::evm_runner_function::execute_transaction,
                        runner_params,
                        false,
-                       [callback, tx](const interface::exec_return_type&) {
-                           auto txid = cbdc::make_buffer(tx_id(*tx));
-                           auto ret = Json::Value();
-                           ret["result"] = "0x" + txid.to_hex();
-                           callback(ret);
-                       });
+                       res_cb);
     }
 
     auto http_server::handle_fee_history(
@@ -1392,31 +1426,55 @@ namespace cbdc::parsec::agent::rpc {
         bool is_readonly_run,
         const std::function<void(interface::exec_return_type)>& res_success_cb)
         -> bool {
+        return exec_agent(
+            f_type,
+            runner_params,
+            is_readonly_run,
+            [json_ret_callback,
+             res_success_cb](const interface::exec_return_type& res) {
+                handle_exec_result(json_ret_callback, res_success_cb, res);
+            });
+    }
+
+    void http_server::handle_exec_result(
+        const server_type::result_callback_type& json_ret_callback,
+        const std::function<void(interface::exec_return_type)>&
+            res_success_cb,
+        const interface::exec_return_type& res) {
+        if(std::holds_alternative<return_type>(res)) {
+            res_success_cb(res);
+            return;
+        }
+        const auto ec = std::get<interface::error_code>(res);
+        auto ret = Json::Value();
+        ret["error"] = Json::Value();
+        ret["error"]["code"]
+            = error_code::execution_error - static_cast<int>(ec);
+        ret["error"]["message"] = "Execution error";
+        json_ret_callback(ret);
+    }
+
+    auto http_server::exec_agent(
+        runner::evm_runner_function f_type,
+        const cbdc::buffer& runner_params,
+        bool is_readonly_run,
+        const std::function<void(interface::exec_return_type)>& res_cb)
+        -> bool {
         auto function = cbdc::buffer();
         function.append(&f_type, sizeof(f_type));
         auto id = m_next_id++;
 
         const auto res_cb_for_agent =
-            [this, id, res_success_cb, json_ret_callback](
-                interface::exec_return_type res) {
+            [this, id, res_cb](interface::exec_return_type res) {
                 const auto success = std::holds_alternative<return_type>(res);
                 if(success) {
-                    res_success_cb(res);
+                    res_cb(res);
                     m_cleanup_queue.push(id);
+                } else if(std::get<interface::error_code>(res)
+                          == interface::error_code::retry) {
+                    m_retry_queue.push(id);
                 } else {
-                    // Handle error:
-                    const auto ec = std::get<interface::error_code>(res);
-
-                    if(ec == interface::error_code::retry) {
-                        m_retry_queue.push(id);
-                    } else {
-                        auto ret = Json::Value();
-                        ret["error"] = Json::Value();
-                        ret["error"]["code"] = error_code::execution_error
-                                             - static_cast<int>(ec);
-                        ret["error"]["message"] = "Execution error";
-                        json_ret_callback(ret);
-                    }
+                    res_cb(res);
                 }
             };
 
@@ -1424,7 +1482,11 @@ namespace cbdc::parsec::agent::rpc {
             auto agent = std::make_shared<impl>(
                 m_log,
                 m_cfg,
-                &runner::factory<runner::evm_runner>::create,
+                [cache = m_code_cache](auto&&... args) {
+                    return std::make_unique<runner::evm_runner>(
+                        std::forward<decltype(args)>(args)...,
+                        cache);
+                },
                 m_broker,
                 function,
                 runner_params,
@@ -1441,4 +1503,216 @@ namespace cbdc::parsec::agent::rpc {
         }();
         return a->exec();
     }
+
+    void http_server::run_batches() {
+        auto batch = std::shared_ptr<batch_state>();
+        while(true) {
+            if(!batch) {
+                {
+                    std::unique_lock l(m_batch_mut);
+                    m_batch_cv.wait(l, [&]() {
+                        return m_batch_stop || !m_pending.empty();
+                    });
+                    if(m_batch_stop) {
+                        return;
+                    }
+                    batch = take_batch();
+                }
+                speculate(batch);
+            }
+            batch = exec_batch(batch);
+        }
+    }
+
+    auto http_server::take_batch() -> std::shared_ptr<batch_state> {
+        auto batch = std::make_shared<batch_state>();
+        auto n = std::min(m_pending.size(), m_cfg.m_evm_batch_size);
+        auto end = m_pending.begin() + static_cast<std::ptrdiff_t>(n);
+        batch->m_txs.assign(std::make_move_iterator(m_pending.begin()),
+                            std::make_move_iterator(end));
+        m_pending.erase(m_pending.begin(), end);
+        batch->m_accesses.resize(n);
+        return batch;
+    }
+
+    void http_server::speculate(const std::shared_ptr<batch_state>& batch) {
+        // Speculate on every transaction in parallel, using only read
+        // locks, to find the keys each one accesses
+        for(size_t i = 0; i < batch->m_txs.size(); i++) {
+            auto sent = exec_agent(
+                runner::evm_runner_function::speculate_transaction,
+                batch->m_txs[i].m_params,
+                true,
+                [this, batch, i](const interface::exec_return_type& res) {
+                    auto accesses = decode_accesses(res);
+                    {
+                        std::unique_lock l(m_batch_mut);
+                        batch->m_accesses[i] = std::move(accesses);
+                        batch->m_speculated++;
+                    }
+                    m_batch_cv.notify_all();
+                });
+            if(!sent) {
+                std::unique_lock l(m_batch_mut);
+                batch->m_speculated++;
+            }
+        }
+    }
+
+    auto http_server::exec_batch(const std::shared_ptr<batch_state>& batch)
+        -> std::shared_ptr<batch_state> {
+        const auto n = batch->m_txs.size();
+        const auto timeout
+            = std::chrono::milliseconds(m_cfg.m_evm_batch_timeout);
+        auto graph = conflict_graph();
+        auto dependents = std::vector<std::vector<size_t>>(n);
+        auto waiting = std::vector<size_t>(n);
+        {
+            std::unique_lock l(m_batch_mut);
+            auto speculated = m_batch_cv.wait_for(l, timeout, [&]() {
+                return m_batch_stop || batch->m_speculated == n;
+            });
+            if(m_batch_stop) {
+                return nullptr;
+            }
+            if(!speculated) {
+                // Transactions whose speculative runs have not completed
+                // have unknown accesses, so they run on their own
+                m_log->warn("Speculative runs of batch timed out,",
+                            n - batch->m_speculated,
+                            "of",
+                            n,
+                            "incomplete");
+            }
+            for(size_t i = 0; i < n; i++) {
+                auto deps = graph.add(batch->m_accesses[i]);
+                waiting[i] = deps.size();
+                for(auto dep : deps) {
+                    dependents[dep].push_back(i);
+                }
+            }
+        }
+
+        m_log->debug("Executing batch of",
+                     n,
+                     "transactions,",
+                     std::count_if(waiting.begin(),
+                                   waiting.end(),
+                                   [](size_t w) {
+                                       return w > 0;
+                                   }),
+                     "wait for conflicting transactions");
+
+        // Execute each transaction once every earlier transaction it
+        // conflicts with has finished, so conflicting transactions run in
+        // batch order instead of wounding each other
+        auto execute = [&](size_t i) {
+            auto sent = exec_agent(
+                runner::evm_runner_function::execute_transaction,
+                batch->m_txs[i].m_params,
+                false,
+                [this, batch, i, cb = batch->m_txs[i].m_result_callback](
+                    const interface::exec_return_type& res) {
+                    cb(res);
+                    {
+                        std::unique_lock l(m_batch_mut);
+                        batch->m_finished.push_back(i);
+                    }
+                    m_batch_cv.notify_all();
+                });
+            if(!sent) {
+                std::unique_lock l(m_batch_mut);
+                batch->m_finished.push_back(i);
+            }
+        };
+        for(size_t i = 0; i < n; i++) {
+            if(waiting[i] == 0) {
+                execute(i);
+            }
+        }
+
+        // While this batch executes, start speculating on the next one so
+        // its schedule is ready when this batch finishes. Its speculative
+        // runs take only read locks, so at worst they wound and delay a
+        // transaction of this batch.
+        auto next = std::shared_ptr<batch_state>();
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        size_t n_finished{0};
+        while(n_finished < n) {
+            auto finished = std::vector<size_t>();
+            auto speculate_next = false;
+            {
+                std::unique_lock l(m_batch_mut);
+                auto progress = m_batch_cv.wait_until(l, deadline, [&]() {
+                    return m_batch_stop || !batch->m_finished.empty()
+                        || (!next && !m_pending.empty());
+                });
+                if(m_batch_stop) {
+                    return nullptr;
+                }
+                if(!progress) {
+                    break;
+                }
+                if(!next && !m_pending.empty()) {
+                    next = take_batch();
+                    speculate_next = true;
+                }
+                finished.swap(batch->m_finished);
+            }
+            if(speculate_next) {
+                speculate(next);
+            }
+            if(!finished.empty()) {
+                deadline = std::chrono::steady_clock::now() + timeout;
+            }
+            n_finished += finished.size();
+            for(auto i : finished) {
+                for(auto dep : dependents[i]) {
+                    if(--waiting[dep] == 0) {
+                        execute(dep);
+                    }
+                }
+            }
+        }
+
+        if(n_finished < n) {
+            // A transaction has not finished in time, so stop ordering the
+            // rest of the batch. Transactions still waiting execute now and
+            // may wound each other, but do not hold up later batches.
+            auto n_waiting = std::count_if(waiting.begin(),
+                                           waiting.end(),
+                                           [](size_t w) {
+                                               return w > 0;
+                                           });
+            m_log->warn("Batch execution timed out,",
+                        n - n_finished,
+                        "transactions unfinished,",
+                        n_waiting,
+                        "executing without ordering");
+            for(size_t i = 0; i < n; i++) {
+                if(waiting[i] > 0) {
+                    waiting[i] = 0;
+                    execute(i);
+                }
+            }
+        }
+
+        return next;
+    }
+
+    auto http_server::decode_accesses(const interface::exec_return_type& res)
+        -> std::optional<broker::held_locks_set_type> {
+        if(!std::holds_alternative<return_type>(res)) {
+            return std::nullopt;
+        }
+        auto ret = broker::held_locks_set_type();
+        for(const auto& [key, value] : std::get<return_type>(res)) {
+            auto maybe_locktype = from_buffer<broker::lock_type>(value);
+            if(!maybe_locktype.has_value()) {
+                return std::nullopt;
+            }
+            ret[key] = maybe_locktype.value();
+        }
+        return ret;
+    }
 }
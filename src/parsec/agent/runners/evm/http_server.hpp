@@ -17,6 +17,7 @@
 #include "util/rpc/http/json_rpc_http_server.hpp"
 
 #include <atomic>
+#include <condition_variable>
 #include <secp256k1.h>
 #include <thread>
 
@@ -40,7 +41,7 @@ namespace cbdc::parsec::agent::rpc {
                     const cbdc::parsec::config& cfg);
 
         /// Stops listening for incoming connections, waits for existing
-        /// connections to drain.
+        /// connections to drain. Stops scheduling batches.
         ~http_server() override;
 
         /// Starts listening for incoming connections and processing requests.
@@ -55,6 +56,37 @@ namespace cbdc::parsec::agent::rpc {
       private:
         std::unique_ptr<server_type> m_srv;
 
+        /// Contract code shared by the runners of this server.
+        std::shared_ptr<runner::code_cache> m_code_cache;
+
+        /// Raw transaction waiting to be executed in a batch.
+        struct pending_tx {
+            /// Serialized transaction.
+            cbdc::buffer m_params;
+            /// Function to call with the execution result.
+            std::function<void(interface::exec_return_type)> m_result_callback;
+        };
+
+        /// Batch of transactions and the progress of its execution.
+        struct batch_state {
+            /// Transactions in batch order.
+            std::vector<pending_tx> m_txs;
+            /// Keys accessed by each transaction's speculative run, if
+            /// known.
+            std::vector<std::optional<broker::held_locks_set_type>>
+                m_accesses;
+            /// Number of completed speculative runs.
+            size_t m_speculated{};
+            /// Transactions which finished executing since last checked.
+            std::vector<size_t> m_finished;
+        };
+
+        std::mutex m_batch_mut;
+        std::condition_variable m_batch_cv;
+        std::vector<pending_tx> m_pending;
+        bool m_batch_stop{false};
+        std::thread m_batch_thread;
+
         enum error_code : int {
             wallet_not_supported = -32001,
             mining_not_supported = -32002,
@@ -200,6 +232,38 @@ namespace cbdc::parsec::agent::rpc {
                                                   cbdc::buffer)>& res_cb)
             -> bool;
 
+        auto exec_agent(
+            runner::evm_runner_function f_type,
+            const cbdc::buffer& runner_params,
+            bool is_readonly_run,
+            const std::function<void(interface::exec_return_type)>& res_cb)
+            -> bool;
+
+        static void handle_exec_result(
+            const server_type::result_callback_type& json_ret_callback,
+            const std::function<void(interface::exec_return_type)>&
+                res_success_cb,
+            const interface::exec_return_type& res);
+
+        void run_batches();
+
+        /// Takes the next batch from the pending transactions. Must be
+        /// called with m_batch_mut held.
+        auto take_batch() -> std::shared_ptr<batch_state>;
+
+        /// Starts the speculative runs of a batch.
+        void speculate(const std::shared_ptr<batch_state>& batch);
+
+        /// Executes a batch once its speculative runs complete. Starts the
+        /// speculative runs of the next batch while this one executes.
+        /// \return next batch, or nullptr if no transactions arrived
+        ///         during execution or the server is stopping.
+        auto exec_batch(const std::shared_ptr<batch_state>& batch)
+            -> std::shared_ptr<batch_state>;
+
+        static auto decode_accesses(const interface::exec_return_type& res)
+            -> std::optional<broker::held_locks_set_type>;
+
         auto
         exec_tx(const server_type::result_callback_type& json_ret_callback,
                 runner::evm_runner_function f_type,
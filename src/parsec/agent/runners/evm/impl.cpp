@@ -26,7 +26,8 @@ namespace cbdc::parsec::agent::runner {
                            try_lock_callback_type try_lock_callback,
                            std::shared_ptr<secp256k1_context> secp,
                            std::shared_ptr<thread_pool> t_pool,
-                           ticket_number_type ticket_number)
+                           ticket_number_type ticket_number,
+                           std::shared_ptr<code_cache> cache)
         : interface(std::move(logger),
                     cfg,
                     std::move(function),
@@ -36,7 +37,8 @@ namespace cbdc::parsec::agent::runner {
                     std::move(try_lock_callback),
                     std::move(secp),
                     std::move(t_pool),
-                    ticket_number) {}
+                    ticket_number),
+          m_code_cache(std::move(cache)) {}
 
     evm_runner::~evm_runner() {
         for(auto& t : m_evm_threads) {
@@ -57,8 +59,8 @@ namespace cbdc::parsec::agent::runner {
         static constexpr uint8_t invalid_function = 255;
         uint8_t f = invalid_function;
         std::memcpy(&f, m_function.data(), sizeof(uint8_t));
-        if(f
-           > static_cast<uint8_t>(evm_runner_function::read_account_storage)) {
+        if(f > static_cast<uint8_t>(
+               evm_runner_function::speculate_transaction)) {
             m_log->error("Unknown EVM runner function ", f);
             m_result_callback(error_code::function_load);
             return;
@@ -97,6 +99,9 @@ namespace cbdc::parsec::agent::runner {
                 success = run_get_account(); // m_param contains the right key
                                              // already
                 break;
+            case evm_runner_function::speculate_transaction:
+                success = run_speculate_transaction();
+                break;
             default:
                 m_result_callback(error_code::function_load);
                 break;
@@ -444,6 +449,47 @@ namespace cbdc::parsec::agent::runner {
         return run_execute_transaction(dryrun_tx.m_from, true);
     }
 
+    auto evm_runner::run_speculate_transaction() -> bool {
+        auto maybe_tx = cbdc::from_buffer<evm_tx>(m_param);
+        if(!maybe_tx.has_value()) {
+            m_log->error("Unable to deserialize transaction");
+            m_result_callback(error_code::function_load);
+            return true;
+        }
+        m_tx = std::move(maybe_tx.value());
+
+        auto maybe_from = check_signature(m_tx, m_secp);
+        if(!maybe_from.has_value()) {
+            m_log->error("Transaction signature is invalid");
+            m_result_callback(error_code::exec_error);
+            return true;
+        }
+        auto from = maybe_from.value();
+
+        // Execute as a normal transaction so that the host requests the
+        // locks a normal execution would, but record them and only take
+        // read locks.
+        m_speculative = true;
+        m_try_lock_callback
+            = [this, try_lock = std::move(m_try_lock_callback)](
+                  broker::key_type key,
+                  broker::lock_type locktype,
+                  broker::interface::try_lock_callback_type res_cb) {
+                  {
+                      std::unique_lock l(m_accesses_mut);
+                      auto it = m_accesses.find(key);
+                      if(it == m_accesses.end()
+                         || it->second == broker::lock_type::read) {
+                          m_accesses[key] = locktype;
+                      }
+                  }
+                  return try_lock(std::move(key),
+                                  broker::lock_type::read,
+                                  std::move(res_cb));
+              };
+        return run_execute_transaction(from, false);
+    }
+
     auto evm_runner::check_base_gas(const evm_tx& evmtx, bool is_readonly_run)
         -> std::pair<evmc::uint256be, bool> {
         constexpr auto base_gas = evmc::uint256be(21000);
@@ -528,7 +574,8 @@ namespace cbdc::parsec::agent::runner {
                                             tx_ctx,
                                             m_tx,
                                             is_readonly_run,
-                                            m_ticket_number);
+                                            m_ticket_number,
+                                            m_code_cache);
 
         auto [msg, enough_gas] = make_message(from, m_tx, is_readonly_run);
         if(!enough_gas) {
@@ -558,7 +605,7 @@ namespace cbdc::parsec::agent::runner {
                 return false;
             }
         } else {
-            schedule_exec();
+            prefetch_and_exec();
         }
 
         return true;
@@ -585,6 +632,18 @@ namespace cbdc::parsec::agent::runner {
             m_log->trace("EVM output data:", out_buf.to_hex());
 
             m_log->trace("Result status: ", result.status_code);
+            if(m_speculative) {
+                auto ret = runtime_locking_shard::state_update_type();
+                {
+                    std::unique_lock l(m_accesses_mut);
+                    for(auto& [key, locktype] : m_accesses) {
+                        ret[key] = make_buffer(locktype);
+                    }
+                }
+                m_result_callback(ret);
+                return;
+            }
+
             auto fn = [this, gas_left = result.gas_left]() {
                 auto gas_used = m_msg.gas - gas_left;
                 m_host->finalize(gas_left, gas_used);
@@ -704,7 +763,7 @@ namespace cbdc::parsec::agent::runner {
                     return;
                 }
                 m_log->trace(m_ticket_number, "locked ticket_number key");
-                schedule_exec();
+                prefetch_and_exec();
             });
         if(!maybe_sent) {
             m_log->error(
@@ -720,6 +779,21 @@ namespace cbdc::parsec::agent::runner {
         schedule(fn);
     }
 
+    void evm_runner::prefetch_and_exec() {
+        if(!m_cfg.m_evm_prefetch) {
+            schedule_exec();
+            return;
+        }
+        m_host->prefetch([this]() {
+            if(m_host->should_retry()) {
+                m_log->debug("Failed to prefetch state");
+                m_result_callback(error_code::wounded);
+                return;
+            }
+            schedule_exec();
+        });
+    }
+
     void evm_runner::schedule(const std::function<void()>& fn) {
         if(m_threads) {
             m_threads->push(fn);
@@ -11,6 +11,7 @@
 #include "parsec/util.hpp"
 
 #include <evmc/evmc.h>
+#include <mutex>
 #include <secp256k1.h>
 #include <thread>
 
@@ -41,12 +42,18 @@ namespace cbdc::parsec::agent::runner {
         get_logs,
         /// Read a specific key of an account's storage
         read_account_storage,
+        /// Execute a transaction taking only read locks and without applying
+        /// any changes, and return the keys it would lock. Maps each key to
+        /// the serialized type of lock a normal execution would take.
+        speculate_transaction,
     };
 
     /// Executes EVM transactions, implementing the runner interface.
     class evm_runner : public interface {
       public:
         /// \copydoc interface::interface
+        /// \param cache contract code shared between runners, or nullptr
+        ///              to always fetch code from the shards.
         evm_runner(std::shared_ptr<logging::log> logger,
                    const cbdc::parsec::config& cfg,
                    runtime_locking_shard::value_type function,
@@ -56,7 +63,8 @@ namespace cbdc::parsec::agent::runner {
                    try_lock_callback_type try_lock_callback,
                    std::shared_ptr<secp256k1_context> secp,
                    std::shared_ptr<thread_pool> t_pool,
-                   ticket_number_type ticket_number);
+                   ticket_number_type ticket_number,
+                   std::shared_ptr<code_cache> cache = nullptr);
 
         /// Blocks until the transaction has completed and all processing
         /// threads have ended.
@@ -80,12 +88,20 @@ namespace cbdc::parsec::agent::runner {
         std::vector<std::thread> m_evm_threads;
 
         std::unique_ptr<evm_host> m_host;
+        std::shared_ptr<code_cache> m_code_cache;
         evm_tx m_tx;
         evmc_message m_msg{};
 
+        /// Whether this is a speculative run.
+        bool m_speculative{false};
+        std::mutex m_accesses_mut;
+        /// Locks requested by a speculative run.
+        broker::held_locks_set_type m_accesses;
+
         void exec();
         auto run_execute_real_transaction() -> bool;
         auto run_execute_dryrun_transaction() -> bool;
+        auto run_speculate_transaction() -> bool;
         auto run_get_account_code() -> bool;
         auto run_get_transaction() -> bool;
         auto run_get_transaction_receipt() -> bool;
@@ -113,6 +129,7 @@ namespace cbdc::parsec::agent::runner {
         void lock_ticket_number_key();
         void lock_index_keys(const std::function<void()>& callback);
         void schedule_exec();
+        void prefetch_and_exec();
 
         void schedule(const std::function<void()>& fn);
 
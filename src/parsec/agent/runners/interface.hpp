@@ -121,7 +121,7 @@ namespace cbdc::parsec::agent::runner {
 
       private:
         std::shared_ptr<logging::log> m_log;
-        const cbdc::parsec::config& m_cfg;
+        const cbdc::parsec::config m_cfg;
         runtime_locking_shard::value_type m_function;
         parameter_type m_param;
         bool m_is_readonly_run;
@@ -42,11 +42,15 @@ namespace cbdc::parsec::agent::runner {
                     ticket_number) {}
 
     auto lua_runner::run() -> bool {
-        // TODO: use custom allocator to limit memory allocation
-        m_state
-            = std::shared_ptr<lua_State>(luaL_newstate(), [](lua_State* s) {
-                  lua_close(s);
-              });
+        // The state may be returned from another thread, so the deleter
+        // keeps the pool alive until then
+        auto pool = state_pool();
+        m_state = std::shared_ptr<lua_State>(pool->acquire(),
+                                             [pool](lua_State* s) {
+                                                 if(s != nullptr) {
+                                                     pool->release(s);
+                                                 }
+                                             });
 
         if(!m_state) {
             m_log->error("Failed to allocate new lua state");
@@ -54,26 +58,23 @@ namespace cbdc::parsec::agent::runner {
             return true;
         }
 
-        // TODO: provide custom environment limited only to safe library
-        //       methods
-        luaL_openlibs(m_state.get());
-
-        lua_register(m_state.get(), "check_sig", &lua_runner::check_sig);
+        // The thread stays on the stack of the state until the state is
+        // returned to the pool
+        m_thread = lua_newthread(m_state.get());
 
         static constexpr auto function_name = "contract";
 
-        auto load_ret = luaL_loadbufferx(m_state.get(),
-                                         m_function.c_str(),
-                                         m_function.size(),
-                                         function_name,
-                                         "b");
+        auto load_ret = lua_state_pool::load(m_state.get(),
+                                             m_function,
+                                             function_name);
         if(load_ret != LUA_OK) {
             m_log->error("Failed to load function chunk");
             m_result_callback(error_code::function_load);
             return true;
         }
+        lua_xmove(m_state.get(), m_thread, 1);
 
-        if(lua_pushlstring(m_state.get(), m_param.c_str(), m_param.size())
+        if(lua_pushlstring(m_thread, m_param.c_str(), m_param.size())
            == nullptr) {
             m_log->error("Failed to push function params");
             m_result_callback(error_code::internal_error);
@@ -92,7 +93,7 @@ namespace cbdc::parsec::agent::runner {
             return;
         }
 
-        if(lua_istable(m_state.get(), -1) != 1) {
+        if(lua_istable(m_thread, -1) != 1) {
             m_log->error("Contract did not return a table");
             m_result_callback(error_code::result_type);
             return;
@@ -100,8 +101,8 @@ namespace cbdc::parsec::agent::runner {
 
         auto results = runtime_locking_shard::state_update_type();
 
-        lua_pushnil(m_state.get());
-        while(lua_next(m_state.get(), -2) != 0) {
+        lua_pushnil(m_thread);
+        while(lua_next(m_thread, -2) != 0) {
             auto key_buf = get_stack_string(-2);
             if(!key_buf.has_value()) {
                 m_log->error("Result key is not a string");
@@ -118,7 +119,7 @@ namespace cbdc::parsec::agent::runner {
             results.emplace(std::move(key_buf.value()),
                             std::move(value_buf.value()));
 
-            lua_pop(m_state.get(), 1);
+            lua_pop(m_thread, 1);
         }
 
         m_log->trace(this, "running calling result callback");
@@ -127,11 +128,11 @@ namespace cbdc::parsec::agent::runner {
     }
 
     auto lua_runner::get_stack_string(int index) -> std::optional<buffer> {
-        if(lua_isstring(m_state.get(), index) != 1) {
+        if(lua_isstring(m_thread, index) != 1) {
             return std::nullopt;
         }
         size_t sz{};
-        const auto* str = lua_tolstring(m_state.get(), index, &sz);
+        const auto* str = lua_tolstring(m_thread, index, &sz);
         assert(str != nullptr);
         auto buf = buffer();
         buf.append(str, sz);
@@ -139,15 +140,15 @@ namespace cbdc::parsec::agent::runner {
     }
 
     auto lua_runner::get_stack_integer(int index) -> std::optional<int64_t> {
-        if(lua_isinteger(m_state.get(), index) != 1) {
+        if(lua_isinteger(m_thread, index) != 1) {
             return std::nullopt;
         }
-        return lua_tointeger(m_state.get(), index);
+        return lua_tointeger(m_thread, index);
     }
 
     void lua_runner::schedule_contract() {
         int n_results{};
-        auto resume_ret = lua_resume(m_state.get(), nullptr, 1, &n_results);
+        auto resume_ret = lua_resume(m_thread, nullptr, 1, &n_results);
         if(resume_ret == LUA_YIELD) {
             if(n_results > 2) {
                 m_log->error("Contract yielded more than two keys");
@@ -169,7 +170,7 @@ namespace cbdc::parsec::agent::runner {
                     m_result_callback(error_code::yield_type);
                     return;
                 }
-                lua_pop(m_state.get(), 1);
+                lua_pop(m_thread, 1);
 
                 lock_level = (lock_type.value() == 0)
                                ? broker::lock_type::read
@@ -183,7 +184,7 @@ namespace cbdc::parsec::agent::runner {
                 return;
             }
 
-            lua_pop(m_state.get(), 1);
+            lua_pop(m_thread, 1);
 
             auto success
                 = m_try_lock_callback(std::move(key_buf.value()),
@@ -196,7 +197,7 @@ namespace cbdc::parsec::agent::runner {
                 m_result_callback(error_code::internal_error);
             }
         } else if(resume_ret != LUA_OK) {
-            const auto* err = lua_tostring(m_state.get(), -1);
+            const auto* err = lua_tostring(m_thread, -1);
             m_log->error("Error running contract:", err);
             m_result_callback(error_code::exec_error);
         } else {
@@ -209,7 +210,7 @@ namespace cbdc::parsec::agent::runner {
         auto maybe_error = std::visit(
             overloaded{
                 [&](const broker::value_type& v) -> std::optional<error_code> {
-                    if(lua_pushlstring(m_state.get(), v.c_str(), v.size())
+                    if(lua_pushlstring(m_thread, v.c_str(), v.size())
                        == nullptr) {
                         m_log->error("Failed to push yield params");
                         return error_code::internal_error;
@@ -299,4 +300,13 @@ namespace cbdc::parsec::agent::runner {
 
         return 0;
     }
+
+    auto lua_runner::state_pool() -> std::shared_ptr<lua_state_pool> {
+        static auto pool = std::make_shared<lua_state_pool>(
+            [](lua_State* L) {
+                lua_register(L, "check_sig", &lua_runner::check_sig);
+            },
+            lua_state_pool::default_max_states);
+        return pool;
+    }
 }
@@ -7,6 +7,7 @@
 #define OPENCBDC_TX_SRC_PARSEC_AGENT_RUNNER_H_
 
 #include "parsec/agent/runners/interface.hpp"
+#include "parsec/agent/runners/lua/state_pool.hpp"
 #include "parsec/util.hpp"
 
 #include <lua.hpp>
@@ -17,7 +18,9 @@ namespace cbdc::parsec::agent::runner {
     /// in. Manages retrieval of function bytecode, locking keys during
     /// function execution, signature checking and commiting execution results.
     /// Class cannot be re-used for different functions/transactions, manages
-    /// the lifecycle of a single transaction.
+    /// the lifecycle of a single transaction. Contracts run in a thread of a
+    /// Lua state borrowed from a lua_state_pool shared by all runners, which
+    /// resets the state when the runner is destroyed.
     /// NOTE: When writing contracts, to pass data between the Lua environment
     /// and the C++ environment, use `coroutine.yield()`. To request a
     /// read-lock use coroutine.yield(<data>, 0). To request a write-lock use
@@ -46,6 +49,7 @@ namespace cbdc::parsec::agent::runner {
 
       private:
         std::shared_ptr<lua_State> m_state;
+        lua_State* m_thread{};
 
         void contract_epilogue(int n_results);
 
@@ -59,6 +63,8 @@ namespace cbdc::parsec::agent::runner {
         handle_try_lock(const broker::interface::try_lock_return_type& res);
 
         static auto check_sig(lua_State* L) -> int;
+
+        static auto state_pool() -> std::shared_ptr<lua_state_pool>;
     };
 }
 
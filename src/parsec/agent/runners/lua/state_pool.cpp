@@ -0,0 +1,364 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "state_pool.hpp"
+
+#include "util/common/hash.hpp"
+
+#include <array>
+
+namespace cbdc::parsec::agent::runner {
+    namespace {
+        // Slots on the stack of a prepared state. Unlike the registry,
+        // the stack is not reachable from contracts.
+        constexpr int snapshot_idx = 1;
+        constexpr int type_metatables_idx = 2;
+        constexpr int functions_idx = 3;
+        constexpr int base_top = functions_idx;
+
+        // Lua 5.4 defaults for the incremental collector.
+        constexpr int gc_pause = 200;
+        constexpr int gc_step_multiplier = 100;
+        constexpr int gc_step_size = 13;
+
+        constexpr auto basic_types = std::array{LUA_TNIL,
+                                                LUA_TBOOLEAN,
+                                                LUA_TLIGHTUSERDATA,
+                                                LUA_TNUMBER,
+                                                LUA_TSTRING,
+                                                LUA_TFUNCTION,
+                                                LUA_TTHREAD};
+
+        auto sample_function(lua_State* /* L */) -> int {
+            return 0;
+        }
+
+        // Pushes a value of a basic type. Values of a basic type share one
+        // metatable.
+        void push_sample(lua_State* L, int type) {
+            switch(type) {
+                case LUA_TNIL:
+                    lua_pushnil(L);
+                    break;
+                case LUA_TBOOLEAN:
+                    lua_pushboolean(L, 0);
+                    break;
+                case LUA_TLIGHTUSERDATA:
+                    lua_pushlightuserdata(L, nullptr);
+                    break;
+                case LUA_TNUMBER:
+                    lua_pushinteger(L, 0);
+                    break;
+                case LUA_TSTRING:
+                    lua_pushliteral(L, "");
+                    break;
+                case LUA_TFUNCTION:
+                    lua_pushcfunction(L, &sample_function);
+                    break;
+                default:
+                    lua_pushthread(L);
+                    break;
+            }
+        }
+
+        // The generator of math.random is userdata, which restoring does
+        // not reset, so reseed it randomly as a new state does.
+        void reseed_random(lua_State* L) {
+            const auto top = lua_gettop(L);
+            luaL_getsubtable(L, LUA_REGISTRYINDEX, LUA_LOADED_TABLE);
+            if(lua_getfield(L, -1, LUA_MATHLIBNAME) == LUA_TTABLE
+               && lua_getfield(L, -1, "randomseed") == LUA_TFUNCTION) {
+                lua_pcall(L, 0, 0, 0);
+            }
+            lua_settop(L, top);
+        }
+    }
+
+    lua_state_pool::lua_state_pool(setup_function_type setup,
+                                   size_t max_states)
+        : m_setup(setup),
+          m_max_states(max_states) {}
+
+    lua_state_pool::~lua_state_pool() {
+        for(auto* L : m_states) {
+            lua_close(L);
+        }
+    }
+
+    auto lua_state_pool::acquire() -> lua_State* {
+        {
+            std::unique_lock l(m_mut);
+            if(!m_states.empty()) {
+                auto* L = m_states.back();
+                m_states.pop_back();
+                return L;
+            }
+        }
+        return prepare();
+    }
+
+    void lua_state_pool::release(lua_State* L) {
+        // Drops the thread the contract ran in
+        lua_settop(L, base_top);
+        lua_sethook(L, nullptr, 0, 0);
+        restore(L);
+        reseed_random(L);
+        lua_gc(L, LUA_GCRESTART);
+        lua_gc(L, LUA_GCINC, gc_pause, gc_step_multiplier, gc_step_size);
+
+        {
+            std::unique_lock l(m_mut);
+            if(m_states.size() < m_max_states) {
+                m_states.push_back(L);
+                return;
+            }
+        }
+        lua_close(L);
+    }
+
+    auto lua_state_pool::size() const -> size_t {
+        std::unique_lock l(m_mut);
+        return m_states.size();
+    }
+
+    auto lua_state_pool::load(lua_State* L,
+                              const buffer& code,
+                              const char* name) -> int {
+        const auto top = lua_gettop(L);
+        const auto code_hash
+            = hash_data(static_cast<const std::byte*>(code.data()),
+                        code.size());
+        lua_pushlstring(
+            L,
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            reinterpret_cast<const char*>(code_hash.data()),
+            code_hash.size());
+
+        lua_pushvalue(L, -1);
+        if(lua_rawget(L, functions_idx) != LUA_TFUNCTION) {
+            lua_pop(L, 1);
+            auto ret = luaL_loadbufferx(L,
+                                        code.c_str(),
+                                        code.size(),
+                                        name,
+                                        "b");
+            if(ret != LUA_OK) {
+                lua_settop(L, top);
+                return ret;
+            }
+
+            auto& count = function_count(L);
+            if(count >= max_functions) {
+                lua_newtable(L);
+                lua_replace(L, functions_idx);
+                count = 0;
+            }
+            lua_pushvalue(L, -2);
+            lua_pushvalue(L, -2);
+            lua_rawset(L, functions_idx);
+            count++;
+        }
+        lua_remove(L, -2);
+
+        // An earlier run of the contract may have replaced its environment
+        lua_pushglobaltable(L);
+        if(lua_setupvalue(L, -2, 1) == nullptr) {
+            lua_pop(L, 1);
+        }
+        return LUA_OK;
+    }
+
+    auto lua_state_pool::prepare() -> lua_State* {
+        // TODO: use custom allocator to limit memory allocation
+        auto* L = luaL_newstate();
+        if(L == nullptr) {
+            return nullptr;
+        }
+
+        // TODO: provide custom environment limited only to safe library
+        //       methods
+        luaL_openlibs(L);
+        m_setup(L);
+        lua_settop(L, 0);
+        lua_gc(L, LUA_GCINC, gc_pause, gc_step_multiplier, gc_step_size);
+
+        lua_newtable(L);
+        lua_newtable(L);
+        lua_newtable(L);
+        function_count(L) = 0;
+
+        lua_newtable(L);
+        const auto seen_idx = lua_gettop(L);
+        for(auto type : basic_types) {
+            push_sample(L, type);
+            if(lua_getmetatable(L, -1) != 0) {
+                lua_pushvalue(L, -1);
+                lua_rawseti(L, type_metatables_idx, type);
+                record(L, -1, seen_idx, max_depth - 1);
+                lua_pop(L, 1);
+            }
+            lua_pop(L, 1);
+        }
+        lua_pushvalue(L, LUA_REGISTRYINDEX);
+        record(L, -1, seen_idx, max_depth);
+        lua_settop(L, base_top);
+
+        return L;
+    }
+
+    void
+    lua_state_pool::record(lua_State* L, int idx, int seen_idx, int depth) {
+        idx = lua_absindex(L, idx);
+        const auto type = lua_type(L, idx);
+        // Functions without upvalues and userdata without a metatable have
+        // nothing to restore.
+        if(type == LUA_TFUNCTION) {
+            if(lua_getupvalue(L, idx, 1) == nullptr) {
+                return;
+            }
+            lua_pop(L, 1);
+        } else if(type == LUA_TUSERDATA) {
+            if(lua_getmetatable(L, idx) == 0) {
+                return;
+            }
+            lua_pop(L, 1);
+        } else if(type != LUA_TTABLE) {
+            return;
+        }
+
+        lua_pushvalue(L, idx);
+        const auto seen = lua_rawget(L, seen_idx) != LUA_TNIL;
+        lua_pop(L, 1);
+        if(seen) {
+            return;
+        }
+        lua_pushvalue(L, idx);
+        lua_pushboolean(L, 1);
+        lua_rawset(L, seen_idx);
+
+        // Each entry holds the object, its contents or upvalues, and its
+        // metatable.
+        lua_createtable(L, 3, 0);
+        const auto entry_idx = lua_gettop(L);
+        lua_pushvalue(L, idx);
+        lua_rawseti(L, entry_idx, 1);
+
+        lua_newtable(L);
+        const auto contents_idx = lua_gettop(L);
+        if(type == LUA_TTABLE) {
+            lua_pushnil(L);
+            while(lua_next(L, idx) != 0) {
+                lua_pushvalue(L, -2);
+                lua_insert(L, -2);
+                lua_rawset(L, contents_idx);
+            }
+        } else if(type == LUA_TFUNCTION) {
+            for(int n = 1; lua_getupvalue(L, idx, n) != nullptr; n++) {
+                lua_rawseti(L, contents_idx, n);
+            }
+        }
+
+        if(depth > 0) {
+            lua_pushnil(L);
+            while(lua_next(L, contents_idx) != 0) {
+                record(L, -1, seen_idx, depth - 1);
+                lua_pop(L, 1);
+            }
+            if(lua_getmetatable(L, idx) != 0) {
+                record(L, -1, seen_idx, depth - 1);
+                lua_pop(L, 1);
+            }
+        }
+
+        lua_rawseti(L, entry_idx, 2);
+        if(lua_getmetatable(L, idx) != 0) {
+            lua_rawseti(L, entry_idx, 3);
+        }
+        lua_rawseti(L,
+                    snapshot_idx,
+                    static_cast<lua_Integer>(lua_rawlen(L, snapshot_idx))
+                        + 1);
+    }
+
+    void lua_state_pool::restore(lua_State* L) {
+        const auto n_entries
+            = static_cast<lua_Integer>(lua_rawlen(L, snapshot_idx));
+        for(lua_Integer i = 1; i <= n_entries; i++) {
+            lua_rawgeti(L, snapshot_idx, i);
+            const auto entry_idx = lua_gettop(L);
+            lua_rawgeti(L, entry_idx, 1);
+            const auto obj_idx = entry_idx + 1;
+            lua_rawgeti(L, entry_idx, 2);
+            const auto contents_idx = entry_idx + 2;
+
+            if(lua_type(L, obj_idx) == LUA_TTABLE) {
+                restore_table(L, obj_idx, contents_idx);
+            } else if(lua_type(L, obj_idx) == LUA_TFUNCTION) {
+                lua_pushnil(L);
+                while(lua_next(L, contents_idx) != 0) {
+                    const auto n = static_cast<int>(lua_tointeger(L, -2));
+                    if(lua_setupvalue(L, obj_idx, n) == nullptr) {
+                        lua_pop(L, 1);
+                    }
+                }
+            }
+
+            lua_rawgeti(L, entry_idx, 3);
+            if(lua_getmetatable(L, obj_idx) == 0) {
+                lua_pushnil(L);
+            }
+            const auto changed = lua_rawequal(L, -1, -2) == 0;
+            lua_pop(L, 1);
+            if(changed) {
+                lua_setmetatable(L, obj_idx);
+            }
+            lua_settop(L, entry_idx - 1);
+        }
+
+        for(auto type : basic_types) {
+            push_sample(L, type);
+            lua_rawgeti(L, type_metatables_idx, type);
+            lua_setmetatable(L, -2);
+            lua_pop(L, 1);
+        }
+    }
+
+    void lua_state_pool::restore_table(lua_State* L,
+                                       int idx,
+                                       int contents_idx) {
+        // Clearing fields is allowed while traversing a table
+        lua_pushnil(L);
+        while(lua_next(L, idx) != 0) {
+            lua_pop(L, 1);
+            lua_pushvalue(L, -1);
+            if(lua_rawget(L, contents_idx) == LUA_TNIL) {
+                lua_pushvalue(L, -2);
+                lua_pushnil(L);
+                lua_rawset(L, idx);
+            }
+            lua_pop(L, 1);
+        }
+
+        lua_pushnil(L);
+        while(lua_next(L, contents_idx) != 0) {
+            lua_pushvalue(L, -2);
+            lua_rawget(L, idx);
+            const auto changed = lua_rawequal(L, -1, -2) == 0;
+            lua_pop(L, 1);
+            if(changed) {
+                lua_pushvalue(L, -2);
+                lua_insert(L, -2);
+                lua_rawset(L, idx);
+            } else {
+                lua_pop(L, 1);
+            }
+        }
+    }
+
+    auto lua_state_pool::function_count(lua_State* L) -> size_t& {
+        static_assert(LUA_EXTRASPACE >= sizeof(size_t));
+        return *static_cast<size_t*>(lua_getextraspace(L));
+    }
+}
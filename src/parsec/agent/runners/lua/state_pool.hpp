@@ -0,0 +1,111 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PARSEC_AGENT_RUNNERS_LUA_STATE_POOL_H_
+#define OPENCBDC_TX_SRC_PARSEC_AGENT_RUNNERS_LUA_STATE_POOL_H_
+
+#include "util/common/buffer.hpp"
+
+#include <lua.hpp>
+#include <mutex>
+#include <vector>
+
+namespace cbdc::parsec::agent::runner {
+    /// \brief Pool of Lua states prepared for running contracts.
+    ///
+    /// Preparing a state allocates it, opens the standard libraries and
+    /// runs a setup function, which is a large part of the cost of running
+    /// a short contract. Once a state is prepared, the pool records the
+    /// contents and metatables of the tables reachable from its registry,
+    /// the upvalues of the C functions in them and the metatables of the
+    /// basic types. Returning a state to the pool restores all of them, so
+    /// changes a contract makes to its environment are not visible to later
+    /// contracts. Contracts should run in a thread created on the state, as
+    /// returning the state discards its stack. Each state also caches the
+    /// contract functions it has loaded by code hash.
+    ///
+    /// Restoring a state has limits. Objects more than max_depth references
+    /// away from the registry are not recorded, so changes to them persist.
+    /// Only references are restored, not the contents of userdata, which
+    /// hold the internal state of C libraries. The one such state of the
+    /// standard libraries a contract can change, the generator of
+    /// math.random, is reseeded when a state is returned, as it is when a
+    /// new state is created.
+    ///
+    /// Thread-safe. A state may be returned from a different thread than
+    /// the one which took it, but only one thread may use it at a time.
+    class lua_state_pool {
+      public:
+        /// Function which prepares a new state after the standard
+        /// libraries are opened.
+        using setup_function_type = void (*)(lua_State*);
+
+        /// Default maximum number of states held by a pool.
+        static constexpr size_t default_max_states = 64;
+
+        /// Maximum number of references between the registry and an object
+        /// for the object to be restored.
+        static constexpr int max_depth = 4;
+
+        /// Maximum number of contract functions cached by a state. The
+        /// cache is cleared when it is full.
+        static constexpr size_t max_functions = 128;
+
+        /// Constructor.
+        /// \param setup function to prepare new states.
+        /// \param max_states maximum number of states to hold. States
+        ///                   returned to a full pool are closed.
+        lua_state_pool(setup_function_type setup, size_t max_states);
+
+        /// Closes the states held by the pool.
+        ~lua_state_pool();
+
+        lua_state_pool(const lua_state_pool&) = delete;
+        auto operator=(const lua_state_pool&) -> lua_state_pool& = delete;
+        lua_state_pool(lua_state_pool&&) = delete;
+        auto operator=(lua_state_pool&&) -> lua_state_pool& = delete;
+
+        /// Takes a state from the pool, or prepares a new state if the
+        /// pool is empty.
+        /// \return state, or nullptr if allocating a new state failed.
+        auto acquire() -> lua_State*;
+
+        /// Resets a state taken from a pool with the same setup function
+        /// and adds it to this pool.
+        /// \param L state to return.
+        void release(lua_State* L);
+
+        /// Returns the number of states held by the pool.
+        /// \return number of states.
+        [[nodiscard]] auto size() const -> size_t;
+
+        /// Pushes the main function of a contract onto the stack of a
+        /// state taken from a pool. Loads the contract unless the state
+        /// has loaded the same code before. Each call sets the
+        /// environment of the function to the global table.
+        /// \param L state taken from a pool.
+        /// \param code contract bytecode.
+        /// \param name chunk name to use when loading the contract.
+        /// \return LUA_OK, or the error returned by luaL_loadbufferx. The
+        ///         stack is unchanged on error.
+        static auto load(lua_State* L, const buffer& code, const char* name)
+            -> int;
+
+      private:
+        setup_function_type m_setup;
+        size_t m_max_states;
+        /// Protects m_states.
+        mutable std::mutex m_mut;
+        std::vector<lua_State*> m_states;
+
+        auto prepare() -> lua_State*;
+        static void record(lua_State* L, int idx, int seen_idx, int depth);
+        static void restore(lua_State* L);
+        static void restore_table(lua_State* L, int idx, int contents_idx);
+        static auto function_count(lua_State* L) -> size_t&;
+    };
+}
+
+#endif
@@ -7,7 +7,9 @@
 
 #include "util/common/variant_overloaded.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <map>
 
 namespace cbdc::parsec::broker {
     impl::impl(
@@ -15,62 +17,241 @@ namespace cbdc::parsec::broker {
         std::vector<std::shared_ptr<runtime_locking_shard::interface>> shards,
         std::shared_ptr<ticket_machine::interface> ticketer,
         std::shared_ptr<directory::interface> directory,
-        std::shared_ptr<logging::log> logger)
+        std::shared_ptr<logging::log> logger,
+        std::chrono::milliseconds ticket_lease_duration)
         : m_broker_id(broker_id),
           m_shards(std::move(shards)),
           m_ticketer(std::move(ticketer)),
           m_directory(std::move(directory)),
-          m_log(std::move(logger)) {}
+          m_log(std::move(logger)),
+          m_ticket_lease_duration(ticket_lease_duration) {}
 
     auto impl::begin(begin_callback_type result_callback) -> bool {
-        if(!m_ticketer->get_ticket_number(
-               [this, result_callback](
-                   std::optional<parsec::ticket_machine::interface::
+        auto ticket_number = std::optional<ticket_number_type>();
+        auto fetch = false;
+        {
+            std::unique_lock l(m_lease_mut);
+            ticket_number = take_leased_ticket();
+            if(!ticket_number.has_value()) {
+                m_begin_callbacks.push(std::move(result_callback));
+            }
+            fetch = should_fetch_lease();
+        }
+
+        if(fetch) {
+            fetch_lease();
+        }
+
+        if(ticket_number.has_value()) {
+            begin_ticket(ticket_number.value(), result_callback);
+        }
+
+        return true;
+    }
+
+    auto impl::take_leased_ticket() -> std::optional<ticket_number_type> {
+        const auto now = std::chrono::steady_clock::now();
+        while(!m_leases.empty()) {
+            auto& lease = m_leases.front();
+            if(lease.m_next < lease.m_end && now < lease.m_expiry) {
+                return hand_out_ticket(lease);
+            }
+            m_leases.pop_front();
+        }
+        return std::nullopt;
+    }
+
+    auto impl::hand_out_ticket(ticket_lease& lease) -> ticket_number_type {
+        auto ticket_number = lease.m_next++;
+        if(m_highest_ticket < ticket_number) {
+            m_highest_ticket = ticket_number;
+        }
+        return ticket_number;
+    }
+
+    auto impl::should_fetch_lease() -> bool {
+        if(m_fetching_lease) {
+            return false;
+        }
+        ticket_number_type remaining{0};
+        for(const auto& lease : m_leases) {
+            remaining += lease.m_end - lease.m_next;
+        }
+        // Request the next range once half of the last one is used so it
+        // usually arrives before the current lease runs out.
+        if(m_begin_callbacks.empty() && remaining > m_lease_size / 2) {
+            return false;
+        }
+        m_fetching_lease = true;
+        return true;
+    }
+
+    void impl::fetch_lease() {
+        auto success = m_ticketer->get_ticket_number(
+            [this](std::optional<parsec::ticket_machine::interface::
                                      get_ticket_number_return_type> res) {
-                   handle_ticket_number(result_callback, res);
-               })) {
+                handle_ticket_number(res);
+            });
+        if(!success) {
             m_log->error("Failed to request a ticket number");
-            result_callback(error_code::ticket_machine_unreachable);
+            {
+                std::unique_lock l(m_lease_mut);
+                m_fetching_lease = false;
+            }
+            fail_begin_callbacks(error_code::ticket_machine_unreachable);
         }
+    }
 
-        return true;
+    void impl::fail_begin_callbacks(error_code err) {
+        auto callbacks = decltype(m_begin_callbacks)();
+        {
+            std::unique_lock l(m_lease_mut);
+            callbacks.swap(m_begin_callbacks);
+        }
+        while(!callbacks.empty()) {
+            callbacks.front()(err);
+            callbacks.pop();
+        }
     }
 
     void impl::handle_ticket_number(
-        begin_callback_type result_callback,
         std::optional<
             parsec::ticket_machine::interface::get_ticket_number_return_type>
             res) {
         if(!res.has_value()) {
-            result_callback(error_code::ticket_number_assignment);
+            {
+                std::unique_lock l(m_lease_mut);
+                m_fetching_lease = false;
+            }
+            fail_begin_callbacks(error_code::ticket_number_assignment);
+            return;
+        }
+
+        auto ready = std::vector<
+            std::pair<begin_callback_type, ticket_number_type>>();
+        auto fetch = false;
+        auto success = std::visit(
+            overloaded{[&](const parsec::ticket_machine::interface::
+                               ticket_number_range_type& n) {
+                           // Single ticket numbers may be returned as an
+                           // empty range.
+                           auto lease = ticket_lease{
+                               n.first,
+                               std::max(n.second, n.first + 1),
+                               std::chrono::steady_clock::now()
+                                   + m_ticket_lease_duration};
+                           std::unique_lock l(m_lease_mut);
+                           m_fetching_lease = false;
+                           m_lease_size = lease.m_end - lease.m_next;
+                           // Requests are only waiting if every earlier
+                           // lease is used up, so serve them from the new
+                           // lease first, even if it has already expired.
+                           while(!m_begin_callbacks.empty()
+                                 && lease.m_next < lease.m_end) {
+                               ready.emplace_back(
+                                   std::move(m_begin_callbacks.front()),
+                                   hand_out_ticket(lease));
+                               m_begin_callbacks.pop();
+                           }
+                           m_leases.push_back(lease);
+                           fetch = should_fetch_lease();
+                           return true;
+                       },
+                       [&](const parsec::ticket_machine::interface::
+                               error_code& /* e */) {
+                           std::unique_lock l(m_lease_mut);
+                           m_fetching_lease = false;
+                           return false;
+                       }},
+            res.value());
+
+        if(!success) {
+            fail_begin_callbacks(error_code::ticket_number_assignment);
             return;
         }
-        std::visit(overloaded{[&](const parsec::ticket_machine::interface::
-                                      ticket_number_range_type& n) {
-                                  {
-                                      std::unique_lock l(m_mut);
-                                      if(m_highest_ticket < n.second) {
-                                          m_highest_ticket = n.second;
-                                      }
-                                      m_tickets.emplace(
-                                          n.first,
-                                          std::make_shared<state>(
-                                              state{ticket_state::begun, {}}));
-                                  }
-                                  result_callback(n.first);
-                              },
-                              [&](const parsec::ticket_machine::interface::
-                                      error_code& /* e */) {
-                                  result_callback(
-                                      error_code::ticket_number_assignment);
-                              }},
-                   res.value());
+
+        for(auto& [cb, ticket_number] : ready) {
+            begin_ticket(ticket_number, cb);
+        }
+
+        if(fetch) {
+            fetch_lease();
+        }
+    }
+
+    void impl::begin_ticket(ticket_number_type ticket_number,
+                            const begin_callback_type& result_callback) {
+        add_ticket(ticket_number, std::make_shared<state>());
+        result_callback(ticket_number);
     }
 
     auto impl::highest_ticket() -> ticket_number_type {
+        std::unique_lock l(m_lease_mut);
         return m_highest_ticket;
     }
 
+    auto impl::ticket_partition_for(ticket_number_type ticket_number)
+        -> ticket_partition& {
+        return m_ticket_partitions[ticket_number
+                                   % m_ticket_partitions.size()];
+    }
+
+    void impl::add_ticket(ticket_number_type ticket_number,
+                          std::shared_ptr<state> ts) {
+        auto& partition = ticket_partition_for(ticket_number);
+        std::unique_lock l(partition.m_mut);
+        partition.m_tickets.emplace(ticket_number, std::move(ts));
+    }
+
+    auto impl::lock_ticket(ticket_number_type ticket_number)
+        -> locked_ticket_type {
+        auto ts = [&]() -> std::shared_ptr<state> {
+            auto& partition = ticket_partition_for(ticket_number);
+            std::unique_lock l(partition.m_mut);
+            auto it = partition.m_tickets.find(ticket_number);
+            if(it == partition.m_tickets.end()) {
+                return nullptr;
+            }
+            return it->second;
+        }();
+        if(!ts) {
+            return {nullptr, std::unique_lock<std::mutex>()};
+        }
+        auto l = std::unique_lock(ts->m_mut);
+        // The ticket may have been erased after it was found
+        if(ts->m_erased) {
+            return {nullptr, std::unique_lock<std::mutex>()};
+        }
+        return {std::move(ts), std::move(l)};
+    }
+
+    void impl::erase_ticket(ticket_number_type ticket_number, state& ts) {
+        ts.m_erased = true;
+        auto& partition = ticket_partition_for(ticket_number);
+        std::unique_lock l(partition.m_mut);
+        partition.m_tickets.erase(ticket_number);
+    }
+
+    auto impl::tickets_empty() -> bool {
+        return std::all_of(m_ticket_partitions.begin(),
+                           m_ticket_partitions.end(),
+                           [](ticket_partition& partition) {
+                               std::unique_lock l(partition.m_mut);
+                               return partition.m_tickets.empty();
+                           });
+    }
+
+    auto impl::shard_in_state(state& ts,
+                              uint64_t shard_idx,
+                              shard_state_type expected) -> bool {
+        std::unique_lock l(ts.m_mut);
+        if(ts.m_state == ticket_state::aborted) {
+            return false;
+        }
+        auto it = ts.m_shard_states.find(shard_idx);
+        return it != ts.m_shard_states.end() && it->second.m_state == expected;
+    }
+
     void impl::handle_lock(
         ticket_number_type ticket_number,
         key_type key,
@@ -82,13 +263,11 @@ namespace cbdc::parsec::broker {
             overloaded{
                 [&](parsec::runtime_locking_shard::value_type v)
                     -> try_lock_return_type {
-                    std::unique_lock l(m_mut);
-                    auto it = m_tickets.find(ticket_number);
-                    if(it == m_tickets.end()) {
+                    auto [t_state, l] = lock_ticket(ticket_number);
+                    if(!t_state) {
                         return error_code::unknown_ticket;
                     }
 
-                    auto t_state = it->second;
                     auto& s_state = t_state->m_shard_states[shard_idx];
                     auto k_it = s_state.m_key_states.find(key);
                     if(k_it == s_state.m_key_states.end()) {
@@ -134,25 +313,14 @@ namespace cbdc::parsec::broker {
                         lock_type locktype,
                         try_lock_callback_type result_callback) -> bool {
         auto maybe_error = [&]() -> std::optional<error_code> {
-            std::unique_lock l(m_mut);
-            auto it = m_tickets.find(ticket_number);
-            if(it == m_tickets.end()) {
-                return error_code::unknown_ticket;
-            }
-
-            auto t_state = it->second;
-            switch(t_state->m_state) {
-                case ticket_state::begun:
-                    break;
-                case ticket_state::prepared:
-                    return error_code::prepared;
-                case ticket_state::committed:
-                    return error_code::committed;
-                case ticket_state::aborted:
-                    t_state->m_state = ticket_state::begun;
-                    t_state->m_shard_states.clear();
-                    m_log->trace(this, "broker restarting", ticket_number);
-                    break;
+            {
+                auto [t_state, l] = lock_ticket(ticket_number);
+                if(!t_state) {
+                    return error_code::unknown_ticket;
+                }
+                if(auto err = start_locking(ticket_number, *t_state)) {
+                    return err;
+                }
             }
 
             if(!m_directory->key_location(
@@ -179,19 +347,292 @@ namespace cbdc::parsec::broker {
         return true;
     }
 
+    auto impl::start_locking(ticket_number_type ticket_number, state& ts)
+        -> std::optional<error_code> {
+        switch(ts.m_state) {
+            case ticket_state::begun:
+                break;
+            case ticket_state::prepared:
+                return error_code::prepared;
+            case ticket_state::committed:
+                return error_code::committed;
+            case ticket_state::aborted:
+                ts.m_state = ticket_state::begun;
+                ts.m_shard_states.clear();
+                m_log->trace(this, "broker restarting", ticket_number);
+                break;
+        }
+
+        return std::nullopt;
+    }
+
+    auto impl::try_lock_many(ticket_number_type ticket_number,
+                             std::vector<lock_request_type> locks,
+                             try_lock_many_callback_type result_callback)
+        -> bool {
+        auto maybe_error = [&]() -> std::optional<error_code> {
+            auto [t_state, l] = lock_ticket(ticket_number);
+            if(!t_state) {
+                return error_code::unknown_ticket;
+            }
+            return start_locking(ticket_number, *t_state);
+        }();
+        if(maybe_error.has_value()) {
+            result_callback(maybe_error.value());
+            return true;
+        }
+
+        if(locks.empty()) {
+            result_callback(std::vector<value_type>());
+            return true;
+        }
+
+        auto batch = std::make_shared<lock_batch>();
+        batch->m_ticket_number = ticket_number;
+        batch->m_locks = std::move(locks);
+        batch->m_shard_idxs.resize(batch->m_locks.size());
+        batch->m_values.resize(batch->m_locks.size());
+        batch->m_pending = batch->m_locks.size();
+        batch->m_callback = std::move(result_callback);
+
+        for(size_t i{0}; i < batch->m_locks.size(); i++) {
+            if(!m_directory->key_location(
+                   batch->m_locks[i].first,
+                   [=, this](std::optional<parsec::directory::interface::
+                                               key_location_return_type> res) {
+                       handle_find_keys(batch, i, res);
+                   })) {
+                m_log->error("Failed to make key location directory request");
+                finish_lock_batch(*batch, error_code::directory_unreachable);
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    void impl::handle_find_keys(
+        const std::shared_ptr<lock_batch>& batch,
+        size_t idx,
+        std::optional<parsec::directory::interface::key_location_return_type>
+            res) {
+        if(!res.has_value()) {
+            finish_lock_batch(*batch, error_code::directory_unreachable);
+            return;
+        }
+        {
+            std::unique_lock l(batch->m_mut);
+            assert(res.value() < m_shards.size());
+            batch->m_shard_idxs[idx] = res.value();
+            batch->m_pending--;
+            if(batch->m_pending > 0 || batch->m_done) {
+                return;
+            }
+        }
+        request_lock_batch(batch);
+    }
+
+    void impl::request_lock_batch(const std::shared_ptr<lock_batch>& batch) {
+        auto requests = std::map<uint64_t, shard_lock_request>();
+        auto tss = std::shared_ptr<state>();
+        auto maybe_error = [&]() -> std::optional<error_code> {
+            auto [t_state, l] = lock_ticket(batch->m_ticket_number);
+            if(!t_state) {
+                m_log->error("Unknown ticket number");
+                return error_code::unknown_ticket;
+            }
+            tss = t_state;
+
+            switch(tss->m_state) {
+                case ticket_state::begun:
+                    break;
+                case ticket_state::prepared:
+                    return error_code::prepared;
+                case ticket_state::committed:
+                    return error_code::committed;
+                case ticket_state::aborted:
+                    return error_code::aborted;
+            }
+
+            // Group the locks still to be acquired by shard
+            for(size_t i{0}; i < batch->m_locks.size(); i++) {
+                const auto& [key, locktype] = batch->m_locks[i];
+                const auto shard_idx = batch->m_shard_idxs[i];
+                auto& ss = tss->m_shard_states[shard_idx];
+                auto [req, added] = requests.try_emplace(shard_idx);
+                if(added) {
+                    req->second.m_first_lock = ss.m_key_states.empty();
+                }
+
+                auto it = ss.m_key_states.find(key);
+                if(it != ss.m_key_states.end()
+                   && it->second.m_key_state == key_state::locked
+                   && it->second.m_locktype >= locktype) {
+                    assert(it->second.m_value.has_value());
+                    batch->m_values[i] = it->second.m_value.value();
+                    continue;
+                }
+
+                auto& ks = ss.m_key_states[key];
+                ks.m_key_state = key_state::locking;
+                ks.m_locktype = locktype;
+
+                req->second.m_idxs.push_back(i);
+                req->second.m_locks.emplace_back(key, locktype);
+            }
+            std::erase_if(requests, [](const auto& req) {
+                return req.second.m_idxs.empty();
+            });
+
+            std::unique_lock ll(batch->m_mut);
+            batch->m_pending = requests.size();
+            return std::nullopt;
+        }();
+
+        if(!maybe_error.has_value() && requests.empty()) {
+            finish_lock_batch(*batch, std::nullopt);
+            return;
+        }
+
+        if(!maybe_error.has_value()) {
+            for(auto& [shard_idx, req] : requests) {
+                // An earlier shard's response may have aborted the ticket
+                if(!shard_in_state(*tss, shard_idx, shard_state_type::begun)) {
+                    m_log->trace("Broker aborted during try_lock_many for",
+                                 batch->m_ticket_number);
+                    maybe_error = error_code::aborted;
+                    break;
+                }
+                auto idxs = std::move(req.m_idxs);
+                if(!m_shards[shard_idx]->try_lock_many(
+                       batch->m_ticket_number,
+                       m_broker_id,
+                       std::move(req.m_locks),
+                       req.m_first_lock,
+                       [=, this](parsec::runtime_locking_shard::interface::
+                                     try_lock_many_return_type lock_res) {
+                           handle_lock_many(batch,
+                                            shard_idx,
+                                            idxs,
+                                            std::move(lock_res));
+                       })) {
+                    m_log->error("Failed to make try_lock_many shard "
+                                 "request");
+                    maybe_error = error_code::shard_unreachable;
+                    break;
+                }
+            }
+        }
+
+        if(maybe_error.has_value()) {
+            finish_lock_batch(*batch, maybe_error.value());
+        }
+    }
+
+    void impl::handle_lock_many(
+        const std::shared_ptr<lock_batch>& batch,
+        uint64_t shard_idx,
+        const std::vector<size_t>& idxs,
+        parsec::runtime_locking_shard::interface::try_lock_many_return_type
+            res) {
+        auto maybe_error = std::visit(
+            overloaded{
+                [&](std::vector<value_type>& values)
+                    -> std::optional<try_lock_many_return_type> {
+                    assert(values.size() == idxs.size());
+                    {
+                        auto [t_state, l]
+                            = lock_ticket(batch->m_ticket_number);
+                        if(!t_state) {
+                            return error_code::unknown_ticket;
+                        }
+
+                        auto& s_state = t_state->m_shard_states[shard_idx];
+                        for(size_t i{0}; i < idxs.size(); i++) {
+                            const auto& key = batch->m_locks[idxs[i]].first;
+                            auto k_it = s_state.m_key_states.find(key);
+                            if(k_it == s_state.m_key_states.end()
+                               || k_it->second.m_key_state
+                                      != key_state::locking) {
+                                m_log->error("Shard state not locking");
+                                return error_code::invalid_shard_state;
+                            }
+                            k_it->second.m_key_state = key_state::locked;
+                            k_it->second.m_value = values[i];
+                        }
+                    }
+
+                    m_log->trace(this,
+                                 "Broker locked",
+                                 idxs.size(),
+                                 "keys for",
+                                 batch->m_ticket_number);
+
+                    {
+                        std::unique_lock l(batch->m_mut);
+                        for(size_t i{0}; i < idxs.size(); i++) {
+                            batch->m_values[idxs[i]] = std::move(values[i]);
+                        }
+                        batch->m_pending--;
+                        if(batch->m_pending > 0) {
+                            return std::nullopt;
+                        }
+                    }
+                    finish_lock_batch(*batch, std::nullopt);
+                    return std::nullopt;
+                },
+                [&](parsec::runtime_locking_shard::shard_error& e)
+                    -> std::optional<try_lock_many_return_type> {
+                    m_log->trace(this,
+                                 "Shard error",
+                                 static_cast<int>(e.m_error_code),
+                                 "locking keys for",
+                                 batch->m_ticket_number);
+                    return e;
+                }},
+            res);
+
+        if(maybe_error.has_value()) {
+            finish_lock_batch(*batch, std::move(maybe_error));
+        }
+    }
+
+    void impl::finish_lock_batch(
+        lock_batch& batch,
+        std::optional<try_lock_many_return_type> result) {
+        {
+            std::unique_lock l(batch.m_mut);
+            if(batch.m_done) {
+                return;
+            }
+            batch.m_done = true;
+            if(!result.has_value()) {
+                auto values = std::vector<value_type>();
+                values.reserve(batch.m_values.size());
+                for(auto& v : batch.m_values) {
+                    assert(v.has_value());
+                    values.emplace_back(std::move(v.value()));
+                }
+                result = std::move(values);
+            }
+        }
+        batch.m_callback(std::move(result.value()));
+    }
+
     void impl::handle_prepare(
         const commit_callback_type& commit_cb,
         ticket_number_type ticket_number,
         uint64_t shard_idx,
         parsec::runtime_locking_shard::interface::prepare_return_type res) {
+        auto ts = std::shared_ptr<state>();
+        auto shard_idxs = std::vector<uint64_t>();
         auto maybe_error = [&]() -> std::optional<commit_return_type> {
-            std::unique_lock ll(m_mut);
-            auto itt = m_tickets.find(ticket_number);
-            if(itt == m_tickets.end()) {
+            auto [t_state, ll] = lock_ticket(ticket_number);
+            if(!t_state) {
                 return error_code::unknown_ticket;
             }
 
-            auto ts = itt->second;
+            ts = t_state;
             switch(ts->m_state) {
                 case ticket_state::begun:
                     break;
@@ -203,13 +644,25 @@ namespace cbdc::parsec::broker {
                     return error_code::aborted;
             }
 
-            return do_handle_prepare(commit_cb,
-                                     ticket_number,
-                                     ts,
-                                     shard_idx,
-                                     res);
+            auto commit = false;
+            auto err = do_handle_prepare(ticket_number,
+                                         *ts,
+                                         shard_idx,
+                                         res,
+                                         commit);
+            if(commit) {
+                shard_idxs = start_commit(*ts);
+            }
+            return err;
         }();
 
+        if(!maybe_error.has_value() && !shard_idxs.empty()) {
+            auto err = do_commit(commit_cb, ticket_number, ts, shard_idxs);
+            if(err.has_value()) {
+                maybe_error = err.value();
+            }
+        }
+
         m_log->trace(this, "Broker handled prepare for", ticket_number);
 
         if(maybe_error.has_value()) {
@@ -221,13 +674,13 @@ namespace cbdc::parsec::broker {
     }
 
     auto impl::do_handle_prepare(
-        const commit_callback_type& commit_cb,
         ticket_number_type ticket_number,
-        const std::shared_ptr<state>& ts,
+        state& ts,
         uint64_t shard_idx,
         const parsec::runtime_locking_shard::interface::prepare_return_type&
-            res) -> std::optional<commit_return_type> {
-        auto& ss = ts->m_shard_states[shard_idx].m_state;
+            res,
+        bool& commit) -> std::optional<commit_return_type> {
+        auto& ss = ts.m_shard_states[shard_idx].m_state;
         if(ss != shard_state_type::preparing) {
             m_log->trace(this,
                          "Shard",
@@ -246,7 +699,7 @@ namespace cbdc::parsec::broker {
                              shard_idx,
                              "wounded ticket",
                              ticket_number);
-                for(auto& [sidx, s] : ts->m_shard_states) {
+                for(auto& [sidx, s] : ts.m_shard_states) {
                     if(s.m_state == shard_state_type::wounded) {
                         return std::nullopt;
                     }
@@ -263,36 +716,40 @@ namespace cbdc::parsec::broker {
                      ticket_number);
         ss = shard_state_type::prepared;
 
-        for(auto& shard : ts->m_shard_states) {
+        for(auto& shard : ts.m_shard_states) {
             if(shard.second.m_state != shard_state_type::prepared) {
                 return std::nullopt;
             }
         }
 
-        ts->m_state = ticket_state::prepared;
+        ts.m_state = ticket_state::prepared;
+        commit = true;
+        return std::nullopt;
+    }
 
-        auto maybe_error = do_commit(commit_cb, ticket_number, ts);
-        if(maybe_error.has_value()) {
-            return maybe_error.value();
+    auto impl::start_commit(state& ts) -> std::vector<uint64_t> {
+        auto shard_idxs = std::vector<uint64_t>();
+        for(auto& shard : ts.m_shard_states) {
+            if(shard.second.m_state == shard_state_type::committed) {
+                continue;
+            }
+            shard.second.m_state = shard_state_type::committing;
+            shard_idxs.push_back(shard.first);
         }
-        return std::nullopt;
+        return shard_idxs;
     }
 
     auto impl::do_commit(const commit_callback_type& commit_cb,
                          ticket_number_type ticket_number,
-                         const std::shared_ptr<state>& ts)
+                         const std::shared_ptr<state>& ts,
+                         const std::vector<uint64_t>& shard_idxs)
         -> std::optional<error_code> {
-        for(auto& shard : ts->m_shard_states) {
-            if(ts->m_state == ticket_state::aborted) {
+        for(auto sidx : shard_idxs) {
+            if(!shard_in_state(*ts, sidx, shard_state_type::committing)) {
                 m_log->trace("Broker aborted during commit for",
                              ticket_number);
                 break;
             }
-            if(shard.second.m_state == shard_state_type::committed) {
-                continue;
-            }
-            shard.second.m_state = shard_state_type::committing;
-            auto sidx = shard.first;
             if(!m_shards[sidx]->commit(
                    ticket_number,
                    [=, this](const parsec::runtime_locking_shard::interface::
@@ -313,13 +770,11 @@ namespace cbdc::parsec::broker {
         parsec::runtime_locking_shard::interface::commit_return_type res) {
         auto callback = false;
         auto maybe_error = [&]() -> std::optional<error_code> {
-            std::unique_lock lll(m_mut);
-            auto ittt = m_tickets.find(ticket_number);
-            if(ittt == m_tickets.end()) {
+            auto [tss, lll] = lock_ticket(ticket_number);
+            if(!tss) {
                 return error_code::unknown_ticket;
             }
 
-            auto tss = ittt->second;
             switch(tss->m_state) {
                 case ticket_state::begun:
                     return error_code::not_prepared;
@@ -377,14 +832,19 @@ namespace cbdc::parsec::broker {
                       state_update_type state_updates,
                       commit_callback_type result_callback) -> bool {
         m_log->trace(this, "Broker got commit request for", ticket_number);
+        auto t_state = std::shared_ptr<state>();
+        auto commit_shards = std::vector<uint64_t>();
+        auto prepare_requests
+            = std::vector<std::pair<uint64_t, state_update_type>>();
+        auto prepared = false;
+        auto one_phase = false;
         auto maybe_error = [&]() -> std::optional<error_code> {
-            std::unique_lock l(m_mut);
-            auto it = m_tickets.find(ticket_number);
-            if(it == m_tickets.end()) {
+            auto [ts, l] = lock_ticket(ticket_number);
+            if(!ts) {
                 return error_code::unknown_ticket;
             }
 
-            auto t_state = it->second;
+            t_state = ts;
             switch(t_state->m_state) {
                 case ticket_state::begun:
                     [[fallthrough]];
@@ -422,15 +882,40 @@ namespace cbdc::parsec::broker {
                 }
             }
 
-            if(t_state->m_state == ticket_state::prepared) {
-                return do_commit(result_callback, ticket_number, t_state);
+            prepared = t_state->m_state == ticket_state::prepared;
+            if(prepared) {
+                commit_shards = start_commit(*t_state);
+            } else {
+                prepare_requests = start_prepare(*t_state, state_updates);
+                // If only one shard holds locks for the ticket, it can
+                // decide the outcome alone without a separate commit round
+                // trip.
+                one_phase = prepare_requests.size() == 1
+                         && t_state->m_shard_states.size() == 1;
             }
-            return do_prepare(result_callback,
-                              ticket_number,
-                              t_state,
-                              state_updates);
+            return std::nullopt;
         }();
 
+        if(!maybe_error.has_value()) {
+            if(prepared) {
+                maybe_error = do_commit(result_callback,
+                                        ticket_number,
+                                        t_state,
+                                        commit_shards);
+            } else if(one_phase) {
+                auto& [shard_idx, shard_updates] = prepare_requests.front();
+                maybe_error = do_prepare_commit(result_callback,
+                                                ticket_number,
+                                                shard_idx,
+                                                std::move(shard_updates));
+            } else {
+                maybe_error = do_prepare(result_callback,
+                                         ticket_number,
+                                         t_state,
+                                         std::move(prepare_requests));
+            }
+        }
+
         if(maybe_error.has_value()) {
             m_log->trace(
                 this,
@@ -442,20 +927,11 @@ namespace cbdc::parsec::broker {
         return true;
     }
 
-    auto impl::do_prepare(const commit_callback_type& result_callback,
-                          ticket_number_type ticket_number,
-                          const std::shared_ptr<state>& t_state,
-                          const state_update_type& state_updates)
-        -> std::optional<error_code> {
-        for(auto& shard : t_state->m_shard_states) {
-            // Shard states might get nuked in this loop if there's a
-            // rollback Before iterating, make sure we're still good to
-            // do more prepares Only nuke shard states on restart
-            if(t_state->m_state == ticket_state::aborted) {
-                m_log->trace("Broker aborted during prepare for",
-                             ticket_number);
-                break;
-            }
+    auto impl::start_prepare(state& t_state,
+                             const state_update_type& state_updates)
+        -> std::vector<std::pair<uint64_t, state_update_type>> {
+        auto requests = std::vector<std::pair<uint64_t, state_update_type>>();
+        for(auto& shard : t_state.m_shard_states) {
             if(shard.second.m_state == shard_state_type::prepared) {
                 continue;
             }
@@ -467,19 +943,38 @@ namespace cbdc::parsec::broker {
                     shard_updates.emplace(update);
                 }
             }
-            if(!m_shards[shard.first]->prepare(
+            requests.emplace_back(shard.first, std::move(shard_updates));
+        }
+        return requests;
+    }
+
+    auto impl::do_prepare(
+        const commit_callback_type& result_callback,
+        ticket_number_type ticket_number,
+        const std::shared_ptr<state>& t_state,
+        std::vector<std::pair<uint64_t, state_update_type>> requests)
+        -> std::optional<error_code> {
+        for(auto& [shard_idx, shard_updates] : requests) {
+            // Shard states might get nuked by a rollback triggered by an
+            // earlier prepare response. Before sending each request, make
+            // sure we're still good to do more prepares.
+            if(!shard_in_state(*t_state,
+                               shard_idx,
+                               shard_state_type::preparing)) {
+                m_log->trace("Broker aborted during prepare for",
+                             ticket_number);
+                break;
+            }
+            if(!m_shards[shard_idx]->prepare(
                    ticket_number,
                    m_broker_id,
                    std::move(shard_updates),
-                   [this,
-                    result_callback,
-                    ticket_number,
-                    shard_idx
-                    = shard.first](const parsec::runtime_locking_shard::
-                                       interface::prepare_return_type& res) {
+                   [this, result_callback, ticket_number, sidx = shard_idx](
+                       const parsec::runtime_locking_shard::interface::
+                           prepare_return_type& res) {
                        handle_prepare(result_callback,
                                       ticket_number,
-                                      shard_idx,
+                                      sidx,
                                       res);
                    })) {
                 m_log->error("Failed to make prepare shard request");
@@ -489,20 +984,96 @@ namespace cbdc::parsec::broker {
         return std::nullopt;
     }
 
+    auto impl::do_prepare_commit(const commit_callback_type& result_callback,
+                                 ticket_number_type ticket_number,
+                                 uint64_t shard_idx,
+                                 state_update_type shard_updates)
+        -> std::optional<error_code> {
+        if(!m_shards[shard_idx]->prepare_commit(
+               ticket_number,
+               m_broker_id,
+               std::move(shard_updates),
+               [this, result_callback, ticket_number, shard_idx](
+                   const parsec::runtime_locking_shard::interface::
+                       commit_return_type& res) {
+                   handle_prepare_commit(result_callback,
+                                         ticket_number,
+                                         shard_idx,
+                                         res);
+               })) {
+            m_log->error("Failed to make prepare commit shard request");
+            return error_code::shard_unreachable;
+        }
+        return std::nullopt;
+    }
+
+    void impl::handle_prepare_commit(
+        const commit_callback_type& commit_cb,
+        ticket_number_type ticket_number,
+        uint64_t shard_idx,
+        parsec::runtime_locking_shard::interface::commit_return_type res) {
+        auto callback = false;
+        auto maybe_error = [&]() -> std::optional<commit_return_type> {
+            auto [ts, l] = lock_ticket(ticket_number);
+            if(!ts) {
+                return error_code::unknown_ticket;
+            }
+
+            switch(ts->m_state) {
+                case ticket_state::begun:
+                    break;
+                case ticket_state::prepared:
+                    return error_code::prepared;
+                case ticket_state::committed:
+                    return error_code::committed;
+                case ticket_state::aborted:
+                    return error_code::aborted;
+            }
+
+            // The shard either committed the ticket or failed to prepare
+            // it, so handle the result as a prepare result and skip the
+            // commit phase if it succeeded.
+            auto prepared = false;
+            auto err = do_handle_prepare(ticket_number,
+                                         *ts,
+                                         shard_idx,
+                                         res,
+                                         prepared);
+            if(prepared) {
+                ts->m_shard_states[shard_idx].m_state
+                    = shard_state_type::committed;
+                ts->m_state = ticket_state::committed;
+                callback = true;
+                m_log->trace(this,
+                             "Broker handled prepare commit for",
+                             ticket_number);
+            }
+            return err;
+        }();
+
+        if(maybe_error.has_value()) {
+            m_log->trace(this,
+                         "Broker calling commit callback with error for",
+                         ticket_number);
+            commit_cb(maybe_error.value());
+        } else if(callback) {
+            commit_cb(std::nullopt);
+        }
+    }
+
     auto impl::finish(ticket_number_type ticket_number,
                       finish_callback_type result_callback) -> bool {
         auto done = false;
+        auto shard_idxs = std::vector<uint64_t>();
         auto maybe_error = [&]() -> std::optional<error_code> {
-            std::unique_lock l(m_mut);
-            auto it = m_tickets.find(ticket_number);
-            if(it == m_tickets.end()) {
+            auto [t_state, l] = lock_ticket(ticket_number);
+            if(!t_state) {
                 m_log->trace(this,
                              "Broker failing finish: [Unknown ticket] for ",
                              ticket_number);
                 return error_code::unknown_ticket;
             }
 
-            auto t_state = it->second;
             switch(t_state->m_state) {
                 case ticket_state::begun:
                     m_log->trace(this,
@@ -519,7 +1090,7 @@ namespace cbdc::parsec::broker {
                     break;
                 case ticket_state::aborted:
                     // Ticket already rolled back. Just delete the ticket.
-                    m_tickets.erase(it);
+                    erase_ticket(ticket_number, *t_state);
                     done = true;
                     return std::nullopt;
             }
@@ -539,9 +1110,16 @@ namespace cbdc::parsec::broker {
                                  " already finished");
                     continue;
                 }
-                auto sidx = shard.first;
-                assert(sidx < m_shards.size());
+                assert(shard.first < m_shards.size());
                 shard.second.m_state = shard_state_type::finishing;
+                shard_idxs.push_back(shard.first);
+            }
+
+            return std::nullopt;
+        }();
+
+        if(!maybe_error.has_value()) {
+            for(auto sidx : shard_idxs) {
                 if(!m_shards[sidx]->finish(
                        ticket_number,
                        [=, this](const parsec::runtime_locking_shard::
@@ -552,12 +1130,11 @@ namespace cbdc::parsec::broker {
                                          res);
                        })) {
                     m_log->error("Failed to make finish shard request");
-                    return error_code::shard_unreachable;
+                    maybe_error = error_code::shard_unreachable;
+                    break;
                 }
             }
-
-            return std::nullopt;
-        }();
+        }
 
         if(maybe_error.has_value()) {
             result_callback(maybe_error.value());
@@ -572,14 +1149,13 @@ namespace cbdc::parsec::broker {
                         rollback_callback_type result_callback) -> bool {
         m_log->trace(this, "Broker got rollback request for", ticket_number);
         auto callback = false;
+        auto shard_idxs = std::vector<uint64_t>();
         auto maybe_error = [&]() -> std::optional<error_code> {
-            std::unique_lock l(m_mut);
-            auto it = m_tickets.find(ticket_number);
-            if(it == m_tickets.end()) {
+            auto [t_state, l] = lock_ticket(ticket_number);
+            if(!t_state) {
                 return error_code::unknown_ticket;
             }
 
-            auto t_state = it->second;
             switch(t_state->m_state) {
                 case ticket_state::begun:
                     break;
@@ -612,9 +1188,16 @@ namespace cbdc::parsec::broker {
                                  " already rolled back");
                     continue;
                 }
-                auto sidx = shard.first;
-                assert(sidx < m_shards.size());
+                assert(shard.first < m_shards.size());
                 shard.second.m_state = shard_state_type::rolling_back;
+                shard_idxs.push_back(shard.first);
+            }
+
+            return std::nullopt;
+        }();
+
+        if(!maybe_error.has_value()) {
+            for(auto sidx : shard_idxs) {
                 if(!m_shards[sidx]->rollback(
                        ticket_number,
                        [=, this](const parsec::runtime_locking_shard::
@@ -625,12 +1208,11 @@ namespace cbdc::parsec::broker {
                                            res);
                        })) {
                     m_log->error("Failed to make rollback shard request");
-                    return error_code::shard_unreachable;
+                    maybe_error = error_code::shard_unreachable;
+                    break;
                 }
             }
-
-            return std::nullopt;
-        }();
+        }
 
         m_log->trace(this,
                      "Broker initiated rollback request for",
@@ -656,13 +1238,11 @@ namespace cbdc::parsec::broker {
         parsec::runtime_locking_shard::interface::rollback_return_type res) {
         auto callback = false;
         auto maybe_error = [&]() -> std::optional<error_code> {
-            std::unique_lock lll(m_mut);
-            auto ittt = m_tickets.find(ticket_number);
-            if(ittt == m_tickets.end()) {
+            auto [tss, lll] = lock_ticket(ticket_number);
+            if(!tss) {
                 return error_code::unknown_ticket;
             }
 
-            auto tss = ittt->second;
             switch(tss->m_state) {
                 case ticket_state::begun:
                     break;
@@ -735,16 +1315,16 @@ namespace cbdc::parsec::broker {
         try_lock_callback_type result_callback,
         std::optional<parsec::directory::interface::key_location_return_type>
             res) {
+        auto shard_idx = uint64_t{};
+        auto first_lock = false;
         auto maybe_error = [&]() -> std::optional<try_lock_return_type> {
-            std::unique_lock l(m_mut);
             assert(res < m_shards.size());
-            auto ticket = m_tickets.find(ticket_number);
-            if(ticket == m_tickets.end()) {
+            auto [tss, l] = lock_ticket(ticket_number);
+            if(!tss) {
                 m_log->error("Unknown ticket number");
                 return error_code::unknown_ticket;
             }
 
-            auto tss = ticket->second;
             switch(tss->m_state) {
                 case ticket_state::begun:
                     break;
@@ -760,9 +1340,9 @@ namespace cbdc::parsec::broker {
                 return error_code::directory_unreachable;
             }
 
-            auto shard_idx = res.value();
+            shard_idx = res.value();
             auto& ss = tss->m_shard_states[shard_idx];
-            auto first_lock = ss.m_key_states.empty();
+            first_lock = ss.m_key_states.empty();
             auto it = ss.m_key_states.find(key);
             if(it != ss.m_key_states.end()
                && it->second.m_key_state == key_state::locked
@@ -775,27 +1355,28 @@ namespace cbdc::parsec::broker {
 
             ks.m_key_state = key_state::locking;
             ks.m_locktype = locktype;
-
-            if(!m_shards[shard_idx]->try_lock(
-                   ticket_number,
-                   m_broker_id,
-                   key,
-                   locktype,
-                   first_lock,
-                   [=, this](const parsec::runtime_locking_shard::interface::
-                                 try_lock_return_type& lock_res) {
-                       handle_lock(ticket_number,
-                                   key,
-                                   shard_idx,
-                                   result_callback,
-                                   lock_res);
-                   })) {
-                m_log->error("Failed to make try_lock shard request");
-                return error_code::shard_unreachable;
-            }
             return std::nullopt;
         }();
 
+        if(!maybe_error.has_value()
+           && !m_shards[shard_idx]->try_lock(
+               ticket_number,
+               m_broker_id,
+               key,
+               locktype,
+               first_lock,
+               [=, this](const parsec::runtime_locking_shard::interface::
+                             try_lock_return_type& lock_res) {
+                   handle_lock(ticket_number,
+                               key,
+                               shard_idx,
+                               result_callback,
+                               lock_res);
+               })) {
+            m_log->error("Failed to make try_lock shard request");
+            maybe_error = error_code::shard_unreachable;
+        }
+
         if(maybe_error.has_value()) {
             result_callback(maybe_error.value());
         }
@@ -808,13 +1389,11 @@ namespace cbdc::parsec::broker {
         parsec::runtime_locking_shard::interface::finish_return_type res) {
         auto callback = false;
         auto maybe_error = [&]() -> std::optional<error_code> {
-            std::unique_lock lll(m_mut);
-            auto ittt = m_tickets.find(ticket_number);
-            if(ittt == m_tickets.end()) {
+            auto [tss, lll] = lock_ticket(ticket_number);
+            if(!tss) {
                 return error_code::unknown_ticket;
             }
 
-            auto tss = ittt->second;
             switch(tss->m_state) {
                 case ticket_state::begun:
                     return error_code::begun;
@@ -866,7 +1445,7 @@ namespace cbdc::parsec::broker {
 
             m_log->trace(this, "All shards finished for", ticket_number);
 
-            m_tickets.erase(ittt);
+            erase_ticket(ticket_number, *tss);
 
             callback = true;
             return std::nullopt;
@@ -881,11 +1460,7 @@ namespace cbdc::parsec::broker {
 
     auto impl::recover(recover_callback_type result_callback) -> bool {
         // Do not allow recovery when tickets are in-flight
-        auto maybe_tickets = [&]() {
-            std::unique_lock l(m_mut);
-            return !m_tickets.empty();
-        }();
-        if(maybe_tickets) {
+        if(!tickets_empty()) {
             return false;
         }
         for(uint64_t i = 0; i < m_shards.size(); i++) {
@@ -914,47 +1489,46 @@ namespace cbdc::parsec::broker {
             overloaded{[&](const runtime_locking_shard::interface::
                                get_tickets_success_type& tickets)
                            -> std::optional<error_code> {
-                           std::unique_lock l(m_mut);
-                           m_recovery_tickets.emplace(shard_idx, tickets);
-                           if(m_recovery_tickets.size() != m_shards.size()) {
-                               return std::nullopt;
-                           }
-                           for(auto& [s, ts] : m_recovery_tickets) {
-                               for(auto& [ticket_number, t_state] : ts) {
-                                   auto& ticket = m_tickets[ticket_number];
-                                   if(!ticket) {
-                                       ticket = std::make_shared<state>();
-                                   }
-                                   switch(t_state) {
-                                       case runtime_locking_shard::
-                                           ticket_state::begun:
-                                           ticket->m_shard_states[s].m_state
-                                               = shard_state_type::begun;
-                                           break;
-                                       case runtime_locking_shard::
-                                           ticket_state::committed:
-                                           ticket->m_shard_states[s].m_state
-                                               = shard_state_type::committed;
-                                           break;
-                                       case runtime_locking_shard::
-                                           ticket_state::prepared:
-                                           ticket->m_shard_states[s].m_state
-                                               = shard_state_type::prepared;
-                                           break;
-                                       case runtime_locking_shard::
-                                           ticket_state::wounded:
-                                           ticket->m_shard_states[s].m_state
-                                               = shard_state_type::wounded;
-                                           break;
+                           auto recovered = std::unordered_map<
+                               ticket_number_type,
+                               std::shared_ptr<state>>();
+                           {
+                               std::unique_lock l(m_recovery_mut);
+                               m_recovery_tickets.emplace(shard_idx, tickets);
+                               if(m_recovery_tickets.size()
+                                  != m_shards.size()) {
+                                   return std::nullopt;
+                               }
+                               for(auto& [s, ts] : m_recovery_tickets) {
+                                   for(auto& [ticket_number, t_state] : ts) {
+                                       auto& ticket
+                                           = recovered[ticket_number];
+                                       if(!ticket) {
+                                           ticket = std::make_shared<state>();
+                                       }
+                                       ticket->m_shard_states[s].m_state
+                                           = recovered_shard_state(t_state);
                                    }
                                }
+                               m_recovery_tickets.clear();
                            }
-                           if(m_tickets.empty()) {
+                           if(recovered.empty()) {
                                done = true;
                                return std::nullopt;
                            }
-                           m_recovery_tickets.clear();
-                           return do_recovery(result_callback);
+                           // Add every ticket before recovering any so the
+                           // table only empties once all are finished
+                           auto recovered_tickets = std::vector<
+                               std::pair<ticket_number_type,
+                                         std::shared_ptr<state>>>(
+                               recovered.begin(),
+                               recovered.end());
+                           for(auto& [ticket_number, ticket] :
+                               recovered_tickets) {
+                               add_ticket(ticket_number, ticket);
+                           }
+                           return do_recovery(result_callback,
+                                              recovered_tickets);
                        },
                        [&](const runtime_locking_shard::error_code& /* e */)
                            -> std::optional<error_code> {
@@ -970,27 +1544,56 @@ namespace cbdc::parsec::broker {
         m_log->trace(this, "Broker handled get_tickets for shard", shard_idx);
     }
 
-    auto impl::do_recovery(const recover_callback_type& result_callback)
+    auto impl::recovered_shard_state(runtime_locking_shard::ticket_state ts)
+        -> shard_state_type {
+        switch(ts) {
+            case runtime_locking_shard::ticket_state::begun:
+                return shard_state_type::begun;
+            case runtime_locking_shard::ticket_state::committed:
+                return shard_state_type::committed;
+            case runtime_locking_shard::ticket_state::prepared:
+                return shard_state_type::prepared;
+            case runtime_locking_shard::ticket_state::wounded:
+                return shard_state_type::wounded;
+        }
+        return shard_state_type::begun;
+    }
+
+    auto impl::do_recovery(
+        const recover_callback_type& result_callback,
+        const std::vector<std::pair<ticket_number_type,
+                                    std::shared_ptr<state>>>& tickets)
         -> std::optional<error_code> {
-        for(auto [ticket_number, ticket] : m_tickets) {
+        for(const auto& [ticket_number, ticket] : tickets) {
             size_t committed{};
-            for(auto& [sidx, t_state] : ticket->m_shard_states) {
-                switch(t_state.m_state) {
-                    case shard_state_type::begun:
-                    case shard_state_type::prepared:
-                    case shard_state_type::wounded:
-                        break;
-                    case shard_state_type::committed:
-                        committed++;
-                        break;
-                    default:
-                        m_log->fatal(this,
-                                     "Found invalid shard "
-                                     "state during recovery");
+            size_t n_shards{};
+            {
+                std::unique_lock l(ticket->m_mut);
+                n_shards = ticket->m_shard_states.size();
+                for(auto& [sidx, t_state] : ticket->m_shard_states) {
+                    switch(t_state.m_state) {
+                        case shard_state_type::begun:
+                        case shard_state_type::prepared:
+                        case shard_state_type::wounded:
+                            break;
+                        case shard_state_type::committed:
+                            committed++;
+                            break;
+                        default:
+                            m_log->fatal(this,
+                                         "Found invalid shard "
+                                         "state during recovery");
+                    }
+                }
+                if(committed == n_shards) {
+                    ticket->m_state = ticket_state::committed;
+                } else if(committed > 0) {
+                    ticket->m_state = ticket_state::prepared;
+                } else {
+                    ticket->m_state = ticket_state::begun;
                 }
             }
-            if(committed == ticket->m_shard_states.size()) {
-                ticket->m_state = ticket_state::committed;
+            if(committed == n_shards) {
                 auto success = finish(
                     ticket_number,
                     [&, result_callback](finish_return_type fin_res) {
@@ -1000,7 +1603,6 @@ namespace cbdc::parsec::broker {
                     return error_code::shard_unreachable;
                 }
             } else if(committed > 0) {
-                ticket->m_state = ticket_state::prepared;
                 auto success = commit(
                     ticket_number,
                     {},
@@ -1012,7 +1614,6 @@ namespace cbdc::parsec::broker {
                     return error_code::shard_unreachable;
                 }
             } else {
-                ticket->m_state = ticket_state::begun;
                 auto success
                     = rollback(ticket_number,
                                [&, result_callback, tn = ticket_number](
@@ -1055,11 +1656,7 @@ namespace cbdc::parsec::broker {
             result_callback(error_code::finish_error);
             return;
         }
-        auto done = [&]() {
-            std::unique_lock l(m_mut);
-            return m_tickets.empty();
-        }();
-        if(done) {
+        if(tickets_empty()) {
             result_callback(std::nullopt);
         }
     }
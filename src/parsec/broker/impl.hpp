@@ -10,30 +10,59 @@
 #include "parsec/directory/interface.hpp"
 #include "util/common/logging.hpp"
 
+#include <array>
+#include <chrono>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <queue>
 
 namespace cbdc::parsec::broker {
-    /// Implementation of a broker. Stores ticket states in memory.
-    /// Thread-safe.
+    /// \brief Implementation of a broker. Stores ticket states in memory.
+    ///
+    /// Leases whole ranges of ticket numbers from the ticket machine and
+    /// hands them out locally, requesting the next range before the
+    /// current one runs out. Wound-wait treats lower ticket numbers as
+    /// older transactions, so leased ranges expire after a fixed duration
+    /// to bound how much older a locally issued ticket can appear than
+    /// the transaction it identifies.
+    ///
+    /// Ticket states are kept in a table partitioned by ticket number, and
+    /// each ticket has its own mutex, so operations on different tickets
+    /// never contend. Requests to shards are sent after releasing the
+    /// ticket's mutex, so shards may call back synchronously without
+    /// re-entering it. Thread-safe.
     class impl : public interface {
       public:
+        /// Default duration after which unused leased ticket numbers are
+        /// discarded.
+        static constexpr auto default_ticket_lease_duration
+            = std::chrono::milliseconds(100);
+
         /// Constructor.
         /// \param broker_id unique ID of this broker instance.
         /// \param shards vector of shard instances.
         /// \param ticketer ticket machine instance.
         /// \param directory directory instance.
         /// \param logger log instance.
+        /// \param ticket_lease_duration duration after which unused ticket
+        ///                              numbers leased from the ticket
+        ///                              machine are discarded.
         impl(runtime_locking_shard::broker_id_type broker_id,
              std::vector<std::shared_ptr<runtime_locking_shard::interface>>
                  shards,
              std::shared_ptr<ticket_machine::interface> ticketer,
              std::shared_ptr<directory::interface> directory,
-             std::shared_ptr<logging::log> logger);
-
-        /// Requests a new ticket number from the ticket machine.
+             std::shared_ptr<logging::log> logger,
+             std::chrono::milliseconds ticket_lease_duration
+             = default_ticket_lease_duration);
+
+        /// Assigns a new ticket number from the leased range of ticket
+        /// numbers, requesting a new range from the ticket machine if the
+        /// lease is exhausted or close to it. Calls the callback before
+        /// returning if a leased ticket number is available.
         /// \param result_callback function to call with the begin result.
-        /// \return true if the request to the ticket machine was initiated
-        ///         successfully.
+        /// \return true.
         auto begin(begin_callback_type result_callback) -> bool override;
 
         /// Determines the shard responsible for the given key and issues a try
@@ -50,7 +79,22 @@ namespace cbdc::parsec::broker {
                       lock_type locktype,
                       try_lock_callback_type result_callback) -> bool override;
 
-        /// Commits the ticket on all shards involved in the ticket.
+        /// Determines the shards responsible for the given keys and issues a
+        /// single multi-key try lock request to each of them in parallel.
+        /// Keys already locked by the ticket are not requested again.
+        /// \param ticket_number ticket number.
+        /// \param locks keys to lock and the lock type for each key.
+        /// \param result_callback function to call with try_lock_many
+        ///                        result.
+        /// \return true.
+        auto try_lock_many(ticket_number_type ticket_number,
+                           std::vector<lock_request_type> locks,
+                           try_lock_many_callback_type result_callback)
+            -> bool override;
+
+        /// Commits the ticket on all shards involved in the ticket. If only
+        /// one shard holds locks for the ticket, prepares and commits it on
+        /// that shard with a single request rather than two.
         /// \param ticket_number ticket number.
         /// \param state_updates state updates to apply if ticket commits.
         /// \param result_callback function to call with commit result.
@@ -102,8 +146,29 @@ namespace cbdc::parsec::broker {
         std::shared_ptr<directory::interface> m_directory;
         std::shared_ptr<logging::log> m_log;
 
-        mutable std::recursive_mutex m_mut;
+        /// Range of ticket numbers leased from the ticket machine.
+        struct ticket_lease {
+            /// Next ticket number to hand out.
+            ticket_number_type m_next{};
+            /// End of the range, exclusive.
+            ticket_number_type m_end{};
+            /// Time after which the remaining ticket numbers are discarded.
+            std::chrono::steady_clock::time_point m_expiry{};
+        };
+
+        std::chrono::milliseconds m_ticket_lease_duration;
+        /// Protects the ticket leases and m_highest_ticket.
+        std::mutex m_lease_mut;
+        /// Highest ticket number handed out by begin. Leased ticket
+        /// numbers which are not handed out yet are not counted.
         ticket_number_type m_highest_ticket{};
+        /// Leased ticket numbers in the order they are handed out.
+        std::deque<ticket_lease> m_leases;
+        /// Size of the most recently leased range.
+        ticket_number_type m_lease_size{};
+        bool m_fetching_lease{false};
+        /// Begin requests waiting for a new lease.
+        std::queue<begin_callback_type> m_begin_callbacks;
 
         enum class shard_state_type : uint8_t {
             begun,
@@ -140,19 +205,62 @@ namespace cbdc::parsec::broker {
         using shard_states = std::unordered_map<size_t, shard_state>;
 
         struct state {
+            /// Protects the other members. Taken after no other mutex
+            /// except a lock batch's.
+            std::mutex m_mut;
             ticket_state m_state{};
             shard_states m_shard_states;
+            /// True once the ticket is removed from the ticket table.
+            bool m_erased{false};
+        };
+
+        /// Partition of the ticket table.
+        struct ticket_partition {
+            /// Protects m_tickets. May be taken while holding a ticket
+            /// mutex.
+            std::mutex m_mut;
+            std::unordered_map<ticket_number_type, std::shared_ptr<state>>
+                m_tickets;
         };
 
-        std::unordered_map<ticket_number_type, std::shared_ptr<state>>
-            m_tickets;
+        static constexpr size_t ticket_partition_count = 64;
+
+        std::array<ticket_partition, ticket_partition_count>
+            m_ticket_partitions;
+
+        using locked_ticket_type
+            = std::pair<std::shared_ptr<state>, std::unique_lock<std::mutex>>;
 
+        std::mutex m_recovery_mut;
         std::unordered_map<
             uint64_t,
             std::unordered_map<ticket_number_type,
                                runtime_locking_shard::ticket_state>>
             m_recovery_tickets;
 
+        /// State of a multi-key try lock request.
+        struct lock_batch {
+            std::mutex m_mut;
+            ticket_number_type m_ticket_number{};
+            std::vector<lock_request_type> m_locks;
+            /// Shard responsible for each key.
+            std::vector<uint64_t> m_shard_idxs;
+            /// Value of each key once locked.
+            std::vector<std::optional<value_type>> m_values;
+            /// Number of outstanding directory or shard requests.
+            size_t m_pending{};
+            bool m_done{false};
+            try_lock_many_callback_type m_callback;
+        };
+
+        /// Locks to request from one shard for a lock batch.
+        struct shard_lock_request {
+            /// Index of each lock in the batch.
+            std::vector<size_t> m_idxs;
+            std::vector<lock_request_type> m_locks;
+            bool m_first_lock{false};
+        };
+
         void handle_prepare(
             const commit_callback_type& commit_cb,
             ticket_number_type ticket_number,
@@ -173,10 +281,91 @@ namespace cbdc::parsec::broker {
                              try_lock_return_type& res);
 
         void handle_ticket_number(
-            begin_callback_type result_callback,
             std::optional<parsec::ticket_machine::interface::
                               get_ticket_number_return_type> res);
 
+        /// Removes and returns the next leased ticket number, discarding
+        /// expired and exhausted leases. Requires m_lease_mut.
+        auto take_leased_ticket() -> std::optional<ticket_number_type>;
+
+        /// Removes and returns the next ticket number of a lease and
+        /// updates m_highest_ticket. Requires m_lease_mut.
+        auto hand_out_ticket(ticket_lease& lease) -> ticket_number_type;
+
+        /// Returns true if a new lease should be requested from the ticket
+        /// machine. Marks the request as in flight if so. Requires
+        /// m_lease_mut.
+        auto should_fetch_lease() -> bool;
+
+        /// Requests a new ticket number range from the ticket machine.
+        /// Fails all waiting begin requests if the request could not be
+        /// initiated.
+        void fetch_lease();
+
+        /// Fails all begin requests waiting for a lease with the given
+        /// error.
+        void fail_begin_callbacks(error_code err);
+
+        /// Records the state of a newly assigned ticket number and calls the
+        /// begin callback with it.
+        void begin_ticket(ticket_number_type ticket_number,
+                          const begin_callback_type& result_callback);
+
+        auto ticket_partition_for(ticket_number_type ticket_number)
+            -> ticket_partition&;
+
+        /// Adds a ticket to the ticket table unless it is already there.
+        void add_ticket(ticket_number_type ticket_number,
+                        std::shared_ptr<state> ts);
+
+        /// Returns the ticket's state with its mutex held, or nullptr if
+        /// the ticket is not in the ticket table.
+        auto lock_ticket(ticket_number_type ticket_number)
+            -> locked_ticket_type;
+
+        /// Removes a ticket from the ticket table. Requires the ticket
+        /// mutex.
+        void erase_ticket(ticket_number_type ticket_number, state& ts);
+
+        /// Returns true if the ticket table is empty.
+        auto tickets_empty() -> bool;
+
+        /// Returns true if the ticket is not aborted and the given shard is
+        /// in the expected state. Used before sending each of a ticket's
+        /// shard requests, as earlier requests may have aborted it.
+        static auto shard_in_state(state& ts,
+                                   uint64_t shard_idx,
+                                   shard_state_type expected) -> bool;
+
+        /// Returns an error if the ticket cannot request locks. Restarts
+        /// aborted tickets. Requires the ticket mutex.
+        auto start_locking(ticket_number_type ticket_number, state& ts)
+            -> std::optional<error_code>;
+
+        void handle_find_keys(
+            const std::shared_ptr<lock_batch>& batch,
+            size_t idx,
+            std::optional<
+                parsec::directory::interface::key_location_return_type> res);
+
+        /// Sends the locks of the batch which are not already held to their
+        /// shards, one request per shard.
+        void request_lock_batch(const std::shared_ptr<lock_batch>& batch);
+
+        void handle_lock_many(
+            const std::shared_ptr<lock_batch>& batch,
+            uint64_t shard_idx,
+            const std::vector<size_t>& idxs,
+            parsec::runtime_locking_shard::interface::try_lock_many_return_type
+                res);
+
+        /// Calls the batch callback with the given result, or with the
+        /// values of the locked keys if std::nullopt, unless the callback
+        /// was already called.
+        static void
+        finish_lock_batch(lock_batch& batch,
+                          std::optional<try_lock_many_return_type> result);
+
         void handle_rollback(
             const rollback_callback_type& result_callback,
             ticket_number_type ticket_number,
@@ -217,26 +406,66 @@ namespace cbdc::parsec::broker {
                                  ticket_number_type ticket_number,
                                  rollback_return_type res);
 
+        /// Marks the shards which have not committed the ticket as
+        /// committing and returns their indices. Requires the ticket mutex.
+        static auto start_commit(state& ts) -> std::vector<uint64_t>;
+
+        /// Sends commit requests to the given shards. Requires the ticket
+        /// mutex not be held.
         auto do_commit(const commit_callback_type& commit_cb,
                        ticket_number_type ticket_number,
-                       const std::shared_ptr<state>& ts)
+                       const std::shared_ptr<state>& ts,
+                       const std::vector<uint64_t>& shard_idxs)
             -> std::optional<error_code>;
 
-        auto do_handle_prepare(const commit_callback_type& commit_cb,
-                               ticket_number_type ticket_number,
-                               const std::shared_ptr<state>& ts,
+        /// Handles a prepare result. Sets commit to true if the ticket is
+        /// now prepared on every shard. Requires the ticket mutex.
+        auto do_handle_prepare(ticket_number_type ticket_number,
+                               state& ts,
                                uint64_t shard_idx,
                                const parsec::runtime_locking_shard::interface::
-                                   prepare_return_type& res)
+                                   prepare_return_type& res,
+                               bool& commit)
             -> std::optional<commit_return_type>;
 
-        auto do_prepare(const commit_callback_type& result_callback,
-                        ticket_number_type ticket_number,
-                        const std::shared_ptr<state>& t_state,
-                        const state_update_type& state_updates)
+        /// Marks the shards which have not prepared the ticket as preparing
+        /// and returns their indices with the state updates for each.
+        /// Requires the ticket mutex.
+        static auto start_prepare(state& t_state,
+                                  const state_update_type& state_updates)
+            -> std::vector<std::pair<uint64_t, state_update_type>>;
+
+        /// Sends prepare requests to the given shards. Requires the ticket
+        /// mutex not be held.
+        auto do_prepare(
+            const commit_callback_type& result_callback,
+            ticket_number_type ticket_number,
+            const std::shared_ptr<state>& t_state,
+            std::vector<std::pair<uint64_t, state_update_type>> requests)
+            -> std::optional<error_code>;
+
+        /// Sends a combined prepare and commit request to the only shard
+        /// involved in the ticket. Requires the ticket mutex not be held.
+        auto do_prepare_commit(const commit_callback_type& result_callback,
+                               ticket_number_type ticket_number,
+                               uint64_t shard_idx,
+                               state_update_type shard_updates)
             -> std::optional<error_code>;
 
-        auto do_recovery(const recover_callback_type& result_callback)
+        void handle_prepare_commit(
+            const commit_callback_type& commit_cb,
+            ticket_number_type ticket_number,
+            uint64_t shard_idx,
+            parsec::runtime_locking_shard::interface::commit_return_type res);
+
+        static auto
+        recovered_shard_state(runtime_locking_shard::ticket_state ts)
+            -> shard_state_type;
+
+        auto do_recovery(
+            const recover_callback_type& result_callback,
+            const std::vector<std::pair<ticket_number_type,
+                                        std::shared_ptr<state>>>& tickets)
             -> std::optional<error_code>;
     };
 }
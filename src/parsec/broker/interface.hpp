@@ -20,6 +20,8 @@ namespace cbdc::parsec::broker {
     using state_update_type = runtime_locking_shard::state_update_type;
     /// Shard lock type.
     using lock_type = runtime_locking_shard::lock_type;
+    /// Key to lock and the type of lock to acquire on it.
+    using lock_request_type = runtime_locking_shard::lock_request_type;
     /// Set of held locks
     using held_locks_set_type = std::
         unordered_map<key_type, lock_type, hashing::const_sip_hash<key_type>>;
@@ -120,6 +122,30 @@ namespace cbdc::parsec::broker {
                  try_lock_callback_type result_callback) -> bool
             = 0;
 
+        /// Return type from a multi-key try lock operation. Either the values
+        /// associated with the requested keys, in the order they were
+        /// requested, a broker error, or a shard error.
+        using try_lock_many_return_type
+            = std::variant<std::vector<value_type>,
+                           error_code,
+                           runtime_locking_shard::shard_error>;
+        /// Callback function type for a multi-key try lock operation.
+        using try_lock_many_callback_type
+            = std::function<void(try_lock_many_return_type)>;
+
+        /// Attempts to acquire the given locks, sending a single request to
+        /// each shard involved.
+        /// \param ticket_number ticket number.
+        /// \param locks keys to lock and the lock type for each key. Each
+        ///              key may appear only once.
+        /// \param result_callback function to call with try lock result.
+        /// \return true if the operation was initiated successfully.
+        [[nodiscard]] virtual auto
+        try_lock_many(ticket_number_type ticket_number,
+                      std::vector<lock_request_type> locks,
+                      try_lock_many_callback_type result_callback) -> bool
+            = 0;
+
         /// Return type from a commit operation. Broker or shard error code, if
         /// applicable.
         using commit_return_type = std::optional<
@@ -0,0 +1,70 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "consistent_hash.hpp"
+
+#include "crypto/siphash.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace cbdc::parsec::directory {
+    namespace {
+        // Fixed key so every broker places keys identically
+        constexpr uint64_t siphash_key = 0x1337;
+    }
+
+    consistent_hash::consistent_hash(size_t n_shards,
+                                     size_t virtual_nodes,
+                                     size_t prefix_length)
+        : m_prefix_length(prefix_length) {
+        assert(n_shards > 0);
+        virtual_nodes = std::max<size_t>(virtual_nodes, 1);
+        m_ring.reserve(n_shards * virtual_nodes);
+        for(uint64_t shard{0}; shard < n_shards; shard++) {
+            for(uint64_t vnode{0}; vnode < virtual_nodes; vnode++) {
+                // Virtual node positions only depend on the shard and
+                // virtual node indices, so existing shards keep their
+                // positions when shards are added.
+                auto hasher = CSipHasher(siphash_key, siphash_key);
+                hasher.Write(shard);
+                hasher.Write(vnode);
+                m_ring.emplace_back(hasher.Finalize(), shard);
+            }
+        }
+        std::sort(m_ring.begin(), m_ring.end());
+    }
+
+    auto consistent_hash::key_location(
+        runtime_locking_shard::key_type key,
+        key_location_callback_type result_callback) -> bool {
+        result_callback(locate(key));
+        return true;
+    }
+
+    auto consistent_hash::locate(const runtime_locking_shard::key_type& key)
+        const -> key_location_return_type {
+        auto len = key.size();
+        if(m_prefix_length != 0) {
+            len = std::min(len, m_prefix_length);
+        }
+        auto hasher = CSipHasher(siphash_key, siphash_key);
+        hasher.Write(key.c_ptr(), len);
+        const auto key_hash = hasher.Finalize();
+
+        auto it = std::lower_bound(
+            m_ring.begin(),
+            m_ring.end(),
+            key_hash,
+            [](const auto& node, uint64_t hash) {
+                return node.first < hash;
+            });
+        // Wrap around to the first virtual node
+        if(it == m_ring.end()) {
+            it = m_ring.begin();
+        }
+        return it->second;
+    }
+}
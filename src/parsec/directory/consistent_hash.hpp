@@ -0,0 +1,65 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PARSEC_DIRECTORY_CONSISTENT_HASH_H_
+#define OPENCBDC_TX_SRC_PARSEC_DIRECTORY_CONSISTENT_HASH_H_
+
+#include "interface.hpp"
+
+#include <vector>
+
+namespace cbdc::parsec::directory {
+    /// \brief Directory which places keys on a consistent-hash ring.
+    ///
+    /// Each shard owns a number of virtual nodes at pseudo-random points on
+    /// the ring, and a key belongs to the shard owning the first virtual
+    /// node at or after the key's hash. Adding a shard only moves the keys
+    /// which fall just before the new shard's virtual nodes, about 1/n of
+    /// all keys, rather than almost every key.
+    ///
+    /// Optionally hashes only a fixed-length prefix of each key, so that
+    /// related keys sharing the prefix are placed on the same shard. For
+    /// example, a prefix of 20 bytes co-locates an EVM account with its
+    /// code and storage. Thread-safe.
+    class consistent_hash : public interface {
+      public:
+        /// Default number of virtual nodes per shard.
+        static constexpr size_t default_virtual_nodes = 128;
+
+        /// Constructor.
+        /// \param n_shards number of shards available to the directory.
+        /// \param virtual_nodes number of points each shard owns on the
+        ///                      ring.
+        /// \param prefix_length number of leading key bytes which determine
+        ///                      the key's shard, or zero to use whole keys.
+        ///                      Keys no longer than the prefix are hashed
+        ///                      whole.
+        explicit consistent_hash(size_t n_shards,
+                                 size_t virtual_nodes = default_virtual_nodes,
+                                 size_t prefix_length = 0);
+
+        /// Returns the shard ID responsible for the given key. Calls the
+        /// callback before returning.
+        /// \param key key to locate.
+        /// \param result_callback function to call with key location.
+        /// \return true.
+        auto key_location(runtime_locking_shard::key_type key,
+                          key_location_callback_type result_callback)
+            -> bool override;
+
+        /// Returns the shard ID responsible for the given key.
+        /// \param key key to locate.
+        /// \return shard ID.
+        [[nodiscard]] auto locate(const runtime_locking_shard::key_type& key)
+            const -> key_location_return_type;
+
+      private:
+        /// Virtual node positions and their shard IDs, sorted by position.
+        std::vector<std::pair<uint64_t, key_location_return_type>> m_ring;
+        size_t m_prefix_length{};
+    };
+}
+
+#endif
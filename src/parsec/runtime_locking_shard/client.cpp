@@ -38,6 +38,27 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
             });
     }
 
+    auto client::try_lock_many(ticket_number_type ticket_number,
+                               broker_id_type broker_id,
+                               std::vector<lock_request_type> locks,
+                               bool first_lock,
+                               try_lock_many_callback_type result_callback)
+        -> bool {
+        auto req = try_lock_many_request{ticket_number,
+                                         broker_id,
+                                         std::move(locks),
+                                         first_lock};
+        return m_client->call(
+            std::move(req),
+            [result_callback](std::optional<response> resp) {
+                assert(resp.has_value());
+                assert(std::holds_alternative<try_lock_many_return_type>(
+                    resp.value()));
+                result_callback(
+                    std::get<try_lock_many_return_type>(resp.value()));
+            });
+    }
+
     auto client::prepare(ticket_number_type ticket_number,
                          broker_id_type broker_id,
                          state_update_type state_update,
@@ -66,6 +87,24 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
             });
     }
 
+    auto client::prepare_commit(ticket_number_type ticket_number,
+                                broker_id_type broker_id,
+                                state_update_type state_update,
+                                commit_callback_type result_callback)
+        -> bool {
+        auto req = prepare_commit_request{ticket_number,
+                                          std::move(state_update),
+                                          broker_id};
+        return m_client->call(
+            std::move(req),
+            [result_callback](std::optional<response> resp) {
+                assert(resp.has_value());
+                assert(
+                    std::holds_alternative<commit_return_type>(resp.value()));
+                result_callback(std::get<commit_return_type>(resp.value()));
+            });
+    }
+
     auto client::rollback(ticket_number_type ticket_number,
                           rollback_callback_type result_callback) -> bool {
         auto req = rollback_request{ticket_number};
@@ -45,6 +45,20 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
                       bool first_lock,
                       try_lock_callback_type result_callback) -> bool override;
 
+        /// Requests a multi-key try lock operation from the remote shard.
+        /// \param ticket_number ticket number.
+        /// \param broker_id ID of broker managing ticket.
+        /// \param locks keys to lock and the lock type for each key.
+        /// \param first_lock true if these are the first locks.
+        /// \param result_callback function to call with try lock result.
+        /// \return true if the request was sent successfully.
+        auto try_lock_many(ticket_number_type ticket_number,
+                           broker_id_type broker_id,
+                           std::vector<lock_request_type> locks,
+                           bool first_lock,
+                           try_lock_many_callback_type result_callback)
+            -> bool override;
+
         /// Requests a prepare operation from the remote shard.
         /// \param ticket_number ticket number.
         /// \param broker_id ID of broker managing ticket.
@@ -63,6 +77,19 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
         auto commit(ticket_number_type ticket_number,
                     commit_callback_type result_callback) -> bool override;
 
+        /// Requests a combined prepare and commit operation from the
+        /// remote shard.
+        /// \param ticket_number ticket number.
+        /// \param broker_id ID of broker managing ticket.
+        /// \param state_update state updates to apply.
+        /// \param result_callback function to call with commit result.
+        /// \return true if the request was sent successfully.
+        auto prepare_commit(ticket_number_type ticket_number,
+                            broker_id_type broker_id,
+                            state_update_type state_update,
+                            commit_callback_type result_callback)
+            -> bool override;
+
         /// Requests a rollback operation from the remote shard.
         /// \param ticket_number ticket number.
         /// \param result_callback function to call with the rollback result.
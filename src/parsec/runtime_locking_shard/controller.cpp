@@ -16,7 +16,9 @@ namespace cbdc::parsec::runtime_locking_shard {
                            size_t node_id,
                            network::endpoint_t server_endpoint,
                            std::vector<network::endpoint_t> raft_endpoints,
-                           std::shared_ptr<logging::log> logger)
+                           std::shared_ptr<logging::log> logger,
+                           bool segmented_log,
+                           bool log_sync)
         : m_logger(std::move(logger)),
           m_state_machine(nuraft::cs_new<state_machine>()),
           m_raft_serv(std::make_shared<raft::node>(
@@ -30,7 +32,9 @@ namespace cbdc::parsec::runtime_locking_shard {
               [&](auto&& res, auto&& err) {
                   return raft_callback(std::forward<decltype(res)>(res),
                                        std::forward<decltype(err)>(err));
-              })),
+              },
+              segmented_log,
+              log_sync)),
           m_raft_client(
               std::make_shared<replicated_shard_client>(m_raft_serv)),
           m_raft_endpoints(std::move(raft_endpoints)),
@@ -24,11 +24,17 @@ namespace cbdc::parsec::runtime_locking_shard {
         /// \param raft_endpoints vector of raft endpoints for nodes in the
         ///                       cluster.
         /// \param logger log to use for output.
+        /// \param segmented_log true to store the raft log in append-only
+        ///                      segment files instead of LevelDB.
+        /// \param log_sync true to sync raft log writes to disk before they
+        ///                 are acknowledged.
         controller(size_t component_id,
                    size_t node_id,
                    network::endpoint_t server_endpoint,
                    std::vector<network::endpoint_t> raft_endpoints,
-                   std::shared_ptr<logging::log> logger);
+                   std::shared_ptr<logging::log> logger,
+                   bool segmented_log = false,
+                   bool log_sync = false);
         ~controller() = default;
 
         controller() = delete;
@@ -22,6 +22,21 @@ namespace cbdc {
             >> req.m_locktype >> req.m_first_lock;
     }
 
+    auto operator<<(
+        serializer& ser,
+        const parsec::runtime_locking_shard::rpc::try_lock_many_request& req)
+        -> serializer& {
+        return ser << req.m_ticket_number << req.m_broker_id << req.m_locks
+                   << req.m_first_lock;
+    }
+    auto
+    operator>>(serializer& deser,
+               parsec::runtime_locking_shard::rpc::try_lock_many_request& req)
+        -> serializer& {
+        return deser >> req.m_ticket_number >> req.m_broker_id >> req.m_locks
+            >> req.m_first_lock;
+    }
+
     auto
     operator<<(serializer& ser,
                const parsec::runtime_locking_shard::rpc::commit_request& req)
@@ -48,6 +63,21 @@ namespace cbdc {
             >> req.m_broker_id;
     }
 
+    auto operator<<(
+        serializer& ser,
+        const parsec::runtime_locking_shard::rpc::prepare_commit_request& req)
+        -> serializer& {
+        return ser << req.m_ticket_number << req.m_state_updates
+                   << req.m_broker_id;
+    }
+    auto
+    operator>>(serializer& deser,
+               parsec::runtime_locking_shard::rpc::prepare_commit_request& req)
+        -> serializer& {
+        return deser >> req.m_ticket_number >> req.m_state_updates
+            >> req.m_broker_id;
+    }
+
     auto
     operator<<(serializer& ser,
                const parsec::runtime_locking_shard::rpc::rollback_request& req)
@@ -122,6 +152,21 @@ namespace cbdc {
             >> req.m_state_update;
     }
 
+    auto operator<<(serializer& ser,
+                    const parsec::runtime_locking_shard::rpc::
+                        replicated_prepare_commit_request& req)
+        -> serializer& {
+        return ser << req.m_ticket_number << req.m_broker_id
+                   << req.m_state_update;
+    }
+    auto operator>>(serializer& deser,
+                    parsec::runtime_locking_shard::rpc::
+                        replicated_prepare_commit_request& req)
+        -> serializer& {
+        return deser >> req.m_ticket_number >> req.m_broker_id
+            >> req.m_state_update;
+    }
+
     auto operator<<(serializer& ser,
                     const parsec::runtime_locking_shard::rpc::
                         replicated_get_tickets_request& /* req */)
@@ -18,6 +18,15 @@ namespace cbdc {
                     parsec::runtime_locking_shard::rpc::try_lock_request& req)
         -> serializer&;
 
+    auto operator<<(
+        serializer& ser,
+        const parsec::runtime_locking_shard::rpc::try_lock_many_request& req)
+        -> serializer&;
+    auto
+    operator>>(serializer& deser,
+               parsec::runtime_locking_shard::rpc::try_lock_many_request& req)
+        -> serializer&;
+
     auto
     operator<<(serializer& ser,
                const parsec::runtime_locking_shard::rpc::commit_request& req)
@@ -34,6 +43,15 @@ namespace cbdc {
                     parsec::runtime_locking_shard::rpc::prepare_request& req)
         -> serializer&;
 
+    auto operator<<(
+        serializer& ser,
+        const parsec::runtime_locking_shard::rpc::prepare_commit_request& req)
+        -> serializer&;
+    auto
+    operator>>(serializer& deser,
+               parsec::runtime_locking_shard::rpc::prepare_commit_request& req)
+        -> serializer&;
+
     auto
     operator<<(serializer& ser,
                const parsec::runtime_locking_shard::rpc::rollback_request& req)
@@ -82,6 +100,15 @@ namespace cbdc {
         parsec::runtime_locking_shard::rpc::replicated_prepare_request& req)
         -> serializer&;
 
+    auto operator<<(serializer& ser,
+                    const parsec::runtime_locking_shard::rpc::
+                        replicated_prepare_commit_request& req)
+        -> serializer&;
+    auto operator>>(serializer& deser,
+                    parsec::runtime_locking_shard::rpc::
+                        replicated_prepare_commit_request& req)
+        -> serializer&;
+
     auto operator<<(serializer& ser,
                     const parsec::runtime_locking_shard::rpc::
                         replicated_get_tickets_request& req) -> serializer&;
@@ -5,11 +5,13 @@
 
 #include "impl.hpp"
 
+#include <algorithm>
 #include <cassert>
 
 namespace cbdc::parsec::runtime_locking_shard {
-    impl::impl(std::shared_ptr<logging::log> logger)
-        : m_log(std::move(logger)) {}
+    impl::impl(std::shared_ptr<logging::log> logger, size_t stripe_count)
+        : m_log(std::move(logger)),
+          m_stripes(std::max<size_t>(stripe_count, 1)) {}
 
     auto impl::try_lock(ticket_number_type ticket_number,
                         broker_id_type broker_id,
@@ -17,16 +19,152 @@ namespace cbdc::parsec::runtime_locking_shard {
                         lock_type locktype,
                         bool first_lock,
                         try_lock_callback_type result_callback) -> bool {
-        auto callbacks = pending_callbacks_list_type();
-        auto w_details = std::optional<wounded_details>();
-        auto maybe_error = [&]() -> std::optional<error_code> {
-            std::unique_lock<std::mutex> l(m_mut);
+        m_log->trace(ticket_number,
+                     "requesting lock on",
+                     key.to_hex(),
+                     static_cast<int>(locktype));
+
+        auto locks = std::vector<lock_request_type>();
+        locks.emplace_back(std::move(key), locktype);
+        auto callbacks = std::vector<try_lock_callback_type>();
+        callbacks.emplace_back(result_callback);
+
+        auto maybe_error = queue_locks(ticket_number,
+                                       broker_id,
+                                       std::move(locks),
+                                       first_lock,
+                                       std::move(callbacks));
+        if(maybe_error.has_value()) {
+            result_callback(maybe_error.value());
+        }
 
-            m_log->trace(ticket_number,
-                         "requesting lock on",
-                         key.to_hex(),
-                         static_cast<int>(locktype));
+        return true;
+    }
+
+    auto impl::try_lock_many(ticket_number_type ticket_number,
+                             broker_id_type broker_id,
+                             std::vector<lock_request_type> locks,
+                             bool first_lock,
+                             try_lock_many_callback_type result_callback)
+        -> bool {
+        // Collects the result of each lock and calls the result callback
+        // once every lock is acquired, or with the first error.
+        struct lock_results {
+            std::mutex m_mut;
+            std::vector<std::optional<value_type>> m_values;
+            size_t m_pending{};
+            bool m_done{false};
+            try_lock_many_callback_type m_callback;
+        };
+
+        m_log->trace(ticket_number, "requesting", locks.size(), "locks");
+
+        auto results = std::make_shared<lock_results>();
+        results->m_values.resize(locks.size());
+        results->m_pending = locks.size();
+        results->m_callback = result_callback;
+
+        auto callbacks = std::vector<try_lock_callback_type>();
+        callbacks.reserve(locks.size());
+        for(size_t i{0}; i < locks.size(); i++) {
+            callbacks.emplace_back([results, i](try_lock_return_type res) {
+                auto ret = std::optional<try_lock_many_return_type>();
+                {
+                    std::unique_lock l(results->m_mut);
+                    if(results->m_done) {
+                        return;
+                    }
+                    if(auto* err = std::get_if<shard_error>(&res)) {
+                        results->m_done = true;
+                        ret = std::move(*err);
+                    } else {
+                        results->m_values[i]
+                            = std::move(std::get<value_type>(res));
+                        results->m_pending--;
+                        if(results->m_pending == 0) {
+                            results->m_done = true;
+                            auto values = std::vector<value_type>();
+                            values.reserve(results->m_values.size());
+                            for(auto& v : results->m_values) {
+                                values.emplace_back(std::move(v.value()));
+                            }
+                            ret = std::move(values);
+                        }
+                    }
+                }
+                if(ret.has_value()) {
+                    results->m_callback(std::move(ret.value()));
+                }
+            });
+        }
+
+        auto empty = locks.empty();
+        auto maybe_error = queue_locks(ticket_number,
+                                       broker_id,
+                                       std::move(locks),
+                                       first_lock,
+                                       std::move(callbacks));
+        if(maybe_error.has_value()) {
+            result_callback(maybe_error.value());
+        } else if(empty) {
+            result_callback(std::vector<value_type>());
+        }
 
+        return true;
+    }
+
+    auto impl::stripe_index(const key_type& key) const -> size_t {
+        return hashing::const_sip_hash<key_type>()(key) % m_stripes.size();
+    }
+
+    auto impl::find_ticket(ticket_number_type ticket_number)
+        -> std::shared_ptr<ticket_state_type> {
+        std::unique_lock l(m_tickets_mut);
+        auto it = m_tickets.find(ticket_number);
+        if(it == m_tickets.end()) {
+            return nullptr;
+        }
+        return it->second;
+    }
+
+    auto impl::lock_stripes(const stripe_set_type& stripes)
+        -> std::vector<std::unique_lock<std::mutex>> {
+        auto locks = std::vector<std::unique_lock<std::mutex>>();
+        locks.reserve(stripes.size());
+        for(auto idx : stripes) {
+            locks.emplace_back(m_stripes[idx].m_mut);
+        }
+        return locks;
+    }
+
+    auto impl::lock_ticket(ticket_state_type& ticket)
+        -> std::pair<std::vector<std::unique_lock<std::mutex>>,
+                     std::unique_lock<std::mutex>> {
+        // The ticket's stripes can only grow while their mutexes are held,
+        // so retry until the set is unchanged after locking them.
+        while(true) {
+            auto stripes = [&]() {
+                std::unique_lock l(ticket.m_mut);
+                return ticket.m_stripes;
+            }();
+            auto stripe_locks = lock_stripes(stripes);
+            auto l = std::unique_lock(ticket.m_mut);
+            if(ticket.m_stripes == stripes) {
+                return {std::move(stripe_locks), std::move(l)};
+            }
+        }
+    }
+
+    auto impl::queue_locks(ticket_number_type ticket_number,
+                           broker_id_type broker_id,
+                           std::vector<lock_request_type> locks,
+                           bool first_lock,
+                           std::vector<try_lock_callback_type> lock_callbacks)
+        -> std::optional<shard_error> {
+        assert(locks.size() == lock_callbacks.size());
+
+        auto ticket = [&]() -> std::shared_ptr<ticket_state_type> {
+            std::unique_lock l(m_tickets_mut);
             auto it = m_tickets.find(ticket_number);
             if(first_lock && it != m_tickets.end()) {
                 m_log->fatal(ticket_number,
@@ -35,121 +173,230 @@ namespace cbdc::parsec::runtime_locking_shard {
             }
             if(it == m_tickets.end()) {
                 if(!first_lock) {
-                    m_log->error(ticket_number,
-                                 "called try_lock with unknown ticket");
-                    return error_code::unknown_ticket;
+                    return nullptr;
                 }
-                it = m_tickets.emplace(ticket_number, ticket_state_type{})
+                it = m_tickets
+                         .emplace(ticket_number,
+                                  std::make_shared<ticket_state_type>())
                          .first;
             }
-            auto& ticket = it->second;
-
-            // Callers shouldn't be using try_lock after prepare
-            if(ticket.m_state == ticket_state::prepared) {
-                m_log->error(ticket_number, "called try_lock after prepare");
-                return error_code::prepared;
-            }
+            return it->second;
+        }();
+        if(!ticket) {
+            m_log->error(ticket_number, "called try_lock with unknown ticket");
+            return shard_error{error_code::unknown_ticket, std::nullopt};
+        }
 
-            if(ticket.m_state == ticket_state::committed) {
-                m_log->error(ticket_number, "called try_lock after commit");
-                return error_code::committed;
-            }
+        auto stripes = stripe_set_type();
+        auto key_stripes = std::vector<size_t>();
+        key_stripes.reserve(locks.size());
+        for(const auto& [key, locktype] : locks) {
+            auto idx = stripe_index(key);
+            key_stripes.push_back(idx);
+            stripes.insert(idx);
+        }
 
-            // If the ticket way wounded don't bother trying to acquire any
-            // locks
-            if(ticket.m_state == ticket_state::wounded) {
-                m_log->trace(ticket_number,
-                             "called try_lock after being wounded");
-                w_details = ticket.m_wounded_details;
-                return error_code::wounded;
-            }
+        auto callbacks = pending_callbacks_list_type();
+        auto wounded = std::vector<wounded_ticket_type>();
+        {
+            auto stripe_locks = lock_stripes(stripes);
+            {
+                std::unique_lock l(ticket->m_mut);
+                if(ticket->m_erased) {
+                    m_log->error(ticket_number,
+                                 "called try_lock with unknown ticket");
+                    return shard_error{error_code::unknown_ticket,
+                                       std::nullopt};
+                }
 
-            // Make sure the ticket doesn't already hold a lock on the key
-            if(auto lock_it = ticket.m_locks_held.find(key);
-               lock_it != ticket.m_locks_held.end()
-               && lock_it->second >= locktype) {
-                m_log->warn(this,
-                            ticket_number,
-                            "tried to acquire already held lock");
-                return error_code::lock_held;
-            }
+                // Callers shouldn't be using try_lock after prepare
+                if(ticket->m_state == ticket_state::prepared) {
+                    m_log->error(ticket_number,
+                                 "called try_lock after prepare");
+                    return shard_error{error_code::prepared, std::nullopt};
+                }
 
-            if(ticket.m_queued_locks.find(key)
-               != ticket.m_queued_locks.end()) {
-                m_log->warn(ticket_number,
-                            "tried to acquire already queued lock");
-                return error_code::lock_queued;
-            }
+                if(ticket->m_state == ticket_state::committed) {
+                    m_log->error(ticket_number,
+                                 "called try_lock after commit");
+                    return shard_error{error_code::committed, std::nullopt};
+                }
 
-            ticket.m_broker_id = broker_id;
+                // If the ticket way wounded don't bother trying to acquire
+                // any locks
+                if(ticket->m_state == ticket_state::wounded) {
+                    m_log->trace(ticket_number,
+                                 "called try_lock after being wounded");
+                    return shard_error{error_code::wounded,
+                                       ticket->m_wounded_details};
+                }
 
-            // Grab the requested state element
-            auto& state_element = m_state[key];
-            auto& lock = state_element.m_lock;
+                // Check every lock before queuing any so the request either
+                // queues all its locks or none of them
+                auto requested = key_set_type();
+                for(size_t i{0}; i < locks.size(); i++) {
+                    const auto& [key, locktype] = locks[i];
+                    auto& stripe = m_stripes[key_stripes[i]];
+                    auto it = stripe.m_tickets.find(ticket_number);
+                    if(it != stripe.m_tickets.end()) {
+                        // Make sure the ticket doesn't already hold a lock
+                        // on the key
+                        auto& held = it->second.m_locks_held;
+                        if(auto lock_it = held.find(key);
+                           lock_it != held.end()
+                           && lock_it->second >= locktype) {
+                            m_log->warn(this,
+                                        ticket_number,
+                                        "tried to acquire already held lock");
+                            return shard_error{error_code::lock_held,
+                                               std::nullopt};
+                        }
+
+                        auto& queued = it->second.m_queued_locks;
+                        if(queued.find(key) != queued.end()) {
+                            m_log->warn(ticket_number,
+                                        "tried to acquire already queued "
+                                        "lock");
+                            return shard_error{error_code::lock_queued,
+                                               std::nullopt};
+                        }
+                    }
+                    if(!requested.insert(key).second) {
+                        m_log->warn(ticket_number,
+                                    "requested the same lock twice");
+                        return shard_error{error_code::lock_queued,
+                                           std::nullopt};
+                    }
+                }
 
-            // Queue the lock
-            lock.m_queue.emplace(
-                ticket_number,
-                lock_queue_element_type{locktype, std::move(result_callback)});
-            ticket.m_queued_locks.insert(key);
+                ticket->m_broker_id = broker_id;
+                ticket->m_stripes.insert(stripes.begin(), stripes.end());
+            }
 
-            // Determine if the ticket will wait on any locks
-            auto waiting_on = get_waiting_on(ticket_number, locktype, lock);
-            callbacks
-                = wound_tickets(std::move(key), waiting_on, ticket_number);
+            for(size_t i{0}; i < locks.size(); i++) {
+                auto& [key, locktype] = locks[i];
+                auto& stripe = m_stripes[key_stripes[i]];
+
+                // Queue the lock
+                auto& lock = stripe.m_state[key].m_lock;
+                lock.m_queue.emplace(
+                    ticket_number,
+                    lock_queue_element_type{locktype,
+                                            std::move(lock_callbacks[i])});
+                stripe.m_tickets[ticket_number].m_queued_locks.insert(key);
+
+                // Determine if the ticket will wait on any locks
+                auto waiting_on
+                    = get_waiting_on(ticket_number, locktype, lock);
+                auto wounded_tickets = wound_tickets(key,
+                                                     waiting_on,
+                                                     ticket_number,
+                                                     stripes,
+                                                     callbacks);
+                wounded.insert(
+                    wounded.end(),
+                    std::make_move_iterator(wounded_tickets.begin()),
+                    std::make_move_iterator(wounded_tickets.end()));
+
+                auto acquire_callbacks = acquire_locks(stripe, {key});
+                callbacks.insert(
+                    callbacks.end(),
+                    std::make_move_iterator(acquire_callbacks.begin()),
+                    std::make_move_iterator(acquire_callbacks.end()));
+            }
+        }
 
-            w_details = ticket.m_wounded_details;
+        // Release the wounded tickets' remaining locks after unlocking the
+        // requested stripes so stripe mutexes are taken in order
+        auto release_callbacks = release_wounded(wounded);
+        callbacks.insert(callbacks.end(),
+                         std::make_move_iterator(release_callbacks.begin()),
+                         std::make_move_iterator(release_callbacks.end()));
 
-            m_log->trace(this, "shard handled try_lock for", ticket_number);
-            return std::nullopt;
-        }();
+        m_log->trace(this, "shard handled try_lock for", ticket_number);
 
-        if(maybe_error.has_value()) {
-            result_callback(shard_error{maybe_error.value(), w_details});
-        } else {
-            // Call all the result callbacks without holding the lock
-            for(auto& callback : callbacks) {
-                callback.m_callback(std::move(callback.m_returning));
-            }
+        // Call all the result callbacks without holding any locks
+        for(auto& callback : callbacks) {
+            callback.m_callback(std::move(callback.m_returning));
         }
 
-        return true;
+        return std::nullopt;
     }
 
     auto impl::wound_tickets(
-        key_type key,
+        const key_type& key,
         const std::vector<ticket_number_type>& blocking_tickets,
-        ticket_number_type blocked_ticket) -> pending_callbacks_list_type {
-        auto callbacks = pending_callbacks_list_type();
-        auto keys = key_set_type();
+        ticket_number_type blocked_ticket,
+        const stripe_set_type& held_stripes,
+        pending_callbacks_list_type& callbacks)
+        -> std::vector<wounded_ticket_type> {
+        auto wounded = std::vector<wounded_ticket_type>();
         for(auto blocking_ticket_number : blocking_tickets) {
-            auto& blocking_ticket = m_tickets[blocking_ticket_number];
-            // Tickets can't be deadlocked by prepared tickets and
-            // we're not allowed to wound them anyway
-            if(blocking_ticket.m_state == ticket_state::prepared) {
-                continue;
-            }
-
-            // Mark the ticket as wounded
-            blocking_ticket.m_state = ticket_state::wounded;
-            blocking_ticket.m_wounded_details = {blocked_ticket, key};
-
-            auto [wounded_callbacks, affected_keys]
-                = release_locks(blocking_ticket_number, blocking_ticket);
-            callbacks.insert(
-                callbacks.end(),
-                std::make_move_iterator(wounded_callbacks.begin()),
-                std::make_move_iterator(wounded_callbacks.end()));
-            keys.merge(affected_keys);
-        }
+            // The blocking ticket holds a lock in a held stripe so it can't
+            // have been rolled back or finished
+            auto blocking_ticket = find_ticket(blocking_ticket_number);
+            assert(blocking_ticket);
+
+            auto w = wounded_ticket_type{blocking_ticket_number,
+                                         blocking_ticket,
+                                         std::nullopt,
+                                         {}};
+            {
+                std::unique_lock l(blocking_ticket->m_mut);
+                // Tickets can't be deadlocked by prepared tickets and
+                // we're not allowed to wound them anyway
+                if(blocking_ticket->m_state == ticket_state::prepared) {
+                    continue;
+                }
 
-        keys.insert(std::move(key));
+                // Mark the ticket as wounded
+                blocking_ticket->m_state = ticket_state::wounded;
+                blocking_ticket->m_wounded_details = {blocked_ticket, key};
+                w.m_details = blocking_ticket->m_wounded_details;
+                w.m_stripes = blocking_ticket->m_stripes;
+            }
 
-        auto acquire_callbacks = acquire_locks(keys);
-        callbacks.insert(callbacks.end(),
-                         std::make_move_iterator(acquire_callbacks.begin()),
-                         std::make_move_iterator(acquire_callbacks.end()));
+            for(auto it = w.m_stripes.begin(); it != w.m_stripes.end();) {
+                if(held_stripes.find(*it) == held_stripes.end()) {
+                    it++;
+                    continue;
+                }
+                release_locks(m_stripes[*it],
+                              blocking_ticket_number,
+                              w.m_details,
+                              callbacks);
+                it = w.m_stripes.erase(it);
+            }
+
+            if(!w.m_stripes.empty()) {
+                wounded.emplace_back(std::move(w));
+            }
+        }
+        return wounded;
+    }
 
+    auto impl::release_wounded(const std::vector<wounded_ticket_type>& wounded)
+        -> pending_callbacks_list_type {
+        auto callbacks = pending_callbacks_list_type();
+        for(const auto& w : wounded) {
+            for(auto idx : w.m_stripes) {
+                auto& stripe = m_stripes[idx];
+                std::unique_lock l(stripe.m_mut);
+                {
+                    // If the ticket was rolled back in the meantime its
+                    // locks are already released, and any locks in the
+                    // stripe belong to a restarted ticket
+                    std::unique_lock ll(w.m_ticket->m_mut);
+                    if(w.m_ticket->m_erased) {
+                        break;
+                    }
+                }
+                release_locks(stripe,
+                              w.m_ticket_number,
+                              w.m_details,
+                              callbacks);
+            }
+        }
         return callbacks;
     }
 
@@ -182,52 +429,63 @@ namespace cbdc::parsec::runtime_locking_shard {
                        state_update_type state_update,
                        prepare_callback_type result_callback) -> bool {
         auto result = [&]() -> std::optional<shard_error> {
-            std::unique_lock<std::mutex> l(m_mut);
             // Grab the ticket and ensure it exists
-            auto ticket_it = m_tickets.find(ticket_number);
-            if(ticket_it == m_tickets.end()) {
+            auto ticket = find_ticket(ticket_number);
+            if(!ticket) {
+                m_log->error(this,
+                             ticket_number,
+                             "does not exist on shard for prepare");
+                return shard_error{error_code::unknown_ticket, std::nullopt};
+            }
+            auto [stripe_locks, l] = lock_ticket(*ticket);
+            if(ticket->m_erased) {
                 m_log->error(this,
                              ticket_number,
                              "does not exist on shard for prepare");
                 return shard_error{error_code::unknown_ticket, std::nullopt};
             }
-            auto& ticket = ticket_it->second;
 
             // If the ticket is already prepared, return the result as such
-            if(ticket.m_state == ticket_state::prepared) {
+            if(ticket->m_state == ticket_state::prepared) {
                 m_log->warn(ticket_number,
                             "called prepare but already prepared");
                 return shard_error{error_code::prepared, std::nullopt};
             }
 
-            if(ticket.m_state == ticket_state::committed) {
+            if(ticket->m_state == ticket_state::committed) {
                 m_log->warn(ticket_number,
                             "called prepare but already committed");
                 return shard_error{error_code::committed, std::nullopt};
             }
 
             // If the ticket was wounded it can't be prepared
-            if(ticket.m_state == ticket_state::wounded) {
+            if(ticket->m_state == ticket_state::wounded) {
                 m_log->debug(ticket_number,
                              "called prepare after being wounded");
                 return shard_error{error_code::wounded,
-                                   ticket.m_wounded_details};
+                                   ticket->m_wounded_details};
             }
 
-            if(!ticket.m_queued_locks.empty()) {
-                m_log->error(ticket_number, "still has queued locks");
-                return shard_error{error_code::lock_queued, std::nullopt};
+            for(auto idx : ticket->m_stripes) {
+                auto& stripe_tickets = m_stripes[idx].m_tickets;
+                auto it = stripe_tickets.find(ticket_number);
+                if(it != stripe_tickets.end()
+                   && !it->second.m_queued_locks.empty()) {
+                    m_log->error(ticket_number, "still has queued locks");
+                    return shard_error{error_code::lock_queued,
+                                       std::nullopt};
+                }
             }
 
             for(auto& [key, value] : state_update) {
-                auto lk_it = ticket.m_locks_held.find(key);
-                if(lk_it == ticket.m_locks_held.end()) {
+                auto lt = held_lock_type(*ticket, ticket_number, key);
+                if(!lt.has_value()) {
                     m_log->warn(ticket_number,
                                 "wanted state update for unheld lock");
                     return shard_error{error_code::lock_not_held,
                                        std::nullopt};
                 }
-                if(lk_it->second != lock_type::write) {
+                if(lt.value() != lock_type::write) {
                     m_log->warn(ticket_number,
                                 "wanted state update for read lock");
                     return shard_error{error_code::state_update_with_read_lock,
@@ -235,8 +493,8 @@ namespace cbdc::parsec::runtime_locking_shard {
                 }
             }
 
-            ticket.m_state_update = std::move(state_update);
-            ticket.m_state = ticket_state::prepared;
+            ticket->m_state_update = std::move(state_update);
+            ticket->m_state = ticket_state::prepared;
             return std::nullopt;
         }();
 
@@ -244,41 +502,66 @@ namespace cbdc::parsec::runtime_locking_shard {
         return true;
     }
 
+    auto impl::held_lock_type(const ticket_state_type& ticket,
+                              ticket_number_type ticket_number,
+                              const key_type& key)
+        -> std::optional<lock_type> {
+        auto idx = stripe_index(key);
+        if(ticket.m_stripes.find(idx) == ticket.m_stripes.end()) {
+            return std::nullopt;
+        }
+        auto& stripe_tickets = m_stripes[idx].m_tickets;
+        auto it = stripe_tickets.find(ticket_number);
+        if(it == stripe_tickets.end()) {
+            return std::nullopt;
+        }
+        auto lk_it = it->second.m_locks_held.find(key);
+        if(lk_it == it->second.m_locks_held.end()) {
+            return std::nullopt;
+        }
+        return lk_it->second;
+    }
+
     auto impl::commit(ticket_number_type ticket_number,
                       commit_callback_type result_callback) -> bool {
         auto callbacks = pending_callbacks_list_type();
         auto result = [&]() -> std::optional<shard_error> {
-            std::unique_lock<std::mutex> l(m_mut);
             // Grab the ticket and ensure it exists
-            auto ticket_it = m_tickets.find(ticket_number);
-            if(ticket_it == m_tickets.end()) {
+            auto ticket = find_ticket(ticket_number);
+            if(!ticket) {
+                m_log->error(this,
+                             ticket_number,
+                             "does not exist on shard for commit");
+                return shard_error{error_code::unknown_ticket, std::nullopt};
+            }
+            auto [stripe_locks, l] = lock_ticket(*ticket);
+            if(ticket->m_erased) {
                 m_log->error(this,
                              ticket_number,
                              "does not exist on shard for commit");
                 return shard_error{error_code::unknown_ticket, std::nullopt};
             }
-            auto& ticket = ticket_it->second;
 
             // If the ticket is not prepared we can't commit
-            if(ticket.m_state != ticket_state::prepared) {
+            if(ticket->m_state != ticket_state::prepared) {
                 m_log->warn(ticket_number, "called commit but not prepared");
                 return shard_error{error_code::not_prepared, std::nullopt};
             }
 
-            for(auto&& [key, value] : ticket.m_state_update) {
-                m_state[key].m_value = std::move(value);
+            for(auto&& [key, value] : ticket->m_state_update) {
+                m_stripes[stripe_index(key)].m_state[key].m_value
+                    = std::move(value);
             }
 
-            auto [wounded_callbacks, affected_keys]
-                = release_locks(ticket_number, ticket);
-            assert(wounded_callbacks.empty());
-            callbacks = acquire_locks(affected_keys);
-            callbacks.insert(
-                callbacks.end(),
-                std::make_move_iterator(wounded_callbacks.begin()),
-                std::make_move_iterator(wounded_callbacks.end()));
+            // Prepared tickets have no queued locks to abort
+            for(auto idx : ticket->m_stripes) {
+                release_locks(m_stripes[idx],
+                              ticket_number,
+                              ticket->m_wounded_details,
+                              callbacks);
+            }
 
-            ticket.m_state = ticket_state::committed;
+            ticket->m_state = ticket_state::committed;
 
             m_log->trace(this, "Shard executed commit for", ticket_number);
             return std::nullopt;
@@ -298,30 +581,53 @@ namespace cbdc::parsec::runtime_locking_shard {
         return true;
     }
 
-    auto impl::release_locks(ticket_number_type ticket_number,
-                             ticket_state_type& ticket)
-        -> std::pair<pending_callbacks_list_type, key_set_type> {
-        auto callbacks = pending_callbacks_list_type();
+    auto impl::prepare_commit(ticket_number_type ticket_number,
+                              broker_id_type broker_id,
+                              state_update_type state_update,
+                              commit_callback_type result_callback) -> bool {
+        auto err = prepare_return_type();
+        prepare(ticket_number,
+                broker_id,
+                std::move(state_update),
+                [&](prepare_return_type res) {
+                    err = std::move(res);
+                });
+        if(err.has_value()) {
+            result_callback(std::move(err));
+            return true;
+        }
+        return commit(ticket_number, std::move(result_callback));
+    }
+
+    void impl::release_locks(stripe_type& stripe,
+                             ticket_number_type ticket_number,
+                             const std::optional<wounded_details>& details,
+                             pending_callbacks_list_type& callbacks) {
+        auto ticket_it = stripe.m_tickets.find(ticket_number);
+        if(ticket_it == stripe.m_tickets.end()) {
+            return;
+        }
+        auto ticket_locks = std::move(ticket_it->second);
+        stripe.m_tickets.erase(ticket_it);
+
         // Unqueue any pending locks
-        for(const auto& lock_key : ticket.m_queued_locks) {
-            auto& queued_element = m_state[lock_key];
-            auto& lk = queued_element.m_lock;
+        auto wounded_callbacks = pending_callbacks_list_type();
+        for(const auto& lock_key : ticket_locks.m_queued_locks) {
+            auto& lk = stripe.m_state[lock_key].m_lock;
             auto queue_node = lk.m_queue.extract(ticket_number);
             auto& queued_lock_element = queue_node.mapped();
             // Notify the ticket the queued lock was aborted
-            callbacks.emplace_back(pending_callback_element_type{
+            wounded_callbacks.emplace_back(pending_callback_element_type{
                 std::move(queued_lock_element.m_callback),
-                shard_error{error_code::wounded, ticket.m_wounded_details},
+                shard_error{error_code::wounded, details},
                 ticket_number});
         }
-        auto keys = std::move(ticket.m_queued_locks);
-        ticket.m_queued_locks = key_set_type();
-
-        for(auto& [lock_key, lt] : ticket.m_locks_held) {
-            // Release any locks held by the blocking ticket
-            auto& locked_element = m_state[lock_key];
-            auto& lk = locked_element.m_lock;
-            // Release the read lock held by the wounded ticket
+        auto keys = std::move(ticket_locks.m_queued_locks);
+
+        for(auto& [lock_key, lt] : ticket_locks.m_locks_held) {
+            // Release any locks held by the ticket
+            auto& lk = stripe.m_state[lock_key].m_lock;
+            // Release the read lock held by the ticket
             if(lt == lock_type::read) {
                 m_log->trace("Releasing read lock on",
                              lock_key.to_hex(),
@@ -329,7 +635,7 @@ namespace cbdc::parsec::runtime_locking_shard {
                              ticket_number);
                 lk.m_readers.erase(ticket_number);
             }
-            // Release the write lock held by the wounded ticket
+            // Release the write lock held by the ticket
             if(lt == lock_type::write) {
                 m_log->trace("Releasing write lock on",
                              lock_key.to_hex(),
@@ -339,17 +645,22 @@ namespace cbdc::parsec::runtime_locking_shard {
             }
             keys.insert(lock_key);
         }
-        ticket.m_locks_held.clear();
 
-        return {callbacks, keys};
+        auto acquire_callbacks = acquire_locks(stripe, keys);
+        callbacks.insert(callbacks.end(),
+                         std::make_move_iterator(acquire_callbacks.begin()),
+                         std::make_move_iterator(acquire_callbacks.end()));
+        callbacks.insert(callbacks.end(),
+                         std::make_move_iterator(wounded_callbacks.begin()),
+                         std::make_move_iterator(wounded_callbacks.end()));
     }
 
-    auto impl::acquire_locks(const key_set_type& keys)
+    auto impl::acquire_locks(stripe_type& stripe, const key_set_type& keys)
         -> pending_callbacks_list_type {
         auto callbacks = pending_callbacks_list_type();
         for(const auto& key : keys) {
             // Attempt to allow queued tickets to acquire the lock
-            while(acquire_lock(key, callbacks)) {}
+            while(acquire_lock(stripe, key, callbacks)) {}
         }
         return callbacks;
     }
@@ -358,29 +669,33 @@ namespace cbdc::parsec::runtime_locking_shard {
                         rollback_callback_type result_callback) -> bool {
         auto callbacks = pending_callbacks_list_type();
         auto result = [&]() -> std::optional<shard_error> {
-            std::unique_lock<std::mutex> l(m_mut);
             // Grab the ticket and ensure it exists
-            auto ticket_it = m_tickets.find(ticket_number);
-            if(ticket_it == m_tickets.end()) {
+            auto ticket = find_ticket(ticket_number);
+            if(!ticket) {
+                m_log->error(this,
+                             ticket_number,
+                             "does not exist on shard for rollback");
+                return shard_error{error_code::unknown_ticket, std::nullopt};
+            }
+            auto [stripe_locks, l] = lock_ticket(*ticket);
+            if(ticket->m_erased) {
                 m_log->error(this,
                              ticket_number,
                              "does not exist on shard for rollback");
                 return shard_error{error_code::unknown_ticket, std::nullopt};
             }
-            auto& ticket = ticket_it->second;
 
-            auto [wounded_callbacks, affected_keys]
-                = release_locks(ticket_number, ticket);
-            callbacks = acquire_locks(affected_keys);
-            callbacks.insert(
-                callbacks.end(),
-                std::make_move_iterator(wounded_callbacks.begin()),
-                std::make_move_iterator(wounded_callbacks.end()));
+            for(auto idx : ticket->m_stripes) {
+                release_locks(m_stripes[idx],
+                              ticket_number,
+                              ticket->m_wounded_details,
+                              callbacks);
+            }
 
             // We erase the ticket here as we won't need the ticket for
             // recovery. No need for a "rolled back" state and subsequent
             // finish.
-            m_tickets.erase(ticket_it);
+            erase_ticket(ticket_number, *ticket);
 
             m_log->trace(this, "Shard handled rollback for", ticket_number);
 
@@ -395,28 +710,41 @@ namespace cbdc::parsec::runtime_locking_shard {
         return true;
     }
 
+    void impl::erase_ticket(ticket_number_type ticket_number,
+                            ticket_state_type& ticket) {
+        ticket.m_erased = true;
+        std::unique_lock l(m_tickets_mut);
+        m_tickets.erase(ticket_number);
+    }
+
     auto impl::finish(ticket_number_type ticket_number,
                       finish_callback_type result_callback) -> bool {
         auto maybe_error = [&]() -> std::optional<shard_error> {
-            std::unique_lock l(m_mut);
-            auto ticket_it = m_tickets.find(ticket_number);
-            if(ticket_it == m_tickets.end()) {
+            auto ticket = find_ticket(ticket_number);
+            if(!ticket) {
                 m_log->error(this,
                              ticket_number,
                              "does not exist on shard for finish");
                 return shard_error{error_code::unknown_ticket, std::nullopt};
             }
 
-            auto& ticket = ticket_it->second;
+            // Committed tickets hold no locks so no stripes are needed
+            std::unique_lock l(ticket->m_mut);
+            if(ticket->m_erased) {
+                m_log->error(this,
+                             ticket_number,
+                             "does not exist on shard for finish");
+                return shard_error{error_code::unknown_ticket, std::nullopt};
+            }
 
-            if(ticket.m_state != ticket_state::committed) {
+            if(ticket->m_state != ticket_state::committed) {
                 m_log->error(this,
                              ticket_number,
                              "finish requested but not committed");
                 return shard_error{error_code::not_committed, std::nullopt};
             }
 
-            m_tickets.erase(ticket_it);
+            erase_ticket(ticket_number, *ticket);
 
             m_log->trace(this, "Shard handled finish for", ticket_number);
 
@@ -431,11 +759,21 @@ namespace cbdc::parsec::runtime_locking_shard {
     auto impl::get_tickets(broker_id_type broker_id,
                            get_tickets_callback_type result_callback) -> bool {
         auto result = [&]() -> get_tickets_success_type {
-            std::unique_lock l(m_mut);
+            auto tickets = std::vector<
+                std::pair<ticket_number_type,
+                          std::shared_ptr<ticket_state_type>>>();
+            {
+                std::unique_lock l(m_tickets_mut);
+                tickets.reserve(m_tickets.size());
+                for(auto& [ticket_number, ticket] : m_tickets) {
+                    tickets.emplace_back(ticket_number, ticket);
+                }
+            }
             auto ret = get_tickets_success_type();
-            for(auto& [ticket_number, ticket] : m_tickets) {
-                if(ticket.m_broker_id == broker_id) {
-                    ret.emplace(ticket_number, ticket.m_state);
+            for(auto& [ticket_number, ticket] : tickets) {
+                std::unique_lock l(ticket->m_mut);
+                if(!ticket->m_erased && ticket->m_broker_id == broker_id) {
+                    ret.emplace(ticket_number, ticket->m_state);
                 }
             }
             return ret;
@@ -448,40 +786,57 @@ namespace cbdc::parsec::runtime_locking_shard {
 
     auto impl::recover(const replicated_shard::state_type& state,
                        const replicated_shard::tickets_type& tickets) -> bool {
-        std::unique_lock l(m_mut);
-        if(!m_tickets.empty() && !m_state.empty()) {
+        auto all_stripes = stripe_set_type();
+        for(size_t i{0}; i < m_stripes.size(); i++) {
+            all_stripes.insert(all_stripes.end(), i);
+        }
+        auto stripe_locks = lock_stripes(all_stripes);
+        std::unique_lock l(m_tickets_mut);
+        auto state_empty = std::all_of(m_stripes.begin(),
+                                       m_stripes.end(),
+                                       [](const stripe_type& stripe) {
+                                           return stripe.m_state.empty();
+                                       });
+        if(!m_tickets.empty() && !state_empty) {
             m_log->error("Shard state is not empty, cannot recover");
             return false;
         }
-        m_state.reserve(state.size());
         for(auto&& [k, v] : state) {
-            m_state.emplace(k, state_element_type{v, {}});
+            m_stripes[stripe_index(k)].m_state.emplace(
+                k,
+                state_element_type{v, {}});
         }
         m_tickets.reserve(tickets.size());
         for(auto&& [tn, t] : tickets) {
-            auto ticket = ticket_state_type{};
-            ticket.m_broker_id = t.m_broker_id;
+            auto ticket = std::make_shared<ticket_state_type>();
+            ticket->m_broker_id = t.m_broker_id;
             switch(t.m_state) {
                 case replicated_shard::ticket_state::committed:
-                    ticket.m_state = ticket_state::committed;
+                    ticket->m_state = ticket_state::committed;
                     break;
                 case replicated_shard::ticket_state::prepared:
-                    ticket.m_state = ticket_state::prepared;
+                    ticket->m_state = ticket_state::prepared;
                     for(const auto& [k, v] : t.m_state_update) {
-                        ticket.m_locks_held.emplace(k, lock_type::write);
-                        m_state[k].m_lock.m_writer = tn;
+                        auto idx = stripe_index(k);
+                        auto& stripe = m_stripes[idx];
+                        stripe.m_tickets[tn].m_locks_held.emplace(
+                            k,
+                            lock_type::write);
+                        stripe.m_state[k].m_lock.m_writer = tn;
+                        ticket->m_stripes.insert(idx);
                     }
                     break;
             }
-            ticket.m_state_update = t.m_state_update;
+            ticket->m_state_update = t.m_state_update;
             m_tickets.emplace(tn, std::move(ticket));
         }
         return true;
     }
 
-    auto impl::acquire_lock(const key_type& key,
+    auto impl::acquire_lock(stripe_type& stripe,
+                            const key_type& key,
                             pending_callbacks_list_type& callbacks) -> bool {
-        auto& locked_element = m_state[key];
+        auto& locked_element = stripe.m_state[key];
         auto& lk = locked_element.m_lock;
         if(lk.m_queue.empty()) {
             return false;
@@ -490,7 +845,7 @@ namespace cbdc::parsec::runtime_locking_shard {
         auto queue_node = lk.m_queue.begin();
         const auto& queued_ticket_number = queue_node->first;
         auto& queued_lock_element = queue_node->second;
-        auto& queued_ticket = m_tickets[queued_ticket_number];
+        auto& queued_ticket = stripe.m_tickets[queued_ticket_number];
         // Acquire the read lock if the ticket requested a
         // read
         if(queued_lock_element.m_type == lock_type::read) {
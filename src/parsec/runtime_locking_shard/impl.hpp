@@ -13,17 +13,37 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
 
 namespace cbdc::parsec::runtime_locking_shard {
-    /// Implementation of a runtime locking shard. Stores keys in memory using
-    /// a hash map. Thread-safe.
+    /// \brief Implementation of a runtime locking shard. Stores keys in
+    ///        memory using hash maps. Thread-safe.
+    ///
+    /// Keys are partitioned into stripes by hash. Each stripe has its own
+    /// mutex protecting the values and lock queues of its keys, and the
+    /// locks tickets hold or are queued for on them. Lock requests only
+    /// take the mutexes of the stripes holding the requested keys, and
+    /// ticket-level operations such as prepare, commit and rollback only
+    /// take the mutexes of the stripes the ticket has touched. Stripe
+    /// mutexes are always taken in ascending order. When an older ticket
+    /// wounds a younger one, the wounded ticket's locks in the stripes
+    /// held by the request are released immediately, and its locks in
+    /// other stripes are released after the request's stripes are
+    /// unlocked.
     class impl : public interface {
       public:
+        /// Default number of key stripes.
+        static constexpr size_t default_stripe_count = 64;
+
         /// Constructor.
         /// \param logger log instance.
-        explicit impl(std::shared_ptr<logging::log> logger);
+        /// \param stripe_count number of stripes into which to partition
+        ///                     keys.
+        explicit impl(std::shared_ptr<logging::log> logger,
+                      size_t stripe_count = default_stripe_count);
 
         /// Locks the given key for a ticket and returns the associated value.
         /// If lock is unavailable, lock will be queued. May wound other
@@ -42,6 +62,24 @@ namespace cbdc::parsec::runtime_locking_shard {
                       bool first_lock,
                       try_lock_callback_type result_callback) -> bool override;
 
+        /// Locks the given keys for a ticket and returns the associated
+        /// values once every lock is acquired. Queues all the locks while
+        /// holding the mutexes of every stripe involved, after checking
+        /// that none of them is already held or queued. May wound other
+        /// tickets to acquire the locks.
+        /// \param ticket_number ticket number.
+        /// \param broker_id ID of broker managing ticket.
+        /// \param locks keys to lock and the lock type for each key.
+        /// \param first_lock true if these are the first locks.
+        /// \param result_callback function to call with try lock result.
+        /// \return true.
+        auto try_lock_many(ticket_number_type ticket_number,
+                           broker_id_type broker_id,
+                           std::vector<lock_request_type> locks,
+                           bool first_lock,
+                           try_lock_many_callback_type result_callback)
+            -> bool override;
+
         /// Prepares a ticket with the given state updates.
         /// \param ticket_number ticket number.
         /// \param broker_id ID of broker managing ticket.
@@ -61,6 +99,19 @@ namespace cbdc::parsec::runtime_locking_shard {
         auto commit(ticket_number_type ticket_number,
                     commit_callback_type result_callback) -> bool override;
 
+        /// Prepares the ticket and, if that succeeds, commits it. Calls
+        /// the callback before returning.
+        /// \param ticket_number ticket number.
+        /// \param broker_id ID of broker managing ticket.
+        /// \param state_update state updates to apply.
+        /// \param result_callback function to call with commit result.
+        /// \return true.
+        auto prepare_commit(ticket_number_type ticket_number,
+                            broker_id_type broker_id,
+                            state_update_type state_update,
+                            commit_callback_type result_callback)
+            -> bool override;
+
         /// Rolls back an uncommitted ticket. Releases any locks held by
         /// the ticket and assigns the locks to tickets queuing for the lock.
         /// \param ticket_number ticket number.
@@ -112,16 +163,40 @@ namespace cbdc::parsec::runtime_locking_shard {
         using key_set_type
             = std::unordered_set<key_type, hashing::const_sip_hash<key_type>>;
 
-        struct ticket_state_type {
-            ticket_state m_state{ticket_state::begun};
+        /// Locks a ticket holds or is queued for in one stripe.
+        struct ticket_locks_type {
             std::unordered_map<key_type,
                                lock_type,
                                hashing::const_sip_hash<key_type>>
                 m_locks_held;
             key_set_type m_queued_locks;
+        };
+
+        /// Partition of the shard's keys.
+        struct stripe_type {
+            std::mutex m_mut;
+            std::unordered_map<key_type,
+                               state_element_type,
+                               hashing::const_sip_hash<key_type>>
+                m_state;
+            std::unordered_map<ticket_number_type, ticket_locks_type>
+                m_tickets;
+        };
+
+        /// Set of stripe indices, in ascending order.
+        using stripe_set_type = std::set<size_t>;
+
+        struct ticket_state_type {
+            /// Protects the other members. Taken after any stripe mutexes.
+            std::mutex m_mut;
+            ticket_state m_state{ticket_state::begun};
             state_update_type m_state_update;
             broker_id_type m_broker_id{};
             std::optional<wounded_details> m_wounded_details{};
+            /// Stripes in which the ticket has held or queued locks.
+            stripe_set_type m_stripes;
+            /// True once the ticket is removed from m_tickets.
+            bool m_erased{false};
         };
 
         struct pending_callback_element_type {
@@ -133,34 +208,95 @@ namespace cbdc::parsec::runtime_locking_shard {
         using pending_callbacks_list_type
             = std::vector<pending_callback_element_type>;
 
-        mutable std::mutex m_mut;
+        /// Ticket wounded while its locks in some stripes could not be
+        /// released because the wounding request did not hold them.
+        struct wounded_ticket_type {
+            ticket_number_type m_ticket_number{};
+            std::shared_ptr<ticket_state_type> m_ticket;
+            std::optional<wounded_details> m_details;
+            /// Stripes in which the ticket's locks still need releasing.
+            stripe_set_type m_stripes;
+        };
+
         std::shared_ptr<logging::log> m_log;
 
-        std::unordered_map<key_type,
-                           state_element_type,
-                           hashing::const_sip_hash<key_type>>
-            m_state;
-        std::unordered_map<ticket_number_type, ticket_state_type> m_tickets;
+        std::vector<stripe_type> m_stripes;
+
+        /// Protects m_tickets. Taken after any stripe or ticket mutexes.
+        std::mutex m_tickets_mut;
+        std::unordered_map<ticket_number_type,
+                           std::shared_ptr<ticket_state_type>>
+            m_tickets;
 
-        auto
-        wound_tickets(key_type key,
-                      const std::vector<ticket_number_type>& blocking_tickets,
-                      ticket_number_type blocked_ticket)
+        [[nodiscard]] auto stripe_index(const key_type& key) const -> size_t;
+
+        auto find_ticket(ticket_number_type ticket_number)
+            -> std::shared_ptr<ticket_state_type>;
+
+        /// Locks the given stripes in ascending order.
+        auto lock_stripes(const stripe_set_type& stripes)
+            -> std::vector<std::unique_lock<std::mutex>>;
+
+        /// Locks all the stripes the ticket has touched, followed by the
+        /// ticket itself.
+        auto lock_ticket(ticket_state_type& ticket)
+            -> std::pair<std::vector<std::unique_lock<std::mutex>>,
+                         std::unique_lock<std::mutex>>;
+
+        /// Checks and queues the given locks for a ticket, calling each
+        /// lock's callback once the lock is acquired or aborted.
+        auto queue_locks(ticket_number_type ticket_number,
+                         broker_id_type broker_id,
+                         std::vector<lock_request_type> locks,
+                         bool first_lock,
+                         std::vector<try_lock_callback_type> callbacks)
+            -> std::optional<shard_error>;
+
+        /// Marks blocking tickets as wounded and releases their locks in
+        /// the given held stripes. Returns the wounded tickets whose locks
+        /// in other stripes must be released with \ref release_wounded.
+        /// Requires the held stripe mutexes.
+        auto wound_tickets(const key_type& key,
+                           const std::vector<ticket_number_type>&
+                               blocking_tickets,
+                           ticket_number_type blocked_ticket,
+                           const stripe_set_type& held_stripes,
+                           pending_callbacks_list_type& callbacks)
+            -> std::vector<wounded_ticket_type>;
+
+        /// Releases the locks of wounded tickets in the remaining stripes.
+        /// Requires no stripe mutexes.
+        auto release_wounded(const std::vector<wounded_ticket_type>& wounded)
             -> pending_callbacks_list_type;
 
+        /// Returns the type of lock the ticket holds on the key, if any.
+        /// Requires the key's stripe mutex.
+        auto held_lock_type(const ticket_state_type& ticket,
+                            ticket_number_type ticket_number,
+                            const key_type& key) -> std::optional<lock_type>;
+
+        /// Marks the ticket as erased and removes it from m_tickets.
+        /// Requires the ticket mutex.
+        void erase_ticket(ticket_number_type ticket_number,
+                          ticket_state_type& ticket);
+
         static auto get_waiting_on(ticket_number_type ticket_number,
                                    lock_type locktype,
                                    rw_lock_type& lock)
             -> std::vector<ticket_number_type>;
 
-        auto release_locks(ticket_number_type ticket_number,
-                           ticket_state_type& ticket)
-            -> std::pair<pending_callbacks_list_type, key_set_type>;
+        /// Releases the locks held and queued by the ticket in the stripe
+        /// and lets queued tickets acquire them. Requires the stripe mutex.
+        void release_locks(stripe_type& stripe,
+                           ticket_number_type ticket_number,
+                           const std::optional<wounded_details>& details,
+                           pending_callbacks_list_type& callbacks);
 
-        auto acquire_locks(const key_set_type& keys)
+        auto acquire_locks(stripe_type& stripe, const key_set_type& keys)
             -> pending_callbacks_list_type;
 
-        auto acquire_lock(const key_type& key,
+        auto acquire_lock(stripe_type& stripe,
+                          const key_type& key,
                           pending_callbacks_list_type& callbacks) -> bool;
     };
 }
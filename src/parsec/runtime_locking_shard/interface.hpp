@@ -12,6 +12,7 @@
 
 #include <functional>
 #include <unordered_map>
+#include <vector>
 
 namespace cbdc::parsec::runtime_locking_shard {
     /// Type for a ticket number.
@@ -35,6 +36,9 @@ namespace cbdc::parsec::runtime_locking_shard {
         write = 1,
     };
 
+    /// Key to lock and the type of lock to acquire on it.
+    using lock_request_type = std::pair<key_type, lock_type>;
+
     /// Error codes returned by methods on shards.
     enum class error_code : uint8_t {
         /// Request invalid because ticket is in the prepared state.
@@ -144,6 +148,36 @@ namespace cbdc::parsec::runtime_locking_shard {
                               try_lock_callback_type result_callback) -> bool
             = 0;
 
+        /// Return type from a multi-key try lock operation. Either the
+        /// values at the requested keys, in the order they were requested,
+        /// or an error code.
+        using try_lock_many_return_type
+            = std::variant<std::vector<value_type>, shard_error>;
+        /// Function type for multi-key try lock operation results.
+        using try_lock_many_callback_type
+            = std::function<void(try_lock_many_return_type)>;
+
+        /// Requests locks on the given keys as in \ref try_lock, and returns
+        /// the values associated with the keys once every lock is acquired.
+        /// All the locks are requested together so that no other request
+        /// can interleave with them. Returns the first error encountered if
+        /// any of the locks cannot be acquired.
+        /// \param ticket_number ticket number requesting the locks.
+        /// \param broker_id broker ID managing the ticket.
+        /// \param locks keys to lock and the lock type for each key. Each
+        ///              key may appear only once.
+        /// \param first_lock true if these are the first locks.
+        /// \param result_callback function to call with the values or error
+        ///                        code.
+        /// \return true if the operation was initiated successfully.
+        virtual auto try_lock_many(ticket_number_type ticket_number,
+                                   broker_id_type broker_id,
+                                   std::vector<lock_request_type> locks,
+                                   bool first_lock,
+                                   try_lock_many_callback_type result_callback)
+            -> bool
+            = 0;
+
         /// Return type from a prepare operation. An error, if applicable.
         using prepare_return_type = std::optional<shard_error>;
         /// Callback function type for the result of a prepare operation.
@@ -178,6 +212,23 @@ namespace cbdc::parsec::runtime_locking_shard {
                             commit_callback_type result_callback) -> bool
             = 0;
 
+        /// Prepares and commits a ticket in one step, as if by \ref prepare
+        /// followed by \ref commit. Only valid when this shard holds every
+        /// lock of the ticket, so no other shard needs to agree before
+        /// committing. Fails without changing the ticket if the prepare
+        /// would fail.
+        /// \param ticket_number ticket to commit.
+        /// \param broker_id broker ID managing the ticket.
+        /// \param state_update state changes to apply.
+        /// \param result_callback function to call with the commit result.
+        /// \return true if the operation was initiated successfully.
+        virtual auto prepare_commit(ticket_number_type ticket_number,
+                                    broker_id_type broker_id,
+                                    state_update_type state_update,
+                                    commit_callback_type result_callback)
+            -> bool
+            = 0;
+
         /// Return type from a rollback operation. An error code, if
         /// applicable.
         using rollback_return_type = std::optional<shard_error>;
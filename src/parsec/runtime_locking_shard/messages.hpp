@@ -24,6 +24,18 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
         bool m_first_lock{false};
     };
 
+    /// Multi-key try lock request message.
+    struct try_lock_many_request {
+        /// Ticket number.
+        ticket_number_type m_ticket_number{};
+        /// ID of broker managing ticket.
+        broker_id_type m_broker_id{};
+        /// Keys for which to request locks, and the lock type for each key.
+        std::vector<lock_request_type> m_locks;
+        /// Flag for when these are the first locks.
+        bool m_first_lock{false};
+    };
+
     /// Prepare request message.
     struct prepare_request {
         /// Ticket number.
@@ -34,6 +46,17 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
         broker_id_type m_broker_id{};
     };
 
+    /// Combined prepare and commit request message, for tickets whose
+    /// locks are all held by a single shard.
+    struct prepare_commit_request {
+        /// Ticket number.
+        ticket_number_type m_ticket_number;
+        /// State updates to apply.
+        state_update_type m_state_updates;
+        /// ID of broker managing ticket.
+        broker_id_type m_broker_id{};
+    };
+
     /// Commit request message.
     struct commit_request {
         /// Ticket number.
@@ -64,11 +87,14 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
                                  commit_request,
                                  rollback_request,
                                  finish_request,
-                                 get_tickets_request>;
+                                 get_tickets_request,
+                                 try_lock_many_request,
+                                 prepare_commit_request>;
     /// RPC response message type.
     using response = std::variant<interface::try_lock_return_type,
                                   interface::prepare_return_type,
-                                  interface::get_tickets_return_type>;
+                                  interface::get_tickets_return_type,
+                                  interface::try_lock_many_return_type>;
 
     /// Message for replicating a prepare request.
     struct replicated_prepare_request {
@@ -80,6 +106,16 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
         replicated_shard_interface::state_type m_state_update;
     };
 
+    /// Message for replicating a combined prepare and commit request.
+    struct replicated_prepare_commit_request {
+        /// Ticket number being committed.
+        ticket_number_type m_ticket_number{};
+        /// Broker ID responsible for the ticket.
+        broker_id_type m_broker_id{};
+        /// State updates to apply.
+        replicated_shard_interface::state_type m_state_update;
+    };
+
     /// Message for retrieving unfinished tickets from the replicated state
     /// machine.
     struct replicated_get_tickets_request {};
@@ -88,7 +124,8 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
     using replicated_request = std::variant<replicated_prepare_request,
                                             commit_request,
                                             finish_request,
-                                            replicated_get_tickets_request>;
+                                            replicated_get_tickets_request,
+                                            replicated_prepare_commit_request>;
 
     /// Shard replicated state machine response type.
     using replicated_response
@@ -41,6 +41,26 @@ namespace cbdc::parsec::runtime_locking_shard {
         return true;
     }
 
+    auto replicated_shard::prepare_commit(ticket_number_type ticket_number,
+                                          broker_id_type broker_id,
+                                          state_type state_update,
+                                          callback_type result_callback)
+        -> bool {
+        auto ret = [&]() {
+            std::unique_lock l(m_mut);
+            for(const auto& [k, v] : state_update) {
+                m_state[k] = v;
+            }
+            m_tickets.emplace(ticket_number,
+                              ticket_type{broker_id,
+                                          std::move(state_update),
+                                          ticket_state::committed});
+            return std::nullopt;
+        }();
+        result_callback(ret);
+        return true;
+    }
+
     auto replicated_shard::finish(ticket_number_type ticket_number,
                                   callback_type result_callback) -> bool {
         auto ret = [&]() -> return_type {
@@ -27,6 +27,13 @@ namespace cbdc::parsec::runtime_locking_shard {
         auto commit(ticket_number_type ticket_number,
                     callback_type result_callback) -> bool override;
 
+        /// \copydoc replicated_shard_interface::prepare_commit
+        /// \return true.
+        auto prepare_commit(ticket_number_type ticket_number,
+                            broker_id_type broker_id,
+                            state_type state_update,
+                            callback_type result_callback) -> bool override;
+
         /// \copydoc replicated_shard_interface::finish
         /// \return true.
         auto finish(ticket_number_type ticket_number,
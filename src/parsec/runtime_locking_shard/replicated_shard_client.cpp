@@ -63,6 +63,33 @@ namespace cbdc::parsec::runtime_locking_shard {
         return success;
     }
 
+    auto replicated_shard_client::prepare_commit(
+        ticket_number_type ticket_number,
+        broker_id_type broker_id,
+        state_type state_update,
+        callback_type result_callback) -> bool {
+        auto req = rpc::replicated_prepare_commit_request{
+            ticket_number,
+            broker_id,
+            std::move(state_update)};
+        auto success = replicate_request(
+            std::move(req),
+            [result_callback](
+                std::optional<rpc::replicated_response> maybe_res) {
+                if(!maybe_res.has_value()) {
+                    result_callback(error_code::internal_error);
+                    return;
+                }
+                auto&& res = maybe_res.value();
+                assert(std::holds_alternative<
+                       replicated_shard_interface::return_type>(res));
+                auto&& resp_val
+                    = std::get<replicated_shard_interface::return_type>(res);
+                result_callback(resp_val);
+            });
+        return success;
+    }
+
     auto replicated_shard_client::finish(ticket_number_type ticket_number,
                                          callback_type result_callback)
         -> bool {
@@ -40,6 +40,18 @@ namespace cbdc::parsec::runtime_locking_shard {
         auto commit(ticket_number_type ticket_number,
                     callback_type result_callback) -> bool override;
 
+        /// Replicates a combined prepare and commit request in the state
+        /// machine and returns the response via a callback function.
+        /// \param ticket_number ticket to commit.
+        /// \param broker_id broker managing the ticket.
+        /// \param state_update keys and values to update.
+        /// \param result_callback function to call with commit result.
+        /// \return true if request replication was initiated successfully.
+        auto prepare_commit(ticket_number_type ticket_number,
+                            broker_id_type broker_id,
+                            state_type state_update,
+                            callback_type result_callback) -> bool override;
+
         /// Replicates a finish request in the state machine and returns the
         /// response via a callback function.
         /// \param ticket_number ticket to finish.
@@ -86,6 +86,19 @@ namespace cbdc::parsec::runtime_locking_shard {
                             callback_type result_callback) -> bool
             = 0;
 
+        /// Stores a committed ticket in the state machine and applies its
+        /// state updates, as if by \ref prepare followed by \ref commit.
+        /// \param ticket_number ticket to commit.
+        /// \param broker_id broker managing the ticket.
+        /// \param state_update keys and values to update.
+        /// \param result_callback function to call with commit result.
+        /// \return true if operation was initiated successfully.
+        virtual auto prepare_commit(ticket_number_type ticket_number,
+                                    broker_id_type broker_id,
+                                    state_type state_update,
+                                    callback_type result_callback) -> bool
+            = 0;
+
         /// Stores a finish request in the state machine.
         /// \param ticket_number ticket to finish.
         /// \param result_callback function to call with finish result.
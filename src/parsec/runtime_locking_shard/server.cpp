@@ -40,6 +40,16 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
                             callback(std::move(ret));
                         });
                 },
+                [&](const rpc::try_lock_many_request& msg) {
+                    return m_impl->try_lock_many(
+                        msg.m_ticket_number,
+                        msg.m_broker_id,
+                        msg.m_locks,
+                        msg.m_first_lock,
+                        [callback](interface::try_lock_many_return_type ret) {
+                            callback(std::move(ret));
+                        });
+                },
                 [&](const rpc::prepare_request& msg) {
                     return m_impl->prepare(
                         msg.m_ticket_number,
@@ -50,6 +60,18 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
                             handle_prepare(std::move(ret), msg, callback);
                         });
                 },
+                [&](const rpc::prepare_commit_request& msg) {
+                    return m_impl->prepare(
+                        msg.m_ticket_number,
+                        msg.m_broker_id,
+                        msg.m_state_updates,
+                        [this, callback, msg](
+                            interface::prepare_return_type ret) {
+                            handle_prepare_commit(std::move(ret),
+                                                  msg,
+                                                  callback);
+                        });
+                },
                 [&](rpc::commit_request msg) {
                     return m_repl->commit(
                         msg.m_ticket_number,
@@ -112,6 +134,33 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
         }
     }
 
+    void server::handle_prepare_commit(interface::prepare_return_type ret,
+                                       const rpc::prepare_commit_request& msg,
+                                       const callback_type& callback) {
+        if(ret.has_value()) {
+            m_log->trace("Error response during prepare commit");
+            callback(std::move(ret));
+            return;
+        }
+
+        // Replicate the prepared and committed ticket in a single entry,
+        // then commit the prepared ticket in memory.
+        auto success = m_repl->prepare_commit(
+            msg.m_ticket_number,
+            msg.m_broker_id,
+            msg.m_state_updates,
+            [this, callback, msg](
+                replicated_shard_interface::return_type res) {
+                handle_commit(res,
+                              rpc::commit_request{msg.m_ticket_number},
+                              callback);
+            });
+        if(!success) {
+            m_log->error("Error replicating prepare commit");
+            callback(error_code::internal_error);
+        }
+    }
+
     void server::handle_commit(replicated_shard_interface::return_type ret,
                                rpc::commit_request msg,
                                const callback_type& callback) {
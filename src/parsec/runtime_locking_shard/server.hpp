@@ -42,6 +42,10 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
                             const rpc::prepare_request& msg,
                             const callback_type& callback);
 
+        void handle_prepare_commit(interface::prepare_return_type ret,
+                                   const rpc::prepare_commit_request& msg,
+                                   const callback_type& callback);
+
         void handle_commit(replicated_shard_interface::return_type ret,
                            rpc::commit_request msg,
                            const callback_type& callback);
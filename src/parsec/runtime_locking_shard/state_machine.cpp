@@ -67,6 +67,15 @@ namespace cbdc::parsec::runtime_locking_shard {
                             ret = res;
                         });
                 },
+                [&](const rpc::replicated_prepare_commit_request& msg) {
+                    return m_shard->prepare_commit(
+                        msg.m_ticket_number,
+                        msg.m_broker_id,
+                        msg.m_state_update,
+                        [&](replicated_shard::return_type res) {
+                            ret = res;
+                        });
+                },
                 [&](rpc::commit_request msg) {
                     return m_shard->commit(
                         msg.m_ticket_number,
@@ -22,10 +22,16 @@ namespace cbdc::parsec::ticket_machine {
         /// \param raft_endpoints vector of endpoints for the raft nodes in the
         ///                       cluster.
         /// \param logger log to use for output.
+        /// \param segmented_log true to store the raft log in append-only
+        ///                      segment files instead of LevelDB.
+        /// \param log_sync true to sync raft log writes to disk before they
+        ///                 are acknowledged.
         controller(size_t node_id,
                    network::endpoint_t server_endpoint,
                    std::vector<network::endpoint_t> raft_endpoints,
-                   std::shared_ptr<logging::log> logger);
+                   std::shared_ptr<logging::log> logger,
+                   bool segmented_log = false,
+                   bool log_sync = false);
         ~controller() = default;
 
         controller() = delete;
@@ -5,6 +5,10 @@
 
 #include "util.hpp"
 
+#include "agent/runners/evm/code_cache.hpp"
+#include "directory/consistent_hash.hpp"
+#include "directory/impl.hpp"
+
 #include <future>
 #include <unordered_map>
 
@@ -189,9 +193,88 @@ namespace cbdc::parsec {
             }
         }
 
+        constexpr auto directory_type_key = "directory_type";
+        it = opts->find(directory_type_key);
+        if(it != opts->end()) {
+            const auto& val = it->second;
+            if(val == "modulo") {
+                cfg.m_directory_type = directory_type::modulo;
+            } else if(val == "consistent_hash") {
+                cfg.m_directory_type = directory_type::consistent_hash;
+            } else {
+                return std::nullopt;
+            }
+        }
+
+        cfg.m_directory_virtual_nodes
+            = directory::consistent_hash::default_virtual_nodes;
+        constexpr auto directory_virtual_nodes_key = "directory_virtual_nodes";
+        it = opts->find(directory_virtual_nodes_key);
+        if(it != opts->end()) {
+            cfg.m_directory_virtual_nodes = std::stoull(it->second);
+        }
+
+        constexpr auto directory_prefix_length_key = "directory_prefix_length";
+        it = opts->find(directory_prefix_length_key);
+        if(it != opts->end()) {
+            cfg.m_directory_prefix_length = std::stoull(it->second);
+        }
+
+        constexpr auto raft_segmented_log_key = "raft_segmented_log";
+        it = opts->find(raft_segmented_log_key);
+        if(it != opts->end()) {
+            cfg.m_raft_segmented_log = std::stoull(it->second) != 0;
+        }
+
+        constexpr auto raft_log_sync_key = "raft_log_sync";
+        it = opts->find(raft_log_sync_key);
+        if(it != opts->end()) {
+            cfg.m_raft_log_sync = std::stoull(it->second) != 0;
+        }
+
+        constexpr auto evm_prefetch_key = "evm_prefetch";
+        it = opts->find(evm_prefetch_key);
+        if(it != opts->end()) {
+            cfg.m_evm_prefetch = std::stoull(it->second) != 0;
+        }
+
+        constexpr auto evm_batch_size_key = "evm_batch_size";
+        it = opts->find(evm_batch_size_key);
+        if(it != opts->end()) {
+            cfg.m_evm_batch_size = std::stoull(it->second);
+        }
+
+        constexpr auto evm_batch_timeout_key = "evm_batch_timeout";
+        it = opts->find(evm_batch_timeout_key);
+        if(it != opts->end()) {
+            cfg.m_evm_batch_timeout = std::stoull(it->second);
+        }
+
+        cfg.m_evm_code_cache_size
+            = agent::runner::code_cache::default_max_entries;
+        constexpr auto evm_code_cache_size_key = "evm_code_cache_size";
+        it = opts->find(evm_code_cache_size_key);
+        if(it != opts->end()) {
+            cfg.m_evm_code_cache_size = std::stoull(it->second);
+        }
+
         return cfg;
     }
 
+    auto make_directory(const config& cfg, size_t n_shards)
+        -> std::shared_ptr<directory::interface> {
+        switch(cfg.m_directory_type) {
+            case directory_type::modulo:
+                break;
+            case directory_type::consistent_hash:
+                return std::make_shared<directory::consistent_hash>(
+                    n_shards,
+                    cfg.m_directory_virtual_nodes,
+                    cfg.m_directory_prefix_length);
+        }
+        return std::make_shared<directory::impl>(n_shards);
+    }
+
     auto put_row(const std::shared_ptr<broker::interface>& broker,
                  broker::key_type key,
                  broker::value_type value,
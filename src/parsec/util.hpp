@@ -7,6 +7,7 @@
 #define OPENCBDC_TX_SRC_PARSEC_UTIL_H_
 
 #include "broker/interface.hpp"
+#include "directory/interface.hpp"
 #include "util/common/config.hpp"
 #include "util/common/logging.hpp"
 
@@ -27,6 +28,14 @@ namespace cbdc::parsec {
         evm
     };
 
+    /// Key placement strategy of the directory
+    enum class directory_type {
+        /// Hash of the key modulo the number of shards.
+        modulo,
+        /// Consistent-hash ring with virtual nodes.
+        consistent_hash
+    };
+
     /// Configuration parameters for a phase two system.
     struct config {
         /// RPC endpoints for the nodes in the ticket machine raft cluster.
@@ -51,6 +60,33 @@ namespace cbdc::parsec {
         /// The percentage of transactions that are using the same account
         /// to simulate contention
         double m_contention_rate;
+        /// Key placement strategy of the directory.
+        directory_type m_directory_type{directory_type::modulo};
+        /// Number of virtual nodes per shard on the consistent-hash ring.
+        size_t m_directory_virtual_nodes{};
+        /// Number of leading key bytes which determine a key's shard on the
+        /// consistent-hash ring, or zero to use whole keys.
+        size_t m_directory_prefix_length{};
+        /// Whether raft nodes store their log in append-only segment files
+        /// instead of LevelDB.
+        bool m_raft_segmented_log{false};
+        /// Whether raft nodes sync log writes to disk before acknowledging
+        /// them.
+        bool m_raft_log_sync{false};
+        /// Whether the EVM runner locks the state named by a transaction's
+        /// recipient and access list in parallel before executing it.
+        bool m_evm_prefetch{true};
+        /// Maximum number of raw transactions the EVM agent server schedules
+        /// together from their speculative runs, or zero to execute each
+        /// transaction as soon as it arrives.
+        size_t m_evm_batch_size{};
+        /// Maximum time in milliseconds the EVM agent server waits for a
+        /// batch's speculative runs, or for the next transaction of a batch
+        /// to finish, before executing the rest of the batch immediately.
+        size_t m_evm_batch_timeout{1000};
+        /// Maximum number of contracts whose code the EVM agent server
+        /// caches between transactions, or zero to fetch code every time.
+        size_t m_evm_code_cache_size{};
     };
 
     /// Reads the configuration parameters from the program arguments.
@@ -60,6 +96,13 @@ namespace cbdc::parsec {
     ///         while parsing the arguments.
     auto read_config(int argc, char** argv) -> std::optional<config>;
 
+    /// Creates the directory described by the configuration.
+    /// \param cfg configuration parameters.
+    /// \param n_shards number of shards available to the directory.
+    /// \return directory instance.
+    auto make_directory(const config& cfg, size_t n_shards)
+        -> std::shared_ptr<directory::interface>;
+
     /// Asynchronously inserts the given row into the cluster.
     /// \param broker broker to use for inserting the row.
     /// \param key key at which to insert value.
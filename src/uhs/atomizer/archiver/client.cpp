@@ -23,7 +23,7 @@ namespace cbdc::archiver {
     auto client::get_block(uint64_t height)
         -> std::optional<cbdc::atomizer::block> {
         m_logger->info("Requesting block", height, "from archiver...");
-        if(!m_sock.send(height)) {
+        if(!m_sock.send(request{height})) {
             m_logger->error("Error requesting block from archiver.");
             return std::nullopt;
         }
@@ -43,4 +43,50 @@ namespace cbdc::archiver {
 
         return resp.value();
     }
+
+    auto client::get_blocks(uint64_t from, uint64_t to)
+        -> std::vector<cbdc::atomizer::block> {
+        auto blks = std::vector<cbdc::atomizer::block>();
+        auto next = from;
+        while(next <= to) {
+            m_logger->info("Requesting blocks",
+                           next,
+                           "to",
+                           to,
+                           "from archiver...");
+            if(!m_sock.send(request{range_request{next, to}})) {
+                m_logger->error("Error requesting blocks from archiver.");
+                break;
+            }
+
+            uint64_t n_received{0};
+            while(true) {
+                cbdc::buffer resp_pkt;
+                if(!m_sock.receive(resp_pkt)) {
+                    m_logger->error("Error receiving block from archiver.");
+                    return blks;
+                }
+
+                auto resp = cbdc::from_buffer<response>(resp_pkt);
+                if(!resp.has_value()) {
+                    m_logger->error("Invalid response packet");
+                    return blks;
+                }
+
+                // A response without a block ends the range
+                if(!resp.value().has_value()) {
+                    break;
+                }
+                blks.emplace_back(std::move(resp.value().value()));
+                n_received++;
+            }
+
+            if(n_received == 0) {
+                break;
+            }
+            next += n_received;
+        }
+
+        return blks;
+    }
 }
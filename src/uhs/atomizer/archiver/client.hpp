@@ -10,13 +10,27 @@
 #include "util/common/logging.hpp"
 #include "util/network/tcp_socket.hpp"
 
+#include <variant>
+
 namespace cbdc::archiver {
-    /// Height of the block to fetch from the archiver.
-    using request = uint64_t;
+    /// Heights of the first and last (inclusive) of a range of consecutive
+    /// blocks to fetch from the archiver.
+    using range_request = std::pair<uint64_t, uint64_t>;
+
+    /// Height of the block to fetch from the archiver, or a range of
+    /// blocks.
+    using request = std::variant<uint64_t, range_request>;
 
-    /// The requested block, or std::nullopt if not found.
+    /// \brief The requested block, or std::nullopt if not found.
+    ///
+    /// The archiver answers a \ref range_request with one response for
+    /// each block it returns, in height order, followed by a response
+    /// without a block.
     using response = std::optional<cbdc::atomizer::block>;
 
+    /// Maximum number of blocks the archiver returns for one range request.
+    static constexpr uint64_t max_range_blocks = 64;
+
     /// \brief Retrieves blocks from a remote archiver via the network.
     ///
     /// \warning Not thread-safe. Only one thread can use the client without
@@ -40,6 +54,17 @@ namespace cbdc::archiver {
         auto get_block(uint64_t height)
             -> std::optional<cbdc::atomizer::block>;
 
+        /// Retrieves consecutive blocks from the archiver. Requests ranges of
+        /// blocks so that the archiver streams the blocks back without a
+        /// round trip per block.
+        /// \param from height of the first block to retrieve.
+        /// \param to height of the last block to retrieve (inclusive).
+        /// \return the retrieved blocks in height order. Stops before the
+        ///         first block the archiver does not have, so may contain
+        ///         fewer blocks than requested.
+        auto get_blocks(uint64_t from, uint64_t to)
+            -> std::vector<cbdc::atomizer::block>;
+
       private:
         network::tcp_socket m_sock;
         network::endpoint_t m_endpoint;
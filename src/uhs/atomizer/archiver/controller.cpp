@@ -5,7 +5,9 @@
 
 #include "controller.hpp"
 
+#include "uhs/atomizer/atomizer/block_encoding.hpp"
 #include "uhs/atomizer/atomizer/format.hpp"
+#include "util/common/variant_overloaded.hpp"
 #include "util/serialization/format.hpp"
 #include "util/serialization/util.hpp"
 
@@ -28,7 +30,16 @@ namespace cbdc::archiver {
         : m_archiver_id(archiver_id),
           m_opts(std::move(opts)),
           m_logger(std::move(log)),
-          m_max_samples(max_samples) {}
+          m_max_samples(max_samples) {
+        for(size_t i{0}; i < encode_thread_count; i++) {
+            m_encode_threads.emplace_back([&]() {
+                auto task = std::function<void()>();
+                while(m_encode_queue.pop(task)) {
+                    task();
+                }
+            });
+        }
+    }
 
     controller::~controller() {
         m_atomizer_network.close();
@@ -43,6 +54,11 @@ namespace cbdc::archiver {
         if(m_archiver_server.joinable()) {
             m_archiver_server.join();
         }
+
+        m_encode_queue.clear();
+        for(auto& t : m_encode_threads) {
+            t.join();
+        }
     }
 
     auto controller::init() -> bool {
@@ -151,13 +167,37 @@ namespace cbdc::archiver {
             m_logger->error("Invalid request packet");
             return std::nullopt;
         }
-        auto blk = get_block(req.value());
-        return cbdc::make_buffer(blk);
+        return std::visit(
+            overloaded{
+                [&](uint64_t height) {
+                    auto res = std::optional<cbdc::buffer>();
+                    read_blocks(height, height, [&](std::string&& blk_str) {
+                        res = make_block_response(blk_str);
+                    });
+                    if(!res.has_value()) {
+                        m_logger->warn("block", height, "not found");
+                        res = cbdc::make_buffer(response());
+                    }
+                    return res;
+                },
+                [&](const range_request& range) {
+                    read_blocks(range.first,
+                                range.second,
+                                [&](std::string&& blk_str) {
+                                    m_archiver_network.send(
+                                        std::make_shared<cbdc::buffer>(
+                                            make_block_response(blk_str)),
+                                        pkt.m_peer_id);
+                                });
+                    return std::optional<cbdc::buffer>(
+                        cbdc::make_buffer(response()));
+                }},
+            req.value());
     }
 
     auto controller::atomizer_handler(cbdc::network::message_t&& pkt)
         -> std::optional<cbdc::buffer> {
-        auto blk = from_buffer<atomizer::block>(*pkt.m_pkt);
+        auto blk = atomizer::decode_block(*pkt.m_pkt);
         if(!blk.has_value()) {
             m_logger->error("Invalid request packet");
             return std::nullopt;
@@ -166,7 +206,7 @@ namespace cbdc::archiver {
             m_running = false;
             return std::nullopt;
         }
-        digest_block(blk.value());
+        digest_block(std::move(blk.value()));
         return std::nullopt;
     }
 
@@ -174,7 +214,7 @@ namespace cbdc::archiver {
         return m_best_height;
     }
 
-    void controller::digest_block(const cbdc::atomizer::block& blk) {
+    void controller::digest_block(cbdc::atomizer::block blk) {
         if(m_best_height == 0) {
             // This is the first call to digest_block. Check if there is
             // already a best height value in the database and set it if so.
@@ -187,75 +227,89 @@ namespace cbdc::archiver {
             }
         }
 
-        cbdc::atomizer::block next_blk;
-        bool digest_next{false};
-        {
-            if(blk.m_height <= m_best_height) {
-                m_logger->warn("Not processing duplicate block h:",
-                               blk.m_height);
-                return;
-            }
+        if(blk.m_height <= m_best_height) {
+            m_logger->warn("Not processing duplicate block h:", blk.m_height);
+            return;
+        }
 
-            if(blk.m_height != m_best_height + 1) {
-                // Not contiguous, check prev block isn't deferred already
-                auto it = m_deferred.find(blk.m_height - 1);
-                if(it == m_deferred.end()) {
-                    // Request previous block from atomizer cluster
-                    request_block(blk.m_height - 1);
-                }
-                m_deferred.emplace(blk.m_height, blk);
+        if(blk.m_height != m_best_height + 1) {
+            if(m_deferred.find(blk.m_height) != m_deferred.end()) {
                 return;
             }
+            // Not contiguous, check prev block isn't deferred already
+            auto it = m_deferred.find(blk.m_height - 1);
+            if(it == m_deferred.end()) {
+                // Request previous block from atomizer cluster
+                request_block(blk.m_height - 1);
+            }
 
-            leveldb::WriteBatch batch;
-
-            m_logger->trace("Digesting block ", blk.m_height, "... ");
-
-            auto blk_bytes = make_buffer(blk);
-            leveldb::Slice blk_slice(blk_bytes.c_str(), blk_bytes.size());
-
-            const auto height_str = std::to_string(blk.m_height);
+            // Encode the block while waiting for the preceding blocks
+            auto& deferred = m_deferred[blk.m_height];
+            deferred.m_tx_count = blk.m_transactions.size();
+            auto bytes
+                = std::make_shared<std::promise<std::shared_ptr<buffer>>>();
+            deferred.m_bytes = bytes->get_future();
+            auto deferred_blk
+                = std::make_shared<cbdc::atomizer::block>(std::move(blk));
+            m_encode_queue.push([this, bytes, deferred_blk]() {
+                bytes->set_value(encode_for_storage(*deferred_blk));
+            });
+            return;
+        }
 
-            batch.Put(height_str, blk_slice);
-            batch.Put(m_bestblock_key, height_str);
-            m_best_height++;
+        m_logger->trace("Digesting block ", blk.m_height, "... ");
+
+        // Write the block and every deferred block contiguous with it in a
+        // single batch.
+        leveldb::WriteBatch batch;
+        auto blk_bytes = encode_for_storage(blk);
+        batch.Put(std::to_string(blk.m_height),
+                  leveldb::Slice(blk_bytes->c_str(), blk_bytes->size()));
+        auto tx_counts = std::vector<size_t>{blk.m_transactions.size()};
+        auto height = blk.m_height;
+        for(auto it = m_deferred.begin();
+            it != m_deferred.end() && it->first == height + 1;
+            it = m_deferred.erase(it)) {
+            height++;
+            blk_bytes = it->second.m_bytes.get();
+            batch.Put(std::to_string(height),
+                      leveldb::Slice(blk_bytes->c_str(), blk_bytes->size()));
+            tx_counts.push_back(it->second.m_tx_count);
+        }
+        batch.Put(m_bestblock_key, std::to_string(height));
 
-            const auto res = m_db->Write(m_write_options, &batch);
-            assert(res.ok());
+        const auto res = m_db->Write(m_write_options, &batch);
+        assert(res.ok());
+        m_best_height = height;
 
-            m_logger->trace("Digested block ", blk.m_height);
-            if(m_sample_collection_active) {
+        m_logger->trace("Digested blocks up to ", height);
+        if(m_sample_collection_active) {
+            for(const auto tx_count : tx_counts) {
                 const auto old_block_time = m_last_block_time;
                 m_last_block_time = std::chrono::high_resolution_clock::now();
                 const auto s_since_last_block = std::chrono::duration<double>(
                     m_last_block_time - old_block_time);
-                const auto tx_throughput
-                    = static_cast<double>(blk.m_transactions.size())
-                    / s_since_last_block.count();
+                const auto tx_throughput = static_cast<double>(tx_count)
+                                         / s_since_last_block.count();
 
                 m_tp_sample_file << tx_throughput << std::endl;
                 m_samples++;
             }
-
-            // Tell the atomizer cluster to prune all blocks <
-            // m_best_height
-            request_prune(m_best_height);
-
-            auto it = m_deferred.find(blk.m_height + 1);
-            if(it != m_deferred.end()) {
-                next_blk = it->second;
-                digest_next = true;
-            }
-
-            m_deferred.erase(blk.m_height);
         }
 
-        if(digest_next) {
-            // TODO: this can recurse back to genesis. In a long-running system
-            // we'll want an alternative method of building a new archiver node
-            // and limit the depth of recursion here.
-            digest_block(next_blk);
-        }
+        // Tell the atomizer cluster to prune all blocks <
+        // m_best_height
+        request_prune(m_best_height);
+    }
+
+    auto controller::encode_for_storage(const cbdc::atomizer::block& blk) const
+        -> std::shared_ptr<cbdc::buffer> {
+        // Stored blocks are self-describing, so a database may hold
+        // blocks in several encodings if the setting changes.
+        const auto enc = m_opts.m_compact_blocks
+                           ? atomizer::block_encoding::pubkey_table
+                           : atomizer::block_encoding::plain;
+        return atomizer::encode_block(blk, enc);
     }
 
     auto controller::get_block(uint64_t height)
@@ -277,12 +331,72 @@ namespace cbdc::archiver {
 
         auto buf = cbdc::buffer();
         buf.append(blk_str.data(), blk_str.size());
-        auto blk = from_buffer<atomizer::block>(buf);
+        auto blk = atomizer::decode_block(buf);
         assert(blk.has_value());
         m_logger->trace("found block", height, "-", blk.value().m_height);
         return blk.value();
     }
 
+    auto controller::get_blocks(uint64_t from, uint64_t to)
+        -> std::vector<cbdc::atomizer::block> {
+        auto blks = std::vector<cbdc::atomizer::block>();
+        read_blocks(from, to, [&](std::string&& blk_str) {
+            auto buf = cbdc::buffer();
+            buf.append(blk_str.data(), blk_str.size());
+            auto blk = atomizer::decode_block(buf);
+            assert(blk.has_value());
+            blks.emplace_back(std::move(blk.value()));
+        });
+        return blks;
+    }
+
+    void controller::read_blocks(
+        uint64_t from,
+        uint64_t to,
+        const std::function<void(std::string&&)>& handler) {
+        if(to < from) {
+            return;
+        }
+        if(to - from >= max_range_blocks) {
+            to = from + max_range_blocks - 1;
+        }
+
+        // Reading a range of old blocks should not evict recent blocks from
+        // the LevelDB block cache.
+        auto opts = leveldb::ReadOptions();
+        opts.fill_cache = from == to;
+        for(auto height = from; height <= to; height++) {
+            std::string blk_str;
+            const auto res = m_db->Get(opts, std::to_string(height), &blk_str);
+            if(!res.ok()) {
+                return;
+            }
+            handler(std::move(blk_str));
+        }
+    }
+
+    auto controller::make_block_response(const std::string& blk_str)
+        -> cbdc::buffer {
+        auto res = cbdc::buffer();
+        auto ser = cbdc::buffer_serializer(res);
+        ser << true;
+        res.append(blk_str.data(), blk_str.size());
+
+        auto deser = cbdc::buffer_serializer(res);
+        bool has_value{};
+        deser >> has_value;
+        if(atomizer::read_block_encoding(deser)
+           == atomizer::block_encoding::plain) {
+            return res;
+        }
+
+        auto buf = cbdc::buffer();
+        buf.append(blk_str.data(), blk_str.size());
+        auto blk = atomizer::decode_block(buf);
+        assert(blk.has_value());
+        return cbdc::make_buffer(response(std::move(blk)));
+    }
+
     void controller::request_block(uint64_t height) {
         m_logger->trace("Requesting block", height);
         auto req = atomizer::get_block_request{height};
@@ -8,9 +8,12 @@
 
 #include "client.hpp"
 #include "uhs/atomizer/atomizer/block.hpp"
+#include "util/common/blocking_queue.hpp"
 #include "util/common/config.hpp"
 #include "util/network/connection_manager.hpp"
 
+#include <functional>
+#include <future>
 #include <leveldb/db.h>
 
 namespace cbdc::archiver {
@@ -76,8 +79,11 @@ namespace cbdc::archiver {
         [[nodiscard]] auto best_block_height() const -> uint64_t;
 
         /// Receives a request for an archived block and returns the block.
+        /// For a request for a range of blocks, sends each block in the
+        /// range to the requester as it is read from the database, and
+        /// returns the response which ends the range.
         /// \param pkt packet containing the request.
-        /// \return block or std::nullopt from \ref get_block.
+        /// \return serialized \ref response.
         /// \see \ref network::packet_handler_t
         auto server_handler(cbdc::network::message_t&& pkt)
             -> std::optional<cbdc::buffer>;
@@ -94,14 +100,15 @@ namespace cbdc::archiver {
         ///
         /// Initializes the best block height field on its first call. If the
         /// controller's known best block height is not contiguous with the
-        /// height of the provided block, recursively requests preceding blocks
-        /// from the atomizer. Stores each received block in a deferred
-        /// processing cache until receiving the next contiguous block, then
-        /// digests each block in order.
+        /// height of the provided block, requests the preceding block from
+        /// the atomizer and defers the block. Deferred blocks are encoded
+        /// for storage by worker threads while they wait. Once the next
+        /// contiguous block arrives, writes it together with the run of
+        /// deferred blocks that follow it in a single batch.
         ///
         /// Instructs connected atomizers to prune digested blocks.
         /// \param blk block to digest.
-        void digest_block(const cbdc::atomizer::block& blk);
+        void digest_block(cbdc::atomizer::block blk);
 
         /// Queries the archiver database for the block at the specified
         /// height.
@@ -111,6 +118,14 @@ namespace cbdc::archiver {
         auto get_block(uint64_t height)
             -> std::optional<cbdc::atomizer::block>;
 
+        /// Queries the archiver database for a range of consecutive blocks.
+        /// \param from height of the first block to retrieve.
+        /// \param to height of the last block to retrieve (inclusive).
+        /// \return the blocks in height order, stopping before the first
+        ///         block the database does not contain.
+        auto get_blocks(uint64_t from, uint64_t to)
+            -> std::vector<cbdc::atomizer::block>;
+
         /// \brief Returns true if this archiver is receiving blocks
         /// from the atomizer.
         ///
@@ -126,10 +141,22 @@ namespace cbdc::archiver {
 
         std::unique_ptr<leveldb::DB> m_db;
         uint64_t m_best_height{0};
-        /// Blocks pending digestion, waiting for the archiver to digest
-        /// preceding blocks from the atomizer, keyed by height.
+        /// Block pending digestion, waiting for the archiver to digest
+        /// preceding blocks from the atomizer.
+        struct deferred_block {
+            /// Number of transactions in the block.
+            size_t m_tx_count{};
+            /// Encoding of the block for storage, produced by a worker
+            /// thread.
+            std::future<std::shared_ptr<cbdc::buffer>> m_bytes;
+        };
+
+        /// Blocks pending digestion, keyed by height.
         /// \see \ref digest_block
-        std::map<uint64_t, cbdc::atomizer::block> m_deferred;
+        std::map<uint64_t, deferred_block> m_deferred;
+        /// Tasks encoding deferred blocks.
+        blocking_queue<std::function<void()>> m_encode_queue;
+        std::vector<std::thread> m_encode_threads;
         std::ofstream m_tp_sample_file;
         std::chrono::high_resolution_clock::time_point m_last_block_time;
         size_t m_max_samples{};
@@ -149,6 +176,29 @@ namespace cbdc::archiver {
         static constexpr const leveldb::ReadOptions m_read_options{};
         static const leveldbWriteOptions m_write_options;
 
+        /// Reads the stored encodings of consecutive blocks from the
+        /// database, stopping before the first missing block.
+        /// \param from height of the first block to read.
+        /// \param to height of the last block to read (inclusive).
+        /// \param handler function to call with each stored block.
+        void read_blocks(uint64_t from,
+                         uint64_t to,
+                         const std::function<void(std::string&&)>& handler);
+
+        /// Returns a serialized \ref response containing the given stored
+        /// block. Blocks stored with the plain encoding are already
+        /// serialized, so are copied into the response without decoding.
+        static auto make_block_response(const std::string& blk_str)
+            -> cbdc::buffer;
+
+        /// Number of worker threads encoding deferred blocks.
+        static constexpr size_t encode_thread_count = 4;
+
+        /// Returns the encoding of the block for storage.
+        [[nodiscard]] auto encode_for_storage(
+            const cbdc::atomizer::block& blk) const
+            -> std::shared_ptr<cbdc::buffer>;
+
         void request_block(uint64_t height);
         void request_prune(uint64_t height);
     };
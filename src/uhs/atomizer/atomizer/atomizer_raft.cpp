@@ -28,7 +28,9 @@ namespace cbdc::atomizer {
                    "atomizer_snps_" + std::to_string(atomizer_id)),
                0,
                logger,
-               std::move(raft_callback)),
+               std::move(raft_callback),
+               opts.m_raft_segmented_log,
+               opts.m_raft_log_sync),
           m_log(std::move(logger)),
           m_opts(std::move(opts)) {}
 
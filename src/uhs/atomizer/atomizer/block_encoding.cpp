@@ -0,0 +1,143 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "block_encoding.hpp"
+
+#include "format.hpp"
+#include "uhs/transaction/messages.hpp"
+#include "util/common/hashmap.hpp"
+#include "util/serialization/format.hpp"
+#include "util/serialization/util.hpp"
+
+#include <limits>
+#include <unordered_map>
+
+namespace cbdc::atomizer {
+    namespace {
+        /// Leading value of blocks not encoded with block_encoding::plain.
+        /// Occupies the position of the block height in the plain encoding.
+        constexpr auto encoded_block_marker
+            = std::numeric_limits<uint64_t>::max();
+
+        void write_pubkey_table_block(serializer& ser, const block& blk) {
+            auto pubkeys = std::vector<pubkey_t>();
+            auto indices
+                = std::unordered_map<pubkey_t, uint32_t, hashing::null>();
+            for(const auto& tx : blk.m_transactions) {
+                for(const auto& att : tx.m_attestations) {
+                    const auto idx = static_cast<uint32_t>(pubkeys.size());
+                    if(indices.emplace(att.first, idx).second) {
+                        pubkeys.push_back(att.first);
+                    }
+                }
+            }
+
+            ser << encoded_block_marker << block_encoding::pubkey_table
+                << blk.m_height << pubkeys
+                << static_cast<uint64_t>(blk.m_transactions.size());
+            for(const auto& tx : blk.m_transactions) {
+                ser << tx.m_id << tx.m_inputs << tx.m_uhs_outputs
+                    << static_cast<uint64_t>(tx.m_attestations.size());
+                for(const auto& att : tx.m_attestations) {
+                    ser << indices[att.first] << att.second;
+                }
+            }
+        }
+
+        auto read_pubkey_table_block(serializer& deser, block& blk) -> bool {
+            auto pubkeys = std::vector<pubkey_t>();
+            uint64_t n_txs{};
+            if(!(deser >> blk.m_height >> pubkeys >> n_txs)) {
+                return false;
+            }
+
+            for(uint64_t i = 0; i < n_txs; i++) {
+                auto tx = transaction::compact_tx();
+                uint64_t n_atts{};
+                if(!(deser >> tx.m_id >> tx.m_inputs >> tx.m_uhs_outputs
+                     >> n_atts)) {
+                    return false;
+                }
+                for(uint64_t j = 0; j < n_atts; j++) {
+                    uint32_t idx{};
+                    signature_t sig{};
+                    if(!(deser >> idx >> sig) || idx >= pubkeys.size()) {
+                        return false;
+                    }
+                    tx.m_attestations.emplace(pubkeys[idx], sig);
+                }
+                blk.m_transactions.push_back(std::move(tx));
+            }
+
+            return true;
+        }
+    }
+
+    auto encode_block(const block& blk, block_encoding enc)
+        -> std::shared_ptr<buffer> {
+        switch(enc) {
+            case block_encoding::pubkey_table: {
+                auto buf = std::make_shared<buffer>();
+                auto ser = buffer_serializer(*buf);
+                write_pubkey_table_block(ser, blk);
+                return buf;
+            }
+            case block_encoding::plain:
+                break;
+        }
+        return make_shared_buffer(blk);
+    }
+
+    auto decode_block(buffer& buf) -> std::optional<block> {
+        auto deser = buffer_serializer(buf);
+        uint64_t height_or_marker{};
+        if(!(deser >> height_or_marker)) {
+            return std::nullopt;
+        }
+
+        auto blk = block();
+        if(height_or_marker != encoded_block_marker) {
+            blk.m_height = height_or_marker;
+            if(!(deser >> blk.m_transactions)) {
+                return std::nullopt;
+            }
+            return blk;
+        }
+
+        auto enc = block_encoding::plain;
+        if(!(deser >> enc)) {
+            return std::nullopt;
+        }
+
+        switch(enc) {
+            case block_encoding::pubkey_table:
+                if(!read_pubkey_table_block(deser, blk)) {
+                    return std::nullopt;
+                }
+                return blk;
+            case block_encoding::plain:
+                break;
+        }
+
+        return std::nullopt;
+    }
+
+    auto read_block_encoding(serializer& deser)
+        -> std::optional<block_encoding> {
+        uint64_t height_or_marker{};
+        if(!(deser >> height_or_marker)) {
+            return std::nullopt;
+        }
+        if(height_or_marker != encoded_block_marker) {
+            return block_encoding::plain;
+        }
+
+        auto enc = block_encoding::plain;
+        if(!(deser >> enc)) {
+            return std::nullopt;
+        }
+        return enc;
+    }
+}
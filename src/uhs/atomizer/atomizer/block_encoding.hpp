@@ -0,0 +1,54 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_ATOMIZER_BLOCK_ENCODING_H_
+#define OPENCBDC_TX_SRC_ATOMIZER_BLOCK_ENCODING_H_
+
+#include "block.hpp"
+#include "util/serialization/serializer.hpp"
+
+#include <memory>
+#include <optional>
+
+namespace cbdc::atomizer {
+    /// Encodings for transmitting blocks to shards, watchtowers and
+    /// archivers, and for storing blocks in the archiver.
+    enum class block_encoding : uint8_t {
+        /// Standard serialization of \ref block.
+        plain = 0,
+        /// Sentinel public keys from the attestations of every transaction
+        /// in the block are deduplicated into a per-block table. Each
+        /// attestation refers to its public key by index in the table.
+        pubkey_table = 1
+    };
+
+    /// \brief Serializes a block using the given encoding.
+    ///
+    /// Blocks encoded with \ref block_encoding::plain are identical to the
+    /// standard serialization of \ref block. Other encodings are prefixed
+    /// with a marker that cannot be a valid block height, followed by the
+    /// encoding, so \ref decode_block can distinguish them.
+    /// \param blk block to encode.
+    /// \param enc encoding to use.
+    /// \return buffer containing the encoded block.
+    auto encode_block(const block& blk, block_encoding enc)
+        -> std::shared_ptr<buffer>;
+
+    /// Deserializes a block produced by \ref encode_block with any encoding.
+    /// \param buf buffer containing the encoded block.
+    /// \return the decoded block, or std::nullopt if the buffer does not
+    ///         contain a valid encoded block.
+    auto decode_block(buffer& buf) -> std::optional<block>;
+
+    /// Reads the encoding of a block produced by \ref encode_block without
+    /// decoding the rest of the block.
+    /// \param deser serializer positioned at the start of the encoded block.
+    /// \return the block's encoding, or std::nullopt if the serializer does
+    ///         not contain enough data.
+    auto read_block_encoding(serializer& deser)
+        -> std::optional<block_encoding>;
+}
+
+#endif // OPENCBDC_TX_SRC_ATOMIZER_BLOCK_ENCODING_H_
@@ -20,6 +20,9 @@ namespace cbdc::atomizer {
         : m_atomizer_id(atomizer_id),
           m_opts(opts),
           m_logger(std::move(log)),
+          m_block_encoding(m_opts.m_compact_blocks
+                               ? block_encoding::pubkey_table
+                               : block_encoding::plain),
           m_raft_node(static_cast<uint32_t>(atomizer_id),
                       opts.m_atomizer_raft_endpoints,
                       m_opts.m_stxo_cache_depth,
@@ -146,7 +149,9 @@ namespace cbdc::atomizer {
                             maybe_resp.value()));
                         auto& resp
                             = std::get<get_block_response>(maybe_resp.value());
-                        m_atomizer_network.send(resp.m_blk, peer_id);
+                        m_atomizer_network.send(
+                            encode_block(resp.m_blk, m_block_encoding),
+                            peer_id);
                     };
                     m_raft_node.make_request(g, result_fn);
                 }},
@@ -209,7 +214,7 @@ namespace cbdc::atomizer {
             std::holds_alternative<make_block_response>(maybe_resp.value()));
         auto& resp = std::get<make_block_response>(maybe_resp.value());
 
-        auto blk_pkt = make_shared_buffer(resp.m_blk);
+        auto blk_pkt = encode_block(resp.m_blk, m_block_encoding);
 
         m_atomizer_network.broadcast(blk_pkt);
 
@@ -7,6 +7,7 @@
 #define OPENCBDC_TX_SRC_ATOMIZER_CONTROLLER_H_
 
 #include "atomizer_raft.hpp"
+#include "block_encoding.hpp"
 #include "uhs/atomizer/atomizer/block.hpp"
 #include "util/common/config.hpp"
 #include "util/network/connection_manager.hpp"
@@ -41,6 +42,7 @@ namespace cbdc::atomizer {
         uint32_t m_atomizer_id;
         cbdc::config::options m_opts;
         std::shared_ptr<logging::log> m_logger;
+        block_encoding m_block_encoding;
 
         atomizer_raft m_raft_node;
         std::atomic_bool m_running{true};
@@ -8,9 +8,11 @@
 namespace cbdc::sentinel::rpc {
     server::server(
         interface* impl,
-        std::unique_ptr<cbdc::rpc::async_server<request, response>> srv)
+        std::unique_ptr<cbdc::rpc::async_server<request, response>> srv,
+        size_t max_batch_size)
         : m_impl(impl),
-          m_srv(std::move(srv)) {
+          m_srv(std::move(srv)),
+          m_max_batch_size(max_batch_size) {
         m_srv->register_handler_callback(
             [&](request req, callback_type callback) -> bool {
                 m_queue.push({std::move(req), std::move(callback)});
@@ -48,6 +50,13 @@ namespace cbdc::sentinel::rpc {
                 },
                 [&](validate_request v_req) -> std::optional<response> {
                     return m_impl->validate_transaction(std::move(v_req));
+                },
+                [&](execute_batch_request b_req) -> std::optional<response> {
+                    if(b_req.m_txs.size() > m_max_batch_size) {
+                        return std::nullopt;
+                    }
+                    return m_impl->execute_transactions(
+                        std::move(b_req.m_txs));
                 }},
             req.first);
 
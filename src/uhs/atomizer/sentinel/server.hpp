@@ -19,10 +19,14 @@ namespace cbdc::sentinel::rpc {
         /// server using a request handler callback.
         /// \param impl pointer to a sentinel implementation.
         /// \param srv pointer to a blocking RPC server.
+        /// \param max_batch_size maximum number of transactions in a batch
+        ///                       execution request. Larger requests are
+        ///                       rejected with an error response.
         server(
             interface* impl, // TODO: convert sentinel::controller to
                              //       contain a shared_ptr to an implementation
-            std::unique_ptr<cbdc::rpc::async_server<request, response>> srv);
+            std::unique_ptr<cbdc::rpc::async_server<request, response>> srv,
+            size_t max_batch_size);
 
         ~server();
 
@@ -37,6 +41,7 @@ namespace cbdc::sentinel::rpc {
 
         interface* m_impl;
         std::unique_ptr<cbdc::rpc::async_server<request, response>> m_srv;
+        size_t m_max_batch_size;
         blocking_queue<request_type> m_queue;
 
         std::vector<std::thread> m_threads;
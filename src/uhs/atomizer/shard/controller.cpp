@@ -6,6 +6,7 @@
 #include "controller.hpp"
 
 #include "uhs/atomizer/atomizer/atomizer_raft.hpp"
+#include "uhs/atomizer/atomizer/block_encoding.hpp"
 #include "uhs/transaction/messages.hpp"
 
 #include <utility>
@@ -111,7 +112,7 @@ namespace cbdc::shard {
 
     auto controller::atomizer_handler(cbdc::network::message_t&& pkt)
         -> std::optional<cbdc::buffer> {
-        auto maybe_blk = from_buffer<atomizer::block>(*pkt.m_pkt);
+        auto maybe_blk = atomizer::decode_block(*pkt.m_pkt);
         if(!maybe_blk.has_value()) {
             m_logger->error("Invalid block packet");
             return std::nullopt;
@@ -134,18 +135,16 @@ namespace cbdc::shard {
             }
 
             // Attempt to catch up to the latest block
-            for(uint64_t i = m_shard.best_block_height() + 1; i < blk.m_height;
-                i++) {
-                const auto past_blk = m_archiver_client.get_block(i);
-                if(past_blk) {
-                    m_shard.digest_block(past_blk.value());
-                } else {
-                    m_logger->info("Waiting for archiver sync");
-                    const auto wait_time = std::chrono::milliseconds(10);
-                    std::this_thread::sleep_for(wait_time);
-                    i--;
-                    continue;
-                }
+            const auto past_blks = m_archiver_client.get_blocks(
+                m_shard.best_block_height() + 1,
+                blk.m_height - 1);
+            for(const auto& past_blk : past_blks) {
+                m_shard.digest_block(past_blk);
+            }
+            if(m_shard.best_block_height() + 1 < blk.m_height) {
+                m_logger->info("Waiting for archiver sync");
+                const auto wait_time = std::chrono::milliseconds(10);
+                std::this_thread::sleep_for(wait_time);
             }
         }
 
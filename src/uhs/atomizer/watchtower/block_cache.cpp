@@ -5,62 +5,167 @@
 
 #include "block_cache.hpp"
 
+#include <algorithm>
+
 namespace cbdc::watchtower {
-    block_cache::block_cache(size_t k) : m_k_blks(k) {
-        static constexpr auto puts_per_tx = 2;
-        static constexpr auto txs_per_block = 1000000;
-        m_spent_ids.reserve(k * txs_per_block * puts_per_tx);
-        m_unspent_ids.reserve(k * txs_per_block * puts_per_tx);
+    namespace {
+        constexpr size_t filter_bits_per_id = 10;
+        constexpr size_t filter_probes = 7;
+        constexpr size_t bits_per_word = 64;
+        constexpr size_t half_word_bits = 32;
+
+        /// Returns the position of the ith Bloom filter bit for the given
+        /// hash, using double hashing.
+        auto filter_bit(uint64_t hash, size_t i, size_t n_bits) -> size_t {
+            const auto h2 = ((hash << half_word_bits)
+                             | (hash >> half_word_bits))
+                          | 1U;
+            return static_cast<size_t>((hash + i * h2) % n_bits);
+        }
     }
 
-    void block_cache::push_block(cbdc::atomizer::block&& blk) {
-        if((m_k_blks != 0) && (m_blks.size() == m_k_blks)) {
-            auto& old_blk = m_blks.front();
-            for(auto& tx : old_blk.m_transactions) {
-                for(auto& in : tx.m_inputs) {
-                    m_spent_ids.erase(in);
-                }
-                for(auto& out : tx.m_uhs_outputs) {
-                    m_unspent_ids.erase(out);
-                }
+    block_index::block_index(const cbdc::atomizer::block& blk)
+        : m_height(blk.m_height) {
+        size_t n_spent{0};
+        size_t n_created{0};
+        for(const auto& tx : blk.m_transactions) {
+            n_spent += tx.m_inputs.size();
+            n_created += tx.m_uhs_outputs.size();
+        }
+
+        m_spent.reserve(n_spent);
+        m_created.reserve(n_created);
+        for(const auto& tx : blk.m_transactions) {
+            for(const auto& in : tx.m_inputs) {
+                m_spent.emplace_back(in, tx.m_id);
+            }
+            for(const auto& out : tx.m_uhs_outputs) {
+                m_created.emplace_back(out, tx.m_id);
             }
-            m_blks.pop();
         }
 
-        m_blks.push(std::forward<cbdc::atomizer::block>(blk));
+        // Stable sort so lookups for repeated UHS IDs return the first
+        // occurrence in the block.
+        auto by_uhs_id = [](const entry& a, const entry& b) {
+            return a.first < b.first;
+        };
+        std::stable_sort(m_spent.begin(), m_spent.end(), by_uhs_id);
+        std::stable_sort(m_created.begin(), m_created.end(), by_uhs_id);
 
-        auto blk_height = m_blks.back().m_height;
-        for(auto& tx : m_blks.back().m_transactions) {
-            for(auto& in : tx.m_inputs) {
-                m_unspent_ids.erase(in);
-                m_spent_ids.insert(
-                    {{in, std::make_pair(blk_height, tx.m_id)}});
-            }
-            for(auto& out : tx.m_uhs_outputs) {
-                m_unspent_ids.insert(
-                    {{out, std::make_pair(blk_height, tx.m_id)}});
+        const auto n_bits = (n_spent + n_created) * filter_bits_per_id;
+        m_filter.resize(std::max<size_t>(1, n_bits / bits_per_word + 1));
+        for(const auto& e : m_spent) {
+            add_to_filter(filter_hash(e.first));
+        }
+        for(const auto& e : m_created) {
+            add_to_filter(filter_hash(e.first));
+        }
+    }
+
+    auto block_index::height() const -> uint64_t {
+        return m_height;
+    }
+
+    auto block_index::filter_hash(const hash_t& uhs_id) -> uint64_t {
+        return hashing::const_sip_hash<hash_t>()(uhs_id);
+    }
+
+    auto block_index::find_spent(const hash_t& uhs_id, uint64_t hash) const
+        -> std::optional<hash_t> {
+        if(!may_contain(hash)) {
+            return std::nullopt;
+        }
+        return find(m_spent, uhs_id);
+    }
+
+    auto block_index::find_created(const hash_t& uhs_id, uint64_t hash) const
+        -> std::optional<hash_t> {
+        if(!may_contain(hash)) {
+            return std::nullopt;
+        }
+        return find(m_created, uhs_id);
+    }
+
+    auto block_index::may_contain(uint64_t hash) const -> bool {
+        const auto n_bits = m_filter.size() * bits_per_word;
+        for(size_t i{0}; i < filter_probes; i++) {
+            const auto bit = filter_bit(hash, i, n_bits);
+            if((m_filter[bit / bits_per_word]
+                & (uint64_t{1} << (bit % bits_per_word)))
+               == 0) {
+                return false;
             }
         }
-        m_best_blk_height = std::max(m_best_blk_height, blk_height);
+        return true;
+    }
+
+    void block_index::add_to_filter(uint64_t hash) {
+        const auto n_bits = m_filter.size() * bits_per_word;
+        for(size_t i{0}; i < filter_probes; i++) {
+            const auto bit = filter_bit(hash, i, n_bits);
+            m_filter[bit / bits_per_word]
+                |= uint64_t{1} << (bit % bits_per_word);
+        }
+    }
+
+    auto block_index::find(const std::vector<entry>& entries,
+                           const hash_t& uhs_id) -> std::optional<hash_t> {
+        auto it = std::lower_bound(entries.begin(),
+                                   entries.end(),
+                                   uhs_id,
+                                   [](const entry& e, const hash_t& id) {
+                                       return e.first < id;
+                                   });
+        if(it == entries.end() || it->first != uhs_id) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    block_cache::block_cache(size_t k) : m_k_blks(k) {}
+
+    void block_cache::push_block(cbdc::atomizer::block&& blk) {
+        push_index(std::make_shared<const block_index>(blk));
+    }
+
+    void block_cache::push_index(std::shared_ptr<const block_index> idx) {
+        if((m_k_blks != 0) && (m_blks.size() == m_k_blks)) {
+            m_blks.pop_front();
+        }
+
+        m_best_blk_height = std::max(m_best_blk_height, idx->height());
+        m_blks.push_back(std::move(idx));
     }
 
     auto block_cache::check_unspent(const hash_t& uhs_id) const
         -> std::optional<block_cache_result> {
-        auto res = m_unspent_ids.find(uhs_id);
-        if(res == m_unspent_ids.end()) {
-            return std::nullopt;
+        const auto hash = block_index::filter_hash(uhs_id);
+        for(auto it = m_blks.rbegin(); it != m_blks.rend(); it++) {
+            const auto& idx = **it;
+            // A block which spent the UHS ID is newer than the block which
+            // created it, or is the same block.
+            if(idx.find_spent(uhs_id, hash).has_value()) {
+                return std::nullopt;
+            }
+            if(auto tx_id = idx.find_created(uhs_id, hash)) {
+                return std::make_pair(idx.height(), tx_id.value());
+            }
         }
-        return res->second;
+        return std::nullopt;
     }
 
     auto block_cache::check_spent(const hash_t& uhs_id) const
         -> std::optional<block_cache_result> {
-        auto res = m_spent_ids.find(uhs_id);
-        if(res == m_spent_ids.end()) {
-            return std::nullopt;
+        const auto hash = block_index::filter_hash(uhs_id);
+        for(auto it = m_blks.rbegin(); it != m_blks.rend(); it++) {
+            const auto& idx = **it;
+            if(auto tx_id = idx.find_spent(uhs_id, hash)) {
+                return std::make_pair(idx.height(), tx_id.value());
+            }
         }
-        return res->second;
+        return std::nullopt;
     }
+
     auto block_cache::best_block_height() const -> uint64_t {
         return m_best_blk_height;
     }
@@ -13,20 +13,82 @@
 #include "uhs/atomizer/atomizer/block.hpp"
 #include "util/common/hashmap.hpp"
 
-#include <forward_list>
+#include <deque>
 #include <memory>
-#include <mutex>
 #include <optional>
-#include <queue>
-#include <shared_mutex>
-#include <unordered_map>
+#include <vector>
 
 namespace cbdc::watchtower {
     /// With respect to a particular UHS ID, block height + ID of containing
     /// transaction.
     using block_cache_result = std::pair<size_t, hash_t>;
-    /// Stores a set of blocks in memory and maintains an index of the UHS IDs
-    /// contained therein.
+
+    /// \brief Immutable index of the UHS IDs spent and created by one block.
+    ///
+    /// Stores the UHS IDs in sorted flat arrays, with a Bloom filter over
+    /// all the UHS IDs in the block so most lookups for UHS IDs which the
+    /// block does not contain skip the arrays.
+    class block_index {
+      public:
+        block_index() = delete;
+
+        /// Constructor. Indexes the inputs and outputs of every transaction
+        /// in the block.
+        /// \param blk block to index.
+        explicit block_index(const cbdc::atomizer::block& blk);
+
+        /// Returns the height of the indexed block.
+        /// \return block height.
+        [[nodiscard]] auto height() const -> uint64_t;
+
+        /// Returns the hash of a UHS ID used to query the Bloom filter of
+        /// each block_index.
+        /// \param uhs_id UHS ID to hash.
+        /// \return hash of the UHS ID.
+        static auto filter_hash(const hash_t& uhs_id) -> uint64_t;
+
+        /// Finds the transaction in the block which spent the given UHS ID.
+        /// \param uhs_id UHS ID to find.
+        /// \param hash filter_hash of the UHS ID.
+        /// \return ID of the spending transaction, or std::nullopt if no
+        ///         transaction in the block spent the UHS ID.
+        [[nodiscard]] auto find_spent(const hash_t& uhs_id,
+                                      uint64_t hash) const
+            -> std::optional<hash_t>;
+
+        /// Finds the transaction in the block which created the given UHS
+        /// ID.
+        /// \param uhs_id UHS ID to find.
+        /// \param hash filter_hash of the UHS ID.
+        /// \return ID of the creating transaction, or std::nullopt if no
+        ///         transaction in the block created the UHS ID.
+        [[nodiscard]] auto find_created(const hash_t& uhs_id,
+                                        uint64_t hash) const
+            -> std::optional<hash_t>;
+
+      private:
+        using entry = std::pair<hash_t, hash_t>;
+
+        uint64_t m_height;
+        /// UHS IDs spent in the block and their spending transaction IDs,
+        /// sorted by UHS ID.
+        std::vector<entry> m_spent;
+        /// UHS IDs created in the block and their creating transaction
+        /// IDs, sorted by UHS ID.
+        std::vector<entry> m_created;
+        std::vector<uint64_t> m_filter;
+
+        [[nodiscard]] auto may_contain(uint64_t hash) const -> bool;
+        void add_to_filter(uint64_t hash);
+
+        static auto find(const std::vector<entry>& entries,
+                         const hash_t& uhs_id) -> std::optional<hash_t>;
+    };
+
+    /// \brief Stores an index for each of a set of recent blocks.
+    ///
+    /// Lookups consult the block indexes from newest to oldest. Evicting
+    /// the oldest block drops its index.
     class block_cache {
       public:
         block_cache() = delete;
@@ -35,11 +97,17 @@ namespace cbdc::watchtower {
         /// \param k number of blocks to store in memory. 0 -> no limit.
         explicit block_cache(size_t k);
 
-        /// Moves a block into the block cache, evicting the oldest block if
-        /// the cache has reached its maximum size.
-        /// \param blk the block to move into the cache.
+        /// Indexes a block and adds it to the block cache, evicting the
+        /// oldest block if the cache has reached its maximum size.
+        /// \param blk the block to add to the cache.
         void push_block(cbdc::atomizer::block&& blk);
 
+        /// Adds an indexed block to the block cache, evicting the oldest
+        /// block if the cache has reached its maximum size. Indexes may be
+        /// shared between block caches.
+        /// \param idx index of the block to add.
+        void push_index(std::shared_ptr<const block_index> idx);
+
         /// Checks to see if the given UHS ID is spendable according to the
         /// blocks in the cache.
         /// \param uhs_id UHS ID to check.
@@ -60,16 +128,8 @@ namespace cbdc::watchtower {
 
       private:
         size_t m_k_blks;
-        std::queue<cbdc::atomizer::block> m_blks;
+        std::deque<std::shared_ptr<const block_index>> m_blks;
         uint64_t m_best_blk_height{0};
-        std::unordered_map<hash_t,
-                           block_cache_result,
-                           hashing::const_sip_hash<hash_t>>
-            m_unspent_ids;
-        std::unordered_map<hash_t,
-                           block_cache_result,
-                           hashing::const_sip_hash<hash_t>>
-            m_spent_ids;
     };
 }
 
@@ -140,6 +140,13 @@ namespace cbdc::watchtower {
         m_network.broadcast(pkt);
     }
 
+    void
+    async_client::subscribe_status_updates(const status_update_request& req) {
+        auto data = request{status_update_subscribe_request{req}};
+        auto pkt = make_shared_buffer(data);
+        m_network.broadcast(pkt);
+    }
+
     void async_client::set_status_update_handler(
         const async_client::status_update_response_handler_t& handler) {
         m_su_handler = handler;
@@ -82,6 +82,12 @@ namespace cbdc::watchtower {
         /// Sends a StatusUpdateRequest to the Watchtower.
         void request_status_update(const status_update_request& req);
 
+        /// Subscribes to status updates for the given UHS IDs. The status
+        /// update handler receives the current states of the UHS IDs, then
+        /// further responses as their transactions are resolved.
+        /// \param req UHS IDs of interest, keyed by transaction ID.
+        void subscribe_status_updates(const status_update_request& req);
+
         using status_update_response_handler_t = std::function<void(
             std::shared_ptr<status_request_check_success>&&)>;
 
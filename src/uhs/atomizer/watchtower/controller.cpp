@@ -6,6 +6,7 @@
 #include "controller.hpp"
 
 #include "status_update.hpp"
+#include "uhs/atomizer/atomizer/block_encoding.hpp"
 #include "uhs/atomizer/atomizer/format.hpp"
 #include "util/serialization/buffer_serializer.hpp"
 
@@ -19,7 +20,9 @@ cbdc::watchtower::controller::controller(
       m_opts(std::move(opts)),
       m_logger(log),
       m_watchtower(m_opts.m_watchtower_block_cache_size,
-                   m_opts.m_watchtower_error_cache_size),
+                   m_opts.m_watchtower_error_cache_size,
+                   m_opts.m_watchtower_query_threads,
+                   m_opts.m_watchtower_max_subscriptions),
       m_archiver_client(m_opts.m_archiver_endpoints[0], log) {}
 
 cbdc::watchtower::controller::~controller() {
@@ -38,9 +41,25 @@ cbdc::watchtower::controller::~controller() {
     if(m_atomizer_thread.joinable()) {
         m_atomizer_thread.join();
     }
+
+    {
+        std::unique_lock l(m_requests_mut);
+        m_running = false;
+    }
+    m_requests_cv.notify_one();
+    if(m_query_thread.joinable()) {
+        m_query_thread.join();
+    }
 }
 
 auto cbdc::watchtower::controller::init() -> bool {
+    m_watchtower.set_status_update_handler(
+        [&](watchtower::subscriber_id_t peer_id,
+            std::unique_ptr<response>&& res) {
+            m_external_network.send(make_shared_buffer(*res),
+                                    static_cast<network::peer_id_t>(peer_id));
+        });
+
     auto internal = m_internal_network.start_server(
         m_opts.m_watchtower_internal_endpoints[m_watchtower_id],
         [&](auto&& pkt) {
@@ -67,6 +86,10 @@ auto cbdc::watchtower::controller::init() -> bool {
 
     m_external_server = std::move(external.value());
 
+    m_query_thread = std::thread([&]() {
+        query_loop();
+    });
+
     static constexpr auto retry_delay = std::chrono::seconds(1);
     m_atomizer_network.cluster_connect(m_opts.m_atomizer_endpoints, false);
     while(!m_atomizer_network.connected_to_one()) {
@@ -93,7 +116,7 @@ auto cbdc::watchtower::controller::init() -> bool {
 
 auto cbdc::watchtower::controller::atomizer_handler(
     cbdc::network::message_t&& pkt) -> std::optional<cbdc::buffer> {
-    auto maybe_blk = from_buffer<atomizer::block>(*pkt.m_pkt);
+    auto maybe_blk = atomizer::decode_block(*pkt.m_pkt);
     if(!maybe_blk.has_value()) {
         m_logger->error("Invalid block packet");
         return std::nullopt;
@@ -107,9 +130,10 @@ auto cbdc::watchtower::controller::atomizer_handler(
     if(blk.m_height != (m_last_blk_height + 1)) {
         m_logger->warn("Block not contiguous. Last block:", m_last_blk_height);
         while(blk.m_height != (m_last_blk_height + 1)) {
-            auto missed_blk
-                = m_archiver_client.get_block(m_last_blk_height + 1);
-            if(!missed_blk) {
+            auto missed_blks
+                = m_archiver_client.get_blocks(m_last_blk_height + 1,
+                                               blk.m_height - 1);
+            if(missed_blks.empty()) {
                 m_logger->warn("Waiting for archiver sync");
                 static constexpr auto archiver_wait_time
                     = std::chrono::milliseconds(100);
@@ -117,12 +141,22 @@ auto cbdc::watchtower::controller::atomizer_handler(
                 continue;
             }
 
-            m_last_blk_height = (*missed_blk).m_height;
-            m_watchtower.add_block(std::move(*missed_blk));
+            for(auto& missed_blk : missed_blks) {
+                m_last_blk_height = missed_blk.m_height;
+                m_watchtower.add_block(std::move(missed_blk));
+            }
         }
     }
     m_last_blk_height = blk.m_height;
     m_watchtower.add_block(std::move(blk));
+
+    // Peer IDs are not reused, so subscriptions of disconnected clients
+    // would never be delivered.
+    m_watchtower.remove_subscribers(
+        [&](watchtower::subscriber_id_t peer_id) {
+            return !m_external_network.connected(
+                static_cast<network::peer_id_t>(peer_id));
+        });
     return std::nullopt;
 }
 
@@ -140,26 +174,79 @@ auto cbdc::watchtower::controller::internal_server_handler(
 
 auto cbdc::watchtower::controller::external_server_handler(
     cbdc::network::message_t&& pkt) -> std::optional<cbdc::buffer> {
+    // Respond from the query thread so that large requests do not hold up
+    // the external server.
     auto deser = cbdc::buffer_serializer(*pkt.m_pkt);
     auto req = request(deser);
-    auto res_handler = overloaded{
-        [&](const cbdc::watchtower::status_update_request& su_req)
-            -> cbdc::buffer {
-            auto res = m_watchtower.handle_status_update_request(su_req);
-            m_logger->info("Received status_update_request with",
-                           su_req.uhs_ids().size(),
-                           "UHS IDs");
-            return make_buffer(*res);
-        },
-        [&](const cbdc::watchtower::best_block_height_request& bbh_req)
-            -> cbdc::buffer {
-            auto res = m_watchtower.handle_best_block_height_request(bbh_req);
-            m_logger->info("Received request_best_block_height from peer",
-                           pkt.m_peer_id);
-            return make_buffer(*res);
-        }};
-    auto msg = std::visit(res_handler, req.payload());
-    return msg;
+    {
+        std::unique_lock l(m_requests_mut);
+        m_requests.emplace_back(pkt.m_peer_id, std::move(req));
+    }
+    m_requests_cv.notify_one();
+    return std::nullopt;
+}
+
+void cbdc::watchtower::controller::query_loop() {
+    auto reqs = std::vector<std::pair<network::peer_id_t, request>>();
+    while(true) {
+        {
+            std::unique_lock l(m_requests_mut);
+            m_requests_cv.wait(l, [&]() {
+                return !m_requests.empty() || !m_running;
+            });
+            if(!m_running) {
+                return;
+            }
+            std::swap(reqs, m_requests);
+        }
+
+        auto su_reqs = watchtower::status_update_batch();
+        for(const auto& queued : reqs) {
+            if(const auto* su_req = std::get_if<status_update_request>(
+                   &queued.second.payload())) {
+                m_logger->info("Received status_update_request with",
+                               su_req->uhs_ids().size(),
+                               "UHS IDs");
+                su_reqs.emplace_back(*su_req);
+            }
+        }
+        auto su_res = m_watchtower.handle_status_update_requests(su_reqs);
+
+        // Respond in the order the requests were received
+        auto su_res_it = su_res.begin();
+        network::peer_id_t peer_id{};
+        auto res_handler = overloaded{
+            [&](const cbdc::watchtower::status_update_request& /* unused */)
+                -> std::unique_ptr<response> {
+                return std::move(*su_res_it++);
+            },
+            [&](const cbdc::watchtower::best_block_height_request& bbh_req)
+                -> std::unique_ptr<response> {
+                m_logger->info("Received request_best_block_height from peer",
+                               peer_id);
+                return m_watchtower.handle_best_block_height_request(bbh_req);
+            },
+            [&](const cbdc::watchtower::status_update_subscribe_request&
+                    sub_req) -> std::unique_ptr<response> {
+                m_logger->info("Received status_update_subscribe_request "
+                               "from peer",
+                               peer_id);
+                // The watchtower responds through the status update
+                // handler
+                m_watchtower.subscribe_status_updates(
+                    peer_id,
+                    sub_req.update_request());
+                return nullptr;
+            }};
+        for(const auto& [pid, req] : reqs) {
+            peer_id = pid;
+            auto res = std::visit(res_handler, req.payload());
+            if(res) {
+                m_external_network.send(make_shared_buffer(*res), peer_id);
+            }
+        }
+        reqs.clear();
+    }
 }
 
 auto cbdc::watchtower::controller::get_block_height() const -> uint64_t {
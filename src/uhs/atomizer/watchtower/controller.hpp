@@ -12,6 +12,9 @@
 #include "util/serialization/format.hpp"
 #include "watchtower.hpp"
 
+#include <condition_variable>
+#include <mutex>
+
 namespace cbdc::watchtower {
     /// Wrapper for the watchtower executable implementation.
     class controller {
@@ -56,6 +59,14 @@ namespace cbdc::watchtower {
         std::thread m_external_server;
         std::thread m_atomizer_thread;
 
+        /// Client requests waiting to be handled by the query thread, with
+        /// the peer ID of the client which sent each request.
+        std::vector<std::pair<network::peer_id_t, request>> m_requests;
+        std::mutex m_requests_mut;
+        std::condition_variable m_requests_cv;
+        bool m_running{true};
+        std::thread m_query_thread;
+
         void connect_atomizers();
         auto atomizer_handler(cbdc::network::message_t&& pkt)
             -> std::optional<cbdc::buffer>;
@@ -63,6 +74,11 @@ namespace cbdc::watchtower {
             -> std::optional<cbdc::buffer>;
         auto external_server_handler(cbdc::network::message_t&& pkt)
             -> std::optional<cbdc::buffer>;
+
+        /// Handles client requests queued by the external server until the
+        /// controller is destroyed. All status update requests queued
+        /// since the previous iteration are handled as a single batch.
+        void query_loop();
     };
 }
 
@@ -22,6 +22,20 @@ namespace cbdc {
         return packet >> bbh_res.m_height;
     }
 
+    auto operator<<(
+        cbdc::serializer& packet,
+        const cbdc::watchtower::status_update_subscribe_request& sub_req)
+        -> cbdc::serializer& {
+        return packet << sub_req.m_req;
+    }
+
+    auto
+    operator>>(cbdc::serializer& packet,
+               cbdc::watchtower::status_update_subscribe_request& sub_req)
+        -> cbdc::serializer& {
+        return packet >> sub_req.m_req;
+    }
+
     auto operator<<(cbdc::serializer& packet,
                     const cbdc::watchtower::request& req)
         -> cbdc::serializer& {
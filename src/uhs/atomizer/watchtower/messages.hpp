@@ -15,6 +15,7 @@
 namespace cbdc::watchtower {
     struct best_block_height_request;
     class best_block_height_response;
+    class status_update_subscribe_request;
     class request;
     class response;
 }
@@ -27,6 +28,14 @@ namespace cbdc {
     auto operator>>(cbdc::serializer& packet,
                     cbdc::watchtower::best_block_height_response& bbh_res)
         -> cbdc::serializer&;
+    auto operator<<(
+        cbdc::serializer& packet,
+        const cbdc::watchtower::status_update_subscribe_request& sub_req)
+        -> cbdc::serializer&;
+    auto
+    operator>>(cbdc::serializer& packet,
+               cbdc::watchtower::status_update_subscribe_request& sub_req)
+        -> cbdc::serializer&;
     auto operator<<(cbdc::serializer& packet,
                     const cbdc::watchtower::response& res)
         -> cbdc::serializer&;
@@ -10,29 +10,266 @@
 #include "util/serialization/format.hpp"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 
 namespace cbdc::watchtower {
+    namespace {
+        /// Number of UHS IDs looked up by a query thread at a time.
+        constexpr size_t lookup_chunk_size = 1024;
+    }
+
     void watchtower::add_block(cbdc::atomizer::block&& blk) {
-        std::unique_lock lk(m_bc_mut);
-        m_bc.push_block(std::move(blk));
+        // Both copies of the block cache share the immutable block index
+        auto idx = std::make_shared<const block_index>(blk);
+        {
+            std::unique_lock l(m_cache_writers_mut);
+            m_bc.write([&](block_cache& bc) {
+                bc.push_index(idx);
+            });
+        }
+
+        std::unique_lock l(m_subscriptions_mut);
+        if(m_subscriptions.empty()) {
+            m_subscription_heights.clear();
+            return;
+        }
+        auto resolved = std::vector<hash_t>();
+        for(const auto& tx : blk.m_transactions) {
+            if(m_subscriptions.find(tx.m_id) != m_subscriptions.end()) {
+                resolved.push_back(tx.m_id);
+            }
+        }
+        notify_subscribers(resolved);
+
+        // Blocks which could resolve transactions subscribed to before the
+        // oldest cached block have been checked, so those subscriptions
+        // end.
+        if(m_block_cache_size != 0 && blk.m_height >= m_block_cache_size) {
+            expire_subscriptions(blk.m_height - m_block_cache_size);
+        }
     }
 
     void watchtower::add_errors(std::vector<tx_error>&& errs) {
-        std::shared_lock lk0(m_bc_mut, std::defer_lock);
-        std::unique_lock lk1(m_ec_mut, std::defer_lock);
-        std::lock(lk0, lk1);
+        auto err_tx_ids = std::vector<hash_t>();
+        {
+            // Hold the writers lock from filtering the errors until they
+            // are published, so no block which resolves them can be added
+            // in between and leave a stale error in the cache.
+            std::unique_lock l(m_cache_writers_mut);
+            m_bc.read([&](const block_cache& bc) {
+                filter_repeated_errors(bc, errs);
+            });
+
+            err_tx_ids.reserve(errs.size());
+            for(const auto& err : errs) {
+                err_tx_ids.push_back(err.tx_id());
+            }
+
+            auto err_lists
+                = std::array<std::vector<tx_error>, 2>{errs, std::move(errs)};
+            size_t i{0};
+            m_ec.write([&](error_cache& ec) {
+                ec.push_errors(std::move(err_lists[i++]));
+            });
+        }
+
+        std::unique_lock l(m_subscriptions_mut);
+        if(m_subscriptions.empty()) {
+            return;
+        }
+        err_tx_ids.erase(std::remove_if(err_tx_ids.begin(),
+                                        err_tx_ids.end(),
+                                        [&](const hash_t& tx_id) {
+                                            return m_subscriptions.find(tx_id)
+                                                == m_subscriptions.end();
+                                        }),
+                         err_tx_ids.end());
+        notify_subscribers(err_tx_ids);
+    }
+
+    void watchtower::set_status_update_handler(
+        const status_update_handler_t& handler) {
+        std::unique_lock l(m_subscriptions_mut);
+        m_su_handler = handler;
+    }
+
+    void watchtower::subscribe_status_updates(
+        subscriber_id_t subscriber,
+        const status_update_request& req) {
+        // Hold the lock while checking the caches and delivering the
+        // response so that a block or error added concurrently is either
+        // reflected in the response or matched against the new
+        // subscriptions, and reported afterwards.
+        std::unique_lock l(m_subscriptions_mut);
+        auto res = handle_status_update_request(req);
+        const auto height = m_bc.read([](const block_cache& bc) {
+            return bc.best_block_height();
+        });
+        const auto& states
+            = std::get<status_request_check_success>(res->payload()).states();
+        auto& count = m_subscription_counts[subscriber];
+        for(const auto& [tx_id, uhs_ids] : req.uhs_ids()) {
+            if(count >= m_max_subscriptions) {
+                break;
+            }
+            const auto& tx_states = states.at(tx_id);
+            auto unresolved = std::all_of(
+                tx_states.begin(),
+                tx_states.end(),
+                [](const status_update_state& state) {
+                    return state.status() == search_status::no_history;
+                });
+            if(unresolved) {
+                m_subscriptions[tx_id].push_back(
+                    subscription{subscriber, uhs_ids, height});
+                count++;
+                if(m_block_cache_size != 0) {
+                    m_subscription_heights.emplace_back(height, tx_id);
+                }
+            }
+        }
+        if(count == 0) {
+            m_subscription_counts.erase(subscriber);
+        }
+        if(m_su_handler) {
+            m_su_handler(subscriber, std::move(res));
+        }
+    }
+
+    void watchtower::notify_subscribers(const std::vector<hash_t>& tx_ids) {
+        // Combine the resolved transactions of each subscriber into a
+        // single status update request.
+        auto subscribers = std::vector<subscriber_id_t>();
+        auto tx_uhs_ids = std::vector<tx_id_uhs_ids>();
+        for(const auto& tx_id : tx_ids) {
+            auto it = m_subscriptions.find(tx_id);
+            if(it == m_subscriptions.end()) {
+                continue;
+            }
+            for(auto& sub : it->second) {
+                auto sub_it = std::find(subscribers.begin(),
+                                        subscribers.end(),
+                                        sub.m_subscriber);
+                auto sub_idx
+                    = static_cast<size_t>(sub_it - subscribers.begin());
+                if(sub_it == subscribers.end()) {
+                    subscribers.push_back(sub.m_subscriber);
+                    tx_uhs_ids.emplace_back();
+                }
+                auto& uhs_ids = tx_uhs_ids[sub_idx][tx_id];
+                uhs_ids.insert(uhs_ids.end(),
+                               sub.m_uhs_ids.begin(),
+                               sub.m_uhs_ids.end());
+                release_subscription(sub.m_subscriber);
+            }
+            m_subscriptions.erase(it);
+        }
+        if(subscribers.empty()) {
+            return;
+        }
+
+        auto reqs = std::vector<status_update_request>();
+        reqs.reserve(tx_uhs_ids.size());
+        auto batch = status_update_batch();
+        for(auto& ids : tx_uhs_ids) {
+            batch.emplace_back(reqs.emplace_back(std::move(ids)));
+        }
+        auto responses = handle_status_update_requests(batch);
+        if(!m_su_handler) {
+            return;
+        }
+        for(size_t i{0}; i < subscribers.size(); i++) {
+            m_su_handler(subscribers[i], std::move(responses[i]));
+        }
+    }
+
+    void watchtower::remove_subscribers(
+        const std::function<bool(subscriber_id_t)>& pred) {
+        std::unique_lock l(m_subscriptions_mut);
+        auto removed = std::vector<subscriber_id_t>();
+        for(const auto& [subscriber, count] : m_subscription_counts) {
+            if(pred(subscriber)) {
+                removed.push_back(subscriber);
+            }
+        }
+        if(removed.empty()) {
+            return;
+        }
+        for(auto it = m_subscriptions.begin(); it != m_subscriptions.end();) {
+            auto& subs = it->second;
+            subs.erase(std::remove_if(subs.begin(),
+                                      subs.end(),
+                                      [&](const subscription& sub) {
+                                          return std::find(removed.begin(),
+                                                           removed.end(),
+                                                           sub.m_subscriber)
+                                              != removed.end();
+                                      }),
+                       subs.end());
+            if(subs.empty()) {
+                it = m_subscriptions.erase(it);
+            } else {
+                it++;
+            }
+        }
+        for(const auto& subscriber : removed) {
+            m_subscription_counts.erase(subscriber);
+        }
+    }
+
+    void watchtower::expire_subscriptions(uint64_t height) {
+        while(!m_subscription_heights.empty()
+              && m_subscription_heights.front().first <= height) {
+            const auto tx_id = m_subscription_heights.front().second;
+            m_subscription_heights.pop_front();
+            // The transaction may have been resolved already, or
+            // subscribed to again since.
+            auto it = m_subscriptions.find(tx_id);
+            if(it == m_subscriptions.end()) {
+                continue;
+            }
+            auto& subs = it->second;
+            subs.erase(std::remove_if(subs.begin(),
+                                      subs.end(),
+                                      [&](const subscription& sub) {
+                                          if(sub.m_height > height) {
+                                              return false;
+                                          }
+                                          release_subscription(
+                                              sub.m_subscriber);
+                                          return true;
+                                      }),
+                       subs.end());
+            if(subs.empty()) {
+                m_subscriptions.erase(it);
+            }
+        }
+    }
+
+    void watchtower::release_subscription(subscriber_id_t subscriber) {
+        auto it = m_subscription_counts.find(subscriber);
+        if(--it->second == 0) {
+            m_subscription_counts.erase(it);
+        }
+    }
+
+    void watchtower::filter_repeated_errors(const block_cache& bc,
+                                            std::vector<tx_error>& errs) {
         auto repeated_tx_filter = [&](const auto& err) -> bool {
             auto res = false;
             auto check_uhs = [&](const hash_t& err_tx_id, auto&& info) {
                 for(const auto& uhs : info.input_uhs_ids()) {
-                    if(auto spent = m_bc.check_spent(uhs)) {
+                    if(auto spent = bc.check_spent(uhs)) {
                         auto [height, tx_id] = spent.value();
                         if(err_tx_id == tx_id) {
                             res = true;
                             return;
                         }
                     }
-                    if(auto unspent = m_bc.check_unspent(uhs)) {
+                    if(auto unspent = bc.check_unspent(uhs)) {
                         auto [height, tx_id] = unspent.value();
                         if(err_tx_id == tx_id) {
                             res = true;
@@ -54,10 +291,59 @@ namespace cbdc::watchtower {
         errs.erase(
             std::remove_if(errs.begin(), errs.end(), repeated_tx_filter),
             errs.end());
-        m_ec.push_errors(std::move(errs));
     }
 
-    auto watchtower::check_uhs_id_statuses(const std::vector<hash_t>& uhs_ids,
+    void watchtower::lookup_history(const block_cache& bc,
+                                    uhs_id_history& hist) {
+        const auto n_ids = hist.m_uhs_ids.size();
+        hist.m_spent.resize(n_ids);
+        hist.m_unspent.resize(n_ids);
+        if(n_ids == 0) {
+            return;
+        }
+
+        const auto n_chunks = (n_ids - 1) / lookup_chunk_size + 1;
+        std::atomic<size_t> next_chunk{0};
+        auto lookup_chunks = [&]() {
+            for(auto chunk = next_chunk++; chunk < n_chunks;
+                chunk = next_chunk++) {
+                const auto end
+                    = std::min(n_ids, (chunk + 1) * lookup_chunk_size);
+                for(auto i = chunk * lookup_chunk_size; i < end; i++) {
+                    const auto& uhs_id = hist.m_uhs_ids[i];
+                    hist.m_spent[i] = bc.check_spent(uhs_id);
+                    if(!hist.m_spent[i].has_value()) {
+                        hist.m_unspent[i] = bc.check_unspent(uhs_id);
+                    }
+                }
+            }
+        };
+
+        // The calling thread also looks up chunks, so only start query
+        // threads for the remaining chunks.
+        const auto n_tasks = std::min(m_query_threads, n_chunks - 1);
+        std::mutex mut;
+        std::condition_variable cv;
+        auto n_running = n_tasks;
+        for(size_t i{0}; i < n_tasks; i++) {
+            m_query_pool.push([&]() {
+                lookup_chunks();
+                std::unique_lock l(mut);
+                n_running--;
+                cv.notify_one();
+            });
+        }
+
+        lookup_chunks();
+        std::unique_lock l(mut);
+        cv.wait(l, [&]() {
+            return n_running == 0;
+        });
+    }
+
+    auto watchtower::check_uhs_id_statuses(const uhs_id_history& hist,
+                                           const error_cache& ec,
+                                           const std::vector<hash_t>& uhs_ids,
                                            const hash_t& tx_id,
                                            bool internal_err,
                                            bool tx_err,
@@ -74,7 +360,7 @@ namespace cbdc::watchtower {
                                         uhs_id});
                 found_status = true;
             } else if(tx_err) {
-                if(auto uhs_err = m_ec.check_uhs_id(uhs_id)) {
+                if(auto uhs_err = ec.check_uhs_id(uhs_id)) {
                     states.emplace_back(
                         status_update_state{search_status::invalid_input,
                                             best_height,
@@ -87,7 +373,12 @@ namespace cbdc::watchtower {
                 }
                 found_status = true;
             }
-            if(auto spent = m_bc.check_spent(uhs_id)) {
+            const auto idx = static_cast<size_t>(
+                std::lower_bound(hist.m_uhs_ids.begin(),
+                                 hist.m_uhs_ids.end(),
+                                 uhs_id)
+                - hist.m_uhs_ids.begin());
+            if(const auto& spent = hist.m_spent[idx]) {
                 auto [height, s_tx_id] = spent.value();
                 if(s_tx_id == tx_id) {
                     states.emplace_back(
@@ -96,7 +387,7 @@ namespace cbdc::watchtower {
                                             uhs_id});
                     found_status = true;
                 }
-            } else if(auto unspent = m_bc.check_unspent(uhs_id)) {
+            } else if(const auto& unspent = hist.m_unspent[idx]) {
                 auto [height, us_tx_id] = unspent.value();
                 if(us_tx_id == tx_id) {
                     states.emplace_back(
@@ -119,48 +410,87 @@ namespace cbdc::watchtower {
     auto
     watchtower::handle_status_update_request(const status_update_request& req)
         -> std::unique_ptr<response> {
-        std::unordered_map<hash_t,
-                           std::vector<status_update_state>,
-                           hashing::const_sip_hash<hash_t>>
-            chks;
-        {
-            std::shared_lock lk0(m_bc_mut, std::defer_lock);
-            std::shared_lock lk1(m_ec_mut, std::defer_lock);
-            std::lock(lk0, lk1);
-            auto best_height = m_bc.best_block_height();
-            for(const auto& [tx_id, uhs_ids] : req.uhs_ids()) {
-                auto tx_err = m_ec.check_tx_id(tx_id);
-                bool internal_err{false};
-                if(tx_err.has_value()
-                   && (std::holds_alternative<tx_error_sync>(
-                           tx_err.value().info())
-                       || std::holds_alternative<tx_error_stxo_range>(
-                           tx_err.value().info()))) {
-                    internal_err = true;
-                }
-                auto states = check_uhs_id_statuses(uhs_ids,
+        auto res = handle_status_update_requests({std::cref(req)});
+        return std::move(res.front());
+    }
+
+    auto watchtower::handle_status_update_requests(
+        const status_update_batch& reqs)
+        -> std::vector<std::unique_ptr<response>> {
+        // Sort and deduplicate the UHS IDs of every request so each is
+        // looked up in the block cache once.
+        auto hist = uhs_id_history();
+        for(const auto& req : reqs) {
+            for(const auto& [tx_id, uhs_ids] : req.get().uhs_ids()) {
+                hist.m_uhs_ids.insert(hist.m_uhs_ids.end(),
+                                      uhs_ids.begin(),
+                                      uhs_ids.end());
+            }
+        }
+        std::sort(hist.m_uhs_ids.begin(), hist.m_uhs_ids.end());
+        hist.m_uhs_ids.erase(
+            std::unique(hist.m_uhs_ids.begin(), hist.m_uhs_ids.end()),
+            hist.m_uhs_ids.end());
+
+        std::vector<std::unique_ptr<response>> responses;
+        responses.reserve(reqs.size());
+        m_bc.read([&](const block_cache& bc) {
+            lookup_history(bc, hist);
+            m_ec.read([&](const error_cache& ec) {
+                auto best_height = bc.best_block_height();
+                for(const auto& req : reqs) {
+                    std::unordered_map<hash_t,
+                                       std::vector<status_update_state>,
+                                       hashing::const_sip_hash<hash_t>>
+                        chks;
+                    for(const auto& [tx_id, uhs_ids] : req.get().uhs_ids()) {
+                        auto tx_err = ec.check_tx_id(tx_id);
+                        bool internal_err{false};
+                        if(tx_err.has_value()
+                           && (std::holds_alternative<tx_error_sync>(
+                                   tx_err.value().info())
+                               || std::holds_alternative<tx_error_stxo_range>(
+                                   tx_err.value().info()))) {
+                            internal_err = true;
+                        }
+                        auto states
+                            = check_uhs_id_statuses(hist,
+                                                    ec,
+                                                    uhs_ids,
                                                     tx_id,
                                                     internal_err,
                                                     tx_err.has_value(),
                                                     best_height);
-                chks.emplace(std::make_pair(tx_id, std::move(states)));
-            }
-        }
+                        chks.emplace(
+                            std::make_pair(tx_id, std::move(states)));
+                    }
+                    responses.emplace_back(std::make_unique<response>(
+                        status_request_check_success{chks}));
+                }
+            });
+        });
 
-        return std::make_unique<response>(status_request_check_success{chks});
+        return responses;
     }
 
     auto watchtower::handle_best_block_height_request(
         const best_block_height_request& /* unused */)
         -> std::unique_ptr<response> {
-        std::shared_lock lk(m_bc_mut);
-        return std::make_unique<response>(
-            best_block_height_response{m_bc.best_block_height()});
+        auto height = m_bc.read([](const block_cache& bc) {
+            return bc.best_block_height();
+        });
+        return std::make_unique<response>(best_block_height_response{height});
     }
 
-    watchtower::watchtower(size_t block_cache_size, size_t error_cache_size)
+    watchtower::watchtower(size_t block_cache_size,
+                           size_t error_cache_size,
+                           size_t query_threads,
+                           size_t max_subscriptions)
         : m_bc{block_cache_size},
-          m_ec{error_cache_size} {}
+          m_ec{error_cache_size},
+          m_query_threads(query_threads),
+          m_block_cache_size(block_cache_size),
+          m_max_subscriptions(max_subscriptions) {}
 
     auto best_block_height_request::operator==(
         const best_block_height_request& /* unused */) const -> bool {
@@ -187,6 +517,24 @@ namespace cbdc::watchtower {
         return m_height;
     }
 
+    auto status_update_subscribe_request::operator==(
+        const status_update_subscribe_request& rhs) const -> bool {
+        return m_req == rhs.m_req;
+    }
+
+    status_update_subscribe_request::status_update_subscribe_request(
+        status_update_request req)
+        : m_req(std::move(req)) {}
+
+    status_update_subscribe_request::status_update_subscribe_request(
+        serializer& pkt)
+        : m_req(pkt) {}
+
+    auto status_update_subscribe_request::update_request() const
+        -> const status_update_request& {
+        return m_req;
+    }
+
     auto request::operator==(const request& rhs) const -> bool {
         return m_req == rhs.m_req;
     }
@@ -194,8 +542,9 @@ namespace cbdc::watchtower {
     request::request(request_t req) : m_req(std::move(req)) {}
 
     request::request(serializer& pkt)
-        : m_req(get_variant<status_update_request, best_block_height_request>(
-            pkt)) {}
+        : m_req(get_variant<status_update_request,
+                            best_block_height_request,
+                            status_update_subscribe_request>(pkt)) {}
 
     auto request::payload() const -> const request_t& {
         return m_req;
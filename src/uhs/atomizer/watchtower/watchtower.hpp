@@ -14,6 +14,12 @@
 #include "error_cache.hpp"
 #include "messages.hpp"
 #include "status_update.hpp"
+#include "util/common/left_right.hpp"
+#include "util/common/thread_pool.hpp"
+
+#include <deque>
+#include <functional>
+#include <mutex>
 
 namespace cbdc::watchtower {
     /// Request the watchtower's known best block height.
@@ -62,6 +68,47 @@ namespace cbdc::watchtower {
         uint64_t m_height{};
     };
 
+    /// \brief Request for the status of a set of UHS IDs, and for updates
+    ///        once their transactions are resolved.
+    ///
+    /// The watchtower responds immediately with the current status of
+    /// every UHS ID. For transactions which have no history yet, the
+    /// watchtower later sends another status_request_check_success once a
+    /// block or error resolves the transaction, so clients do not need to
+    /// poll.
+    class status_update_subscribe_request {
+      public:
+        friend auto cbdc::operator<<(
+            cbdc::serializer& packet,
+            const cbdc::watchtower::status_update_subscribe_request& sub_req)
+            -> cbdc::serializer&;
+        friend auto cbdc::operator>>(
+            cbdc::serializer& packet,
+            cbdc::watchtower::status_update_subscribe_request& sub_req)
+            -> cbdc::serializer&;
+
+        auto operator==(const status_update_subscribe_request& rhs) const
+            -> bool;
+
+        status_update_subscribe_request() = delete;
+
+        /// Constructor.
+        /// \param req UHS IDs to subscribe to, keyed by transaction ID.
+        explicit status_update_subscribe_request(status_update_request req);
+
+        /// Construct from a packet.
+        /// \param pkt packet containing a serialized subscribe request.
+        explicit status_update_subscribe_request(cbdc::serializer& pkt);
+
+        /// Returns the UHS IDs to subscribe to.
+        /// \return status update request containing the UHS IDs.
+        [[nodiscard]] auto update_request() const
+            -> const status_update_request&;
+
+      private:
+        status_update_request m_req;
+    };
+
     /// RPC request message to the watchtower external endpoint.
     class request {
       public:
@@ -73,8 +120,9 @@ namespace cbdc::watchtower {
 
         request() = delete;
 
-        using request_t
-            = std::variant<status_update_request, best_block_height_request>;
+        using request_t = std::variant<status_update_request,
+                                       best_block_height_request,
+                                       status_update_subscribe_request>;
 
         /// Constructor.
         /// \param req request payload.
@@ -122,17 +170,36 @@ namespace cbdc::watchtower {
         response_t m_resp;
     };
 
-    /// Service to answer client requests for processing status updates on
-    /// submitted transactions.
+    /// \brief Service to answer client requests for processing status updates
+    ///        on submitted transactions.
+    ///
+    /// The block and error caches are each kept in a \ref cbdc::left_right
+    /// so that client requests never wait for new blocks or errors to be
+    /// added. Status update requests may be handled in batches, in which
+    /// case the UHS IDs of every request in the batch are deduplicated and
+    /// looked up in the block cache in parallel chunks.
     class watchtower {
       public:
+        /// Default maximum number of transactions a subscriber may be
+        /// subscribed to at once.
+        static constexpr size_t default_max_subscriptions{1000};
+
         watchtower() = delete;
 
         /// Constructor.
         /// \param block_cache_size the number of blocks to store in this Watchtower's block cache.
         /// \param error_cache_size the number of errors to store in this Watchtower's error cache.
+        /// \param query_threads number of worker threads used to look up
+        ///                      the UHS IDs of large status update batches.
+        ///                      Zero performs all lookups on the calling
+        ///                      thread.
+        /// \param max_subscriptions maximum number of transactions each
+        ///                          subscriber may be subscribed to at once.
         /// \see cbdc::watchtower::BlockCache
-        watchtower(size_t block_cache_size, size_t error_cache_size);
+        watchtower(size_t block_cache_size,
+                   size_t error_cache_size,
+                   size_t query_threads = 0,
+                   size_t max_subscriptions = default_max_subscriptions);
 
         /// Adds a new block from the Atomizer to the Watchtower. Currently
         /// just forwards the block to the in-memory cache to await requests
@@ -163,6 +230,62 @@ namespace cbdc::watchtower {
         auto handle_status_update_request(const status_update_request& req)
             -> std::unique_ptr<response>;
 
+        /// List of status update requests to handle as a batch.
+        using status_update_batch
+            = std::vector<std::reference_wrapper<const status_update_request>>;
+
+        /// Composes responses to a batch of status update requests, as in
+        /// \ref handle_status_update_request. Each UHS ID is looked up in
+        /// the block cache once, no matter how many requests in the batch
+        /// contain it, and every response reflects the same cache state.
+        /// \param reqs status update requests from clients.
+        /// \return the responses to send to the clients, in the same order
+        ///         as the requests.
+        auto handle_status_update_requests(const status_update_batch& reqs)
+            -> std::vector<std::unique_ptr<response>>;
+
+        /// Identifies a client subscribed to status updates.
+        using subscriber_id_t = uint64_t;
+
+        /// Function called with a subscriber's ID and a status update
+        /// response when transactions the subscriber is interested in are
+        /// resolved.
+        using status_update_handler_t = std::function<
+            void(subscriber_id_t, std::unique_ptr<response>&&)>;
+
+        /// Sets or replaces the handler for status updates to subscribers.
+        /// The handler is called from \ref add_block and \ref add_errors.
+        /// \param handler function to call with each status update.
+        void set_status_update_handler(const status_update_handler_t& handler);
+
+        /// Subscribes to updates for the transactions in the given status
+        /// update request which have no history yet. Immediately calls the
+        /// status update handler with the response to the request, as
+        /// composed by \ref handle_status_update_request. When a later
+        /// block or error resolves any of the subscribed transactions, the
+        /// handler is called again with the states of the requested UHS IDs
+        /// of the resolved transactions, and the subscriptions to those
+        /// transactions end. Updates to a subscriber are never delivered
+        /// before the initial response.
+        ///
+        /// Transactions beyond the subscriber's maximum number of
+        /// subscriptions are included in the initial response but not
+        /// subscribed to. Subscriptions also end, without a further
+        /// update, once as many blocks as the block cache holds have been
+        /// added without resolving the transaction.
+        /// \param subscriber ID of the subscribing client.
+        /// \param req UHS IDs of interest, keyed by transaction ID.
+        void subscribe_status_updates(subscriber_id_t subscriber,
+                                      const status_update_request& req);
+
+        /// Ends all subscriptions of the subscribers for which the given
+        /// function returns true, such as subscribers which have
+        /// disconnected.
+        /// \param pred function called with the ID of each subscriber with
+        ///             at least one subscription.
+        void remove_subscribers(
+            const std::function<bool(subscriber_id_t)>& pred);
+
         /// Composes a response to a status update best block height request.
         /// \param req a best block height request from a client.
         /// \return the response to send to the client or nullopt if request is invalid.
@@ -171,16 +294,78 @@ namespace cbdc::watchtower {
             -> std::unique_ptr<response>;
 
       private:
-        block_cache m_bc;
-        std::shared_mutex m_bc_mut;
-        error_cache m_ec;
-        std::shared_mutex m_ec_mut;
-
-        auto check_uhs_id_statuses(const std::vector<hash_t>& uhs_ids,
-                                   const hash_t& tx_id,
-                                   bool internal_err,
-                                   bool tx_err,
-                                   uint64_t best_height)
+        /// Block cache history of a set of UHS IDs.
+        struct uhs_id_history {
+            /// Sorted, unique UHS IDs.
+            std::vector<hash_t> m_uhs_ids;
+            /// Result of check_spent for each UHS ID.
+            std::vector<std::optional<block_cache_result>> m_spent;
+            /// Result of check_unspent for each UHS ID which is not spent.
+            std::vector<std::optional<block_cache_result>> m_unspent;
+        };
+
+        left_right<block_cache> m_bc;
+        left_right<error_cache> m_ec;
+        /// Serializes adding blocks with filtering and adding errors, so
+        /// errors are checked against the block cache they are added
+        /// alongside. Readers do not take this lock.
+        std::mutex m_cache_writers_mut;
+
+        size_t m_query_threads;
+        thread_pool m_query_pool;
+
+        size_t m_block_cache_size;
+        size_t m_max_subscriptions;
+
+        /// Requested UHS IDs of a subscriber to one transaction.
+        struct subscription {
+            subscriber_id_t m_subscriber;
+            std::vector<hash_t> m_uhs_ids;
+            /// Best block height when the subscription was made.
+            uint64_t m_height;
+        };
+
+        /// Subscriptions keyed by transaction ID, checked as blocks and
+        /// errors are added.
+        std::unordered_map<hash_t,
+                           std::vector<subscription>,
+                           hashing::const_sip_hash<hash_t>>
+            m_subscriptions;
+        /// Number of subscriptions held by each subscriber.
+        std::unordered_map<subscriber_id_t, size_t> m_subscription_counts;
+        /// Subscribed transaction IDs in the order their subscriptions
+        /// were made, with the best block height at the time, for expiry.
+        std::deque<std::pair<uint64_t, hash_t>> m_subscription_heights;
+        std::mutex m_subscriptions_mut;
+        status_update_handler_t m_su_handler;
+
+        /// Sends status updates to the subscribers of the given transactions
+        /// and ends their subscriptions. Requires m_subscriptions_mut.
+        void notify_subscribers(const std::vector<hash_t>& tx_ids);
+
+        /// Ends subscriptions made at or before the given block height.
+        /// Requires m_subscriptions_mut.
+        void expire_subscriptions(uint64_t height);
+
+        /// Decrements the number of subscriptions held by a subscriber.
+        /// Requires m_subscriptions_mut.
+        void release_subscription(subscriber_id_t subscriber);
+
+        /// Removes errors for transactions which appear in the block cache.
+        static void filter_repeated_errors(const block_cache& bc,
+                                           std::vector<tx_error>& errs);
+
+        /// Looks up each UHS ID of the history in the block cache, splitting
+        /// large histories into chunks processed by the query threads.
+        void lookup_history(const block_cache& bc, uhs_id_history& hist);
+
+        static auto check_uhs_id_statuses(const uhs_id_history& hist,
+                                          const error_cache& ec,
+                                          const std::vector<hash_t>& uhs_ids,
+                                          const hash_t& tx_id,
+                                          bool internal_err,
+                                          bool tx_err,
+                                          uint64_t best_height)
             -> std::vector<status_update_state>;
     };
 }
@@ -64,6 +64,7 @@ namespace cbdc {
                    std::string client_file)
         : m_opts(std::move(opts)),
           m_logger(std::move(logger)),
+          m_send_window(std::max<size_t>(1, m_opts.m_client_send_window)),
           m_sentinel_client(m_opts.m_sentinel_endpoints, m_logger),
           m_client_file(std::move(client_file)),
           m_wallet_file(std::move(wallet_file)) {}
@@ -150,6 +151,98 @@ namespace cbdc {
         return std::make_pair(spend_tx.value(), res.value());
     }
 
+    auto client::send_async(uint32_t value,
+                            const pubkey_t& payee,
+                            const send_callback_type& result_callback)
+        -> std::optional<transaction::full_tx> {
+        process_send_results(false);
+        while(m_in_flight.size() >= m_send_window) {
+            process_send_results(true);
+        }
+
+        auto tx = create_transaction(value, payee);
+        if(!tx.has_value()) {
+            m_logger->error("Failed to generate wallet spend tx.");
+            return std::nullopt;
+        }
+
+        import_transaction(tx.value());
+        const auto tx_id = transaction::tx_id(tx.value());
+        m_in_flight.emplace(tx_id,
+                            std::make_pair(tx.value(), result_callback));
+
+        auto sent = m_sentinel_client.execute_transaction(
+            tx.value(),
+            [&, tx_id](cbdc::sentinel::rpc::client::execute_result_type res) {
+                {
+                    std::unique_lock<std::mutex> l(m_send_results_mut);
+                    m_send_results.push({tx_id, std::move(res)});
+                }
+                m_send_results_cv.notify_one();
+            });
+        if(!sent) {
+            std::unique_lock<std::mutex> l(m_send_results_mut);
+            m_send_results.push({tx_id, std::nullopt});
+        }
+
+        return tx;
+    }
+
+    void client::finish_sends() {
+        while(!m_in_flight.empty()) {
+            process_send_results(true);
+        }
+    }
+
+    auto client::in_flight_count() const -> size_t {
+        return m_in_flight.size();
+    }
+
+    void client::process_send_results(bool block) {
+        auto results = std::queue<send_result>();
+        {
+            std::unique_lock<std::mutex> l(m_send_results_mut);
+            if(block) {
+                m_send_results_cv.wait(l, [&]() {
+                    return !m_send_results.empty();
+                });
+            }
+            std::swap(results, m_send_results);
+        }
+
+        for(; !results.empty(); results.pop()) {
+            auto& [tx_id, res] = results.front();
+            auto it = m_in_flight.find(tx_id);
+            assert(it != m_in_flight.end());
+            auto [tx, cb] = std::move(it->second);
+            m_in_flight.erase(it);
+
+            if(!res.has_value()) {
+                // Back off from a sentinel which is failing to keep up
+                m_send_window = std::max<size_t>(1, m_send_window / 2);
+                m_logger->error("Failed to send transaction to sentinel.");
+            } else {
+                m_send_window
+                    = std::min(m_send_window + 1,
+                               std::max<size_t>(1,
+                                                m_opts.m_client_send_window));
+                m_logger->info(
+                    "Sentinel responded:",
+                    cbdc::sentinel::to_string(res.value().m_tx_status),
+                    "for",
+                    to_string(tx_id));
+                if(res.value().m_tx_status
+                   == sentinel::tx_status::confirmed) {
+                    confirm_transaction(tx_id);
+                }
+            }
+
+            if(cb) {
+                cb(tx, res);
+            }
+        }
+    }
+
     auto client::fan(uint32_t count, uint32_t value, const pubkey_t& payee)
         -> std::pair<std::optional<transaction::full_tx>,
                      std::optional<cbdc::sentinel::execute_response>> {
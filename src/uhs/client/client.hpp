@@ -10,6 +10,9 @@
 #include "uhs/transaction/validation.hpp"
 #include "uhs/transaction/wallet.hpp"
 
+#include <condition_variable>
+#include <queue>
+
 namespace cbdc {
     namespace address {
         static constexpr auto bits_per_byte = 8;
@@ -83,6 +86,43 @@ namespace cbdc {
             -> std::pair<std::optional<transaction::full_tx>,
                          std::optional<cbdc::sentinel::execute_response>>;
 
+        /// Function called with a transaction sent by \ref send_async and
+        /// the sentinel's response, or std::nullopt if the sentinel did not
+        /// respond.
+        using send_callback_type
+            = std::function<void(const transaction::full_tx&,
+                                 std::optional<sentinel::execute_response>)>;
+
+        /// \brief Send a specified amount from this client's wallet to a
+        ///        target address without waiting for the sentinel.
+        ///
+        /// Generates and transmits a transaction as in \ref send, but
+        /// returns once the transaction is sent. Keeps a window of at most
+        /// m_client_send_window transactions in flight, blocking until a
+        /// response arrives while the window is full. The window halves
+        /// whenever a sentinel fails to respond, and grows back by one with
+        /// each response, so the client backs off an overloaded sentinel.
+        /// Responses are processed, and callbacks called, on the calling
+        /// thread during calls to this function and to \ref finish_sends.
+        /// \param value the amount to send, in the base unit of the currency.
+        /// \param payee the destination address of the transfer.
+        /// \param result_callback function to call with the response.
+        /// \return the transaction sent, or std::nullopt if generating the
+        ///         transaction failed.
+        auto send_async(uint32_t value,
+                        const pubkey_t& payee,
+                        const send_callback_type& result_callback)
+            -> std::optional<transaction::full_tx>;
+
+        /// Waits for responses to every transaction sent by \ref send_async
+        /// and processes them.
+        void finish_sends();
+
+        /// Returns the number of transactions sent by \ref send_async that
+        /// are awaiting a response.
+        /// \return number of in-flight transactions.
+        [[nodiscard]] auto in_flight_count() const -> size_t;
+
         /// \brief Send a specified number of fixed-value outputs from this
         ///        client's wallet to a target address.
         ///
@@ -274,6 +314,28 @@ namespace cbdc {
         cbdc::config::options m_opts;
         std::shared_ptr<logging::log> m_logger;
 
+        /// Sentinel response to a transaction sent by send_async.
+        struct send_result {
+            hash_t m_tx_id;
+            std::optional<sentinel::execute_response> m_res;
+        };
+
+        /// Responses received by the sentinel client's handler thread,
+        /// waiting to be processed. Declared before m_sentinel_client, which
+        /// may deliver responses while it is being destroyed.
+        std::queue<send_result> m_send_results;
+        std::mutex m_send_results_mut;
+        std::condition_variable m_send_results_cv;
+
+        /// Transactions sent by send_async and their callbacks, keyed by
+        /// transaction ID.
+        std::unordered_map<hash_t,
+                           std::pair<transaction::full_tx, send_callback_type>,
+                           hashing::null>
+            m_in_flight;
+        /// Current size of the in-flight window.
+        size_t m_send_window;
+
         cbdc::sentinel::rpc::client m_sentinel_client;
 
         /// List of pending transactions submitted to the system awaiting
@@ -308,6 +370,10 @@ namespace cbdc {
         void save();
 
         void register_pending_tx(const transaction::full_tx& tx);
+
+        /// Processes sentinel responses to in-flight transactions.
+        /// \param block true to wait for at least one response.
+        void process_send_results(bool block);
     };
 }
 
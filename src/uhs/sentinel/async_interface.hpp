@@ -10,8 +10,10 @@
 #include "uhs/transaction/validation.hpp"
 #include "util/common/hash.hpp"
 
+#include <functional>
 #include <optional>
 #include <string>
+#include <vector>
 
 namespace cbdc::sentinel {
     /// Interface for an asynchronous sentinel.
@@ -64,6 +66,23 @@ namespace cbdc::sentinel {
                              validate_result_callback_type result_callback)
             -> bool
             = 0;
+
+        /// Callback function for a batch execution result.
+        using execute_batch_result_callback_type = std::function<void(
+            std::optional<cbdc::sentinel::execute_batch_response>)>;
+
+        /// Execute a batch of transactions as in \ref execute_transaction,
+        /// and return the results of the whole batch in a single callback.
+        /// The default implementation executes each transaction separately
+        /// and calls the callback once every transaction has a result.
+        /// \param txs transactions to execute.
+        /// \param result_callback function to call with the execution result
+        ///                        of each transaction.
+        /// \return false if the implementation could not start processing the
+        ///         batch.
+        virtual auto execute_transactions(
+            std::vector<transaction::full_tx> txs,
+            execute_batch_result_callback_type result_callback) -> bool;
     };
 }
 
@@ -68,4 +68,28 @@ namespace cbdc::sentinel::rpc {
                 cb(std::get<validate_response>(res.value()));
             });
     }
+
+    auto client::execute_transactions(std::vector<transaction::full_tx> txs)
+        -> execute_batch_result_type {
+        auto res = m_client.call(execute_batch_request{std::move(txs)});
+        if(!res.has_value()) {
+            return std::nullopt;
+        }
+        return std::get<execute_batch_response>(res.value());
+    }
+
+    auto client::execute_transactions(
+        std::vector<transaction::full_tx> txs,
+        std::function<void(execute_batch_result_type)> result_callback)
+        -> bool {
+        return m_client.call(
+            execute_batch_request{std::move(txs)},
+            [cb = std::move(result_callback)](std::optional<response> res) {
+                if(!res.has_value()) {
+                    cb(std::nullopt);
+                    return;
+                }
+                cb(std::get<execute_batch_response>(res.value()));
+            });
+    }
 }
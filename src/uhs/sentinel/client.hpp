@@ -78,6 +78,28 @@ namespace cbdc::sentinel::rpc {
             std::function<void(validate_result_type)> result_callback)
             -> bool override;
 
+        /// Result type from execute_transactions.
+        using execute_batch_result_type
+            = std::optional<cbdc::sentinel::execute_batch_response>;
+
+        /// Send a batch of transactions to the sentinel in a single request
+        /// and return the response.
+        /// \param txs transactions to send to the sentinel.
+        /// \return the execution result of each transaction, or
+        ///         std::nullopt if the request failed.
+        auto execute_transactions(std::vector<transaction::full_tx> txs)
+            -> execute_batch_result_type override;
+
+        /// Send a batch of transactions to the sentinel in a single request
+        /// and return the response via a callback function asynchronously.
+        /// \param txs transactions to send to the sentinel.
+        /// \param result_callback callback function to call with the result.
+        /// \return true if the request was sent successfully.
+        auto execute_transactions(
+            std::vector<transaction::full_tx> txs,
+            std::function<void(execute_batch_result_type)> result_callback)
+            -> bool override;
+
       private:
         cbdc::config::options m_opts;
         std::shared_ptr<logging::log> m_logger;
@@ -18,4 +18,24 @@ namespace cbdc {
         -> serializer& {
         return packet >> r.m_tx_status >> r.m_tx_error;
     }
+
+    auto operator<<(serializer& packet,
+                    const sentinel::execute_batch_request& r) -> serializer& {
+        return packet << r.m_txs;
+    }
+
+    auto operator>>(serializer& packet, sentinel::execute_batch_request& r)
+        -> serializer& {
+        return packet >> r.m_txs;
+    }
+
+    auto operator<<(serializer& packet,
+                    const sentinel::execute_batch_response& r) -> serializer& {
+        return packet << r.m_responses;
+    }
+
+    auto operator>>(serializer& packet, sentinel::execute_batch_response& r)
+        -> serializer& {
+        return packet >> r.m_responses;
+    }
 }
@@ -5,6 +5,10 @@
 
 #include "interface.hpp"
 
+#include "async_interface.hpp"
+
+#include <mutex>
+
 namespace cbdc::sentinel {
     auto execute_response::operator==(
         const cbdc::sentinel::execute_response& rhs) const -> bool {
@@ -12,6 +16,75 @@ namespace cbdc::sentinel {
             == std::tie(rhs.m_tx_status, rhs.m_tx_error);
     }
 
+    auto execute_batch_request::operator==(
+        const execute_batch_request& rhs) const -> bool {
+        return m_txs == rhs.m_txs;
+    }
+
+    auto execute_batch_response::operator==(
+        const execute_batch_response& rhs) const -> bool {
+        return m_responses == rhs.m_responses;
+    }
+
+    auto interface::execute_transactions(std::vector<transaction::full_tx> txs)
+        -> std::optional<execute_batch_response> {
+        auto ret = execute_batch_response();
+        ret.m_responses.reserve(txs.size());
+        for(auto& tx : txs) {
+            ret.m_responses.push_back(execute_transaction(std::move(tx)));
+        }
+        return ret;
+    }
+
+    auto async_interface::execute_transactions(
+        std::vector<transaction::full_tx> txs,
+        execute_batch_result_callback_type result_callback) -> bool {
+        // Shared between the result callbacks of every transaction in the
+        // batch. The last transaction to finish sends the batch response.
+        struct batch_state {
+            std::mutex m_mut;
+            execute_batch_response m_res;
+            size_t m_pending;
+            execute_batch_result_callback_type m_cb;
+        };
+
+        if(txs.empty()) {
+            result_callback(execute_batch_response{});
+            return true;
+        }
+
+        auto state = std::make_shared<batch_state>();
+        state->m_res.m_responses.resize(txs.size());
+        state->m_pending = txs.size();
+        state->m_cb = std::move(result_callback);
+
+        auto on_result
+            = [state](size_t idx, std::optional<execute_response> res) {
+                  {
+                      std::unique_lock l(state->m_mut);
+                      state->m_res.m_responses[idx] = std::move(res);
+                      state->m_pending--;
+                      if(state->m_pending > 0) {
+                          return;
+                      }
+                  }
+                  state->m_cb(std::move(state->m_res));
+              };
+
+        for(size_t i{0}; i < txs.size(); i++) {
+            auto started = execute_transaction(
+                std::move(txs[i]),
+                [on_result, i](std::optional<execute_response> res) {
+                    on_result(i, std::move(res));
+                });
+            if(!started) {
+                on_result(i, std::nullopt);
+            }
+        }
+
+        return true;
+    }
+
     auto to_string(tx_status status) -> std::string {
         auto ret = std::string();
         switch(status) {
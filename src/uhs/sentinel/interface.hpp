@@ -12,6 +12,7 @@
 
 #include <optional>
 #include <string>
+#include <vector>
 
 namespace cbdc::sentinel {
     /// Status of the transaction following sentinel processing.
@@ -65,12 +66,32 @@ namespace cbdc::sentinel {
     /// the given transaction.
     using validate_response = transaction::sentinel_attestation;
 
-    /// Sentinel RPC request type. Either a transaction execution or validation
-    /// request.
-    using request = std::variant<execute_request, validate_request>;
-    /// Sentinel RPC response type. Either a transaction execution or
-    /// validation response.
-    using response = std::variant<execute_response, validate_response>;
+    /// Request to execute a batch of transactions in a single message.
+    struct execute_batch_request {
+        /// Transactions to execute.
+        std::vector<transaction::full_tx> m_txs;
+
+        auto operator==(const execute_batch_request& rhs) const -> bool;
+    };
+
+    /// Response to an execute_batch_request.
+    struct execute_batch_response {
+        /// Execution result of each transaction, in the same order as the
+        /// transactions in the request. std::nullopt if processing the
+        /// transaction failed.
+        std::vector<std::optional<execute_response>> m_responses;
+
+        auto operator==(const execute_batch_response& rhs) const -> bool;
+    };
+
+    /// Sentinel RPC request type. Either a transaction execution, validation
+    /// or batch execution request.
+    using request = std::
+        variant<execute_request, validate_request, execute_batch_request>;
+    /// Sentinel RPC response type. Either a transaction execution, validation
+    /// or batch execution response.
+    using response = std::
+        variant<execute_response, validate_response, execute_batch_response>;
 
     /// Interface for a sentinel.
     class interface {
@@ -99,6 +120,15 @@ namespace cbdc::sentinel {
         ///         std::nullopt if the transaction is invalid.
         virtual auto validate_transaction(transaction::full_tx tx)
             -> std::optional<validate_response> = 0;
+
+        /// Execute a batch of transactions as in \ref execute_transaction.
+        /// The default implementation executes each transaction in turn.
+        /// \param txs transactions to execute.
+        /// \return the execution result of each transaction, or
+        ///         std::nullopt if processing the batch failed.
+        virtual auto
+        execute_transactions(std::vector<transaction::full_tx> txs)
+            -> std::optional<execute_batch_response>;
     };
 }
 
@@ -0,0 +1,173 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "utxo_store.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace cbdc::transaction {
+    auto utxo_store::insert(const input& in) -> bool {
+        const auto seq = m_next_seq;
+        const auto [it, added]
+            = m_utxos.try_emplace(in.m_prevout, entry{in, seq});
+        if(!added) {
+            return false;
+        }
+        m_next_seq++;
+        const auto value = in.m_prevout_data.m_value;
+        m_by_value.emplace(value_key{value, seq}, in.m_prevout);
+        m_by_age.emplace(seq, in.m_prevout);
+        m_balance += value;
+        record_change(in);
+        return true;
+    }
+
+    auto utxo_store::erase(const out_point& point) -> std::optional<input> {
+        auto it = m_utxos.find(point);
+        if(it == m_utxos.end()) {
+            return std::nullopt;
+        }
+        auto in = std::move(it->second.m_input);
+        const auto seq = it->second.m_seq;
+        const auto value = in.m_prevout_data.m_value;
+        m_utxos.erase(it);
+        m_by_value.erase(value_key{value, seq});
+        m_by_age.erase(seq);
+        m_balance -= value;
+        record_change(point);
+        return in;
+    }
+
+    auto utxo_store::select(uint64_t amount, coin_selection strategy)
+        -> std::optional<std::vector<input>> {
+        if(amount > m_balance) {
+            return std::nullopt;
+        }
+
+        auto points = std::vector<out_point>();
+        uint64_t total{0};
+        switch(strategy) {
+            case coin_selection::oldest_first:
+                for(auto it = m_by_age.begin();
+                    it != m_by_age.end() && total < amount;
+                    it++) {
+                    points.push_back(it->second);
+                    total += m_utxos.at(it->second)
+                                 .m_input.m_prevout_data.m_value;
+                }
+                break;
+            case coin_selection::largest_first:
+                for(auto it = m_by_value.rbegin();
+                    it != m_by_value.rend() && total < amount;
+                    it++) {
+                    points.push_back(it->second);
+                    total += it->first.first;
+                }
+                break;
+            case coin_selection::exact_match: {
+                auto it = m_by_value.lower_bound(value_key{amount, 0});
+                if(it != m_by_value.end() && it->first.first == amount) {
+                    points.push_back(it->second);
+                    total = amount;
+                    break;
+                }
+                [[fallthrough]];
+            }
+            case coin_selection::fewest_inputs: {
+                // Take the largest UTXOs until the largest remaining one
+                // covers what is left, then take the smallest UTXO which
+                // covers it. The UTXOs taken so far are all larger, so
+                // that UTXO has not been taken yet.
+                auto end = m_by_value.end();
+                while(total < amount) {
+                    auto largest = std::prev(end);
+                    const auto remaining = amount - total;
+                    if(largest->first.first >= remaining) {
+                        auto best
+                            = m_by_value.lower_bound(value_key{remaining, 0});
+                        points.push_back(best->second);
+                        total += best->first.first;
+                        break;
+                    }
+                    points.push_back(largest->second);
+                    total += largest->first.first;
+                    end = largest;
+                }
+                break;
+            }
+        }
+
+        assert(total >= amount);
+        return take(points);
+    }
+
+    auto utxo_store::oldest(size_t count) const -> std::vector<input> {
+        auto ret = std::vector<input>();
+        ret.reserve(std::min(count, m_utxos.size()));
+        for(auto it = m_by_age.begin();
+            it != m_by_age.end() && ret.size() < count;
+            it++) {
+            ret.push_back(m_utxos.at(it->second).m_input);
+        }
+        return ret;
+    }
+
+    auto utxo_store::take(const std::vector<out_point>& points)
+        -> std::vector<input> {
+        auto ret = std::vector<input>();
+        ret.reserve(points.size());
+        for(const auto& point : points) {
+            auto in = erase(point);
+            assert(in.has_value());
+            ret.push_back(std::move(in.value()));
+        }
+        return ret;
+    }
+
+    auto utxo_store::balance() const -> uint64_t {
+        return m_balance;
+    }
+
+    auto utxo_store::size() const -> size_t {
+        return m_utxos.size();
+    }
+
+    auto utxo_store::utxos() const -> std::vector<input> {
+        auto ret = std::vector<input>();
+        ret.reserve(m_utxos.size());
+        for(const auto& [point, e] : m_utxos) {
+            ret.push_back(e.m_input);
+        }
+        return ret;
+    }
+
+    void utxo_store::track_changes(bool enabled) {
+        m_track_changes = enabled;
+        m_changes_dropped = false;
+        m_changes.clear();
+    }
+
+    auto utxo_store::take_changes() -> std::optional<std::vector<change>> {
+        if(m_changes_dropped) {
+            return std::nullopt;
+        }
+        return std::exchange(m_changes, {});
+    }
+
+    void utxo_store::record_change(change&& c) {
+        if(!m_track_changes) {
+            return;
+        }
+        if(m_changes.size() >= std::max(min_tracked_changes, m_utxos.size())) {
+            m_track_changes = false;
+            m_changes_dropped = true;
+            m_changes = {};
+            return;
+        }
+        m_changes.emplace_back(std::move(c));
+    }
+}
@@ -0,0 +1,133 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_TRANSACTION_UTXO_STORE_H_
+#define OPENCBDC_TX_SRC_TRANSACTION_UTXO_STORE_H_
+
+#include "uhs/transaction/transaction.hpp"
+
+#include <map>
+#include <optional>
+#include <variant>
+#include <vector>
+
+namespace cbdc::transaction {
+    /// Strategy used to choose which UTXOs fund a payment.
+    enum class coin_selection : uint8_t {
+        /// Spend the oldest UTXOs first.
+        oldest_first,
+        /// Spend a single UTXO whose value equals the amount if one exists,
+        /// so no change output is needed. Otherwise behaves as
+        /// fewest_inputs.
+        exact_match,
+        /// Spend the largest UTXOs first.
+        largest_first,
+        /// Spend the fewest UTXOs which cover the amount. The last UTXO
+        /// chosen is the smallest one which covers the remainder, to
+        /// minimize change.
+        fewest_inputs
+    };
+
+    /// \brief Indexed set of the unspent transaction outputs of a wallet.
+    ///
+    /// UTXOs are indexed by out point, by value and by age, so inserting,
+    /// erasing and selecting each UTXO takes O(log n) time. Optionally
+    /// records each insertion and removal so that the owner can persist
+    /// them incrementally. Not thread-safe.
+    class utxo_store {
+      public:
+        /// Change to the store, either an inserted UTXO or the out point of
+        /// a removed UTXO.
+        using change = std::variant<input, out_point>;
+
+        /// Adds a UTXO to the store.
+        /// \param in UTXO to add.
+        /// \return true if the UTXO was not already in the store.
+        auto insert(const input& in) -> bool;
+
+        /// Removes a UTXO from the store.
+        /// \param point out point of the UTXO to remove.
+        /// \return the removed UTXO, or std::nullopt if it was not in the
+        ///         store.
+        auto erase(const out_point& point) -> std::optional<input>;
+
+        /// Removes and returns UTXOs with a total value of at least the
+        /// given amount, chosen with the given strategy. Leaves the store
+        /// unchanged if its balance is too low.
+        /// \param amount minimum total value to select.
+        /// \param strategy coin selection strategy.
+        /// \return selected UTXOs, or std::nullopt if the amount could not
+        ///         be covered.
+        auto select(uint64_t amount, coin_selection strategy)
+            -> std::optional<std::vector<input>>;
+
+        /// Returns up to the given number of UTXOs, oldest first, without
+        /// removing them.
+        /// \param count maximum number of UTXOs to return.
+        /// \return oldest UTXOs.
+        [[nodiscard]] auto oldest(size_t count) const -> std::vector<input>;
+
+        /// Returns the sum of the values of all the UTXOs in the store.
+        /// \return total value.
+        [[nodiscard]] auto balance() const -> uint64_t;
+
+        /// Returns the number of UTXOs in the store.
+        /// \return number of UTXOs.
+        [[nodiscard]] auto size() const -> size_t;
+
+        /// Returns the UTXOs in the store, sorted by out point.
+        /// \return all UTXOs.
+        [[nodiscard]] auto utxos() const -> std::vector<input>;
+
+        /// Minimum number of changes recorded before tracking stops.
+        static constexpr size_t min_tracked_changes = 1024;
+
+        /// Sets whether to record insertions and removals for \ref
+        /// take_changes. Discards changes recorded so far. Once more
+        /// changes are pending than the larger of \ref min_tracked_changes
+        /// and the number of UTXOs, the changes are discarded and tracking
+        /// stops, so pending changes never take much more memory than the
+        /// UTXOs themselves.
+        /// \param enabled true to start recording changes.
+        void track_changes(bool enabled);
+
+        /// Returns and forgets the changes made to the store since
+        /// tracking was enabled or this function was last called, in the
+        /// order in which they were made.
+        /// \return recorded changes, or std::nullopt if tracking stopped
+        ///         because there were too many changes. Tracking stays off
+        ///         until re-enabled with \ref track_changes.
+        auto take_changes() -> std::optional<std::vector<change>>;
+
+      private:
+        struct entry {
+            input m_input;
+            uint64_t m_seq;
+        };
+
+        using value_key = std::pair<uint64_t, uint64_t>;
+
+        std::map<out_point, entry> m_utxos;
+        /// Out points keyed by (value, insertion sequence number).
+        std::map<value_key, out_point> m_by_value;
+        /// Out points keyed by insertion sequence number.
+        std::map<uint64_t, out_point> m_by_age;
+        uint64_t m_next_seq{0};
+        uint64_t m_balance{0};
+
+        bool m_track_changes{false};
+        bool m_changes_dropped{false};
+        std::vector<change> m_changes;
+
+        /// Records a change if tracking is enabled.
+        void record_change(change&& c);
+
+        /// Removes the given UTXOs, which must be in the store, and returns
+        /// them in the given order.
+        auto take(const std::vector<out_point>& points) -> std::vector<input>;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_TRANSACTION_UTXO_STORE_H_
@@ -11,7 +11,9 @@
 #include "util/serialization/istream_serializer.hpp"
 #include "util/serialization/ostream_serializer.hpp"
 
+#include <filesystem>
 #include <secp256k1_schnorrsig.h>
+#include <thread>
 
 namespace cbdc {
     transaction::wallet::wallet() {
@@ -45,9 +47,10 @@ namespace cbdc {
 
     auto transaction::wallet::send_to(const uint32_t amount,
                                       const pubkey_t& payee,
-                                      bool sign_tx)
+                                      bool sign_tx,
+                                      coin_selection strategy)
         -> std::optional<transaction::full_tx> {
-        auto maybe_tx = accumulate_inputs(amount);
+        auto maybe_tx = accumulate_inputs(amount, strategy);
         if(!maybe_tx.has_value()) {
             return std::nullopt;
         }
@@ -122,6 +125,12 @@ namespace cbdc {
     }
 
     auto transaction::wallet::generate_key() -> pubkey_t {
+        return generate_key(m_secp.get(), m_shuffle);
+    }
+
+    auto transaction::wallet::generate_key(secp256k1_context* ctx,
+                                           std::default_random_engine& shuffle)
+        -> pubkey_t {
         // Unique lock on m_keys, m_keygen and m_keygen_dist
         {
             // TODO: add config parameter where 0 = never reuse.
@@ -131,7 +140,7 @@ namespace cbdc {
                 std::uniform_int_distribution<size_t> keyshuffle_dist(
                     0,
                     m_keys.size() - 1);
-                const auto index = keyshuffle_dist(m_shuffle);
+                const auto index = keyshuffle_dist(shuffle);
                 return m_pubkeys[index];
             }
         }
@@ -142,7 +151,7 @@ namespace cbdc {
         for(auto&& b : seckey) {
             b = keygen(*m_random_source);
         }
-        pubkey_t ret = pubkey_from_privkey(seckey, m_secp.get());
+        pubkey_t ret = pubkey_from_privkey(seckey, ctx);
         {
             std::unique_lock<std::shared_mutex> lg(m_keys_mut);
             m_pubkeys.push_back(ret);
@@ -156,59 +165,65 @@ namespace cbdc {
     }
 
     void transaction::wallet::sign(transaction::full_tx& tx) const {
+        sign(tx, m_secp.get());
+    }
+
+    void transaction::wallet::sign(transaction::full_tx& tx,
+                                   const secp256k1_context* ctx) const {
         // TODO: other sighash types besides SIGHASH_ALL?
         const auto sighash = transaction::tx_id(tx);
         tx.m_witness.resize(tx.m_inputs.size());
 
-        for(size_t i = 0; i < tx.m_inputs.size(); i++) {
-            const auto& wit_commit
-                = tx.m_inputs[i].m_prevout_data.m_witness_program_commitment;
-
-            privkey_t seckey{};
-            pubkey_t pubkey{};
-            bool key_ours = false;
-            {
-                std::shared_lock<std::shared_mutex> sl(m_keys_mut);
+        // Look up the keys for every input under a single lock
+        auto keys
+            = std::vector<std::optional<std::pair<pubkey_t, privkey_t>>>(
+                tx.m_inputs.size());
+        {
+            std::shared_lock<std::shared_mutex> sl(m_keys_mut);
+            for(size_t i = 0; i < tx.m_inputs.size(); i++) {
+                const auto& wit_commit
+                    = tx.m_inputs[i]
+                          .m_prevout_data.m_witness_program_commitment;
                 const auto wit_prog = m_witness_programs.find(wit_commit);
-                key_ours = wit_prog != m_witness_programs.end();
-                if(key_ours) {
-                    pubkey = wit_prog->second;
-                    seckey = m_keys.at(pubkey);
+                if(wit_prog != m_witness_programs.end()) {
+                    keys[i] = {wit_prog->second,
+                               m_keys.at(wit_prog->second)};
                 }
             }
+        }
 
-            if(key_ours) {
-                auto& sig = tx.m_witness[i];
-                sig.resize(transaction::validation::p2pk_witness_len);
-                sig[0] = std::byte(
-                    transaction::validation::witness_program_type::p2pk);
-                std::memcpy(
-                    &sig[sizeof(
-                        transaction::validation::witness_program_type)],
-                    pubkey.data(),
-                    pubkey.size());
-
-                secp256k1_keypair keypair{};
-                [[maybe_unused]] const auto ret
-                    = secp256k1_keypair_create(m_secp.get(),
-                                               &keypair,
-                                               seckey.data());
-                assert(ret == 1);
-
-                std::array<unsigned char, sig_len> sig_arr{};
-                [[maybe_unused]] const auto sign_ret
-                    = secp256k1_schnorrsig_sign(m_secp.get(),
-                                                sig_arr.data(),
-                                                sighash.data(),
-                                                &keypair,
-                                                nullptr,
-                                                nullptr);
-                std::memcpy(
-                    &sig[transaction::validation::p2pk_witness_prog_len],
-                    sig_arr.data(),
-                    sizeof(sig_arr));
-                assert(sign_ret == 1);
+        for(size_t i = 0; i < tx.m_inputs.size(); i++) {
+            if(!keys[i].has_value()) {
+                continue;
             }
+            const auto& [pubkey, seckey] = keys[i].value();
+
+            auto& sig = tx.m_witness[i];
+            sig.resize(transaction::validation::p2pk_witness_len);
+            sig[0] = std::byte(
+                transaction::validation::witness_program_type::p2pk);
+            std::memcpy(
+                &sig[sizeof(transaction::validation::witness_program_type)],
+                pubkey.data(),
+                pubkey.size());
+
+            secp256k1_keypair keypair{};
+            [[maybe_unused]] const auto ret
+                = secp256k1_keypair_create(ctx, &keypair, seckey.data());
+            assert(ret == 1);
+
+            std::array<unsigned char, sig_len> sig_arr{};
+            [[maybe_unused]] const auto sign_ret
+                = secp256k1_schnorrsig_sign(ctx,
+                                            sig_arr.data(),
+                                            sighash.data(),
+                                            &keypair,
+                                            nullptr,
+                                            nullptr);
+            std::memcpy(&sig[transaction::validation::p2pk_witness_prog_len],
+                        sig_arr.data(),
+                        sizeof(sig_arr));
+            assert(sign_ret == 1);
         }
     }
 
@@ -217,20 +232,12 @@ namespace cbdc {
         const std::vector<transaction::input>& debits) {
         std::unique_lock<std::shared_mutex> lu(m_utxos_mut);
         for(const auto& inp : credits) {
-            const auto added = m_utxos_set.insert(inp);
-            if(added.second) {
-                m_balance += inp.m_prevout_data.m_value;
-                m_spend_queue.push_back(inp);
-            }
+            m_utxos.insert(inp);
         }
 
         for(const auto& inp : debits) {
-            const auto erased = m_utxos_set.erase(inp) > 0;
-            if(erased) {
-                m_balance -= inp.m_prevout_data.m_value;
-            }
+            m_utxos.erase(inp.m_prevout);
         }
-        assert(m_spend_queue.size() == m_utxos_set.size());
     }
 
     auto transaction::wallet::seed(const privkey_t& privkey,
@@ -288,7 +295,7 @@ namespace cbdc {
     auto transaction::wallet::balance() const -> uint64_t {
         std::shared_lock<std::shared_mutex> lg(m_utxos_mut);
         // TODO: handle overflow
-        auto balance = m_balance;
+        auto balance = m_utxos.balance();
         if(m_seed_from != m_seed_to) {
             balance += (m_seed_to - m_seed_from) * m_seed_value;
         }
@@ -297,70 +304,222 @@ namespace cbdc {
 
     auto transaction::wallet::count() const -> size_t {
         std::shared_lock<std::shared_mutex> lg(m_utxos_mut);
-        auto size = m_utxos_set.size();
+        auto size = m_utxos.size();
         if(m_seed_from != m_seed_to) {
             size += (m_seed_to - m_seed_from);
         }
         return size;
     }
 
-    void transaction::wallet::save(const std::string& wallet_file) const {
-        std::ofstream wal_file(wallet_file,
-                               std::ios::binary | std::ios::trunc
-                                   | std::ios::out);
-        if(!wal_file.good()) {
-            // TODO: add a logger to wallet or give the save/load function
-            // return
-            ///      values
-            std::exit(EXIT_FAILURE);
+    void transaction::wallet::save(const std::string& wallet_file) {
+        std::unique_lock<std::mutex> lj(m_journal_mut);
+        if(wallet_file != m_journal_file || journal_full()
+           || !append_journal()) {
+            write_snapshot(wallet_file);
         }
-        auto ser = ostream_serializer(wal_file);
+    }
+
+    auto transaction::wallet::journal_full() const -> bool {
+        size_t snapshot_records{0};
         {
             std::shared_lock<std::shared_mutex> lk(m_keys_mut);
-            ser << m_keys;
+            snapshot_records += m_keys.size();
         }
-
         {
             std::shared_lock<std::shared_mutex> lu(m_utxos_mut);
-            ser << m_utxos_set;
+            snapshot_records += m_utxos.size();
         }
+        return m_journal_records
+             > std::max(min_journal_records, snapshot_records);
     }
 
-    void transaction::wallet::load(const std::string& wallet_file) {
-        std::ifstream wal_file(wallet_file, std::ios::binary | std::ios::in);
-        if(wal_file.good()) {
-            auto deser = istream_serializer(wal_file);
+    void transaction::wallet::write_snapshot(const std::string& wallet_file) {
+        const auto tmp_file = wallet_file + ".tmp";
+        {
+            std::ofstream wal_file(tmp_file,
+                                   std::ios::binary | std::ios::trunc
+                                       | std::ios::out);
+            if(!wal_file.good()) {
+                // TODO: add a logger to wallet or give the save/load
+                //       function return values
+                std::exit(EXIT_FAILURE);
+            }
+            auto ser = ostream_serializer(wal_file);
             {
-                std::unique_lock<std::shared_mutex> lk(m_keys_mut);
-
-                m_keys.clear();
-                m_pubkeys.clear();
-                m_witness_programs.clear();
-
-                deser >> m_keys;
-                for(const auto& k : m_keys) {
-                    m_pubkeys.push_back(k.first);
-                    m_witness_programs.insert(
-                        {transaction::validation::get_p2pk_witness_commitment(
-                             k.first),
-                         k.first});
-                }
+                std::shared_lock<std::shared_mutex> lk(m_keys_mut);
+                ser << m_keys;
+                m_saved_keys = m_pubkeys.size();
             }
 
             {
                 std::unique_lock<std::shared_mutex> lu(m_utxos_mut);
+                // Same format as a std::set of the UTXOs
+                ser << m_utxos.utxos();
+                m_utxos.track_changes(true);
+            }
 
-                m_utxos_set.clear();
-                m_spend_queue.clear();
-                m_balance = 0;
+            wal_file.flush();
+            if(!wal_file.good()) {
+                std::exit(EXIT_FAILURE);
+            }
+        }
 
-                deser >> m_utxos_set;
-                for(const auto& utxo : m_utxos_set) {
-                    m_balance += utxo.m_prevout_data.m_value;
-                    m_spend_queue.push_back(utxo);
+        auto ec = std::error_code();
+        std::filesystem::rename(tmp_file, wallet_file, ec);
+        if(ec) {
+            std::exit(EXIT_FAILURE);
+        }
+        m_journal_file = wallet_file;
+        m_journal_records = 0;
+    }
+
+    auto transaction::wallet::append_journal() -> bool {
+        auto changes = std::optional<std::vector<utxo_store::change>>();
+        {
+            std::unique_lock<std::shared_mutex> lu(m_utxos_mut);
+            changes = m_utxos.take_changes();
+        }
+        if(!changes.has_value()) {
+            // More changes were made than the store keeps track of, so
+            // only a new snapshot can record them.
+            return false;
+        }
+
+        auto keys = std::vector<std::pair<pubkey_t, privkey_t>>();
+        {
+            std::shared_lock<std::shared_mutex> lk(m_keys_mut);
+            for(size_t i = m_saved_keys; i < m_pubkeys.size(); i++) {
+                const auto& pubkey = m_pubkeys[i];
+                keys.emplace_back(pubkey, m_keys.at(pubkey));
+            }
+            m_saved_keys = m_pubkeys.size();
+        }
+
+        if(keys.empty() && changes->empty()) {
+            return true;
+        }
+
+        std::ofstream wal_file(m_journal_file,
+                               std::ios::binary | std::ios::app
+                                   | std::ios::out);
+        if(!wal_file.good()) {
+            std::exit(EXIT_FAILURE);
+        }
+        auto ser = ostream_serializer(wal_file);
+        for(const auto& [pubkey, privkey] : keys) {
+            ser << journal_op::add_key << pubkey << privkey;
+        }
+        for(const auto& change : *changes) {
+            if(const auto* in = std::get_if<input>(&change)) {
+                ser << journal_op::add_utxo << *in;
+            } else {
+                ser << journal_op::remove_utxo << std::get<out_point>(change);
+            }
+        }
+
+        wal_file.flush();
+        if(!wal_file.good()) {
+            std::exit(EXIT_FAILURE);
+        }
+        m_journal_records += keys.size() + changes->size();
+        return true;
+    }
+
+    void transaction::wallet::load(const std::string& wallet_file) {
+        std::unique_lock<std::mutex> lj(m_journal_mut);
+        auto keys = decltype(m_keys)();
+        auto utxos = utxo_store();
+        size_t journal_records{0};
+        std::streamoff journal_end{0};
+        {
+            std::ifstream wal_file(wallet_file,
+                                   std::ios::binary | std::ios::in);
+            if(!wal_file.good()) {
+                return;
+            }
+            auto deser = istream_serializer(wal_file);
+            auto snapshot_utxos = std::vector<input>();
+            deser >> keys >> snapshot_utxos;
+            for(const auto& utxo : snapshot_utxos) {
+                utxos.insert(utxo);
+            }
+
+            // Replay the journal up to the first incomplete record.
+            journal_end = wal_file.tellg();
+            auto op = journal_op();
+            while(!deser.end_of_buffer() && deser >> op) {
+                auto ok = false;
+                switch(op) {
+                    case journal_op::add_key: {
+                        auto pubkey = pubkey_t();
+                        auto privkey = privkey_t();
+                        ok = static_cast<bool>(deser >> pubkey >> privkey);
+                        if(ok) {
+                            keys.emplace(pubkey, privkey);
+                        }
+                        break;
+                    }
+                    case journal_op::add_utxo: {
+                        auto in = input();
+                        ok = static_cast<bool>(deser >> in);
+                        if(ok) {
+                            utxos.insert(in);
+                        }
+                        break;
+                    }
+                    case journal_op::remove_utxo: {
+                        auto point = out_point();
+                        ok = static_cast<bool>(deser >> point);
+                        if(ok) {
+                            utxos.erase(point);
+                        }
+                        break;
+                    }
                 }
+                if(!ok) {
+                    break;
+                }
+                journal_records++;
+                journal_end = wal_file.tellg();
+            }
+        }
+
+        // Drop any partial record so later appends follow the last
+        // complete one.
+        auto ec = std::error_code();
+        const auto file_size = std::filesystem::file_size(wallet_file, ec);
+        if(!ec && journal_end >= 0
+           && file_size > static_cast<uintmax_t>(journal_end)) {
+            std::filesystem::resize_file(wallet_file,
+                                         static_cast<uintmax_t>(journal_end),
+                                         ec);
+        }
+
+        {
+            std::unique_lock<std::shared_mutex> lk(m_keys_mut);
+
+            m_keys = std::move(keys);
+            m_pubkeys.clear();
+            m_witness_programs.clear();
+
+            for(const auto& k : m_keys) {
+                m_pubkeys.push_back(k.first);
+                m_witness_programs.insert(
+                    {transaction::validation::get_p2pk_witness_commitment(
+                         k.first),
+                     k.first});
             }
+            m_saved_keys = m_pubkeys.size();
         }
+
+        {
+            std::unique_lock<std::shared_mutex> lu(m_utxos_mut);
+            m_utxos = std::move(utxos);
+            m_utxos.track_changes(true);
+        }
+
+        m_journal_file = wallet_file;
+        m_journal_records = journal_records;
     }
 
     auto transaction::wallet::send_to(size_t input_count,
@@ -371,58 +530,152 @@ namespace cbdc {
         assert(input_count > 0);
         assert(output_count > 0);
 
+        auto res = std::optional<reservation>();
+        {
+            std::unique_lock<std::shared_mutex> ul(m_utxos_mut);
+            res = reserve_inputs(input_count, output_count);
+        }
+        if(!res.has_value()) {
+            return std::nullopt;
+        }
+
+        auto ret = make_transaction(std::move(res->m_inputs),
+                                    res->m_seeded_inputs,
+                                    output_count,
+                                    payee);
+        if(sign_tx) {
+            sign(ret);
+        }
+
+        return ret;
+    }
+
+    auto transaction::wallet::reserve_inputs(size_t input_count,
+                                             size_t output_count)
+        -> std::optional<reservation> {
         // TODO: handle overflow with large output values.
         uint64_t total_amount = 0;
-        transaction::full_tx ret;
-        uint64_t output_val{};
+        auto res = reservation();
+        res.m_inputs.reserve(input_count);
 
-        {
-            std::unique_lock<std::shared_mutex> ul(m_utxos_mut);
-            if((m_utxos_set.size() + m_seed_to - m_seed_from) < input_count) {
-                return std::nullopt;
+        while(m_seed_from != m_seed_to && res.m_inputs.size() < input_count) {
+            auto seed_utxo = create_seeded_input(m_seed_from);
+            if(!seed_utxo) {
+                break;
             }
+            res.m_inputs.push_back(std::move(seed_utxo.value()));
+            total_amount += m_seed_value;
+            m_seed_from++;
+            res.m_seeded_inputs++;
+        }
 
-            ret.m_inputs.reserve(input_count);
+        for(auto& utxo : m_utxos.oldest(input_count - res.m_inputs.size())) {
+            total_amount += utxo.m_prevout_data.m_value;
+            res.m_inputs.push_back(std::move(utxo));
+        }
 
-            size_t seeded_inputs = 0;
-            while(m_seed_from != m_seed_to
-                  && ret.m_inputs.size() < input_count) {
-                auto seed_utxo = create_seeded_input(m_seed_from);
-                if(!seed_utxo) {
+        if(res.m_inputs.size() < input_count
+           || (total_amount / output_count == 0 && output_count > 1)) {
+            // Not enough UTXOs, or caller asked for more outputs than we
+            // can make with the amount of coins we have.
+            m_seed_from -= res.m_seeded_inputs;
+            return std::nullopt;
+        }
+
+        for(size_t i = res.m_seeded_inputs; i < res.m_inputs.size(); i++) {
+            m_utxos.erase(res.m_inputs[i].m_prevout);
+        }
+        return res;
+    }
+
+    auto transaction::wallet::generate_transactions(size_t tx_count,
+                                                    size_t input_count,
+                                                    size_t output_count,
+                                                    bool sign_tx,
+                                                    size_t n_threads)
+        -> std::vector<transaction::full_tx> {
+        assert(input_count > 0);
+        assert(output_count > 0);
+        assert(n_threads > 0);
+
+        std::unique_lock<std::mutex> lf(m_factory_mut);
+
+        // Reserve the inputs of every transaction up front so the threads
+        // below never touch m_utxos.
+        auto reserved = std::vector<reservation>();
+        reserved.reserve(tx_count);
+        {
+            std::unique_lock<std::shared_mutex> ul(m_utxos_mut);
+            while(reserved.size() < tx_count) {
+                auto res = reserve_inputs(input_count, output_count);
+                if(!res.has_value()) {
                     break;
                 }
-                ret.m_inputs.push_back(seed_utxo.value());
-                ret.m_witness.emplace_back(sig_len, std::byte(0));
-                total_amount += m_seed_value;
-                m_seed_from++;
-                seeded_inputs++;
+                reserved.push_back(std::move(res.value()));
             }
+        }
 
-            for(auto utxo = m_spend_queue.begin();
-                (utxo != m_spend_queue.end())
-                && (ret.m_inputs.size() < input_count);
-                utxo++) {
-                ret.m_inputs.push_back(*utxo);
-                total_amount += utxo->m_prevout_data.m_value;
-            }
+        n_threads = std::max<size_t>(1, std::min(n_threads, reserved.size()));
+        while(m_signing_ctxs.size() < n_threads) {
+            auto ctx = secp_context_t(
+                secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
+                &secp256k1_context_destroy);
+            const auto seed = m_random_source->random_hash();
+            [[maybe_unused]] const auto ret
+                = secp256k1_context_randomize(ctx.get(), seed.data());
+            assert(ret == 1);
+            m_signing_ctxs.push_back(std::move(ctx));
+        }
 
-            output_val = total_amount / output_count;
-            if(output_val == 0 && output_count > 1) {
-                // Caller asked for more outputs than we can make with the
-                // amount of coins we have.
-                m_seed_from -= seeded_inputs;
-                return std::nullopt;
+        auto txs = std::vector<full_tx>(reserved.size());
+        auto build = [&](size_t thread_idx) {
+            auto* ctx = m_signing_ctxs[thread_idx].get();
+            auto shuffle
+                = std::default_random_engine((*m_random_source)());
+            const auto begin = reserved.size() * thread_idx / n_threads;
+            const auto end = reserved.size() * (thread_idx + 1) / n_threads;
+            for(size_t i = begin; i < end; i++) {
+                auto& res = reserved[i];
+                const auto payee = generate_key(ctx, shuffle);
+                txs[i] = make_transaction(std::move(res.m_inputs),
+                                          res.m_seeded_inputs,
+                                          output_count,
+                                          payee);
+                if(sign_tx) {
+                    sign(txs[i], ctx);
+                }
             }
+        };
 
-            for(size_t i = seeded_inputs; i < ret.m_inputs.size(); i++) {
-                auto& inp = ret.m_inputs[i];
-                m_balance -= inp.m_prevout_data.m_value;
-                m_utxos_set.erase(inp);
-                m_spend_queue.pop_front();
-            }
+        auto threads = std::vector<std::thread>();
+        threads.reserve(n_threads - 1);
+        for(size_t i = 1; i < n_threads; i++) {
+            threads.emplace_back(build, i);
+        }
+        build(0);
+        for(auto& t : threads) {
+            t.join();
         }
 
-        auto wit_comm
+        return txs;
+    }
+
+    auto transaction::wallet::make_transaction(std::vector<input> inputs,
+                                               size_t seeded_inputs,
+                                               size_t output_count,
+                                               const pubkey_t& payee)
+        -> transaction::full_tx {
+        auto ret = full_tx();
+        uint64_t total_amount{0};
+        for(const auto& in : inputs) {
+            total_amount += in.m_prevout_data.m_value;
+        }
+        ret.m_inputs = std::move(inputs);
+        ret.m_witness.resize(seeded_inputs,
+                             witness_t(sig_len, std::byte(0)));
+
+        const auto output_val = total_amount / output_count;
+        const auto wit_comm
             = transaction::validation::get_p2pk_witness_commitment(payee);
         ret.m_outputs.reserve(output_count);
         for(size_t i{0}; i < output_count; i++) {
@@ -436,13 +689,8 @@ namespace cbdc {
             send_out.m_witness_program_commitment = wit_comm;
             ret.m_outputs.push_back(send_out);
         }
-
         assert(total_amount == 0);
 
-        if(sign_tx) {
-            sign(ret);
-        }
-
         return ret;
     }
 
@@ -454,10 +702,11 @@ namespace cbdc {
     auto transaction::wallet::fan(size_t output_count,
                                   uint32_t value,
                                   const pubkey_t& payee,
-                                  bool sign_tx)
+                                  bool sign_tx,
+                                  coin_selection strategy)
         -> std::optional<transaction::full_tx> {
         const uint64_t amount = output_count * value;
-        auto maybe_tx = accumulate_inputs(amount);
+        auto maybe_tx = accumulate_inputs(amount, strategy);
         if(!maybe_tx.has_value()) {
             return std::nullopt;
         }
@@ -491,7 +740,8 @@ namespace cbdc {
         return ret;
     }
 
-    auto transaction::wallet::accumulate_inputs(uint64_t amount)
+    auto transaction::wallet::accumulate_inputs(uint64_t amount,
+                                                coin_selection strategy)
         -> std::optional<std::pair<full_tx, uint64_t>> {
         uint64_t total_amount = 0;
         auto ret = full_tx();
@@ -510,24 +760,18 @@ namespace cbdc {
                 seeded_inputs++;
             }
 
-            auto utxo = m_spend_queue.begin();
-            while((total_amount < amount) && (utxo != m_spend_queue.end())) {
-                ret.m_inputs.push_back(*utxo);
-                ret.m_witness.emplace_back(sig_len, std::byte(0));
-                total_amount += utxo->m_prevout_data.m_value;
-                std::advance(utxo, 1);
-            }
-
             if(total_amount < amount) {
-                m_seed_from -= seeded_inputs;
-                return std::nullopt;
-            }
-
-            for(size_t i = seeded_inputs; i < ret.m_inputs.size(); i++) {
-                const auto del_utxo = m_spend_queue.begin();
-                m_balance -= del_utxo->m_prevout_data.m_value;
-                m_utxos_set.erase(*del_utxo);
-                m_spend_queue.pop_front();
+                auto utxos
+                    = m_utxos.select(amount - total_amount, strategy);
+                if(!utxos.has_value()) {
+                    m_seed_from -= seeded_inputs;
+                    return std::nullopt;
+                }
+                for(auto& utxo : utxos.value()) {
+                    ret.m_witness.emplace_back(sig_len, std::byte(0));
+                    total_amount += utxo.m_prevout_data.m_value;
+                    ret.m_inputs.push_back(std::move(utxo));
+                }
             }
         }
         return {{ret, total_amount}};
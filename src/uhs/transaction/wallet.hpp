@@ -7,19 +7,18 @@
 #define OPENCBDC_TX_SRC_TRANSACTION_WALLET_H_
 
 #include "uhs/transaction/transaction.hpp"
+#include "uhs/transaction/utxo_store.hpp"
 #include "util/common/config.hpp"
 #include "util/common/hashmap.hpp"
 #include "util/common/random_source.hpp"
 
 #include <atomic>
 #include <fstream>
-#include <list>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <random>
 #include <secp256k1.h>
-#include <set>
 #include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
@@ -28,7 +27,14 @@ namespace cbdc::transaction {
     /// \brief Cryptographic wallet for digital currency assets and secrets.
     ///
     /// Stores unspent transaction outputs (UTXOs), and public/private key
-    /// pairs for Pay-to-Public-Key transaction attestations.
+    /// pairs for Pay-to-Public-Key transaction attestations. UTXOs are kept
+    /// in a \ref utxo_store, so coin selection does not scan the wallet.
+    ///
+    /// The wallet file is a snapshot of the keys and UTXOs followed by a
+    /// journal of the keys, UTXOs and spends added since the snapshot.
+    /// Saving to the file which was last saved or loaded appends to the
+    /// journal, and only rewrites the snapshot once the journal grows
+    /// longer than the snapshot would be.
     class wallet {
       public:
         /// \brief Constructor.
@@ -56,9 +62,13 @@ namespace cbdc::transaction {
         /// \param amount the amount to send in the base unit of the currency.
         /// \param payee the destination address of the transfer.
         /// \param sign_tx true if the wallet should sign this transaction.
+        /// \param strategy how to choose the UTXOs to spend.
         /// \return the completed transaction.
         /// \see \ref export_send_inputs
-        auto send_to(uint32_t amount, const pubkey_t& payee, bool sign_tx)
+        auto send_to(uint32_t amount,
+                     const pubkey_t& payee,
+                     bool sign_tx,
+                     coin_selection strategy = coin_selection::oldest_first)
             -> std::optional<full_tx>;
 
         /// \brief Generates a new send transaction with the specified number
@@ -68,7 +78,7 @@ namespace cbdc::transaction {
         /// method cannot use the specified number of inputs to create the
         /// specified number of outputs. Likewise, the method will return an
         /// empty optional if the wallet contains fewer UTXOs than the
-        /// specified input count.
+        /// specified input count. Spends the oldest UTXOs first.
         /// \param input_count number of inputs to include in the Tx.
         ///                    Must be >0.
         /// \param output_count number of outputs to include in the Tx.
@@ -81,6 +91,28 @@ namespace cbdc::transaction {
                      const pubkey_t& payee,
                      bool sign_tx) -> std::optional<full_tx>;
 
+        /// \brief Generates transactions in parallel, each with the specified
+        ///        number of inputs and outputs.
+        ///
+        /// Reserves the inputs of every transaction up front, oldest first,
+        /// then builds and signs the transactions on the given number of
+        /// threads, each with its own share of the reserved inputs and its
+        /// own signing context. Outputs pay new keys of this wallet, as
+        /// load generators do. Stops early if a transaction cannot be
+        /// created, as in \ref send_to.
+        /// \param tx_count number of transactions to generate.
+        /// \param input_count number of inputs per transaction. Must be >0.
+        /// \param output_count number of outputs per transaction.
+        ///                     Must be >0.
+        /// \param sign_tx true if the transactions should be signed.
+        /// \param n_threads number of threads to use. Must be >0.
+        /// \return the completed transactions.
+        auto generate_transactions(size_t tx_count,
+                                   size_t input_count,
+                                   size_t output_count,
+                                   bool sign_tx,
+                                   size_t n_threads) -> std::vector<full_tx>;
+
         /// \brief Generates a transaction sending multiple outputs of a set
         ///        value.
         ///
@@ -93,12 +125,15 @@ namespace cbdc::transaction {
         ///              currency.
         /// \param payee the destination address of the transfer.
         /// \param sign_tx true if the wallet should sign this transaction.
+        /// \param strategy how to choose the UTXOs to spend.
         /// \return the completed transaction.
         /// \see \ref export_send_inputs
         auto fan(size_t output_count,
                  uint32_t value,
                  const pubkey_t& payee,
-                 bool sign_tx) -> std::optional<transaction::full_tx>;
+                 bool sign_tx,
+                 coin_selection strategy = coin_selection::oldest_first)
+            -> std::optional<transaction::full_tx>;
 
         /// \brief Extracts the transaction data that recipients need from
         ///        senders to confirm pending transfers.
@@ -185,12 +220,15 @@ namespace cbdc::transaction {
         /// \return number of UTXOs.
         auto count() const -> size_t;
 
-        /// Save the state of the wallet to a binary data file.
+        /// Save the state of the wallet to a binary data file. Appends the
+        /// changes since the last save if the file is the one last saved to
+        /// or loaded from, otherwise writes a new snapshot.
         /// \param wallet_file path to wallet file location.
-        void save(const std::string& wallet_file) const;
+        void save(const std::string& wallet_file);
 
         /// Overwrites the current state of the wallet with data loaded from a
-        /// file saved via the Wallet::save function.
+        /// file saved via the Wallet::save function. Drops any partially
+        /// written journal record at the end of the file.
         /// \param wallet_file path to wallet file location.
         void load(const std::string& wallet_file);
 
@@ -212,26 +250,15 @@ namespace cbdc::transaction {
         void confirm_inputs(const std::vector<input>& credits);
 
       private:
-        struct cmp_input {
-            auto operator()(const input& lhs, const input& rhs) const -> bool {
-                // First sort by tx hash then output index
-                return std::tie(lhs.m_prevout.m_tx_id, lhs.m_prevout.m_index)
-                     < std::tie(rhs.m_prevout.m_tx_id, rhs.m_prevout.m_index);
-            }
-        };
-
-        /// Locks access to m_utxos and m_balance (the sum of the UTXOs).
+        /// Locks access to m_utxos.
         /// \warning Do not lock simultaneously with m_keys_mut.
         mutable std::shared_mutex m_utxos_mut;
-        uint64_t m_balance{0};
         /// Stores the current set of spendable inputs.
-        std::set<input, cmp_input> m_utxos_set;
+        utxo_store m_utxos;
         size_t m_seed_from{0};
         size_t m_seed_to{0};
         uint32_t m_seed_value{0};
         hash_t m_seed_witness_commitment{0};
-        /// Queue of spendable inputs, oldest first.
-        std::list<input> m_spend_queue;
 
         /// Locks access to m_keys and related members m_pubkeys and
         /// m_witness_programs.
@@ -249,6 +276,41 @@ namespace cbdc::transaction {
         std::unordered_map<hash_t, pubkey_t, hashing::const_sip_hash<hash_t>>
             m_witness_programs;
 
+        /// Type of a record in the wallet file journal.
+        enum class journal_op : uint8_t {
+            add_key,
+            add_utxo,
+            remove_utxo
+        };
+
+        /// Minimum number of journal records before the snapshot is
+        /// rewritten.
+        static constexpr size_t min_journal_records = 1024;
+
+        /// Locks access to the journal state below. Acquire before
+        /// m_keys_mut or m_utxos_mut.
+        std::mutex m_journal_mut;
+        /// Wallet file to which the journal is appended.
+        std::string m_journal_file;
+        /// Number of records in the journal of m_journal_file.
+        size_t m_journal_records{0};
+        /// Number of keys in m_pubkeys which are in m_journal_file.
+        size_t m_saved_keys{0};
+
+        /// Writes a snapshot of the wallet to the given file, replacing the
+        /// file atomically, and starts a new journal.
+        void write_snapshot(const std::string& wallet_file);
+
+        /// Appends the keys and UTXO changes since the last save to the
+        /// journal.
+        /// \return false if the UTXO changes were not all tracked, in
+        ///         which case nothing is appended and a new snapshot is
+        ///         required.
+        auto append_journal() -> bool;
+
+        /// Returns true if the journal is longer than a new snapshot.
+        auto journal_full() const -> bool;
+
         /// Creates a new input from the seed set based on the parameters
         /// passed in a preceding call to the \ref seed function.
         /// \param seed_idx the index in the seed set to generate the input
@@ -265,6 +327,46 @@ namespace cbdc::transaction {
         static const inline auto m_random_source
             = std::make_unique<random_source>(config::random_source);
 
+        using secp_context_t
+            = std::unique_ptr<secp256k1_context,
+                              decltype(&secp256k1_context_destroy)>;
+
+        /// Serializes calls to \ref generate_transactions.
+        std::mutex m_factory_mut;
+        /// Randomized signing contexts, one per \ref generate_transactions
+        /// thread, kept across calls so their precomputed tables are built
+        /// once.
+        std::vector<secp_context_t> m_signing_ctxs;
+
+        /// Signs the transaction's inputs using the given context.
+        void sign(full_tx& tx, const secp256k1_context* ctx) const;
+
+        /// Generates a new key, or reuses an existing one, as in \ref
+        /// generate_key, using the given context and key shuffle engine.
+        auto generate_key(secp256k1_context* ctx,
+                          std::default_random_engine& shuffle) -> pubkey_t;
+
+        /// Inputs reserved for a transaction, seeded inputs first.
+        struct reservation {
+            std::vector<input> m_inputs;
+            size_t m_seeded_inputs{0};
+        };
+
+        /// Removes the given number of inputs from the wallet, seeded
+        /// inputs first, then the oldest UTXOs. Requires m_utxos_mut.
+        /// \return the reserved inputs, or std::nullopt if the wallet has
+        ///         too few inputs, or if they are worth less than the
+        ///         number of outputs.
+        auto reserve_inputs(size_t input_count, size_t output_count)
+            -> std::optional<reservation>;
+
+        /// Builds a transaction spending the given inputs into the given
+        /// number of outputs of equal value paid to the given key.
+        static auto make_transaction(std::vector<input> inputs,
+                                     size_t seeded_inputs,
+                                     size_t output_count,
+                                     const pubkey_t& payee) -> full_tx;
+
         /// Given a set of credit inputs and a set of debits, add and remove
         /// respective the UTXOs and update the wallet's balance.
         /// \param credits the inputs to add to the wallet's set of UTXOs.
@@ -272,7 +374,7 @@ namespace cbdc::transaction {
         void update_balance(const std::vector<input>& credits,
                             const std::vector<input>& debits);
 
-        auto accumulate_inputs(uint64_t amount)
+        auto accumulate_inputs(uint64_t amount, coin_selection strategy)
             -> std::optional<std::pair<full_tx, uint64_t>>;
     };
 }
@@ -94,7 +94,9 @@ namespace cbdc::coordinator {
             [&](auto&& res, auto&& err) {
                 return raft_callback(std::forward<decltype(res)>(res),
                                      std::forward<decltype(err)>(err));
-            });
+            },
+            m_opts.m_raft_segmented_log,
+            m_opts.m_raft_log_sync);
 
         // Thread to handle starting and stopping the message handler and dtx
         // batch processing threads when triggered by the raft callback
@@ -87,7 +87,9 @@ namespace cbdc::locking_shard {
             [&](auto&& res, auto&& err) {
                 return raft_callback(std::forward<decltype(res)>(res),
                                      std::forward<decltype(err)>(err));
-            });
+            },
+            m_opts.m_raft_segmented_log,
+            m_opts.m_raft_log_sync);
 
         if(!m_raft_serv->init(params)) {
             m_logger->error("Failed to initialize raft server");
@@ -90,7 +90,8 @@ namespace cbdc::sentinel_2pc {
 
         m_rpc_server = std::make_unique<decltype(m_rpc_server)::element_type>(
             this,
-            std::move(rpc_server));
+            std::move(rpc_server),
+            m_opts.m_sentinel_max_batch_size);
 
         return true;
     }
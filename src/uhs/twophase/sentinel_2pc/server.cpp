@@ -8,9 +8,11 @@
 namespace cbdc::sentinel::rpc {
     async_server::async_server(
         async_interface* impl,
-        std::unique_ptr<cbdc::rpc::async_server<request, response>> srv)
+        std::unique_ptr<cbdc::rpc::async_server<request, response>> srv,
+        size_t max_batch_size)
         : m_impl(impl),
-          m_srv(std::move(srv)) {
+          m_srv(std::move(srv)),
+          m_max_batch_size(max_batch_size) {
         m_srv->register_handler_callback(
             [&](const request& req,
                 async_interface::result_callback_type callback) {
@@ -24,6 +26,14 @@ namespace cbdc::sentinel::rpc {
                                    return m_impl->validate_transaction(
                                        std::move(v_req),
                                        callback);
+                               },
+                               [&](execute_batch_request b_req) {
+                                   if(b_req.m_txs.size() > m_max_batch_size) {
+                                       return false;
+                                   }
+                                   return m_impl->execute_transactions(
+                                       std::move(b_req.m_txs),
+                                       callback);
                                }},
                     req);
                 return res;
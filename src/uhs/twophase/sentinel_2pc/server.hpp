@@ -19,15 +19,20 @@ namespace cbdc::sentinel::rpc {
         /// server using a request handler callback.
         /// \param impl pointer to a sentinel implementation.
         /// \param srv pointer to a asynchronous RPC server.
+        /// \param max_batch_size maximum number of transactions in a batch
+        ///                       execution request. Larger requests are
+        ///                       rejected with an error response.
         async_server(
             async_interface* impl, // TODO: convert sentinel_2pc::controller to
                                    //      contain a shared_ptr to an
                                    //      implementation
-            std::unique_ptr<cbdc::rpc::async_server<request, response>> srv);
+            std::unique_ptr<cbdc::rpc::async_server<request, response>> srv,
+            size_t max_batch_size);
 
       private:
         async_interface* m_impl;
         std::unique_ptr<cbdc::rpc::async_server<request, response>> m_srv;
+        size_t m_max_batch_size;
     };
 }
 
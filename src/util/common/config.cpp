@@ -411,6 +411,9 @@ namespace cbdc::config {
         opts.m_attestation_threshold
             = cfg.get_ulong(attestation_threshold_key)
                   .value_or(opts.m_attestation_threshold);
+        opts.m_sentinel_max_batch_size
+            = cfg.get_ulong(sentinel_max_batch_size_key)
+                  .value_or(opts.m_sentinel_max_batch_size);
 
         const auto sentinel_count
             = cfg.get_ulong(sentinel_count_key).value_or(0);
@@ -492,6 +495,9 @@ namespace cbdc::config {
         opts.m_stxo_cache_depth
             = cfg.get_ulong(stxo_cache_key).value_or(opts.m_stxo_cache_depth);
 
+        opts.m_compact_blocks
+            = cfg.get_ulong(compact_blocks_key).value_or(0) != 0;
+
         return std::nullopt;
     }
 
@@ -569,6 +575,12 @@ namespace cbdc::config {
         opts.m_watchtower_error_cache_size
             = cfg.get_ulong(watchtower_error_cache_size_key)
                   .value_or(opts.m_watchtower_error_cache_size);
+        opts.m_watchtower_query_threads
+            = cfg.get_ulong(watchtower_query_threads_key)
+                  .value_or(opts.m_watchtower_query_threads);
+        opts.m_watchtower_max_subscriptions
+            = cfg.get_ulong(watchtower_max_subscriptions_key)
+                  .value_or(opts.m_watchtower_max_subscriptions);
 
         return std::nullopt;
     }
@@ -588,6 +600,10 @@ namespace cbdc::config {
         opts.m_raft_max_batch
             = static_cast<int32_t>(cfg.get_ulong(raft_batch_size_key)
                                        .value_or(opts.m_raft_max_batch));
+        opts.m_raft_segmented_log
+            = cfg.get_ulong(raft_segmented_log_key).value_or(0) != 0;
+        opts.m_raft_log_sync
+            = cfg.get_ulong(raft_log_sync_key).value_or(0) != 0;
 
         opts.m_batch_size
             = cfg.get_ulong(batch_size_key).value_or(opts.m_batch_size);
@@ -606,6 +622,9 @@ namespace cbdc::config {
             = opts.m_input_count != 0 && opts.m_output_count != 0;
         opts.m_window_size
             = cfg.get_ulong(window_size_key).value_or(opts.m_window_size);
+        opts.m_client_send_window
+            = cfg.get_ulong(client_send_window_key)
+                  .value_or(opts.m_client_send_window);
 
         opts.m_initial_mint_count = cfg.get_ulong(initial_mint_count_key)
                                         .value_or(opts.m_initial_mint_count);
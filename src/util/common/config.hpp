@@ -47,6 +47,8 @@ namespace cbdc::config {
     namespace defaults {
         static constexpr size_t stxo_cache_depth{1};
         static constexpr size_t window_size{10000};
+        static constexpr size_t client_send_window{64};
+        static constexpr size_t sentinel_max_batch_size{1000};
         static constexpr size_t shard_completed_txs_cache_size{10000000};
         static constexpr size_t batch_size{2000};
         static constexpr size_t target_block_interval{250};
@@ -59,6 +61,8 @@ namespace cbdc::config {
         static constexpr size_t initial_mint_value{100};
         static constexpr size_t watchtower_block_cache_size{100};
         static constexpr size_t watchtower_error_cache_size{1000000};
+        static constexpr size_t watchtower_query_threads{4};
+        static constexpr size_t watchtower_max_subscriptions{1000};
         static constexpr size_t input_count{2};
         static constexpr size_t output_count{2};
         static constexpr double fixed_tx_rate{1.0};
@@ -79,6 +83,8 @@ namespace cbdc::config {
     static constexpr auto seed_to = "seed_to";
     static constexpr auto atomizer_prefix = "atomizer";
     static constexpr auto sentinel_count_key = "sentinel_count";
+    static constexpr auto sentinel_max_batch_size_key
+        = "sentinel_max_batch_size";
     static constexpr auto sentinel_prefix = "sentinel";
     static constexpr auto config_separator = "_";
     static constexpr auto db_postfix = "db";
@@ -88,6 +94,7 @@ namespace cbdc::config {
     static constexpr auto archiver_prefix = "archiver";
     static constexpr auto batch_size_key = "batch_size";
     static constexpr auto window_size_key = "window_size";
+    static constexpr auto client_send_window_key = "client_send_window";
     static constexpr auto target_block_interval_key = "target_block_interval";
     static constexpr auto election_timeout_upper_key
         = "election_timeout_upper";
@@ -96,6 +103,8 @@ namespace cbdc::config {
     static constexpr auto heartbeat_key = "heartbeat";
     static constexpr auto snapshot_distance_key = "snapshot_distance";
     static constexpr auto raft_batch_size_key = "raft_max_batch";
+    static constexpr auto raft_segmented_log_key = "raft_segmented_log";
+    static constexpr auto raft_log_sync_key = "raft_log_sync";
     static constexpr auto input_count_key = "loadgen_sendtx_input_count";
     static constexpr auto output_count_key = "loadgen_sendtx_output_count";
     static constexpr auto invalid_rate_key = "loadgen_invalid_tx_rate";
@@ -109,6 +118,10 @@ namespace cbdc::config {
         = "watchtower_block_cache_size";
     static constexpr auto watchtower_error_cache_size_key
         = "watchtower_error_cache_size";
+    static constexpr auto watchtower_query_threads_key
+        = "watchtower_query_threads";
+    static constexpr auto watchtower_max_subscriptions_key
+        = "watchtower_max_subscriptions";
     static constexpr auto two_phase_mode = "2pc";
     static constexpr auto count_postfix = "count";
     static constexpr auto readonly = "readonly";
@@ -124,6 +137,7 @@ namespace cbdc::config {
     static constexpr auto private_key_postfix = "private_key";
     static constexpr auto public_key_postfix = "public_key";
     static constexpr auto attestation_threshold_key = "attestation_threshold";
+    static constexpr auto compact_blocks_key = "compact_blocks";
 
     /// [start, end] inclusive.
     using shard_range_t = std::pair<uint8_t, uint8_t>;
@@ -134,6 +148,9 @@ namespace cbdc::config {
         size_t m_stxo_cache_depth{defaults::stxo_cache_depth};
         /// Maximum number of unconfirmed transactions in atomizer-cli.
         size_t m_window_size{defaults::window_size};
+        /// Maximum number of transactions a client sends asynchronously to
+        /// sentinels before waiting for responses.
+        size_t m_client_send_window{defaults::client_send_window};
         /// Number of inputs in fixed-size transactions from atomizer-cli.
         size_t m_input_count{defaults::input_count};
         /// Number of outputs in fixed-size transactions from atomizer-cli.
@@ -154,6 +171,9 @@ namespace cbdc::config {
         std::vector<network::endpoint_t> m_archiver_endpoints;
         /// List of sentinel endpoints, ordered by sentinel ID.
         std::vector<network::endpoint_t> m_sentinel_endpoints;
+        /// Maximum number of transactions in a batch execution request
+        /// accepted by sentinels.
+        size_t m_sentinel_max_batch_size{defaults::sentinel_max_batch_size};
         /// List of watchtower client endpoints, ordered by watchtower ID.
         std::vector<network::endpoint_t> m_watchtower_client_endpoints;
         /// List of watchtower internal endpoints, ordered by watchtower ID
@@ -181,6 +201,12 @@ namespace cbdc::config {
         int32_t m_snapshot_distance{0};
         /// Maximum number of raft log entries to batch into one RPC message.
         int32_t m_raft_max_batch{defaults::raft_max_batch};
+        /// Flag set if raft nodes should store their logs in append-only
+        /// segment files instead of LevelDB.
+        bool m_raft_segmented_log{false};
+        /// Flag set if raft log writes should be synced to disk before
+        /// they are acknowledged.
+        bool m_raft_log_sync{false};
         /// List of shard log levels by shard ID.
         std::vector<logging::log_level> m_shard_loglevels;
         /// List of shard DB paths by shard ID.
@@ -246,6 +272,13 @@ namespace cbdc::config {
         /// (0=unlimited).
         size_t m_watchtower_error_cache_size{
             defaults::watchtower_error_cache_size};
+        /// Number of worker threads each watchtower uses to process large
+        /// status update requests, in addition to its request thread.
+        size_t m_watchtower_query_threads{defaults::watchtower_query_threads};
+        /// Maximum number of transactions each watchtower client may be
+        /// subscribed to at once.
+        size_t m_watchtower_max_subscriptions{
+            defaults::watchtower_max_subscriptions};
 
         /// Number of load generators over which to split pre-seeded UTXOs.
         size_t m_loadgen_count{0};
@@ -258,6 +291,10 @@ namespace cbdc::config {
 
         /// Number of sentinel attestations needed for a compact transaction.
         size_t m_attestation_threshold{defaults::attestation_threshold};
+        /// Flag set if the atomizer should broadcast, and archivers store,
+        /// blocks with sentinel public keys deduplicated into a per-block
+        /// table rather than in the plain block encoding.
+        bool m_compact_blocks{false};
     };
 
     /// Read options from the given config file without checking invariants.
@@ -0,0 +1,117 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_LEFT_RIGHT_H_
+#define OPENCBDC_TX_SRC_COMMON_LEFT_RIGHT_H_
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+namespace cbdc {
+    /// \brief Object with reads that never wait for writers.
+    ///
+    /// Keeps two copies of the object. Readers use the copy which is
+    /// currently published, while a writer modifies the other copy, then
+    /// atomically publishes it. Once the readers of the previously
+    /// published copy have finished, the writer applies the same
+    /// modification to that copy. Readers never take a lock and never wait
+    /// for a writer; writers wait for readers of the copy they are about to
+    /// modify, and for other writers.
+    /// \tparam T type of the object.
+    template<typename T>
+    class left_right {
+      public:
+        /// Constructor. Constructs both copies of the object from the given
+        /// arguments.
+        /// \param args arguments to pass to each copy's constructor.
+        template<typename... Args>
+        explicit left_right(const Args&... args)
+            : m_instances{T(args...), T(args...)} {}
+
+        left_right(const left_right&) = delete;
+        auto operator=(const left_right&) -> left_right& = delete;
+
+        left_right(left_right&&) = delete;
+        auto operator=(left_right&&) -> left_right& = delete;
+
+        ~left_right() = default;
+
+        /// Calls the given function with the published copy of the object.
+        /// The copy will not be modified until the function returns.
+        /// \param f function to call with a const reference to the object.
+        /// \return the return value of f.
+        template<typename F>
+        auto read(F&& f) const -> std::invoke_result_t<F, const T&> {
+            const auto idx = enter();
+            auto guard = read_guard{m_readers[idx]};
+            return std::invoke(std::forward<F>(f), m_instances[idx]);
+        }
+
+        /// Applies a modification to both copies of the object. The
+        /// function is called once for each copy, in turn, and must make
+        /// the same modification each time. Readers observe the
+        /// modification atomically.
+        /// \param f function to call with a reference to each copy.
+        template<typename F>
+        void write(F&& f) {
+            std::unique_lock<std::mutex> l(m_write_mut);
+            const auto published = m_published.load();
+            const auto unpublished = published ^ 1U;
+
+            f(m_instances[unpublished]);
+            m_published.store(unpublished);
+
+            while(m_readers[published].load() != 0) {
+                std::this_thread::yield();
+            }
+            f(m_instances[published]);
+        }
+
+      private:
+        /// Decrements a reader count on destruction.
+        class read_guard {
+          public:
+            explicit read_guard(std::atomic<size_t>& count)
+                : m_count(count) {}
+            ~read_guard() {
+                m_count.fetch_sub(1);
+            }
+
+            read_guard(const read_guard&) = delete;
+            auto operator=(const read_guard&) -> read_guard& = delete;
+            read_guard(read_guard&&) = delete;
+            auto operator=(read_guard&&) -> read_guard& = delete;
+
+          private:
+            std::atomic<size_t>& m_count;
+        };
+
+        std::array<T, 2> m_instances;
+        std::atomic<size_t> m_published{0};
+        mutable std::array<std::atomic<size_t>, 2> m_readers{};
+        std::mutex m_write_mut;
+
+        /// Registers a reader of the published copy.
+        /// \return index of the published copy.
+        auto enter() const -> size_t {
+            while(true) {
+                const auto idx = m_published.load();
+                m_readers[idx].fetch_add(1);
+                // If a writer published the other copy in the meantime, it
+                // may not have seen our registration, so try again.
+                if(m_published.load() == idx) {
+                    return idx;
+                }
+                m_readers[idx].fetch_sub(1);
+            }
+        }
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_COMMON_LEFT_RIGHT_H_
@@ -0,0 +1,43 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "log_entry_cache.hpp"
+
+#include <cassert>
+
+namespace cbdc::raft {
+    log_entry_cache::log_entry_cache(size_t capacity) : m_slots(capacity) {
+        assert(capacity > 0);
+    }
+
+    void log_entry_cache::put(uint64_t index,
+                              nuraft::ptr<nuraft::log_entry> entry) {
+        auto& slot = m_slots[index % m_slots.size()];
+        slot.first = index;
+        slot.second = std::move(entry);
+    }
+
+    auto log_entry_cache::get(uint64_t index) const
+        -> nuraft::ptr<nuraft::log_entry> {
+        const auto& slot = m_slots[index % m_slots.size()];
+        if(slot.first != index) {
+            return nullptr;
+        }
+        return slot.second;
+    }
+
+    void log_entry_cache::erase(uint64_t index) {
+        auto& slot = m_slots[index % m_slots.size()];
+        if(slot.first == index) {
+            slot = {};
+        }
+    }
+
+    void log_entry_cache::clear() {
+        for(auto& slot : m_slots) {
+            slot = {};
+        }
+    }
+}
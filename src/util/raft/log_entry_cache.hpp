@@ -0,0 +1,54 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_RAFT_LOG_ENTRY_CACHE_H_
+#define OPENCBDC_TX_SRC_RAFT_LOG_ENTRY_CACHE_H_
+
+#include <libnuraft/log_entry.hxx>
+#include <vector>
+
+namespace cbdc::raft {
+    /// \brief Fixed-size ring cache of recently written raft log entries.
+    ///
+    /// Each log index maps to a single slot, so writing an entry evicts
+    /// whichever entry previously occupied the slot. The cache does not
+    /// track which indices are still part of the log; callers must only
+    /// look up indices within the current log bounds.
+    ///
+    /// \warning Not thread-safe. Callers must provide their own
+    ///          synchronization.
+    class log_entry_cache {
+      public:
+        /// Constructor.
+        /// \param capacity number of entries to cache. Must be positive.
+        explicit log_entry_cache(size_t capacity);
+
+        /// Stores the given entry, replacing the entry previously cached
+        /// in its slot.
+        /// \param index log index of the entry.
+        /// \param entry log entry to cache.
+        void put(uint64_t index, nuraft::ptr<nuraft::log_entry> entry);
+
+        /// Returns the cached entry at the given index. The entry is shared
+        /// with the cache and must not be modified.
+        /// \param index log index of the entry.
+        /// \return cached log entry, or nullptr if the index is not cached.
+        [[nodiscard]] auto get(uint64_t index) const
+            -> nuraft::ptr<nuraft::log_entry>;
+
+        /// Removes the entry at the given index from the cache, if cached.
+        /// \param index log index of the entry.
+        void erase(uint64_t index);
+
+        /// Removes all entries from the cache.
+        void clear();
+
+      private:
+        std::vector<std::pair<uint64_t, nuraft::ptr<nuraft::log_entry>>>
+            m_slots;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_RAFT_LOG_ENTRY_CACHE_H_
@@ -0,0 +1,72 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "log_entry_format.hpp"
+
+#include <cstring>
+
+namespace cbdc::raft {
+    namespace {
+        constexpr size_t bits_per_byte = 8;
+    }
+
+    auto serialized_entry_size(const nuraft::log_entry& entry) -> size_t {
+        auto ret = log_entry_header_size;
+        if(!entry.is_buf_null()) {
+            ret += entry.get_buf().size();
+        }
+        return ret;
+    }
+
+    void serialize_entry(const nuraft::log_entry& entry, void* out) {
+        // NuRaft writes the term in little-endian order, followed by the
+        // value type and the entry data.
+        auto* bytes = static_cast<unsigned char*>(out);
+        const auto term = entry.get_term();
+        for(size_t i{0}; i < sizeof(term); i++) {
+            const auto shift = i * bits_per_byte;
+            bytes[i] = static_cast<unsigned char>(term >> shift);
+        }
+        bytes[sizeof(term)]
+            = static_cast<unsigned char>(entry.get_val_type());
+        if(!entry.is_buf_null()) {
+            const auto& buf = entry.get_buf();
+            std::memcpy(bytes + log_entry_header_size,
+                        buf.data_begin(),
+                        buf.size());
+        }
+    }
+
+    auto deserialize_entry(const void* data, size_t len)
+        -> nuraft::ptr<nuraft::log_entry> {
+        if(len < log_entry_header_size) {
+            return nullptr;
+        }
+
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        uint64_t term{};
+        for(size_t i{0}; i < sizeof(term); i++) {
+            term |= static_cast<uint64_t>(bytes[i]) << (i * bits_per_byte);
+        }
+        const auto val_type
+            = static_cast<nuraft::log_val_type>(bytes[sizeof(term)]);
+
+        auto buf = nuraft::buffer::alloc(len - log_entry_header_size);
+        std::memcpy(buf->data_begin(),
+                    bytes + log_entry_header_size,
+                    buf->size());
+        return nuraft::cs_new<nuraft::log_entry>(term, buf, val_type);
+    }
+
+    auto clone_entry(const nuraft::log_entry& entry)
+        -> nuraft::ptr<nuraft::log_entry> {
+        auto buf = entry.is_buf_null()
+                     ? nullptr
+                     : nuraft::buffer::clone(entry.get_buf());
+        return nuraft::cs_new<nuraft::log_entry>(entry.get_term(),
+                                                 buf,
+                                                 entry.get_val_type());
+    }
+}
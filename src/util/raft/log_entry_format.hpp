@@ -0,0 +1,46 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_RAFT_LOG_ENTRY_FORMAT_H_
+#define OPENCBDC_TX_SRC_RAFT_LOG_ENTRY_FORMAT_H_
+
+#include <libnuraft/log_entry.hxx>
+
+namespace cbdc::raft {
+    /// Size of the term and value type which precede the data in a
+    /// serialized log entry.
+    static constexpr size_t log_entry_header_size
+        = sizeof(uint64_t) + sizeof(uint8_t);
+
+    /// Returns the size of the given log entry when serialized.
+    /// \param entry log entry.
+    /// \return serialized size in bytes.
+    auto serialized_entry_size(const nuraft::log_entry& entry) -> size_t;
+
+    /// Serializes a log entry directly into the given memory, producing
+    /// the same bytes as nuraft::log_entry::serialize without allocating an
+    /// intermediate buffer.
+    /// \param entry log entry to serialize.
+    /// \param out destination, at least serialized_entry_size(entry) bytes.
+    void serialize_entry(const nuraft::log_entry& entry, void* out);
+
+    /// Deserializes a log entry from its stored form with a single copy
+    /// of the entry data.
+    /// \param data serialized log entry.
+    /// \param len size of the serialized log entry in bytes.
+    /// \return log entry, or nullptr if the data is too short to contain a
+    ///         log entry.
+    auto deserialize_entry(const void* data, size_t len)
+        -> nuraft::ptr<nuraft::log_entry>;
+
+    /// Copies a log entry and its buffer, so that callers may modify the
+    /// copy without affecting a cached entry.
+    /// \param entry log entry to copy.
+    /// \return copied log entry.
+    auto clone_entry(const nuraft::log_entry& entry)
+        -> nuraft::ptr<nuraft::log_entry>;
+}
+
+#endif // OPENCBDC_TX_SRC_RAFT_LOG_ENTRY_FORMAT_H_
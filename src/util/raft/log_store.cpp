@@ -5,6 +5,9 @@
 
 #include "log_store.hpp"
 
+#include "log_entry_format.hpp"
+
+#include <algorithm>
 #include <array>
 #include <cstring>
 #include <leveldb/write_batch.h>
@@ -37,8 +40,10 @@ namespace cbdc::raft {
         return ret;
     }
 
-    auto log_store::load(const std::string& db_dir) -> bool {
-        m_write_opt.sync = false;
+    log_store::log_store(size_t cache_size) : m_cache(cache_size) {}
+
+    auto log_store::load(const std::string& db_dir, bool sync) -> bool {
+        m_write_opt.sync = sync;
 
         leveldb::Options opt;
         opt.create_if_missing = true;
@@ -58,6 +63,7 @@ namespace cbdc::raft {
                 = get_first_or_last_index<false>(m_db.get(), m_read_opt) + 1;
             m_start_idx
                 = get_first_or_last_index<true>(m_db.get(), m_read_opt);
+            m_cache.clear();
         }
 
         return true;
@@ -75,9 +81,7 @@ namespace cbdc::raft {
 
     auto log_entry_from_slice(const leveldb::Slice& slice)
         -> nuraft::ptr<nuraft::log_entry> {
-        auto buf = nuraft::buffer::alloc(slice.size());
-        std::memcpy(buf->data_begin(), slice.data(), buf->size());
-        auto entry = nuraft::log_entry::deserialize(*buf);
+        auto entry = deserialize_entry(slice.data(), slice.size());
         assert(entry);
         return entry;
     }
@@ -85,7 +89,18 @@ namespace cbdc::raft {
     auto log_store::last_entry() const -> nuraft::ptr<nuraft::log_entry> {
         nuraft::ptr<nuraft::log_entry> last_entry;
         {
-            std::lock_guard<std::mutex> l(m_db_mut);
+            std::unique_lock<std::mutex> l(m_db_mut);
+            if(m_next_idx > m_start_idx) {
+                auto cached = m_cache.get(m_next_idx - 1);
+                if(cached) {
+                    return clone_entry(*cached);
+                }
+            }
+
+            // Entries missing from the cache may still be queued for
+            // writing by another caller.
+            write_pending(l);
+
             auto it = std::unique_ptr<leveldb::Iterator>(
                 m_db->NewIterator(m_read_opt));
 
@@ -114,24 +129,52 @@ namespace cbdc::raft {
     }
 
     auto get_value_slice(nuraft::ptr<nuraft::log_entry>& entry) -> data_slice {
-        const auto buf = entry->serialize();
-        std::vector<char> value_buf(buf->size());
-        std::memcpy(value_buf.data(), buf->data_begin(), value_buf.size());
+        std::vector<char> value_buf(serialized_entry_size(*entry));
+        serialize_entry(*entry, value_buf.data());
         auto slice = leveldb::Slice(value_buf.data(), value_buf.size());
         return std::make_pair(slice, std::move(value_buf));
     }
 
+    void log_store::write_pending(std::unique_lock<std::mutex>& l) const {
+        const auto target_seq = m_pending_seq;
+        while(m_written_seq < target_seq) {
+            if(m_writing) {
+                m_write_cv.wait(l);
+                continue;
+            }
+
+            // Take every mutation queued so far, including those from
+            // callers now waiting on us, and write them as one batch.
+            m_writing = true;
+            auto batch = std::make_unique<leveldb::WriteBatch>();
+            std::swap(batch, m_pending_batch);
+            const auto batch_seq = m_pending_seq;
+
+            l.unlock();
+            const auto status = m_db->Write(m_write_opt, batch.get());
+            assert(status.ok());
+            l.lock();
+
+            m_written_seq = batch_seq;
+            m_writing = false;
+            m_write_cv.notify_all();
+        }
+    }
+
     auto log_store::append(nuraft::ptr<nuraft::log_entry>& entry) -> uint64_t {
         const auto value = get_value_slice(entry);
 
         {
-            std::lock_guard<std::mutex> l(m_db_mut);
-            const auto key = get_key_slice(m_next_idx);
-            const auto status = m_db->Put(m_write_opt, key.first, value.first);
-            assert(status.ok());
-
+            std::unique_lock<std::mutex> l(m_db_mut);
+            const auto idx = m_next_idx;
+            const auto key = get_key_slice(idx);
+            m_pending_batch->Put(key.first, value.first);
+            m_pending_seq++;
+            m_cache.put(idx, entry);
             m_next_idx++;
-            return m_next_idx - 1;
+
+            write_pending(l);
+            return idx;
         }
     }
 
@@ -139,40 +182,80 @@ namespace cbdc::raft {
                              nuraft::ptr<nuraft::log_entry>& entry) {
         const auto key = get_key_slice(index);
         const auto value = get_value_slice(entry);
-        leveldb::WriteBatch batch;
-        batch.Put(key.first, value.first);
 
         {
-            std::lock_guard<std::mutex> l(m_db_mut);
+            std::unique_lock<std::mutex> l(m_db_mut);
 
-            std::vector<data_slice::second_type> data_slices(m_next_idx
-                                                             - index);
             for(uint64_t i = index + 1; i < m_next_idx; i++) {
-                auto del_key = get_key_slice(i);
-                batch.Delete(del_key.first);
-                data_slices[i - index] = std::move(del_key.second);
+                const auto del_key = get_key_slice(i);
+                m_pending_batch->Delete(del_key.first);
             }
+            m_pending_batch->Put(key.first, value.first);
+            m_pending_seq++;
+            m_cache.put(index, entry);
+            m_next_idx = index + 1;
 
-            const auto status = m_db->Write(m_write_opt, &batch);
-            assert(status.ok());
+            write_pending(l);
+        }
+    }
 
-            m_next_idx = index + 1;
+    auto log_store::get_entry(std::unique_lock<std::mutex>& l, uint64_t index)
+        -> nuraft::ptr<nuraft::log_entry> {
+        if(index < m_start_idx || index >= m_next_idx) {
+            return nullptr;
         }
+
+        auto cached = m_cache.get(index);
+        if(cached) {
+            return clone_entry(*cached);
+        }
+
+        write_pending(l);
+
+        const auto key = get_key_slice(index);
+        std::string val;
+        const auto status = m_db->Get(m_read_opt, key.first, &val);
+        if(!status.ok()) {
+            assert(status.IsNotFound());
+            return nullptr;
+        }
+
+        const auto val_slice = leveldb::Slice(val.data(), val.size());
+        return log_entry_from_slice(val_slice);
     }
 
     auto log_store::log_entries(uint64_t start, uint64_t end)
         -> log_entries_t {
-        const auto first_key = get_key_slice(start);
         auto ret = nuraft::cs_new<log_entries_t::element_type>(end - start);
 
         {
-            std::lock_guard<std::mutex> l(m_db_mut);
+            std::unique_lock<std::mutex> l(m_db_mut);
+
+            // Serve the range from the cache until the first miss, then
+            // fall back to a LevelDB iterator for the remainder.
+            size_t i{0};
+            for(; i < ret->size(); i++) {
+                auto cached = m_cache.get(start + i);
+                if(!cached || start + i < m_start_idx
+                   || start + i >= m_next_idx) {
+                    break;
+                }
+                (*ret)[i] = clone_entry(*cached);
+            }
+
+            if(i == ret->size()) {
+                return ret;
+            }
+
+            write_pending(l);
+
+            const auto first_key = get_key_slice(start + i);
             auto it = std::unique_ptr<leveldb::Iterator>(
                 m_db->NewIterator(m_read_opt));
 
             it->Seek(first_key.first);
 
-            for(size_t i{0}; i < ret->size(); [&]() {
+            for(; i < ret->size(); [&]() {
                     it->Next();
                     i++;
                 }()) {
@@ -189,26 +272,26 @@ namespace cbdc::raft {
 
     auto log_store::entry_at(uint64_t index)
         -> nuraft::ptr<nuraft::log_entry> {
-        const auto key = get_key_slice(index);
-        std::string val;
+        std::unique_lock<std::mutex> l(m_db_mut);
+        auto entry = get_entry(l, index);
+        if(!entry) {
+            auto null_entry = nuraft::cs_new<nuraft::log_entry>(0, nullptr);
+            return null_entry;
+        }
+        return entry;
+    }
 
+    auto log_store::term_at(uint64_t index) -> uint64_t {
         {
             std::lock_guard<std::mutex> l(m_db_mut);
-            const auto status = m_db->Get(m_read_opt, key.first, &val);
-            if(!status.ok()) {
-                assert(status.IsNotFound());
-                auto null_entry
-                    = nuraft::cs_new<nuraft::log_entry>(0, nullptr);
-                return null_entry;
+            if(index >= m_start_idx && index < m_next_idx) {
+                auto cached = m_cache.get(index);
+                if(cached) {
+                    return cached->get_term();
+                }
             }
         }
 
-        const auto val_slice = leveldb::Slice(val.data(), val.size());
-        auto ret = log_entry_from_slice(val_slice);
-        return ret;
-    }
-
-    auto log_store::term_at(uint64_t index) -> uint64_t {
         const auto entry = entry_at(index);
         return entry->get_term();
     }
@@ -216,31 +299,43 @@ namespace cbdc::raft {
     auto log_store::pack(uint64_t index, int32_t cnt)
         -> nuraft::ptr<nuraft::buffer> {
         assert(cnt >= 0);
-        const auto entries
-            = log_entries(index, index + static_cast<uint64_t>(cnt));
+        const auto n_entries = static_cast<uint64_t>(cnt);
 
-        std::vector<nuraft::ptr<nuraft::buffer>> bufs(
-            static_cast<size_t>(cnt));
+        std::unique_lock<std::mutex> l(m_db_mut);
+        write_pending(l);
+
+        // Packed entries use the stored serialization, so copy the values
+        // directly. Both passes use the same iterator to read the same
+        // snapshot of the database.
+        const auto first_key = get_key_slice(index);
+        auto it = std::unique_ptr<leveldb::Iterator>(
+            m_db->NewIterator(m_read_opt));
 
-        size_t i{0};
         size_t total_len{0};
-        for(const auto& entry : *entries) {
-            auto buf = entry->serialize();
-            total_len += buf->size();
-            bufs[i] = std::move(buf);
-            i++;
+        it->Seek(first_key.first);
+        for(uint64_t i{0}; i < n_entries; [&]() {
+                it->Next();
+                i++;
+            }()) {
+            assert(it->Valid());
+            total_len += it->value().size();
         }
 
-        auto ret = nuraft::buffer::alloc(
-            sizeof(uint64_t) + static_cast<size_t>(cnt) * sizeof(uint64_t)
-            + total_len);
+        auto ret = nuraft::buffer::alloc(sizeof(uint64_t)
+                                         + n_entries * sizeof(uint64_t)
+                                         + total_len);
         nuraft::buffer_serializer bs(ret);
 
-        bs.put_u64(static_cast<uint64_t>(cnt));
+        bs.put_u64(n_entries);
 
-        for(const auto& buf : bufs) {
-            bs.put_u64(buf->size());
-            bs.put_raw(buf->data_begin(), buf->size());
+        it->Seek(first_key.first);
+        for(uint64_t i{0}; i < n_entries; [&]() {
+                it->Next();
+                i++;
+            }()) {
+            const auto val_slice = it->value();
+            bs.put_u64(val_slice.size());
+            bs.put_raw(val_slice.data(), val_slice.size());
         }
 
         return ret;
@@ -251,61 +346,50 @@ namespace cbdc::raft {
 
         const auto cnt = bs.get_u64();
 
-        std::vector<nuraft::ptr<nuraft::log_entry>> entries(cnt);
-
-        for(size_t i{0}; i < cnt; i++) {
-            const auto len = bs.get_u64();
-            auto buf = nuraft::buffer::alloc(len);
-            bs.get_buffer(buf);
-            auto entry = nuraft::log_entry::deserialize(*buf);
-            assert(entry);
-            entries[i] = std::move(entry);
-        }
-
-        std::vector<data_slice::second_type> data_slices(entries.size() * 2);
-        leveldb::WriteBatch batch;
-        for(size_t i{0}; i < entries.size(); i++) {
-            auto key = get_key_slice(index + i);
-            auto val = get_value_slice(entries[i]);
-            batch.Put(key.first, val.first);
-
-            // Store the backing data or it will get deleted when we go out of
-            // scope
-            data_slices[i * 2] = std::move(key.second);
-            data_slices[(i * 2) + 1] = std::move(val.second);
-        }
-
         {
-            std::lock_guard<std::mutex> l(m_db_mut);
-            const auto status = m_db->Write(m_write_opt, &batch);
-            assert(status.ok());
+            std::unique_lock<std::mutex> l(m_db_mut);
+
+            // Store the packed entries as they are, without deserializing
+            // them. WriteBatch copies the values.
+            for(uint64_t i{0}; i < cnt; i++) {
+                const auto len = bs.get_u64();
+                const auto* data = bs.get_raw(len);
+                const auto key = get_key_slice(index + i);
+                m_pending_batch->Put(
+                    key.first,
+                    leveldb::Slice(static_cast<const char*>(data), len));
+                m_cache.erase(index + i);
+            }
+            m_pending_seq++;
+
+            // The stored range becomes the union of the existing range and
+            // the packed entries.
+            if(m_next_idx <= m_start_idx) {
+                m_start_idx = index;
+                m_next_idx = index + cnt;
+            } else {
+                m_start_idx = std::min(m_start_idx, index);
+                m_next_idx = std::max(m_next_idx, index + cnt);
+            }
 
-            m_start_idx
-                = get_first_or_last_index<true>(m_db.get(), m_read_opt);
-            m_next_idx
-                = get_first_or_last_index<false>(m_db.get(), m_read_opt) + 1;
+            write_pending(l);
         }
     }
 
     auto log_store::compact(uint64_t last_log_index) -> bool {
-        leveldb::WriteBatch batch;
-
         {
-            std::lock_guard<std::mutex> l(m_db_mut);
+            std::unique_lock<std::mutex> l(m_db_mut);
 
-            const auto n_elems = last_log_index - m_start_idx + 1;
-            std::vector<data_slice::second_type> data_slices(n_elems);
             for(uint64_t i{m_start_idx}; i <= last_log_index; i++) {
-                auto key = get_key_slice(i);
-                batch.Delete(key.first);
-                data_slices[i - m_start_idx] = std::move(key.second);
+                const auto key = get_key_slice(i);
+                m_pending_batch->Delete(key.first);
             }
-
-            const auto status = m_db->Write(m_write_opt, &batch);
-            assert(status.ok());
+            m_pending_seq++;
 
             m_start_idx = last_log_index + 1;
             m_next_idx = std::max(m_next_idx, m_start_idx);
+
+            write_pending(l);
         }
 
         return true;
@@ -7,16 +7,31 @@
 #define OPENCBDC_TX_SRC_RAFT_LOG_STORE_H_
 
 #include "index_comparator.hpp"
+#include "log_entry_cache.hpp"
 
+#include <condition_variable>
 #include <leveldb/db.h>
+#include <leveldb/write_batch.h>
 #include <libnuraft/log_store.hxx>
 #include <mutex>
 
 namespace cbdc::raft {
-    /// NuRaft log_store implementation using LevelDB.
+    /// \brief NuRaft log_store implementation using LevelDB.
+    ///
+    /// Writes use group commit: mutations from concurrent callers are
+    /// queued and written to LevelDB together in one WriteBatch by
+    /// whichever caller finds no write in progress. Each call returns once
+    /// its own mutation has been written. Recently written entries are kept
+    /// in a \ref log_entry_cache so reads near the end of the log do not
+    /// touch LevelDB.
     class log_store : public nuraft::log_store {
       public:
-        log_store() = default;
+        /// Number of recent log entries kept in memory by default.
+        static constexpr size_t default_cache_size = 1024;
+
+        /// Constructor.
+        /// \param cache_size number of recent log entries to keep in memory.
+        explicit log_store(size_t cache_size = default_cache_size);
         ~log_store() override = default;
 
         log_store(const log_store& other) = delete;
@@ -27,8 +42,11 @@ namespace cbdc::raft {
 
         /// Load the log store from the given LevelDB database directory.
         /// \param db_dir database directory.
+        /// \param sync true if each group of writes should be synced to
+        ///             disk before the writing calls return.
         /// \return true if loading the database succeeded.
-        [[nodiscard]] auto load(const std::string& db_dir) -> bool;
+        [[nodiscard]] auto load(const std::string& db_dir, bool sync = false)
+            -> bool;
 
         /// Return the log index of the next empty log entry.
         /// \return log index.
@@ -109,10 +127,36 @@ namespace cbdc::raft {
         uint64_t m_next_idx{};
         uint64_t m_start_idx{};
 
+        log_entry_cache m_cache;
+
+        /// Mutations not yet handed to LevelDB.
+        mutable std::unique_ptr<leveldb::WriteBatch> m_pending_batch{
+            std::make_unique<leveldb::WriteBatch>()};
+        /// Sequence number of the last mutation added to m_pending_batch.
+        uint64_t m_pending_seq{};
+        /// Sequence number of the last mutation written to LevelDB.
+        mutable uint64_t m_written_seq{};
+        /// True while a caller is writing a batch with m_db_mut released.
+        mutable bool m_writing{false};
+        mutable std::condition_variable m_write_cv;
+
         leveldb::ReadOptions m_read_opt;
         leveldb::WriteOptions m_write_opt;
 
         index_comparator m_cmp;
+
+        /// Writes all mutations queued before the call, either by writing
+        /// the pending batch or by waiting for the caller that is.
+        /// \param l lock holding m_db_mut. Released while writing.
+        void write_pending(std::unique_lock<std::mutex>& l) const;
+
+        /// Returns a copy of the log entry at the given index, reading it
+        /// from LevelDB if it is not cached.
+        /// \param l lock holding m_db_mut.
+        /// \param index log index.
+        /// \return log entry, or nullptr if there is no entry at the index.
+        auto get_entry(std::unique_lock<std::mutex>& l, uint64_t index)
+            -> nuraft::ptr<nuraft::log_entry>;
     };
 }
 
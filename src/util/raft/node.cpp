@@ -15,7 +15,9 @@ namespace cbdc::raft {
                nuraft::ptr<nuraft::state_machine> sm,
                size_t asio_thread_pool_size,
                std::shared_ptr<logging::log> logger,
-               nuraft::cb_func::func_type raft_cb)
+               nuraft::cb_func::func_type raft_cb,
+               bool segmented_log,
+               bool log_sync)
         : m_node_id(static_cast<uint32_t>(node_id)),
           m_blocking(blocking),
           m_port(raft_endpoints[m_node_id].second),
@@ -25,7 +27,9 @@ namespace cbdc::raft {
               node_type + "_raft_log_" + std::to_string(m_node_id),
               node_type + "_raft_config_" + std::to_string(m_node_id) + ".dat",
               node_type + "_raft_state_" + std::to_string(m_node_id) + ".dat",
-              std::move(raft_endpoints))),
+              std::move(raft_endpoints),
+              segmented_log,
+              log_sync)),
           m_sm(std::move(sm)),
           m_log(std::move(logger)) {
         m_asio_opt.thread_pool_size_ = asio_thread_pool_size;
@@ -51,6 +51,10 @@ namespace cbdc::raft {
         ///                              of cores on the system.
         /// \param logger log instance NuRaft should use.
         /// \param raft_cb NuRaft callback to report raft events.
+        /// \param segmented_log true to store the raft log in append-only
+        ///                      segment files instead of LevelDB.
+        /// \param log_sync true to sync raft log writes to disk before
+        ///                 they are acknowledged.
         node(int node_id,
              std::vector<network::endpoint_t> raft_endpoints,
              const std::string& node_type,
@@ -58,7 +62,9 @@ namespace cbdc::raft {
              nuraft::ptr<nuraft::state_machine> sm,
              size_t asio_thread_pool_size,
              std::shared_ptr<logging::log> logger,
-             nuraft::cb_func::func_type raft_cb);
+             nuraft::cb_func::func_type raft_cb,
+             bool segmented_log = false,
+             bool log_sync = false);
 
         ~node();
 
@@ -0,0 +1,769 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "segmented_log_store.hpp"
+
+#include "crypto/siphash.h"
+#include "log_entry_format.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <libnuraft/buffer_serializer.hxx>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cbdc::raft {
+    namespace {
+        constexpr auto segment_extension = ".seg";
+        constexpr size_t segment_name_width = 20;
+        /// Records in packs start with the entry length.
+        constexpr size_t pack_record_header_size = sizeof(uint64_t);
+        /// Records in segments also hold a checksum of the entry.
+        constexpr size_t record_header_size
+            = pack_record_header_size + sizeof(uint64_t);
+        constexpr size_t bits_per_byte = 8;
+        constexpr std::array<uint64_t, 2> checksum_key{0x1337, 0x1337};
+
+        /// Encodes a uint64_t in little-endian order, matching
+        /// nuraft::buffer_serializer.
+        void encode_u64(uint64_t val, unsigned char* out) {
+            for(size_t i{0}; i < sizeof(val); i++) {
+                const auto shift = i * bits_per_byte;
+                out[i] = static_cast<unsigned char>(val >> shift);
+            }
+        }
+
+        auto decode_u64(const unsigned char* in) -> uint64_t {
+            uint64_t ret{};
+            for(size_t i{0}; i < sizeof(ret); i++) {
+                ret |= static_cast<uint64_t>(in[i]) << (i * bits_per_byte);
+            }
+            return ret;
+        }
+
+        auto record_checksum(const unsigned char* payload, uint64_t len)
+            -> uint64_t {
+            CSipHasher hasher(checksum_key[0], checksum_key[1]);
+            hasher.Write(len);
+            hasher.Write(payload, len);
+            return hasher.Finalize();
+        }
+
+        /// Aborts after an I/O error. NuRaft's log_store interface cannot
+        /// report errors, and continuing would leave the log on disk
+        /// inconsistent with the log acknowledged to raft.
+        [[noreturn]] void fail_io(const char* op, const std::string& path) {
+            std::fprintf(stderr,
+                         "segmented_log_store: %s failed for %s: %s\n",
+                         op,
+                         path.c_str(),
+                         std::strerror(errno));
+            std::abort();
+        }
+
+        /// Aborts after reading a record which fails validation.
+        [[noreturn]] void fail_corrupt(const std::string& path) {
+            std::fprintf(stderr,
+                         "segmented_log_store: corrupt record in %s\n",
+                         path.c_str());
+            std::abort();
+        }
+
+        auto write_all(int fd,
+                       const unsigned char* data,
+                       size_t len,
+                       uint64_t offset) -> bool {
+            while(len > 0) {
+                const auto n
+                    = ::pwrite(fd, data, len, static_cast<off_t>(offset));
+                if(n < 0) {
+                    if(errno == EINTR) {
+                        continue;
+                    }
+                    return false;
+                }
+                data += n;
+                len -= static_cast<size_t>(n);
+                offset += static_cast<uint64_t>(n);
+            }
+            return true;
+        }
+
+        auto read_all(int fd, unsigned char* data, size_t len, uint64_t offset)
+            -> bool {
+            while(len > 0) {
+                const auto n
+                    = ::pread(fd, data, len, static_cast<off_t>(offset));
+                if(n < 0) {
+                    if(errno == EINTR) {
+                        continue;
+                    }
+                    return false;
+                }
+                if(n == 0) {
+                    return false;
+                }
+                data += n;
+                len -= static_cast<size_t>(n);
+                offset += static_cast<uint64_t>(n);
+            }
+            return true;
+        }
+
+        auto segment_path(const std::string& dir, uint64_t start_idx)
+            -> std::string {
+            auto name = std::to_string(start_idx);
+            name.insert(0, segment_name_width - name.size(), '0');
+            return dir + "/" + name + segment_extension;
+        }
+
+        auto make_record(const nuraft::log_entry& entry)
+            -> std::vector<unsigned char> {
+            const auto entry_size = serialized_entry_size(entry);
+            auto rec
+                = std::vector<unsigned char>(record_header_size + entry_size);
+            encode_u64(entry_size, rec.data());
+            auto* payload = rec.data() + record_header_size;
+            serialize_entry(entry, payload);
+            encode_u64(record_checksum(payload, entry_size),
+                       rec.data() + pack_record_header_size);
+            return rec;
+        }
+
+        /// Returns true if the record at the given address is complete
+        /// and matches its checksum.
+        /// \param rec record.
+        /// \param avail bytes available from the start of the record.
+        auto valid_record(const unsigned char* rec, uint64_t avail) -> bool {
+            if(avail < record_header_size) {
+                return false;
+            }
+            const auto len = decode_u64(rec);
+            if(len < log_entry_header_size
+               || len > avail - record_header_size) {
+                return false;
+            }
+            const auto checksum = decode_u64(rec + pack_record_header_size);
+            return record_checksum(rec + record_header_size, len) == checksum;
+        }
+    }
+
+    /// A segment file and the file offsets of its records.
+    class segmented_log_store::segment {
+      public:
+        segment(uint64_t start_idx, std::string path, int fd)
+            : m_start_idx(start_idx),
+              m_path(std::move(path)),
+              m_fd(fd) {}
+
+        ~segment() {
+            ::close(m_fd);
+        }
+
+        segment(const segment& other) = delete;
+        auto operator=(const segment& other) -> segment& = delete;
+
+        segment(segment&& other) = delete;
+        auto operator=(segment&& other) -> segment& = delete;
+
+        /// Opens the segment file at the given path.
+        /// \param path segment file path.
+        /// \param start_idx log index of the first record in the segment.
+        /// \param create true to create a new, empty segment file.
+        /// \return the segment, or nullptr if the file could not be opened.
+        static auto open(std::string path, uint64_t start_idx, bool create)
+            -> std::unique_ptr<segment> {
+            auto flags = O_RDWR;
+            if(create) {
+                flags |= O_CREAT | O_TRUNC;
+            }
+            constexpr auto mode = 0644;
+            const auto fd = ::open(path.c_str(), flags, mode);
+            if(fd < 0) {
+                return nullptr;
+            }
+            return std::make_unique<segment>(start_idx, std::move(path), fd);
+        }
+
+        /// Builds the record offsets from the segment file, truncating the
+        /// file at the first record which is incomplete or fails its
+        /// checksum.
+        /// \return true if the segment was read successfully.
+        auto scan() -> bool {
+            struct stat st {};
+            if(::fstat(m_fd, &st) != 0) {
+                return false;
+            }
+            const auto file_size = static_cast<uint64_t>(st.st_size);
+            auto data = std::vector<unsigned char>(file_size);
+            if(!read_all(m_fd, data.data(), data.size(), 0)) {
+                return false;
+            }
+
+            uint64_t offset{0};
+            while(valid_record(data.data() + offset, file_size - offset)) {
+                m_offsets.push_back(offset);
+                offset
+                    += record_header_size + decode_u64(data.data() + offset);
+            }
+
+            m_truncated = offset < file_size;
+            if(m_truncated
+               && ::ftruncate(m_fd, static_cast<off_t>(offset)) != 0) {
+                return false;
+            }
+            m_size = offset;
+
+            return true;
+        }
+
+        /// Returns the log index following the last record in the segment.
+        [[nodiscard]] auto end_idx() const -> uint64_t {
+            return m_start_idx + m_offsets.size();
+        }
+
+        /// Returns the file offset following the nth record.
+        [[nodiscard]] auto record_end(size_t n) const -> uint64_t {
+            if(n + 1 < m_offsets.size()) {
+                return m_offsets[n + 1];
+            }
+            return m_size;
+        }
+
+        uint64_t m_start_idx;
+        std::string m_path;
+        int m_fd;
+        std::vector<uint64_t> m_offsets{};
+        uint64_t m_size{};
+        /// True if the segment has been written since the last sync.
+        bool m_dirty{false};
+        /// True if scan() dropped records from the end of the file.
+        bool m_truncated{false};
+    };
+
+    segmented_log_store::segmented_log_store(size_t segment_size,
+                                             size_t cache_size)
+        : m_segment_size(segment_size),
+          m_cache(cache_size) {}
+
+    segmented_log_store::~segmented_log_store() = default;
+
+    auto segmented_log_store::load(const std::string& dir, bool sync) -> bool {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        if(ec) {
+            return false;
+        }
+
+        auto files = std::vector<std::pair<uint64_t, std::string>>();
+        for(const auto& f : std::filesystem::directory_iterator(dir, ec)) {
+            if(f.path().extension() != segment_extension) {
+                continue;
+            }
+            const auto stem = f.path().stem().string();
+            char* end{};
+            constexpr auto base = 10;
+            const auto start_idx = std::strtoull(stem.c_str(), &end, base);
+            if(stem.empty() || *end != '\0') {
+                continue;
+            }
+            files.emplace_back(start_idx, f.path().string());
+        }
+        if(ec) {
+            return false;
+        }
+        std::sort(files.begin(), files.end());
+
+        std::lock_guard<std::mutex> l(m_mut);
+        m_dir = dir;
+        m_sync = sync;
+        m_segments.clear();
+        m_cache.clear();
+
+        for(auto& [start_idx, path] : files) {
+            // Segments after a damaged record cannot continue the log
+            if(!m_segments.empty() && m_segments.back()->m_truncated) {
+                std::filesystem::remove(path, ec);
+                if(ec) {
+                    return false;
+                }
+                m_dir_dirty = true;
+                continue;
+            }
+            auto seg = segment::open(std::move(path), start_idx, false);
+            if(!seg || !seg->scan()) {
+                return false;
+            }
+            if(!m_segments.empty()
+               && m_segments.back()->end_idx() != start_idx) {
+                return false;
+            }
+            m_segments.push_back(std::move(seg));
+        }
+
+        m_start_idx = 1;
+        const auto fd = ::open(start_index_file().c_str(), O_RDONLY);
+        if(fd >= 0) {
+            auto data = std::array<unsigned char, sizeof(uint64_t)>();
+            if(read_all(fd, data.data(), data.size(), 0)) {
+                m_start_idx = decode_u64(data.data());
+            }
+            ::close(fd);
+        }
+
+        if(m_segments.empty()) {
+            m_next_idx = m_start_idx;
+            return true;
+        }
+
+        m_start_idx = std::max(m_start_idx, m_segments.front()->m_start_idx);
+        m_next_idx = std::max(m_segments.back()->end_idx(), m_start_idx);
+
+        // Remove segments left behind by an interrupted compaction
+        while(!m_segments.empty()
+              && m_segments.front()->end_idx() <= m_start_idx) {
+            remove_front_segment();
+        }
+
+        return true;
+    }
+
+    auto segmented_log_store::next_slot() const -> uint64_t {
+        std::lock_guard<std::mutex> l(m_mut);
+        return m_next_idx;
+    }
+
+    auto segmented_log_store::start_index() const -> uint64_t {
+        std::lock_guard<std::mutex> l(m_mut);
+        return m_start_idx;
+    }
+
+    auto segmented_log_store::last_entry() const
+        -> nuraft::ptr<nuraft::log_entry> {
+        std::lock_guard<std::mutex> l(m_mut);
+        if(m_next_idx <= m_start_idx) {
+            return nuraft::cs_new<nuraft::log_entry>(0, nullptr);
+        }
+        return get_entry(m_next_idx - 1);
+    }
+
+    auto segmented_log_store::append(nuraft::ptr<nuraft::log_entry>& entry)
+        -> uint64_t {
+        const auto rec = make_record(*entry);
+
+        std::lock_guard<std::mutex> l(m_mut);
+        const auto idx = m_next_idx;
+        append_records(rec.data(), {rec.size()});
+        m_cache.put(idx, entry);
+        return idx;
+    }
+
+    void segmented_log_store::write_at(uint64_t index,
+                                       nuraft::ptr<nuraft::log_entry>& entry) {
+        const auto rec = make_record(*entry);
+
+        std::lock_guard<std::mutex> l(m_mut);
+        if(index < m_start_idx || index > m_next_idx) {
+            reset(index);
+        } else {
+            truncate(index);
+        }
+        append_records(rec.data(), {rec.size()});
+        m_cache.put(index, entry);
+    }
+
+    auto segmented_log_store::log_entries(uint64_t start, uint64_t end)
+        -> log_entries_t {
+        auto ret = nuraft::cs_new<log_entries_t::element_type>();
+        ret->reserve(end - start);
+
+        std::lock_guard<std::mutex> l(m_mut);
+        assert(start >= m_start_idx && end <= m_next_idx);
+        for(auto idx = start; idx < end; idx = start + ret->size()) {
+            auto cached = m_cache.get(idx);
+            if(cached) {
+                ret->push_back(clone_entry(*cached));
+                continue;
+            }
+            read_entries(idx, end, *ret);
+        }
+
+        return ret;
+    }
+
+    auto segmented_log_store::entry_at(uint64_t index)
+        -> nuraft::ptr<nuraft::log_entry> {
+        std::lock_guard<std::mutex> l(m_mut);
+        if(index < m_start_idx || index >= m_next_idx) {
+            return nuraft::cs_new<nuraft::log_entry>(0, nullptr);
+        }
+        return get_entry(index);
+    }
+
+    auto segmented_log_store::term_at(uint64_t index) -> uint64_t {
+        std::lock_guard<std::mutex> l(m_mut);
+        if(index < m_start_idx || index >= m_next_idx) {
+            return 0;
+        }
+        auto cached = m_cache.get(index);
+        if(cached) {
+            return cached->get_term();
+        }
+        return get_entry(index)->get_term();
+    }
+
+    auto segmented_log_store::pack(uint64_t index, int32_t cnt)
+        -> nuraft::ptr<nuraft::buffer> {
+        assert(cnt >= 0);
+        const auto end = index + static_cast<uint64_t>(cnt);
+
+        std::lock_guard<std::mutex> l(m_mut);
+        assert(index >= m_start_idx && end <= m_next_idx);
+
+        // Read the byte range of the requested records from each segment,
+        // then copy each record into the pack without its checksum.
+        struct file_range {
+            const segment* m_seg;
+            uint64_t m_first;
+            uint64_t m_last;
+            std::vector<unsigned char> m_data;
+        };
+        auto ranges = std::vector<file_range>();
+        uint64_t total_len{0};
+        for(auto idx = index; idx < end;) {
+            const auto& seg = find_segment(idx);
+            const auto first = idx - seg.m_start_idx;
+            const auto last = std::min(end, seg.end_idx()) - seg.m_start_idx;
+            auto data = read_range(seg,
+                                   seg.m_offsets[first],
+                                   seg.record_end(last - 1));
+            total_len += data.size()
+                       - (last - first) * (record_header_size
+                                           - pack_record_header_size);
+            ranges.push_back({&seg, first, last, std::move(data)});
+            idx = seg.m_start_idx + last;
+        }
+
+        auto ret = nuraft::buffer::alloc(sizeof(uint64_t) + total_len);
+        nuraft::buffer_serializer bs(ret);
+        bs.put_u64(static_cast<uint64_t>(cnt));
+
+        auto* out = ret->data_begin() + sizeof(uint64_t);
+        for(const auto& range : ranges) {
+            const auto& offsets = range.m_seg->m_offsets;
+            const auto begin_offset = offsets[range.m_first];
+            for(auto n = range.m_first; n < range.m_last; n++) {
+                const auto* rec
+                    = range.m_data.data() + (offsets[n] - begin_offset);
+                const auto len = decode_u64(rec);
+                std::memcpy(out, rec, pack_record_header_size);
+                out += pack_record_header_size;
+                std::memcpy(out, rec + record_header_size, len);
+                out += len;
+            }
+        }
+
+        return ret;
+    }
+
+    void segmented_log_store::apply_pack(uint64_t index,
+                                         nuraft::buffer& pack) {
+        const auto* data = pack.data_begin();
+        const auto pack_size = pack.size();
+        assert(pack_size >= sizeof(uint64_t));
+
+        // Add a checksum to each record of the pack
+        const auto cnt = decode_u64(data);
+        auto records = std::vector<unsigned char>();
+        constexpr auto checksum_size
+            = record_header_size - pack_record_header_size;
+        records.reserve(pack_size + cnt * checksum_size);
+        auto sizes = std::vector<uint64_t>();
+        sizes.reserve(cnt);
+        uint64_t pos{sizeof(uint64_t)};
+        for(uint64_t i{0}; i < cnt; i++) {
+            assert(pos + pack_record_header_size <= pack_size);
+            const auto len = decode_u64(data + pos);
+            const auto* payload = data + pos + pack_record_header_size;
+            assert(pos + pack_record_header_size + len <= pack_size);
+
+            auto header = std::array<unsigned char, record_header_size>();
+            encode_u64(len, header.data());
+            encode_u64(record_checksum(payload, len),
+                       header.data() + pack_record_header_size);
+            records.insert(records.end(), header.begin(), header.end());
+            records.insert(records.end(), payload, payload + len);
+            sizes.push_back(record_header_size + len);
+            pos += pack_record_header_size + len;
+        }
+
+        std::lock_guard<std::mutex> l(m_mut);
+        if(index < m_start_idx || index > m_next_idx) {
+            reset(index);
+        } else {
+            truncate(index);
+        }
+        append_records(records.data(), sizes);
+        for(uint64_t i{0}; i < cnt; i++) {
+            m_cache.erase(index + i);
+        }
+    }
+
+    auto segmented_log_store::compact(uint64_t last_log_index) -> bool {
+        std::lock_guard<std::mutex> l(m_mut);
+        if(last_log_index < m_start_idx) {
+            return true;
+        }
+
+        // Persist the new start index before deleting segments so an
+        // interrupted compaction is completed by load().
+        m_start_idx = last_log_index + 1;
+        m_next_idx = std::max(m_next_idx, m_start_idx);
+        if(!save_start_index()) {
+            return false;
+        }
+
+        while(!m_segments.empty()
+              && m_segments.front()->end_idx() <= m_start_idx) {
+            remove_front_segment();
+        }
+
+        return true;
+    }
+
+    auto segmented_log_store::flush() -> bool {
+        std::lock_guard<std::mutex> l(m_mut);
+        auto ok = true;
+        for(auto& seg : m_segments) {
+            if(seg->m_dirty) {
+                if(::fsync(seg->m_fd) == 0) {
+                    seg->m_dirty = false;
+                } else {
+                    ok = false;
+                }
+            }
+        }
+
+        if(m_dir_dirty) {
+            const auto fd = ::open(m_dir.c_str(), O_RDONLY);
+            if(fd >= 0 && ::fsync(fd) == 0) {
+                m_dir_dirty = false;
+            } else {
+                ok = false;
+            }
+            if(fd >= 0) {
+                ::close(fd);
+            }
+        }
+
+        return ok;
+    }
+
+    auto segmented_log_store::start_index_file() const -> std::string {
+        return m_dir + "/start_index";
+    }
+
+    auto segmented_log_store::save_start_index() const -> bool {
+        const auto file = start_index_file();
+        const auto tmp_file = file + ".tmp";
+        constexpr auto mode = 0644;
+        const auto fd
+            = ::open(tmp_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+        if(fd < 0) {
+            return false;
+        }
+
+        auto data = std::array<unsigned char, sizeof(uint64_t)>();
+        encode_u64(m_start_idx, data.data());
+        const auto ok
+            = write_all(fd, data.data(), data.size(), 0) && ::fsync(fd) == 0;
+        ::close(fd);
+        if(!ok) {
+            return false;
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmp_file, file, ec);
+        return !ec;
+    }
+
+    auto segmented_log_store::find_segment(uint64_t index) const
+        -> segment& {
+        auto it = std::upper_bound(
+            m_segments.begin(),
+            m_segments.end(),
+            index,
+            [](uint64_t idx, const std::unique_ptr<segment>& seg) {
+                return idx < seg->m_start_idx;
+            });
+        assert(it != m_segments.begin());
+        it--;
+        assert(index < (*it)->end_idx());
+        return **it;
+    }
+
+    auto segmented_log_store::get_entry(uint64_t index) const
+        -> nuraft::ptr<nuraft::log_entry> {
+        auto cached = m_cache.get(index);
+        if(cached) {
+            return clone_entry(*cached);
+        }
+
+        auto entries = std::vector<nuraft::ptr<nuraft::log_entry>>();
+        read_entries(index, index + 1, entries);
+        return entries.front();
+    }
+
+    void segmented_log_store::read_entries(
+        uint64_t index,
+        uint64_t end,
+        std::vector<nuraft::ptr<nuraft::log_entry>>& out) const {
+        const auto& seg = find_segment(index);
+        const auto first = index - seg.m_start_idx;
+        const auto last = std::min(end, seg.end_idx()) - seg.m_start_idx;
+        const auto begin_offset = seg.m_offsets[first];
+        const auto end_offset = seg.record_end(last - 1);
+
+        const auto data = read_range(seg, begin_offset, end_offset);
+        for(auto n = first; n < last; n++) {
+            const auto* rec = data.data() + (seg.m_offsets[n] - begin_offset);
+            const auto len = decode_u64(rec);
+            auto entry = deserialize_entry(rec + record_header_size, len);
+            if(!entry) {
+                fail_corrupt(seg.m_path);
+            }
+            out.push_back(std::move(entry));
+        }
+    }
+
+    auto segmented_log_store::read_range(const segment& seg,
+                                         uint64_t begin_offset,
+                                         uint64_t end_offset)
+        -> std::vector<unsigned char> {
+        auto data = std::vector<unsigned char>(end_offset - begin_offset);
+        if(!read_all(seg.m_fd, data.data(), data.size(), begin_offset)) {
+            fail_io("read", seg.m_path);
+        }
+
+        uint64_t offset{0};
+        while(offset < data.size()) {
+            const auto* rec = data.data() + offset;
+            if(!valid_record(rec, data.size() - offset)) {
+                fail_corrupt(seg.m_path);
+            }
+            offset += record_header_size + decode_u64(rec);
+        }
+        return data;
+    }
+
+    void segmented_log_store::append_records(
+        const unsigned char* records,
+        const std::vector<uint64_t>& sizes) {
+        size_t i{0};
+        while(i < sizes.size()) {
+            if(m_segments.empty()
+               || m_segments.back()->end_idx() != m_next_idx
+               || (m_segments.back()->m_size > 0
+                   && m_segments.back()->m_size + sizes[i]
+                          > m_segment_size)) {
+                auto path = segment_path(m_dir, m_next_idx);
+                auto seg = segment::open(path, m_next_idx, true);
+                if(!seg) {
+                    fail_io("open", path);
+                }
+                m_segments.push_back(std::move(seg));
+                m_dir_dirty = true;
+            }
+
+            // Write as many records as fit in the segment with one call
+            auto& seg = *m_segments.back();
+            const auto* begin = records;
+            auto offset = seg.m_size;
+            do {
+                seg.m_offsets.push_back(offset);
+                offset += sizes[i];
+                records += sizes[i];
+                i++;
+            } while(i < sizes.size() && offset + sizes[i] <= m_segment_size);
+
+            if(!write_all(seg.m_fd,
+                          begin,
+                          static_cast<size_t>(records - begin),
+                          seg.m_size)) {
+                fail_io("write", seg.m_path);
+            }
+            seg.m_size = offset;
+            m_next_idx = seg.end_idx();
+
+            if(m_sync) {
+                if(::fsync(seg.m_fd) != 0) {
+                    fail_io("fsync", seg.m_path);
+                }
+            } else {
+                seg.m_dirty = true;
+            }
+        }
+    }
+
+    void segmented_log_store::truncate(uint64_t index) {
+        while(!m_segments.empty()
+              && m_segments.back()->m_start_idx >= index) {
+            remove_back_segment();
+        }
+
+        if(!m_segments.empty() && m_segments.back()->end_idx() > index) {
+            auto& seg = *m_segments.back();
+            const auto n = index - seg.m_start_idx;
+            const auto offset = seg.m_offsets[n];
+            if(::ftruncate(seg.m_fd, static_cast<off_t>(offset)) != 0) {
+                fail_io("ftruncate", seg.m_path);
+            }
+            seg.m_offsets.resize(n);
+            seg.m_size = offset;
+            seg.m_dirty = true;
+        }
+
+        m_next_idx = index;
+    }
+
+    void segmented_log_store::reset(uint64_t index) {
+        while(!m_segments.empty()) {
+            remove_back_segment();
+        }
+        m_start_idx = index;
+        m_next_idx = index;
+        if(!save_start_index()) {
+            fail_io("save start index", start_index_file());
+        }
+    }
+
+    void segmented_log_store::remove_front_segment() {
+        // A segment left behind is removed again by load(), as it ends
+        // before the persisted start index
+        std::error_code ec;
+        std::filesystem::remove(m_segments.front()->m_path, ec);
+        m_segments.pop_front();
+        m_dir_dirty = true;
+    }
+
+    void segmented_log_store::remove_back_segment() {
+        // A segment left behind would bring truncated entries back on load
+        std::error_code ec;
+        std::filesystem::remove(m_segments.back()->m_path, ec);
+        if(ec) {
+            errno = ec.value();
+            fail_io("unlink", m_segments.back()->m_path);
+        }
+        m_segments.pop_back();
+        m_dir_dirty = true;
+    }
+}
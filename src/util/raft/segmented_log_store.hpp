@@ -0,0 +1,201 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_RAFT_SEGMENTED_LOG_STORE_H_
+#define OPENCBDC_TX_SRC_RAFT_SEGMENTED_LOG_STORE_H_
+
+#include "log_entry_cache.hpp"
+
+#include <deque>
+#include <libnuraft/log_store.hxx>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cbdc::raft {
+    /// \brief NuRaft log_store implementation using append-only segment
+    ///        files.
+    ///
+    /// Log entries are appended to the most recent segment file in a
+    /// directory. Each segment file holds a contiguous range of log
+    /// entries, and is named by the index of its first entry. Each record
+    /// in a segment is a little-endian uint64_t length, a uint64_t SipHash
+    /// checksum and the serialized log entry. Packs use the same records
+    /// without the checksum, so \ref pack and \ref apply_pack only strip
+    /// or add the checksums. File offsets of every record
+    /// are kept in memory. Compaction deletes whole segments and persists
+    /// the new start index, truncating the log truncates at most one
+    /// segment file. I/O errors while writing abort the process, as NuRaft
+    /// cannot handle a log which failed to persist an entry.
+    class segmented_log_store : public nuraft::log_store {
+      public:
+        /// Size in bytes after which a new segment file is started.
+        static constexpr size_t default_segment_size = 64UL * 1024 * 1024;
+        /// Number of recent log entries kept in memory by default.
+        static constexpr size_t default_cache_size = 1024;
+
+        /// Constructor.
+        /// \param segment_size size in bytes after which a new segment file
+        ///                     is started.
+        /// \param cache_size number of recent log entries to keep in memory.
+        explicit segmented_log_store(
+            size_t segment_size = default_segment_size,
+            size_t cache_size = default_cache_size);
+        ~segmented_log_store() override;
+
+        segmented_log_store(const segmented_log_store& other) = delete;
+        auto operator=(const segmented_log_store& other)
+            -> segmented_log_store& = delete;
+
+        segmented_log_store(segmented_log_store&& other) = delete;
+        auto operator=(segmented_log_store&& other)
+            -> segmented_log_store& = delete;
+
+        /// Load the log store from the given directory, creating it if
+        /// necessary. Truncates the log at the first record which is
+        /// incomplete or fails its checksum, such as a partially written
+        /// record at the end of a segment.
+        /// \param dir log directory.
+        /// \param sync true if writes should be synced to disk before the
+        ///             writing calls return.
+        /// \return true if loading the log succeeded.
+        [[nodiscard]] auto load(const std::string& dir, bool sync = false)
+            -> bool;
+
+        /// Return the log index of the next empty log entry.
+        /// \return log index.
+        [[nodiscard]] auto next_slot() const -> uint64_t override;
+
+        /// Return the first log index stored by the log store.
+        /// \return log index.
+        [[nodiscard]] auto start_index() const -> uint64_t override;
+
+        /// Return the last log entry in the log store. Returns an empty log
+        /// entry at index zero if the log store is empty.
+        /// \return log entry.
+        [[nodiscard]] auto last_entry() const
+            -> nuraft::ptr<nuraft::log_entry> override;
+
+        /// Append the given log entry to the end of the log.
+        /// \param entry log entry to append.
+        /// \return index of the appended log entry.
+        auto append(nuraft::ptr<nuraft::log_entry>& entry)
+            -> uint64_t override;
+
+        /// Write a log entry at the given index, removing all later entries.
+        /// \param index log index at which to write the entry.
+        /// \param entry log entry to write.
+        void write_at(uint64_t index,
+                      nuraft::ptr<nuraft::log_entry>& entry) override;
+
+        /// List of log entries.
+        using log_entries_t
+            = nuraft::ptr<std::vector<nuraft::ptr<nuraft::log_entry>>>;
+
+        /// Return the log entries in the given range of indices.
+        /// \param start first log entry to retrieve.
+        /// \param end last log entry to retrieve (exclusive).
+        /// \return list of log entries.
+        [[nodiscard]] auto log_entries(uint64_t start, uint64_t end)
+            -> log_entries_t override;
+
+        /// Return the log entry at the given index. Returns a null log entry
+        /// if there is no log entry at the given index.
+        /// \param index log index.
+        /// \return log entry.
+        [[nodiscard]] auto entry_at(uint64_t index)
+            -> nuraft::ptr<nuraft::log_entry> override;
+
+        /// Return the log term associated with the log entry at the given
+        /// index.
+        /// \param index log index.
+        /// \return log term.
+        [[nodiscard]] auto term_at(uint64_t index) -> uint64_t override;
+
+        /// Serialize the given number of log entries from the given index.
+        /// Uses the same format as \ref cbdc::raft::log_store::pack.
+        /// \param index starting log index.
+        /// \param cnt number of log entries to serialize. Must be positive.
+        /// \return buffer containing serialized log entries.
+        [[nodiscard]] auto pack(uint64_t index, int32_t cnt)
+            -> nuraft::ptr<nuraft::buffer> override;
+
+        /// Write the given serialized log entries starting at the given log
+        /// index, removing all later entries. If the entries are not
+        /// contiguous with the existing log, the existing log is discarded.
+        /// \param index log index at which to write the first log entry.
+        /// \param pack serialized log entries.
+        void apply_pack(uint64_t index, nuraft::buffer& pack) override;
+
+        /// Delete log entries from the start of the log up to the given log
+        /// index. Only segments containing no retained entries are deleted
+        /// from disk.
+        /// \param last_log_index last log index to delete (inclusive).
+        /// \return true if the new start index was persisted.
+        auto compact(uint64_t last_log_index) -> bool override;
+
+        /// Sync all written segments to disk.
+        /// \return true if the flush was successful.
+        auto flush() -> bool override;
+
+      private:
+        class segment;
+
+        mutable std::mutex m_mut{};
+        std::string m_dir;
+        bool m_sync{false};
+        size_t m_segment_size;
+        /// Segments in log order. The last segment receives appends.
+        std::deque<std::unique_ptr<segment>> m_segments;
+        /// True if a segment was created or deleted since the last flush.
+        bool m_dir_dirty{false};
+        uint64_t m_start_idx{1};
+        uint64_t m_next_idx{1};
+
+        log_entry_cache m_cache;
+
+        [[nodiscard]] auto start_index_file() const -> std::string;
+        [[nodiscard]] auto save_start_index() const -> bool;
+
+        /// Returns the segment containing the given stored log index.
+        [[nodiscard]] auto find_segment(uint64_t index) const -> segment&;
+
+        /// Returns a copy of the log entry at the given stored log index.
+        [[nodiscard]] auto get_entry(uint64_t index) const
+            -> nuraft::ptr<nuraft::log_entry>;
+
+        /// Reads the records in the given byte range of a segment, aborting
+        /// if any record fails validation.
+        [[nodiscard]] static auto read_range(const segment& seg,
+                                             uint64_t begin_offset,
+                                             uint64_t end_offset)
+            -> std::vector<unsigned char>;
+
+        /// Reads stored log entries from the given index up to the end of
+        /// its segment or the given end index, whichever comes first.
+        void read_entries(uint64_t index,
+                          uint64_t end,
+                          std::vector<nuraft::ptr<nuraft::log_entry>>& out)
+            const;
+
+        /// Appends records at m_next_idx, starting new segments as needed.
+        /// \param records serialized records to write.
+        /// \param sizes size of each record in bytes.
+        void append_records(const unsigned char* records,
+                            const std::vector<uint64_t>& sizes);
+
+        /// Removes all log entries from the given index onwards.
+        void truncate(uint64_t index);
+
+        /// Removes all segments and restarts the log at the given index.
+        void reset(uint64_t index);
+
+        void remove_front_segment();
+        void remove_back_segment();
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_RAFT_SEGMENTED_LOG_STORE_H_
@@ -6,6 +6,7 @@
 #include "state_manager.hpp"
 
 #include "log_store.hpp"
+#include "segmented_log_store.hpp"
 
 #include <cstring>
 #include <filesystem>
@@ -18,12 +19,16 @@ namespace cbdc::raft {
         std::string log_dir,
         std::string config_file,
         std::string state_file,
-        std::vector<network::endpoint_t> raft_endpoints)
+        std::vector<network::endpoint_t> raft_endpoints,
+        bool segmented_log,
+        bool log_sync)
         : m_id(srv_id),
           m_config_file(std::move(config_file)),
           m_state_file(std::move(state_file)),
           m_log_dir(std::move(log_dir)),
-          m_raft_endpoints(std::move(raft_endpoints)) {}
+          m_raft_endpoints(std::move(raft_endpoints)),
+          m_segmented_log(segmented_log),
+          m_log_sync(log_sync) {}
 
     template<typename T>
     void save_object(const T& obj, const std::string& filename) {
@@ -99,8 +104,27 @@ namespace cbdc::raft {
     }
 
     auto state_manager::load_log_store() -> nuraft::ptr<nuraft::log_store> {
+        // Each log store uses its own directory. Refuse to switch stores
+        // while the other store has a log, as the node would silently
+        // start with an empty log.
+        const auto segmented_dir = m_log_dir + "_segmented";
+        const auto& other_dir = m_segmented_log ? m_log_dir : segmented_dir;
+        std::error_code ec;
+        if(std::filesystem::exists(other_dir, ec) || ec) {
+            return nullptr;
+        }
+
+        if(m_segmented_log) {
+            auto log = nuraft::cs_new<segmented_log_store>();
+            if(!log->load(segmented_dir, m_log_sync)) {
+                return nullptr;
+            }
+
+            return log;
+        }
+
         auto log = nuraft::cs_new<log_store>();
-        if(!log->load(m_log_dir)) {
+        if(!log->load(m_log_dir, m_log_sync)) {
             return nullptr;
         }
 
@@ -21,11 +21,19 @@ namespace cbdc::raft {
         /// \param config_file file for the cluster configuration.
         /// \param state_file file for the server state.
         /// \param raft_endpoints list of initial node endpoints in the cluster.
+        /// \param segmented_log true to store the raft log in a
+        ///                      segmented_log_store in log_dir with a
+        ///                      "_segmented" suffix instead of a LevelDB
+        ///                      log_store in log_dir.
+        /// \param log_sync true to sync raft log writes to disk before
+        ///                 they are acknowledged.
         state_manager(int32_t srv_id,
                       std::string log_dir,
                       std::string config_file,
                       std::string state_file,
-                      std::vector<network::endpoint_t> raft_endpoints);
+                      std::vector<network::endpoint_t> raft_endpoints,
+                      bool segmented_log = false,
+                      bool log_sync = false);
         ~state_manager() override = default;
 
         state_manager(const state_manager& other) = delete;
@@ -51,7 +59,8 @@ namespace cbdc::raft {
         auto read_state() -> nuraft::ptr<nuraft::srv_state> override;
 
         /// Load and return the log store.
-        /// \return log store instance, or nullptr if loading failed.
+        /// \return log store instance, or nullptr if loading failed or the
+        ///         directory of the other kind of log store exists.
         auto load_log_store() -> nuraft::ptr<nuraft::log_store> override;
 
         /// Return the server ID.
@@ -68,6 +77,8 @@ namespace cbdc::raft {
         std::string m_state_file;
         std::string m_log_dir;
         std::vector<network::endpoint_t> m_raft_endpoints;
+        bool m_segmented_log;
+        bool m_log_sync;
     };
 }
 
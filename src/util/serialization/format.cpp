@@ -5,6 +5,8 @@
 
 #include "format.hpp"
 
+#include <climits>
+
 namespace cbdc {
     auto operator<<(serializer& packet, std::byte b) -> serializer& {
         packet << static_cast<uint8_t>(b);
@@ -34,4 +36,50 @@ namespace cbdc {
         deser.read(b.data(), sz);
         return deser;
     }
+
+    auto operator<<(serializer& ser, const std::vector<bool>& vec)
+        -> serializer& {
+        const auto len = static_cast<uint64_t>(vec.size());
+        ser << len;
+        auto packed = std::vector<uint8_t>(
+            (vec.size() + CHAR_BIT - 1) / CHAR_BIT);
+        for(size_t i = 0; i < vec.size(); i++) {
+            if(vec[i]) {
+                packed[i / CHAR_BIT]
+                    |= static_cast<uint8_t>(1U << (i % CHAR_BIT));
+            }
+        }
+        ser.write(packed.data(), packed.size());
+        return ser;
+    }
+
+    auto operator>>(serializer& deser, std::vector<bool>& vec)
+        -> serializer& {
+        uint64_t len{};
+        if(!(deser >> len)) {
+            return deser;
+        }
+
+        // Read the packed bytes in bounded chunks so a bogus length cannot
+        // force a large allocation before the data has actually arrived.
+        const auto n_bytes = len / CHAR_BIT + (len % CHAR_BIT == 0 ? 0 : 1);
+        auto packed = std::vector<uint8_t>();
+        uint64_t allocated = 0;
+        while(allocated < n_bytes) {
+            const auto start = allocated;
+            allocated
+                = std::min(n_bytes, allocated + config::maximum_reservation);
+            packed.resize(allocated);
+            if(!deser.read(&packed[start], allocated - start)) {
+                return deser;
+            }
+        }
+
+        vec.reserve(vec.size() + len);
+        for(uint64_t i = 0; i < len; i++) {
+            vec.push_back(((packed[i / CHAR_BIT] >> (i % CHAR_BIT)) & 1U)
+                          != 0);
+        }
+        return deser;
+    }
 }
@@ -14,10 +14,12 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <limits>
 #include <optional>
 #include <set>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <variant>
@@ -90,26 +92,61 @@ namespace cbdc {
         return s;
     }
 
-    /// Serializes the array of integral values in-order.
+    /// \brief Indicates whether the serialized form of `T` is identical to
+    ///        its in-memory object representation.
+    ///
+    /// Contiguous ranges of such types can be copied into or out of a
+    /// serializer with a single call to \ref serializer::write or
+    /// \ref serializer::read rather than one call per element. Holds for
+    /// integral types other than bool, std::byte, and arrays thereof.
+    /// \tparam T type to check.
+    template<typename T>
+    struct is_bulk_serializable
+        : std::bool_constant<(std::is_integral_v<T>
+                              && !std::is_same_v<T, bool>)
+                             || std::is_same_v<T, std::byte>> {};
+
+    /// \brief Specialization of \ref is_bulk_serializable for arrays.
+    ///
+    /// Arrays of bulk-serializable types without padding are themselves
+    /// bulk-serializable. This covers \ref hash_t.
+    template<typename T, size_t len>
+    struct is_bulk_serializable<std::array<T, len>>
+        : std::bool_constant<is_bulk_serializable<T>::value
+                             && sizeof(std::array<T, len>)
+                                    == sizeof(T) * len> {};
+
+    /// Helper variable template for \ref is_bulk_serializable.
+    template<typename T>
+    inline constexpr bool is_bulk_serializable_v
+        = is_bulk_serializable<T>::value;
+
+    /// Serializes the array of integral or bulk-serializable values
+    /// in-order.
     ///
     /// \see \ref cbdc::operator<<(serializer&, T)
     ///
-    /// \tparam T the underlying integral type
+    /// \tparam T the underlying element type
     /// \tparam len the length of the array to be serialized
     /// \param packet the serializer to receive the data
     /// \param arr the array of data to be serialized
     template<typename T, size_t len>
     auto operator<<(serializer& packet, const std::array<T, len>& arr) ->
-        typename std::enable_if_t<std::is_integral_v<T>, serializer&> {
+        typename std::enable_if_t<std::is_integral_v<T>
+                                      || is_bulk_serializable_v<T>,
+                                  serializer&> {
         packet.write(arr.data(), sizeof(T) * len);
         return packet;
     }
 
-    /// Deserializes the array of integral values in-order.
+    /// Deserializes the array of integral or bulk-serializable values
+    /// in-order.
     /// \see \ref cbdc::operator<<(serializer&, const std::array<T, len>&)
     template<typename T, size_t len>
     auto operator>>(serializer& packet, std::array<T, len>& arr) ->
-        typename std::enable_if_t<std::is_integral_v<T>, serializer&> {
+        typename std::enable_if_t<std::is_integral_v<T>
+                                      || is_bulk_serializable_v<T>,
+                                  serializer&> {
         packet.read(arr.data(), sizeof(T) * len);
         return packet;
     }
@@ -179,21 +216,32 @@ namespace cbdc {
     }
 
     /// Serializes the count of elements in the vector, and then each element
-    /// in-order.
+    /// in-order. Vectors of bulk-serializable elements are written with a
+    /// single call to \ref serializer::write.
     ///
     /// \see \ref cbdc::operator<<(serializer&, T)
+    /// \see \ref is_bulk_serializable
     template<typename T>
     auto operator<<(serializer& packet, const std::vector<T>& vec)
         -> serializer& {
         const auto len = static_cast<uint64_t>(vec.size());
         packet << len;
-        for(uint64_t i = 0; i < len; i++) {
-            packet << static_cast<T>(vec[i]);
+        if constexpr(is_bulk_serializable_v<T>) {
+            packet.write(vec.data(), sizeof(T) * vec.size());
+        } else {
+            for(uint64_t i = 0; i < len; i++) {
+                packet << static_cast<T>(vec[i]);
+            }
         }
         return packet;
     }
 
-    /// Deserializes a vector of elements.
+    /// Deserializes a vector of elements. Vectors of bulk-serializable
+    /// elements are read with one call to \ref serializer::read per
+    /// \ref config::maximum_reservation bytes. If the data ends early, a
+    /// vector of bulk-serializable elements keeps the complete elements
+    /// read from a \ref buffer_serializer, but from other serializers only
+    /// those read before the chunk which ended early.
     /// \see \ref cbdc::operator<<(serializer&, const std::vector<T>&)
     template<typename T>
     auto operator>>(serializer& packet, std::vector<T>& vec) -> serializer& {
@@ -211,19 +259,44 @@ namespace cbdc {
                 len,
                 allocated + config::maximum_reservation / sizeof(T));
             vec.reserve(allocated);
-            while(vec.size() < allocated) {
-                if constexpr(std::is_default_constructible_v<T>) {
+            if constexpr(is_bulk_serializable_v<T>) {
+                const auto start = vec.size();
+                if(start >= allocated) {
+                    continue;
+                }
+                vec.resize(allocated);
+                if(!packet.read(&vec[start],
+                                sizeof(T) * (allocated - start))) {
+                    // A buffer_serializer consumes nothing on a short
+                    // read and accepts later reads, so re-reading element
+                    // by element keeps the complete elements that were
+                    // readable, as reading element-wise would. Other
+                    // serializers, such as istream_serializer, stay failed,
+                    // so the vector keeps only the elements before this
+                    // chunk.
+                    vec.resize(start);
                     T val{};
-                    if(!(packet >> val)) {
-                        return packet;
+                    while(vec.size() < allocated
+                          && packet.read(&val, sizeof(T))) {
+                        vec.push_back(val);
                     }
-                    vec.push_back(std::move(val));
-                } else {
-                    auto val = T(packet);
-                    if(!packet) {
-                        return packet;
+                    return packet;
+                }
+            } else {
+                while(vec.size() < allocated) {
+                    if constexpr(std::is_default_constructible_v<T>) {
+                        T val{};
+                        if(!(packet >> val)) {
+                            return packet;
+                        }
+                        vec.push_back(std::move(val));
+                    } else {
+                        auto val = T(packet);
+                        if(!packet) {
+                            return packet;
+                        }
+                        vec.push_back(std::move(val));
                     }
-                    vec.push_back(std::move(val));
                 }
             }
         }
@@ -232,6 +305,20 @@ namespace cbdc {
         return packet;
     }
 
+    /// \brief Serializes a vector of booleans.
+    ///
+    /// Writes the number of elements as a 64-bit uint, followed by the
+    /// elements packed eight per byte, least significant bit first. This
+    /// replaced an encoding of one byte per element, so data written with
+    /// the old encoding, such as distributed transaction state persisted
+    /// by a two-phase commit coordinator, does not deserialize with it.
+    auto operator<<(serializer& ser, const std::vector<bool>& vec)
+        -> serializer&;
+
+    /// Deserializes a vector of booleans.
+    /// \see \ref cbdc::operator<<(serializer&, const std::vector<bool>&)
+    auto operator>>(serializer& deser, std::vector<bool>& vec) -> serializer&;
+
     /// Serializes the count of key-value pairs, and then each key and value,
     /// statically-casted.
     /// \see \ref cbdc::operator<<(serializer&, T)
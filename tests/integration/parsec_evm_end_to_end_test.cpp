@@ -19,6 +19,7 @@
 
 #include <gtest/gtest.h>
 #include <secp256k1.h>
+#include <thread>
 
 static void gtest_erc20_output_hex_to_ascii(const std::string& hex,
                                             std::string& out_asciistr) {
@@ -49,10 +50,7 @@ class parsec_evm_end_to_end_test : public ::testing::Test {
   protected:
     void SetUp() override {
         m_log->debug("parsec_evm_end_to_end_test::Setup()");
-        const auto rpc_server_endpoint
-            = cbdc::network::endpoint_t{"127.0.0.1", 7007};
-
-        init_jsonrpc_server_and_client(rpc_server_endpoint);
+        init_jsonrpc_server_and_client(m_rpc_server_endpoint);
 
         init_accounts();
     }
@@ -109,6 +107,7 @@ class parsec_evm_end_to_end_test : public ::testing::Test {
     std::shared_ptr<cbdc::logging::log> m_log{
         std::make_shared<cbdc::logging::log>(cbdc::logging::log_level::info)};
     cbdc::parsec::config m_cfg{};
+    cbdc::network::endpoint_t m_rpc_server_endpoint{"127.0.0.1", 7007};
     std::shared_ptr<cbdc::parsec::broker::interface> m_broker;
 
     std::unique_ptr<cbdc::parsec::agent::rpc::http_server> m_rpc_server;
@@ -709,3 +708,71 @@ TEST_F(parsec_evm_end_to_end_test, test_new_account_transaction_count) {
 
     ASSERT_EQ(new_acct_nonce, parsec_default_acct_nonce);
 }
+
+class parsec_evm_batch_end_to_end_test : public parsec_evm_end_to_end_test {
+  protected:
+    void SetUp() override {
+        m_cfg.m_evm_batch_size = 4;
+        parsec_evm_end_to_end_test::SetUp();
+    }
+};
+
+TEST_F(parsec_evm_batch_end_to_end_test, concurrent_transfers) {
+    // Do not re-use this test address within this module:
+    const evmc::address recipient{0xff0001};
+    constexpr uint64_t send_value = 1000;
+    constexpr uint64_t n_sends = 3;
+
+    // Both accounts send to the same recipient at once, each from its own
+    // client, so their transfers share batches and conflict on the
+    // recipient's account
+    const auto send = [&](const evmc::address& from_addr,
+                          const cbdc::privkey_t& from_privkey) {
+        auto client = cbdc::test::gtest_evm_jsonrpc_client(
+            std::vector<std::string>{
+                "http://" + m_rpc_server_endpoint.first + ":"
+                + std::to_string(m_rpc_server_endpoint.second)},
+            0,
+            m_log);
+        for(uint64_t i = 0; i < n_sends; i++) {
+            auto etx = cbdc::parsec::agent::runner::evm_tx();
+            etx.m_to = recipient;
+            etx.m_nonce = client.get_transaction_count(from_addr);
+            etx.m_value = evmc::uint256be(send_value);
+            etx.m_gas_price = evmc::uint256be(0);
+            etx.m_gas_limit = evmc::uint256be(0xffffffff);
+            auto sighash = cbdc::parsec::agent::runner::sig_hash(etx);
+            etx.m_sig = cbdc::parsec::agent::runner::eth_sign(from_privkey,
+                                                              sighash,
+                                                              etx.m_type,
+                                                              m_secp_context);
+            std::string txid{};
+            client.send_transaction(etx, txid);
+        }
+    };
+
+    auto t0 = std::thread([&]() {
+        send(m_acct0_ethaddr, m_acct0_privkey);
+    });
+    auto t1 = std::thread([&]() {
+        send(m_acct1_ethaddr, m_acct1_privkey);
+    });
+    t0.join();
+    t1.join();
+
+    const auto sent = evmc::uint256be(n_sends * send_value);
+    for(const auto& addr : {m_acct0_ethaddr, m_acct1_ethaddr}) {
+        std::optional<evmc::uint256be> balance;
+        m_rpc_client->get_balance(addr, balance);
+        ASSERT_TRUE(balance.has_value());
+        ASSERT_EQ(balance.value(),
+                  cbdc::parsec::agent::runner::operator-(m_init_acct_balance,
+                                                         sent));
+    }
+
+    std::optional<evmc::uint256be> recipient_balance;
+    m_rpc_client->get_balance(recipient, recipient_balance);
+    ASSERT_TRUE(recipient_balance.has_value());
+    ASSERT_EQ(recipient_balance.value(),
+              evmc::uint256be(2 * n_sends * send_value));
+}
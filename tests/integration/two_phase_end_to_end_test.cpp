@@ -142,6 +142,29 @@ TEST_F(two_phase_end_to_end_test, complete_transaction) {
     ASSERT_EQ(m_receiver->pending_input_count(), 0UL);
 }
 
+TEST_F(two_phase_end_to_end_test, send_async) {
+    auto addr = m_receiver->new_address();
+
+    auto confirmed = size_t{0};
+    auto cb = [&](const cbdc::transaction::full_tx& /* tx */,
+                  std::optional<cbdc::sentinel::execute_response> res) {
+        ASSERT_TRUE(res.has_value());
+        ASSERT_EQ(res->m_tx_status, cbdc::sentinel::tx_status::confirmed);
+        confirmed++;
+    };
+    for(size_t i = 0; i < 5; i++) {
+        auto tx = m_sender->send_async(10, addr, cb);
+        ASSERT_TRUE(tx.has_value());
+        ASSERT_LE(m_sender->in_flight_count(), m_opts.m_client_send_window);
+    }
+    m_sender->finish_sends();
+
+    ASSERT_EQ(confirmed, 5UL);
+    ASSERT_EQ(m_sender->in_flight_count(), 0UL);
+    ASSERT_EQ(m_sender->pending_tx_count(), 0UL);
+    ASSERT_EQ(m_sender->balance(), 50UL);
+}
+
 TEST_F(two_phase_end_to_end_test, duplicate_transaction) {
     auto addr = m_receiver->new_address();
 
@@ -210,6 +210,29 @@ TEST_F(ArchiverTest, digest_block_deferral) {
     ASSERT_EQ(m_archiver->best_block_height(), 3UL);
 }
 
+// Test if the archiver digests a burst of out of order blocks once the
+// missing block arrives
+TEST_F(ArchiverTest, digest_block_deferral_burst) {
+    m_archiver->init_leveldb();
+    m_archiver->init_best_block();
+    for(size_t i = m_dummy_blocks.size() - 1; i > 0; i--) {
+        m_archiver->digest_block(m_dummy_blocks[i]);
+        ASSERT_EQ(m_archiver->best_block_height(), 0UL);
+    }
+    // Duplicate deferred block
+    m_archiver->digest_block(m_dummy_blocks[5]);
+
+    m_archiver->digest_block(m_dummy_blocks[0]);
+    ASSERT_EQ(m_archiver->best_block_height(), m_dummy_blocks.size());
+    for(const auto& blk : m_dummy_blocks) {
+        auto stored = m_archiver->get_block(blk.m_height);
+        ASSERT_TRUE(stored.has_value());
+        ASSERT_EQ(stored.value(), blk);
+        ASSERT_EQ(stored.value().m_transactions[2].m_id,
+                  blk.m_transactions[2].m_id);
+    }
+}
+
 // Test the get_block function
 TEST_F(ArchiverTest, get_block) {
     m_archiver->init_leveldb();
@@ -234,7 +257,7 @@ TEST_F(ArchiverTest, server_handler) {
     m_archiver->digest_block(m_dummy_blocks[2]);
     auto pkt = std::make_shared<cbdc::buffer>();
     auto ser = cbdc::buffer_serializer(*pkt);
-    ser << static_cast<uint64_t>(1);
+    ser << cbdc::archiver::request{static_cast<uint64_t>(1)};
     auto msg = cbdc::network::message_t{pkt, 0};
     auto buf = m_archiver->server_handler(std::move(msg));
     ASSERT_TRUE(buf.has_value());
@@ -269,6 +292,84 @@ TEST_F(ArchiverTest, client) {
               m_dummy_blocks[0].m_transactions[2].m_id);
 }
 
+// Test retrieving ranges of blocks from the client
+TEST_F(ArchiverTest, client_get_blocks) {
+    m_archiver->init_leveldb();
+    m_archiver->init_best_block();
+    ASSERT_TRUE(m_archiver->init_archiver_server());
+    for(const auto& blk : m_dummy_blocks) {
+        m_archiver->digest_block(blk);
+    }
+
+    auto client
+        = cbdc::archiver::client(m_config_opts.m_archiver_endpoints[0], m_log);
+    ASSERT_TRUE(client.init());
+    auto blks = client.get_blocks(2, 5);
+    ASSERT_EQ(blks.size(), 4UL);
+    for(size_t i{0}; i < blks.size(); i++) {
+        ASSERT_EQ(blks[i], m_dummy_blocks[i + 1]);
+        ASSERT_EQ(blks[i].m_transactions[2].m_id,
+                  m_dummy_blocks[i + 1].m_transactions[2].m_id);
+    }
+
+    // Stops before the first missing block
+    blks = client.get_blocks(8, 20);
+    ASSERT_EQ(blks.size(), 3UL);
+    ASSERT_EQ(blks.back().m_height, 10UL);
+
+    ASSERT_TRUE(client.get_blocks(11, 20).empty());
+
+    // The connection is still usable for single blocks
+    auto blk = client.get_block(3);
+    ASSERT_TRUE(blk.has_value());
+    ASSERT_EQ(blk.value(), m_dummy_blocks[2]);
+}
+
+// Test serving blocks stored with the compact encoding
+TEST_F(ArchiverTest, client_get_blocks_compact) {
+    m_config_opts.m_compact_blocks = true;
+    m_archiver
+        = std::make_unique<cbdc::archiver::controller>(0,
+                                                       m_config_opts,
+                                                       m_log,
+                                                       0);
+    m_archiver->init_leveldb();
+    m_archiver->init_best_block();
+    ASSERT_TRUE(m_archiver->init_archiver_server());
+    m_archiver->digest_block(m_dummy_blocks[0]);
+    m_archiver->digest_block(m_dummy_blocks[1]);
+
+    auto client
+        = cbdc::archiver::client(m_config_opts.m_archiver_endpoints[0], m_log);
+    ASSERT_TRUE(client.init());
+    auto blks = client.get_blocks(1, 2);
+    ASSERT_EQ(blks.size(), 2UL);
+    ASSERT_EQ(blks[0], m_dummy_blocks[0]);
+    ASSERT_EQ(blks[1], m_dummy_blocks[1]);
+}
+
+// Test reading ranges of blocks, including ranges longer than the maximum
+TEST_F(ArchiverTest, get_blocks) {
+    m_archiver->init_leveldb();
+    m_archiver->init_best_block();
+    auto blk = m_dummy_blocks[0];
+    for(uint64_t h{1}; h <= cbdc::archiver::max_range_blocks + 2; h++) {
+        blk.m_height = h;
+        m_archiver->digest_block(blk);
+    }
+
+    auto blks = m_archiver->get_blocks(2, 4);
+    ASSERT_EQ(blks.size(), 3UL);
+    ASSERT_EQ(blks[0].m_height, 2UL);
+    ASSERT_EQ(blks[2].m_height, 4UL);
+    ASSERT_EQ(blks[1].m_transactions.size(), 20UL);
+
+    blks = m_archiver->get_blocks(1, cbdc::archiver::max_range_blocks + 10);
+    ASSERT_EQ(blks.size(), cbdc::archiver::max_range_blocks);
+
+    ASSERT_TRUE(m_archiver->get_blocks(5, 4).empty());
+}
+
 // Test if the archiver returns null for a non existent block
 TEST_F(ArchiverTest, get_block_non_existent) {
     m_archiver->init_leveldb();
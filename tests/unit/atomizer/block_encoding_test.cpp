@@ -0,0 +1,101 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/atomizer/atomizer/block_encoding.hpp"
+#include "uhs/atomizer/atomizer/format.hpp"
+#include "util/serialization/format.hpp"
+#include "util/serialization/util.hpp"
+
+#include <gtest/gtest.h>
+#include <limits>
+
+class block_encoding_test : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        m_blk.m_height = 42;
+        for(unsigned char i = 0; i < 5; i++) {
+            auto tx = cbdc::transaction::compact_tx();
+            tx.m_id = {i, 'i', 'd'};
+            tx.m_inputs.push_back({i, 'i', 'n'});
+            tx.m_uhs_outputs.push_back({i, 'o', 'u', 't', '0'});
+            tx.m_uhs_outputs.push_back({i, 'o', 'u', 't', '1'});
+            tx.m_attestations.emplace(m_pubkey0, cbdc::signature_t{i, 0});
+            tx.m_attestations.emplace(m_pubkey1, cbdc::signature_t{i, 1});
+            m_blk.m_transactions.push_back(std::move(tx));
+        }
+    }
+
+    static void expect_equal(const cbdc::atomizer::block& a,
+                             const cbdc::atomizer::block& b) {
+        ASSERT_EQ(a, b);
+        for(size_t i = 0; i < a.m_transactions.size(); i++) {
+            const auto& tx_a = a.m_transactions[i];
+            const auto& tx_b = b.m_transactions[i];
+            EXPECT_EQ(tx_a.m_inputs, tx_b.m_inputs);
+            EXPECT_EQ(tx_a.m_uhs_outputs, tx_b.m_uhs_outputs);
+            EXPECT_EQ(tx_a.m_attestations, tx_b.m_attestations);
+        }
+    }
+
+    cbdc::pubkey_t m_pubkey0{'p', 'k', '0'};
+    cbdc::pubkey_t m_pubkey1{'p', 'k', '1'};
+    cbdc::atomizer::block m_blk;
+};
+
+TEST_F(block_encoding_test, plain_matches_block_serialization) {
+    auto buf
+        = cbdc::atomizer::encode_block(m_blk,
+                                       cbdc::atomizer::block_encoding::plain);
+    ASSERT_EQ(*buf, cbdc::make_buffer(m_blk));
+
+    auto res = cbdc::atomizer::decode_block(*buf);
+    ASSERT_TRUE(res.has_value());
+    expect_equal(m_blk, res.value());
+}
+
+TEST_F(block_encoding_test, pubkey_table_roundtrip) {
+    auto buf = cbdc::atomizer::encode_block(
+        m_blk,
+        cbdc::atomizer::block_encoding::pubkey_table);
+    ASSERT_LT(buf->size(), cbdc::serialized_size(m_blk));
+
+    auto res = cbdc::atomizer::decode_block(*buf);
+    ASSERT_TRUE(res.has_value());
+    expect_equal(m_blk, res.value());
+}
+
+TEST_F(block_encoding_test, empty_block_roundtrip) {
+    auto blk = cbdc::atomizer::block();
+    blk.m_height = 7;
+    auto buf = cbdc::atomizer::encode_block(
+        blk,
+        cbdc::atomizer::block_encoding::pubkey_table);
+    auto res = cbdc::atomizer::decode_block(*buf);
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(blk, res.value());
+}
+
+TEST_F(block_encoding_test, malformed_blocks_rejected) {
+    auto buf = cbdc::atomizer::encode_block(
+        m_blk,
+        cbdc::atomizer::block_encoding::pubkey_table);
+
+    auto truncated = cbdc::buffer();
+    truncated.append(buf->data(), buf->size() - 1);
+    ASSERT_FALSE(cbdc::atomizer::decode_block(truncated).has_value());
+
+    // Reference a public key beyond the end of an empty table
+    auto bad_idx = cbdc::buffer();
+    auto ser = cbdc::buffer_serializer(bad_idx);
+    ser << std::numeric_limits<uint64_t>::max()
+        << cbdc::atomizer::block_encoding::pubkey_table << uint64_t{1}
+        << std::vector<cbdc::pubkey_t>() << uint64_t{1} << cbdc::hash_t()
+        << std::vector<cbdc::hash_t>() << std::vector<cbdc::hash_t>()
+        << uint64_t{1} << uint32_t{0} << cbdc::signature_t();
+    ASSERT_FALSE(cbdc::atomizer::decode_block(bad_idx).has_value());
+
+    auto empty = cbdc::buffer();
+    ASSERT_FALSE(cbdc::atomizer::decode_block(empty).has_value());
+}
@@ -0,0 +1,74 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/left_right.hpp"
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct counter_pair {
+        explicit counter_pair(uint64_t initial)
+            : m_first(initial),
+              m_second(initial) {}
+
+        uint64_t m_first;
+        uint64_t m_second;
+    };
+}
+
+TEST(left_right_test, read_after_write) {
+    auto lr = cbdc::left_right<counter_pair>(5);
+    ASSERT_EQ(lr.read([](const counter_pair& p) {
+        return p.m_first;
+    }),
+              5UL);
+
+    // Both copies receive the modification
+    for(uint64_t i{0}; i < 3; i++) {
+        lr.write([](counter_pair& p) {
+            p.m_first++;
+            p.m_second += 2;
+        });
+        auto vals = lr.read([](const counter_pair& p) {
+            return std::make_pair(p.m_first, p.m_second);
+        });
+        ASSERT_EQ(vals.first, 6 + i);
+        ASSERT_EQ(vals.second, 7 + 2 * i);
+    }
+}
+
+TEST(left_right_test, readers_see_complete_writes) {
+    auto lr = cbdc::left_right<counter_pair>(0);
+    constexpr uint64_t n_writes = 10000;
+    constexpr size_t n_readers = 4;
+
+    auto readers = std::vector<std::thread>();
+    for(size_t i{0}; i < n_readers; i++) {
+        readers.emplace_back([&]() {
+            uint64_t last{0};
+            while(last < n_writes) {
+                auto vals = lr.read([](const counter_pair& p) {
+                    return std::make_pair(p.m_first, p.m_second);
+                });
+                ASSERT_EQ(vals.first, vals.second);
+                ASSERT_GE(vals.first, last);
+                last = vals.first;
+            }
+        });
+    }
+
+    for(uint64_t i{0}; i < n_writes; i++) {
+        lr.write([](counter_pair& p) {
+            p.m_first++;
+            p.m_second++;
+        });
+    }
+
+    for(auto& t : readers) {
+        t.join();
+    }
+}
@@ -400,6 +400,41 @@ TEST_F(PacketIOTest, SentinelResponsePendingTest) {
     ASSERT_EQ(resp, resp_deser);
 }
 
+TEST_F(PacketIOTest, SentinelBatchRequestTest) {
+    cbdc::transaction::full_tx tx;
+    tx.m_outputs.emplace_back();
+    tx.m_outputs[0].m_value = 30;
+    tx.m_outputs[0].m_witness_program_commitment = {'q', 'e', 'n', 'r'};
+    tx.m_witness.emplace_back(64, std::byte(1));
+
+    auto req = cbdc::sentinel::request{
+        cbdc::sentinel::execute_batch_request{{tx, tx}}};
+    m_ser << req;
+    auto req_deser = cbdc::sentinel::request{};
+    m_deser >> req_deser;
+    ASSERT_EQ(req, req_deser);
+}
+
+TEST_F(PacketIOTest, SentinelBatchResponseTest) {
+    auto tx_err = cbdc::transaction::validation::tx_error{
+        cbdc::transaction::validation::output_error{
+            cbdc::transaction::validation::output_error_code::zero_value,
+            20}};
+    auto batch_resp = cbdc::sentinel::execute_batch_response{
+        {cbdc::sentinel::execute_response{
+             cbdc::sentinel::tx_status::static_invalid,
+             tx_err},
+         std::nullopt,
+         cbdc::sentinel::execute_response{
+             cbdc::sentinel::tx_status::confirmed,
+             std::nullopt}}};
+    auto resp = cbdc::sentinel::response{batch_resp};
+    m_ser << resp;
+    auto resp_deser = cbdc::sentinel::response{};
+    m_deser >> resp_deser;
+    ASSERT_EQ(resp, resp_deser);
+}
+
 TEST_F(PacketIOTest, empty_optional_test) {
     auto opt = std::optional<cbdc::atomizer::block>();
     m_ser << opt;
@@ -0,0 +1,109 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "parsec/agent/conflict_graph.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+    using cbdc::parsec::broker::held_locks_set_type;
+    using cbdc::parsec::broker::lock_type;
+
+    auto make_key(uint64_t i) -> cbdc::buffer {
+        auto key = cbdc::buffer();
+        key.append("key", 3);
+        key.append(&i, sizeof(i));
+        return key;
+    }
+}
+
+class conflict_graph_test : public ::testing::Test {
+  protected:
+    cbdc::parsec::agent::conflict_graph m_graph;
+};
+
+TEST_F(conflict_graph_test, disjoint_test) {
+    for(uint64_t i = 0; i < 10; i++) {
+        auto deps = m_graph.add(held_locks_set_type{
+            {make_key(i), lock_type::write},
+            {make_key(i + 100), lock_type::read}});
+        ASSERT_TRUE(deps.empty());
+    }
+    ASSERT_EQ(m_graph.size(), 10);
+}
+
+TEST_F(conflict_graph_test, shared_reads_test) {
+    for(uint64_t i = 0; i < 10; i++) {
+        auto deps = m_graph.add(
+            held_locks_set_type{{make_key(0), lock_type::read},
+                                {make_key(i + 1), lock_type::write}});
+        ASSERT_TRUE(deps.empty());
+    }
+}
+
+TEST_F(conflict_graph_test, write_after_write_test) {
+    // Transfers from the same hot account run in batch order
+    for(uint64_t i = 0; i < 10; i++) {
+        auto deps = m_graph.add(
+            held_locks_set_type{{make_key(0), lock_type::write},
+                                {make_key(i + 1), lock_type::write}});
+        if(i == 0) {
+            ASSERT_TRUE(deps.empty());
+        } else {
+            ASSERT_EQ(deps, std::vector<size_t>{i - 1});
+        }
+    }
+}
+
+TEST_F(conflict_graph_test, read_write_test) {
+    auto deps
+        = m_graph.add(held_locks_set_type{{make_key(0), lock_type::read}});
+    ASSERT_TRUE(deps.empty());
+    deps = m_graph.add(held_locks_set_type{{make_key(0), lock_type::read}});
+    ASSERT_TRUE(deps.empty());
+
+    // The writer waits for both readers
+    deps = m_graph.add(held_locks_set_type{{make_key(0), lock_type::write}});
+    ASSERT_EQ(deps, (std::vector<size_t>{0, 1}));
+
+    // Later readers wait only for the writer
+    deps = m_graph.add(held_locks_set_type{{make_key(0), lock_type::read}});
+    ASSERT_EQ(deps, std::vector<size_t>{2});
+
+    deps = m_graph.add(held_locks_set_type{{make_key(0), lock_type::write}});
+    ASSERT_EQ(deps, (std::vector<size_t>{2, 3}));
+}
+
+TEST_F(conflict_graph_test, multiple_keys_test) {
+    auto deps
+        = m_graph.add(held_locks_set_type{{make_key(0), lock_type::write}});
+    ASSERT_TRUE(deps.empty());
+    deps = m_graph.add(held_locks_set_type{{make_key(1), lock_type::write}});
+    ASSERT_TRUE(deps.empty());
+    deps = m_graph.add(held_locks_set_type{{make_key(0), lock_type::read},
+                                           {make_key(1), lock_type::read},
+                                           {make_key(2), lock_type::write}});
+    ASSERT_EQ(deps, (std::vector<size_t>{0, 1}));
+}
+
+TEST_F(conflict_graph_test, unknown_accesses_test) {
+    auto deps
+        = m_graph.add(held_locks_set_type{{make_key(0), lock_type::write}});
+    ASSERT_TRUE(deps.empty());
+    deps = m_graph.add(held_locks_set_type{{make_key(1), lock_type::read}});
+    ASSERT_TRUE(deps.empty());
+
+    // A transaction with unknown accesses waits for everything before it
+    deps = m_graph.add(std::nullopt);
+    ASSERT_EQ(deps, (std::vector<size_t>{0, 1}));
+
+    // Everything after it waits for it, but not for what came before
+    deps = m_graph.add(held_locks_set_type{{make_key(0), lock_type::write}});
+    ASSERT_EQ(deps, std::vector<size_t>{2});
+    deps = m_graph.add(held_locks_set_type{{make_key(3), lock_type::read}});
+    ASSERT_EQ(deps, std::vector<size_t>{2});
+    deps = m_graph.add(std::nullopt);
+    ASSERT_EQ(deps, (std::vector<size_t>{2, 3, 4}));
+}
@@ -0,0 +1,86 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "parsec/agent/runners/evm/code_cache.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+    auto make_buf(const std::string& str) -> cbdc::buffer {
+        auto buf = cbdc::buffer();
+        buf.append(str.data(), str.size());
+        return buf;
+    }
+}
+
+TEST(code_cache_test, get_put_test) {
+    auto cache = cbdc::parsec::agent::runner::code_cache(4);
+    auto key = make_buf("key");
+    ASSERT_FALSE(cache.get(key).has_value());
+
+    ASSERT_TRUE(cache.put(key, make_buf("code"), 1));
+    auto res = cache.get(key);
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(res.value(), make_buf("code"));
+    ASSERT_EQ(cache.size(), 1);
+
+    // Code read by an earlier ticket does not replace the entry
+    ASSERT_TRUE(cache.put(key, make_buf("older"), 0));
+    ASSERT_EQ(cache.get(key).value(), make_buf("code"));
+    ASSERT_TRUE(cache.put(key, make_buf("newer"), 2));
+    ASSERT_EQ(cache.get(key).value(), make_buf("newer"));
+    ASSERT_EQ(cache.size(), 1);
+}
+
+TEST(code_cache_test, empty_code_test) {
+    auto cache = cbdc::parsec::agent::runner::code_cache(4);
+    auto key = make_buf("key");
+    ASSERT_FALSE(cache.put(key, cbdc::buffer(), 1));
+    ASSERT_FALSE(cache.get(key).has_value());
+    ASSERT_EQ(cache.size(), 0);
+}
+
+TEST(code_cache_test, disabled_test) {
+    auto cache = cbdc::parsec::agent::runner::code_cache(0);
+    auto key = make_buf("key");
+    ASSERT_FALSE(cache.put(key, make_buf("code"), 1));
+    ASSERT_FALSE(cache.get(key).has_value());
+}
+
+TEST(code_cache_test, eviction_test) {
+    auto cache = cbdc::parsec::agent::runner::code_cache(2);
+    auto key0 = make_buf("key0");
+    auto key1 = make_buf("key1");
+    auto key2 = make_buf("key2");
+    ASSERT_TRUE(cache.put(key0, make_buf("code0"), 1));
+    ASSERT_TRUE(cache.put(key1, make_buf("code1"), 1));
+
+    // key1 becomes the least recently used
+    ASSERT_TRUE(cache.get(key0).has_value());
+    ASSERT_TRUE(cache.put(key2, make_buf("code2"), 1));
+    ASSERT_EQ(cache.size(), 2);
+    ASSERT_TRUE(cache.get(key0).has_value());
+    ASSERT_FALSE(cache.get(key1).has_value());
+    ASSERT_TRUE(cache.get(key2).has_value());
+}
+
+TEST(code_cache_test, invalidate_test) {
+    auto cache = cbdc::parsec::agent::runner::code_cache(4);
+    auto key0 = make_buf("key0");
+    auto key1 = make_buf("key1");
+    ASSERT_TRUE(cache.put(key0, make_buf("code0"), 1));
+    ASSERT_TRUE(cache.put(key1, make_buf("code1"), 1));
+
+    cache.invalidate(key0, 5);
+    ASSERT_FALSE(cache.get(key0).has_value());
+    ASSERT_TRUE(cache.get(key1).has_value());
+    ASSERT_EQ(cache.size(), 1);
+
+    // Code read before the invalidating ticket may be stale
+    ASSERT_FALSE(cache.put(key0, make_buf("stale"), 4));
+    ASSERT_FALSE(cache.get(key0).has_value());
+    ASSERT_TRUE(cache.put(key0, make_buf("fresh"), 6));
+    ASSERT_EQ(cache.get(key0).value(), make_buf("fresh"));
+}
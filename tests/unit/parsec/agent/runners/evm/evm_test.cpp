@@ -181,7 +181,8 @@ TEST_F(evm_test, host_storage) {
         tx_ctx,
         {},
         false,
-        0);
+        0,
+        nullptr);
     ASSERT_EQ(host.set_storage(addr3, val2, val2), EVMC_STORAGE_ADDED);
     ASSERT_FALSE(host.should_retry());
     m = host.get_state_updates();
@@ -198,7 +199,8 @@ TEST_F(evm_test, host_storage) {
         tx_ctx,
         {},
         false,
-        0);
+        0,
+        nullptr);
     const auto& chost = host;
 
     // Null bytes returned for non-existing accounts.
@@ -230,6 +232,336 @@ TEST_F(evm_test, host_storage) {
     EXPECT_EQ(host.set_storage(addr3, val2, val1), EVMC_STORAGE_DELETED);
 }
 
+TEST_F(evm_test, host_shared_code) {
+    const auto addr = evmc::address{0xff0000};
+    const auto code = cbdc::parsec::agent::runner::evm_account_code{0x60,
+                                                                    0x00};
+
+    auto tx_ctx = evmc_tx_context();
+
+    auto m = std::unordered_map<cbdc::buffer,
+                                cbdc::buffer,
+                                cbdc::hashing::const_sip_hash<cbdc::buffer>>();
+    m[cbdc::make_buffer(cbdc::parsec::agent::runner::code_key{addr})]
+        = cbdc::make_buffer(code);
+
+    auto cache = std::make_shared<cbdc::parsec::agent::runner::code_cache>(
+        cbdc::parsec::agent::runner::code_cache::default_max_entries);
+    size_t n_locks{0};
+    auto try_lock
+        = [&](const cbdc::parsec::runtime_locking_shard::key_type& k,
+              cbdc::parsec::broker::lock_type /* locktype */,
+              const cbdc::parsec::broker::interface::try_lock_callback_type&
+                  cb) {
+              n_locks++;
+              cb(m[k]);
+              return true;
+          };
+
+    auto host = cbdc::parsec::agent::runner::evm_host(m_log,
+                                                      try_lock,
+                                                      tx_ctx,
+                                                      {},
+                                                      false,
+                                                      1,
+                                                      cache);
+    const auto& chost = host;
+    EXPECT_EQ(chost.get_code_size(addr), code.size());
+    EXPECT_EQ(n_locks, 1);
+    EXPECT_EQ(cache->size(), 1);
+
+    // A later host uses the shared code without locking the code key
+    host = cbdc::parsec::agent::runner::evm_host(m_log,
+                                                 try_lock,
+                                                 tx_ctx,
+                                                 {},
+                                                 false,
+                                                 2,
+                                                 cache);
+    EXPECT_EQ(chost.get_code_size(addr), code.size());
+    EXPECT_EQ(n_locks, 1);
+    EXPECT_FALSE(host.should_retry());
+}
+
+TEST_F(evm_test, host_prefetch_access_list) {
+    const auto addr1 = evmc::address{0xff0000};
+    const auto addr2 = evmc::address{0xff0001};
+    const auto slot1 = evmc::bytes32{1};
+    const auto slot2 = evmc::bytes32{2};
+    const auto val = evmc::bytes32{3};
+    const auto code = cbdc::parsec::agent::runner::evm_account_code{0x60,
+                                                                    0x00};
+
+    auto tx_ctx = evmc_tx_context();
+    auto tx = cbdc::parsec::agent::runner::evm_tx();
+    tx.m_to = addr1;
+    // Duplicate slots, within and across entries, are only locked once
+    tx.m_access_list = {{addr1, {slot1, slot2, slot1}},
+                        {addr2, {slot1}},
+                        {addr1, {slot1}}};
+
+    auto m = std::unordered_map<cbdc::buffer,
+                                cbdc::buffer,
+                                cbdc::hashing::const_sip_hash<cbdc::buffer>>();
+    m[cbdc::make_buffer(cbdc::parsec::agent::runner::code_key{addr1})]
+        = cbdc::make_buffer(code);
+    m[cbdc::make_buffer(
+        cbdc::parsec::agent::runner::storage_key{addr1, slot1})]
+        = cbdc::make_buffer(val);
+
+    auto n_locks
+        = std::unordered_map<cbdc::buffer,
+                             size_t,
+                             cbdc::hashing::const_sip_hash<cbdc::buffer>>();
+    auto try_lock
+        = [&](const cbdc::parsec::runtime_locking_shard::key_type& k,
+              cbdc::parsec::broker::lock_type /* locktype */,
+              const cbdc::parsec::broker::interface::try_lock_callback_type&
+                  cb) {
+              n_locks[k]++;
+              cb(m[k]);
+              return true;
+          };
+
+    // Accesses in the order the interpreter makes them for SLOAD and
+    // BALANCE
+    auto accesses = [&](cbdc::parsec::agent::runner::evm_host& h) {
+        auto res = std::vector<evmc_access_status>();
+        res.push_back(h.access_storage(addr1, slot1));
+        EXPECT_EQ(h.get_storage(addr1, slot1), val);
+        res.push_back(h.access_storage(addr1, slot1));
+        res.push_back(h.access_storage(addr1, slot2));
+        res.push_back(h.access_account(addr1));
+        res.push_back(h.access_account(addr2));
+        return res;
+    };
+
+    auto host = cbdc::parsec::agent::runner::evm_host(m_log,
+                                                      try_lock,
+                                                      tx_ctx,
+                                                      tx,
+                                                      false,
+                                                      0,
+                                                      nullptr);
+    auto n_callbacks = size_t{0};
+    host.prefetch([&]() {
+        n_callbacks++;
+    });
+    ASSERT_EQ(n_callbacks, 1);
+    ASSERT_FALSE(host.should_retry());
+    // Recipient code, and the three distinct slots
+    ASSERT_EQ(n_locks.size(), 4);
+
+    // Prefetching does not warm the accessed state
+    const auto prefetched = accesses(host);
+    EXPECT_EQ(prefetched,
+              (std::vector<evmc_access_status>{EVMC_ACCESS_COLD,
+                                               EVMC_ACCESS_WARM,
+                                               EVMC_ACCESS_COLD,
+                                               EVMC_ACCESS_WARM,
+                                               EVMC_ACCESS_COLD}));
+
+    // Later reads of prefetched state use the cache
+    EXPECT_EQ(host.get_code_size(addr1), code.size());
+    EXPECT_EQ(host.get_storage(addr1, slot2), evmc::bytes32{});
+    EXPECT_EQ(host.get_storage(addr2, slot1), evmc::bytes32{});
+    EXPECT_EQ(n_locks.size(), 4);
+    for(const auto& [k, n] : n_locks) {
+        EXPECT_EQ(n, 1);
+    }
+    EXPECT_FALSE(host.should_retry());
+
+    // Accesses are the same as without prefetching
+    n_locks.clear();
+    auto unfetched = cbdc::parsec::agent::runner::evm_host(m_log,
+                                                           try_lock,
+                                                           tx_ctx,
+                                                           tx,
+                                                           false,
+                                                           0,
+                                                           nullptr);
+    EXPECT_EQ(accesses(unfetched), prefetched);
+    EXPECT_EQ(n_locks.size(), 1);
+}
+
+TEST_F(evm_test, host_prefetch_lock_error) {
+    const auto addr = evmc::address{0xff0000};
+    const auto slot1 = evmc::bytes32{1};
+    const auto slot2 = evmc::bytes32{2};
+
+    auto tx_ctx = evmc_tx_context();
+    auto tx = cbdc::parsec::agent::runner::evm_tx();
+    tx.m_access_list = {{addr, {slot1, slot2}}};
+
+    const auto failed_key = cbdc::make_buffer(
+        cbdc::parsec::agent::runner::storage_key{addr, slot1});
+    auto try_lock
+        = [&](const cbdc::parsec::runtime_locking_shard::key_type& k,
+              cbdc::parsec::broker::lock_type /* locktype */,
+              const cbdc::parsec::broker::interface::try_lock_callback_type&
+                  cb) {
+              if(k == failed_key) {
+                  cb(cbdc::parsec::broker::interface::error_code::
+                         shard_unreachable);
+              } else {
+                  cb(cbdc::buffer());
+              }
+              return true;
+          };
+
+    auto host = cbdc::parsec::agent::runner::evm_host(m_log,
+                                                      try_lock,
+                                                      tx_ctx,
+                                                      tx,
+                                                      false,
+                                                      0,
+                                                      nullptr);
+    auto n_callbacks = size_t{0};
+    host.prefetch([&]() {
+        n_callbacks++;
+    });
+    EXPECT_EQ(n_callbacks, 1);
+    EXPECT_TRUE(host.should_retry());
+}
+
+TEST_F(evm_test, host_prefetch_partial_send) {
+    const auto addr = evmc::address{0xff0000};
+    const auto slot1 = evmc::bytes32{1};
+    const auto slot2 = evmc::bytes32{2};
+    const auto slot3 = evmc::bytes32{3};
+    const auto slot4 = evmc::bytes32{4};
+
+    auto tx_ctx = evmc_tx_context();
+    auto tx = cbdc::parsec::agent::runner::evm_tx();
+    tx.m_access_list = {{addr, {slot1, slot2, slot3, slot4}}};
+
+    // The first two requests are sent and complete later, the third
+    // cannot be sent.
+    auto pending = std::vector<
+        cbdc::parsec::broker::interface::try_lock_callback_type>();
+    auto n_requests = size_t{0};
+    auto try_lock
+        = [&](const cbdc::parsec::runtime_locking_shard::key_type& /* k */,
+              cbdc::parsec::broker::lock_type /* locktype */,
+              const cbdc::parsec::broker::interface::try_lock_callback_type&
+                  cb) {
+              n_requests++;
+              if(n_requests > 2) {
+                  return false;
+              }
+              pending.push_back(cb);
+              return true;
+          };
+
+    auto host = cbdc::parsec::agent::runner::evm_host(m_log,
+                                                      try_lock,
+                                                      tx_ctx,
+                                                      tx,
+                                                      false,
+                                                      0,
+                                                      nullptr);
+    auto n_callbacks = size_t{0};
+    host.prefetch([&]() {
+        n_callbacks++;
+    });
+    // No more requests are sent after one fails
+    ASSERT_EQ(n_requests, 3);
+    ASSERT_EQ(pending.size(), 2);
+    EXPECT_EQ(n_callbacks, 0);
+    EXPECT_TRUE(host.should_retry());
+
+    pending[0](cbdc::buffer());
+    EXPECT_EQ(n_callbacks, 0);
+    pending[1](cbdc::buffer());
+    EXPECT_EQ(n_callbacks, 1);
+    EXPECT_TRUE(host.should_retry());
+
+    // When no request is sent, the callback is called immediately
+    n_requests = 2;
+    pending.clear();
+    host = cbdc::parsec::agent::runner::evm_host(m_log,
+                                                 try_lock,
+                                                 tx_ctx,
+                                                 tx,
+                                                 false,
+                                                 0,
+                                                 nullptr);
+    host.prefetch([&]() {
+        n_callbacks++;
+    });
+    EXPECT_EQ(n_requests, 3);
+    EXPECT_TRUE(pending.empty());
+    EXPECT_EQ(n_callbacks, 2);
+    EXPECT_TRUE(host.should_retry());
+}
+
+TEST_F(evm_test, prefetch_lock_error_wounds) {
+    const auto slot = evmc::bytes32{1};
+    auto tx = cbdc::parsec::agent::runner::evm_tx();
+    tx.m_type = cbdc::parsec::agent::runner::evm_tx_type::access_list;
+    tx.m_to = m_addr2_addr;
+    tx.m_nonce = evmc::uint256be(1);
+    tx.m_gas_price = evmc::uint256be(1);
+    tx.m_gas_limit = evmc::uint256be(50000);
+    tx.m_access_list = {{m_addr2_addr, {slot}}};
+    auto sighash = cbdc::parsec::agent::runner::sig_hash(tx);
+    tx.m_sig = cbdc::parsec::agent::runner::eth_sign(m_priv1,
+                                                     sighash,
+                                                     tx.m_type,
+                                                     m_secp_context);
+    auto params = cbdc::make_buffer(tx);
+
+    auto acc = cbdc::parsec::agent::runner::evm_account();
+    acc.m_balance = evmc::uint256be(1000000);
+    const auto from_key = cbdc::make_buffer(m_addr1_addr);
+    const auto from_val = cbdc::make_buffer(acc);
+    const auto failed_key = cbdc::make_buffer(
+        cbdc::parsec::agent::runner::storage_key{m_addr2_addr, slot});
+    auto try_lock
+        = [&](const cbdc::parsec::runtime_locking_shard::key_type& k,
+              cbdc::parsec::broker::lock_type /* locktype */,
+              const cbdc::parsec::broker::interface::try_lock_callback_type&
+                  cb) {
+              if(k == failed_key) {
+                  cb(cbdc::parsec::broker::interface::error_code::
+                         shard_unreachable);
+              } else if(k == from_key) {
+                  cb(from_val);
+              } else {
+                  cb(cbdc::buffer());
+              }
+              return true;
+          };
+
+    auto prom = std::promise<
+        cbdc::parsec::agent::runner::interface::run_return_type>();
+    auto fut = prom.get_future();
+    auto runner = std::make_shared<cbdc::parsec::agent::runner::evm_runner>(
+        m_log,
+        m_cfg,
+        cbdc::make_buffer(cbdc::parsec::agent::runner::evm_runner_function::
+                              execute_transaction),
+        params,
+        false,
+        [&](const cbdc::parsec::agent::runner::interface::run_return_type&
+                res) {
+            prom.set_value(res);
+        },
+        try_lock,
+        m_secp_context,
+        nullptr,
+        0);
+    ASSERT_TRUE(runner->run());
+    ASSERT_EQ(fut.wait_for(std::chrono::seconds(2)),
+              std::future_status::ready);
+    auto res = fut.get();
+    ASSERT_TRUE(std::holds_alternative<
+                cbdc::parsec::agent::runner::interface::error_code>(res));
+    ASSERT_EQ(
+        std::get<cbdc::parsec::agent::runner::interface::error_code>(res),
+        cbdc::parsec::agent::runner::interface::error_code::wounded);
+}
+
 TEST_F(evm_test, simple_send) {
     auto tx = cbdc::parsec::agent::runner::evm_tx();
     tx.m_to = m_addr2_addr;
@@ -0,0 +1,140 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "parsec/agent/runners/lua/state_pool.hpp"
+
+#include <gtest/gtest.h>
+#include <thread>
+
+class lua_state_pool_test : public ::testing::Test {
+  protected:
+    static void setup(lua_State* L) {
+        lua_pushinteger(L, 1);
+        lua_setglobal(L, "setup_value");
+    }
+
+    cbdc::parsec::agent::runner::lua_state_pool m_pool{&setup, 1};
+};
+
+TEST_F(lua_state_pool_test, reuse_test) {
+    auto* L = m_pool.acquire();
+    ASSERT_NE(L, nullptr);
+    ASSERT_EQ(m_pool.size(), 0UL);
+    ASSERT_EQ(lua_getglobal(L, "setup_value"), LUA_TNUMBER);
+
+    m_pool.release(L);
+    ASSERT_EQ(m_pool.size(), 1UL);
+    ASSERT_EQ(m_pool.acquire(), L);
+
+    // The pool is full, so the second state is closed
+    auto* L2 = m_pool.acquire();
+    ASSERT_NE(L2, nullptr);
+    ASSERT_NE(L2, L);
+    m_pool.release(L);
+    m_pool.release(L2);
+    ASSERT_EQ(m_pool.size(), 1UL);
+    ASSERT_EQ(m_pool.acquire(), L);
+    m_pool.release(L);
+}
+
+TEST_F(lua_state_pool_test, isolation_test) {
+    auto* L = m_pool.acquire();
+    ASSERT_NE(L, nullptr);
+    static constexpr auto contract = "x = 1\n"
+                                     "setup_value = nil\n"
+                                     "string.rep = nil\n"
+                                     "table.extra = {}\n"
+                                     "package.searchers[1] = nil\n"
+                                     "getmetatable('').__index = {}\n"
+                                     "setmetatable(_G, {})\n"
+                                     "debug.setmetatable(0, {})\n"
+                                     "collectgarbage('stop')\n";
+    ASSERT_EQ(luaL_dostring(L, contract), LUA_OK);
+    m_pool.release(L);
+
+    ASSERT_EQ(m_pool.acquire(), L);
+    static constexpr auto check
+        = "assert(x == nil)\n"
+          "assert(setup_value == 1)\n"
+          "assert(('a'):rep(2) == 'aa')\n"
+          "assert(table.extra == nil)\n"
+          "assert(package.searchers[1] ~= nil)\n"
+          "assert(getmetatable(_G) == nil)\n"
+          "assert(debug.getmetatable(0) == nil)\n"
+          "assert(collectgarbage('isrunning'))\n";
+    ASSERT_EQ(luaL_dostring(L, check), LUA_OK);
+    m_pool.release(L);
+}
+
+TEST_F(lua_state_pool_test, random_reseed_test) {
+    static constexpr auto seeded = "math.randomseed(42)\n"
+                                   "return math.random(1 << 30)\n";
+    static constexpr auto unseeded = "return math.random(1 << 30)\n";
+
+    auto* L = m_pool.acquire();
+    ASSERT_NE(L, nullptr);
+    ASSERT_EQ(luaL_dostring(L, seeded), LUA_OK);
+    const auto first = lua_tointeger(L, -1);
+    m_pool.release(L);
+
+    // The generator was reseeded, so does not repeat the seeded sequence
+    ASSERT_EQ(m_pool.acquire(), L);
+    ASSERT_EQ(luaL_dostring(L, unseeded), LUA_OK);
+    ASSERT_NE(lua_tointeger(L, -1), first);
+    m_pool.release(L);
+}
+
+TEST_F(lua_state_pool_test, release_thread_test) {
+    auto* L = m_pool.acquire();
+    ASSERT_NE(L, nullptr);
+
+    // A state can be returned from another thread
+    auto t = std::thread([&]() {
+        m_pool.release(L);
+    });
+    t.join();
+    ASSERT_EQ(m_pool.size(), 1UL);
+    ASSERT_EQ(m_pool.acquire(), L);
+    m_pool.release(L);
+}
+
+TEST_F(lua_state_pool_test, load_test) {
+    static constexpr auto contract
+        = "1b4c7561540019930d0a1a0a0408087856000000000000000000000028774001808"
+          "1860100038d8b0000018e00010203810100c40002020f0000019300000052000000"
+          "0f0004018b000004928003058b000004c8000200c700010086048276048a636f726"
+          "f7574696e6504867969656c64048668656c6c6f0482740483686981000000808080"
+          "8080";
+    auto func = cbdc::buffer::from_hex(contract).value();
+
+    auto* L = m_pool.acquire();
+    ASSERT_NE(L, nullptr);
+    const auto top = lua_gettop(L);
+    ASSERT_EQ(cbdc::parsec::agent::runner::lua_state_pool::load(L,
+                                                                 func,
+                                                                 "contract"),
+              LUA_OK);
+    ASSERT_EQ(lua_gettop(L), top + 1);
+    ASSERT_EQ(lua_type(L, -1), LUA_TFUNCTION);
+    const auto* fn = lua_topointer(L, -1);
+    m_pool.release(L);
+
+    // The state loaded the contract before, so returns the same function
+    ASSERT_EQ(m_pool.acquire(), L);
+    ASSERT_EQ(cbdc::parsec::agent::runner::lua_state_pool::load(L,
+                                                                 func,
+                                                                 "contract"),
+              LUA_OK);
+    ASSERT_EQ(lua_topointer(L, -1), fn);
+
+    auto invalid = cbdc::buffer();
+    invalid.append("x = 1", 5);
+    ASSERT_NE(cbdc::parsec::agent::runner::lua_state_pool::load(L,
+                                                                 invalid,
+                                                                 "contract"),
+              LUA_OK);
+    ASSERT_EQ(lua_gettop(L), top + 1);
+    m_pool.release(L);
+}
@@ -7,9 +7,17 @@
 #include "parsec/broker/impl.hpp"
 #include "parsec/directory/impl.hpp"
 #include "parsec/runtime_locking_shard/impl.hpp"
+#include "parsec/ticket_machine/client.hpp"
 #include "parsec/ticket_machine/impl.hpp"
+#include "util/rpc/format.hpp"
+#include "util/rpc/tcp_server.hpp"
+#include "util/serialization/format.hpp"
 
+#include <atomic>
+#include <cstring>
+#include <future>
 #include <gtest/gtest.h>
+#include <thread>
 
 TEST(broker_test, deploy_test) {
     auto log = std::make_shared<cbdc::logging::log>(
@@ -44,3 +52,530 @@ TEST(broker_test, deploy_test) {
 
     cbdc::test::add_to_shard(broker, deploy_contract_key, deploy_contract);
 }
+
+namespace {
+    /// Ticket machine which counts the ticket number ranges it assigns.
+    class counting_ticketer : public cbdc::parsec::ticket_machine::interface {
+      public:
+        counting_ticketer(std::shared_ptr<cbdc::logging::log> log,
+                          cbdc::parsec::ticket_machine::ticket_number_type
+                              range)
+            : m_impl(std::move(log), range) {}
+
+        auto get_ticket_number(get_ticket_number_callback_type result_callback)
+            -> bool override {
+            m_requests++;
+            return m_impl.get_ticket_number(std::move(result_callback));
+        }
+
+        std::atomic<size_t> m_requests{};
+
+      private:
+        cbdc::parsec::ticket_machine::impl m_impl;
+    };
+
+    auto make_broker(
+        const std::shared_ptr<cbdc::logging::log>& log,
+        std::shared_ptr<cbdc::parsec::ticket_machine::interface> ticketer,
+        std::chrono::milliseconds lease_duration)
+        -> std::shared_ptr<cbdc::parsec::broker::impl> {
+        auto shard
+            = std::make_shared<cbdc::parsec::runtime_locking_shard::impl>(
+                log);
+        auto directory = std::make_shared<cbdc::parsec::directory::impl>(1);
+        return std::make_shared<cbdc::parsec::broker::impl>(
+            0,
+            std::vector<std::shared_ptr<
+                cbdc::parsec::runtime_locking_shard::interface>>({shard}),
+            std::move(ticketer),
+            directory,
+            log,
+            lease_duration);
+    }
+
+    auto begin_ticket(cbdc::parsec::broker::impl& broker)
+        -> cbdc::parsec::broker::ticket_number_type {
+        auto ticket
+            = std::optional<cbdc::parsec::broker::ticket_number_type>();
+        auto res = broker.begin(
+            [&](cbdc::parsec::broker::interface::ticketnum_or_errcode_type r) {
+                ASSERT_TRUE(
+                    std::holds_alternative<
+                        cbdc::parsec::broker::ticket_number_type>(r));
+                ticket = std::get<cbdc::parsec::broker::ticket_number_type>(r);
+            });
+        EXPECT_TRUE(res);
+        EXPECT_TRUE(ticket.has_value());
+        return ticket.value_or(0);
+    }
+}
+
+TEST(broker_test, ticket_lease_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    constexpr auto range = 10;
+    auto ticketer = std::make_shared<counting_ticketer>(log, range);
+    auto broker = make_broker(log, ticketer, std::chrono::minutes(1));
+
+    constexpr auto n_tickets = 20;
+    for(cbdc::parsec::broker::ticket_number_type i = 0; i < n_tickets; i++) {
+        ASSERT_EQ(begin_ticket(*broker), i);
+    }
+    // Two ranges of ten tickets, plus the prefetched next range.
+    ASSERT_EQ(ticketer->m_requests, 3UL);
+}
+
+TEST(broker_test, ticket_lease_highest_ticket_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    constexpr auto range = 10;
+    auto ticketer = std::make_shared<counting_ticketer>(log, range);
+    auto broker = make_broker(log, ticketer, std::chrono::minutes(1));
+
+    // Leased ticket numbers which were not handed out yet do not count.
+    constexpr auto n_tickets = 25;
+    for(size_t i = 0; i < n_tickets; i++) {
+        auto ticket = begin_ticket(*broker);
+        ASSERT_EQ(broker->highest_ticket(), ticket);
+    }
+
+    broker = make_broker(log,
+                         std::make_shared<counting_ticketer>(log, range),
+                         std::chrono::milliseconds::zero());
+    for(size_t i = 0; i < 3; i++) {
+        auto ticket = begin_ticket(*broker);
+        ASSERT_EQ(broker->highest_ticket(), ticket);
+    }
+}
+
+TEST(broker_test, ticket_lease_expiry_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    constexpr auto range = 10;
+    auto ticketer = std::make_shared<counting_ticketer>(log, range);
+    auto broker
+        = make_broker(log, ticketer, std::chrono::milliseconds::zero());
+
+    // Each lease expires immediately, so every ticket comes from a new
+    // range and is younger than all previously assigned tickets.
+    auto prev = begin_ticket(*broker);
+    for(size_t i = 0; i < 3; i++) {
+        auto ticket = begin_ticket(*broker);
+        ASSERT_GT(ticket, prev);
+        ASSERT_EQ(ticket % range, 0UL);
+        prev = ticket;
+    }
+}
+
+TEST(broker_test, ticket_lease_client_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    constexpr auto range = 10;
+    auto ticketer = std::make_shared<counting_ticketer>(log, range);
+
+    // Serve the ticket machine over RPC, as for agents
+    const auto ep
+        = cbdc::network::endpoint_t{cbdc::network::localhost, 55560};
+    auto server = cbdc::rpc::async_tcp_server<
+        cbdc::parsec::ticket_machine::rpc::request,
+        cbdc::parsec::ticket_machine::rpc::response>(ep);
+    server.register_handler_callback(
+        [&](cbdc::parsec::ticket_machine::rpc::request /* req */,
+            std::function<void(
+                std::optional<cbdc::parsec::ticket_machine::rpc::response>)>
+                callback) {
+            return ticketer->get_ticket_number(
+                [callback](cbdc::parsec::ticket_machine::rpc::response res) {
+                    callback(res);
+                });
+        });
+    ASSERT_TRUE(server.init());
+
+    auto client
+        = std::make_shared<cbdc::parsec::ticket_machine::rpc::client>(
+            std::vector<cbdc::network::endpoint_t>{ep});
+    ASSERT_TRUE(client->init());
+    auto broker = make_broker(log, client, std::chrono::minutes(1));
+
+    constexpr auto n_tickets = 21;
+    for(cbdc::parsec::broker::ticket_number_type i = 0; i < n_tickets; i++) {
+        auto ticket = std::promise<
+            cbdc::parsec::broker::interface::ticketnum_or_errcode_type>();
+        ASSERT_TRUE(broker->begin(
+            [&](cbdc::parsec::broker::interface::ticketnum_or_errcode_type
+                    r) {
+                ticket.set_value(r);
+            }));
+        auto res = ticket.get_future().get();
+        ASSERT_TRUE(
+            std::holds_alternative<cbdc::parsec::broker::ticket_number_type>(
+                res));
+        ASSERT_EQ(std::get<cbdc::parsec::broker::ticket_number_type>(res),
+                  i);
+    }
+
+    // The client returns whole ranges, so the broker leases them. The
+    // last ticket comes from the prefetched third range.
+    ASSERT_EQ(ticketer->m_requests, 3UL);
+}
+
+TEST(broker_test, try_lock_many_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto shards = std::vector<
+        std::shared_ptr<cbdc::parsec::runtime_locking_shard::interface>>();
+    constexpr auto n_shards = 3;
+    for(size_t i = 0; i < n_shards; i++) {
+        shards.emplace_back(
+            std::make_shared<cbdc::parsec::runtime_locking_shard::impl>(log));
+    }
+    auto ticketer
+        = std::make_shared<cbdc::parsec::ticket_machine::impl>(log, 1);
+    auto directory
+        = std::make_shared<cbdc::parsec::directory::impl>(n_shards);
+    auto broker = std::make_shared<cbdc::parsec::broker::impl>(0,
+                                                               shards,
+                                                               ticketer,
+                                                               directory,
+                                                               log);
+
+    constexpr auto n_keys = 8;
+    auto locks = std::vector<cbdc::parsec::broker::lock_request_type>();
+    auto expected = std::vector<cbdc::parsec::broker::value_type>();
+    for(size_t i = 0; i < n_keys; i++) {
+        auto key = cbdc::buffer();
+        key.append(&i, sizeof(i));
+        auto value = cbdc::buffer();
+        value.append("value", 5);
+        value.append(&i, sizeof(i));
+        cbdc::test::add_to_shard(broker, key, value);
+        locks.emplace_back(key, cbdc::parsec::broker::lock_type::write);
+        expected.push_back(value);
+    }
+
+    auto ticket_number = begin_ticket(*broker);
+
+    // Lock one key on its own first so the batch includes a held lock
+    auto res = broker->try_lock(ticket_number,
+                                locks[0].first,
+                                cbdc::parsec::broker::lock_type::read,
+                                [&](const auto& ret) {
+                                    ASSERT_EQ(std::get<cbdc::buffer>(ret),
+                                              expected[0]);
+                                });
+    ASSERT_TRUE(res);
+
+    auto called = false;
+    res = broker->try_lock_many(
+        ticket_number,
+        locks,
+        [&](cbdc::parsec::broker::interface::try_lock_many_return_type ret) {
+            ASSERT_TRUE(
+                std::holds_alternative<
+                    std::vector<cbdc::parsec::broker::value_type>>(ret));
+            ASSERT_EQ(
+                std::get<std::vector<cbdc::parsec::broker::value_type>>(ret),
+                expected);
+            called = true;
+        });
+    ASSERT_TRUE(res);
+    ASSERT_TRUE(called);
+
+    called = false;
+    res = broker->commit(
+        ticket_number,
+        {{locks[1].first, expected[0]}},
+        [&](cbdc::parsec::broker::interface::commit_return_type ret) {
+            ASSERT_FALSE(ret.has_value());
+            called = true;
+        });
+    ASSERT_TRUE(res);
+    ASSERT_TRUE(called);
+}
+
+TEST(broker_test, concurrent_tickets_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto shards = std::vector<
+        std::shared_ptr<cbdc::parsec::runtime_locking_shard::interface>>();
+    constexpr auto n_shards = 4;
+    for(size_t i = 0; i < n_shards; i++) {
+        shards.emplace_back(
+            std::make_shared<cbdc::parsec::runtime_locking_shard::impl>(log));
+    }
+    auto ticketer
+        = std::make_shared<cbdc::parsec::ticket_machine::impl>(log, 16);
+    auto directory
+        = std::make_shared<cbdc::parsec::directory::impl>(n_shards);
+    auto broker = std::make_shared<cbdc::parsec::broker::impl>(0,
+                                                               shards,
+                                                               ticketer,
+                                                               directory,
+                                                               log);
+
+    using broker_interface = cbdc::parsec::broker::interface;
+    constexpr size_t n_threads = 8;
+    constexpr size_t n_tickets = 50;
+
+    // Each thread increments its own key so tickets never conflict
+    auto threads = std::vector<std::thread>();
+    for(size_t t = 0; t < n_threads; t++) {
+        threads.emplace_back([&, t]() {
+            auto key = cbdc::buffer();
+            key.append(&t, sizeof(t));
+            for(size_t i = 0; i < n_tickets; i++) {
+                auto begun = std::promise<
+                    broker_interface::ticketnum_or_errcode_type>();
+                ASSERT_TRUE(broker->begin([&](auto ret) {
+                    begun.set_value(ret);
+                }));
+                auto ret = begun.get_future().get();
+                ASSERT_TRUE(std::holds_alternative<
+                            cbdc::parsec::broker::ticket_number_type>(ret));
+                auto ticket_number
+                    = std::get<cbdc::parsec::broker::ticket_number_type>(ret);
+
+                auto locked
+                    = std::promise<broker_interface::try_lock_return_type>();
+                ASSERT_TRUE(broker->try_lock(
+                    ticket_number,
+                    key,
+                    cbdc::parsec::broker::lock_type::write,
+                    [&](auto res) {
+                        locked.set_value(res);
+                    }));
+                auto lock_res = locked.get_future().get();
+                ASSERT_TRUE(std::holds_alternative<cbdc::buffer>(lock_res));
+                auto value = std::get<cbdc::buffer>(lock_res);
+                ASSERT_EQ(value.size(), i == 0 ? 0 : sizeof(i));
+                if(i > 0) {
+                    size_t prev{};
+                    std::memcpy(&prev, value.data(), sizeof(prev));
+                    ASSERT_EQ(prev, i - 1);
+                }
+
+                auto new_value = cbdc::buffer();
+                new_value.append(&i, sizeof(i));
+                auto committed
+                    = std::promise<broker_interface::commit_return_type>();
+                ASSERT_TRUE(broker->commit(ticket_number,
+                                           {{key, new_value}},
+                                           [&](auto res) {
+                                               committed.set_value(res);
+                                           }));
+                ASSERT_FALSE(committed.get_future().get().has_value());
+
+                auto finished
+                    = std::promise<broker_interface::finish_return_type>();
+                ASSERT_TRUE(broker->finish(ticket_number, [&](auto res) {
+                    finished.set_value(res);
+                }));
+                ASSERT_FALSE(finished.get_future().get().has_value());
+            }
+        });
+    }
+    for(auto& thread : threads) {
+        thread.join();
+    }
+}
+
+namespace {
+    /// Shard which counts the prepare and commit requests it receives.
+    class counting_shard
+        : public cbdc::parsec::runtime_locking_shard::interface {
+      public:
+        explicit counting_shard(std::shared_ptr<cbdc::logging::log> log)
+            : m_impl(std::move(log)) {}
+
+        auto try_lock(cbdc::parsec::runtime_locking_shard::ticket_number_type
+                          ticket_number,
+                      cbdc::parsec::runtime_locking_shard::broker_id_type
+                          broker_id,
+                      cbdc::parsec::runtime_locking_shard::key_type key,
+                      cbdc::parsec::runtime_locking_shard::lock_type locktype,
+                      bool first_lock,
+                      try_lock_callback_type result_callback)
+            -> bool override {
+            return m_impl.try_lock(ticket_number,
+                                   broker_id,
+                                   std::move(key),
+                                   locktype,
+                                   first_lock,
+                                   std::move(result_callback));
+        }
+
+        auto try_lock_many(
+            cbdc::parsec::runtime_locking_shard::ticket_number_type
+                ticket_number,
+            cbdc::parsec::runtime_locking_shard::broker_id_type broker_id,
+            std::vector<cbdc::parsec::runtime_locking_shard::lock_request_type>
+                locks,
+            bool first_lock,
+            try_lock_many_callback_type result_callback) -> bool override {
+            return m_impl.try_lock_many(ticket_number,
+                                        broker_id,
+                                        std::move(locks),
+                                        first_lock,
+                                        std::move(result_callback));
+        }
+
+        auto prepare(cbdc::parsec::runtime_locking_shard::ticket_number_type
+                         ticket_number,
+                     cbdc::parsec::runtime_locking_shard::broker_id_type
+                         broker_id,
+                     cbdc::parsec::runtime_locking_shard::state_update_type
+                         state_update,
+                     prepare_callback_type result_callback) -> bool override {
+            m_prepares++;
+            return m_impl.prepare(ticket_number,
+                                  broker_id,
+                                  std::move(state_update),
+                                  std::move(result_callback));
+        }
+
+        auto commit(cbdc::parsec::runtime_locking_shard::ticket_number_type
+                        ticket_number,
+                    commit_callback_type result_callback) -> bool override {
+            m_commits++;
+            return m_impl.commit(ticket_number, std::move(result_callback));
+        }
+
+        auto prepare_commit(
+            cbdc::parsec::runtime_locking_shard::ticket_number_type
+                ticket_number,
+            cbdc::parsec::runtime_locking_shard::broker_id_type broker_id,
+            cbdc::parsec::runtime_locking_shard::state_update_type
+                state_update,
+            commit_callback_type result_callback) -> bool override {
+            m_prepare_commits++;
+            return m_impl.prepare_commit(ticket_number,
+                                         broker_id,
+                                         std::move(state_update),
+                                         std::move(result_callback));
+        }
+
+        auto rollback(cbdc::parsec::runtime_locking_shard::ticket_number_type
+                          ticket_number,
+                      rollback_callback_type result_callback)
+            -> bool override {
+            return m_impl.rollback(ticket_number, std::move(result_callback));
+        }
+
+        auto finish(cbdc::parsec::runtime_locking_shard::ticket_number_type
+                        ticket_number,
+                    finish_callback_type result_callback) -> bool override {
+            return m_impl.finish(ticket_number, std::move(result_callback));
+        }
+
+        auto get_tickets(
+            cbdc::parsec::runtime_locking_shard::broker_id_type broker_id,
+            get_tickets_callback_type result_callback) -> bool override {
+            return m_impl.get_tickets(broker_id, std::move(result_callback));
+        }
+
+        size_t m_prepares{};
+        size_t m_commits{};
+        size_t m_prepare_commits{};
+
+      private:
+        cbdc::parsec::runtime_locking_shard::impl m_impl;
+    };
+}
+
+TEST(broker_test, single_shard_commit_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    constexpr auto n_shards = 2;
+    auto counting_shards = std::vector<std::shared_ptr<counting_shard>>();
+    auto shards = std::vector<
+        std::shared_ptr<cbdc::parsec::runtime_locking_shard::interface>>();
+    for(size_t i = 0; i < n_shards; i++) {
+        counting_shards.emplace_back(std::make_shared<counting_shard>(log));
+        shards.emplace_back(counting_shards.back());
+    }
+    auto ticketer
+        = std::make_shared<cbdc::parsec::ticket_machine::impl>(log, 1);
+    auto directory
+        = std::make_shared<cbdc::parsec::directory::impl>(n_shards);
+    auto broker = std::make_shared<cbdc::parsec::broker::impl>(0,
+                                                               shards,
+                                                               ticketer,
+                                                               directory,
+                                                               log);
+
+    // Find two keys on the first shard and one on the second
+    auto keys = std::vector<std::vector<cbdc::buffer>>(n_shards);
+    for(size_t i = 0; keys[0].size() < 2 || keys[1].empty(); i++) {
+        auto key = cbdc::buffer();
+        key.append(&i, sizeof(i));
+        directory->key_location(key, [&](auto shard_idx) {
+            keys[shard_idx].push_back(key);
+        });
+    }
+
+    auto value = cbdc::buffer::from_hex("bb").value();
+    auto commit_ticket = [&](const std::vector<cbdc::buffer>& ticket_keys) {
+        auto ticket_number = begin_ticket(*broker);
+        for(const auto& key : ticket_keys) {
+            auto res = broker->try_lock(
+                ticket_number,
+                key,
+                cbdc::parsec::broker::lock_type::write,
+                [&](const auto& ret) {
+                    ASSERT_TRUE(std::holds_alternative<cbdc::buffer>(ret));
+                });
+            ASSERT_TRUE(res);
+        }
+        auto updates = cbdc::parsec::broker::state_update_type();
+        for(const auto& key : ticket_keys) {
+            updates.emplace(key, value);
+        }
+        auto called = false;
+        auto res = broker->commit(
+            ticket_number,
+            std::move(updates),
+            [&](cbdc::parsec::broker::interface::commit_return_type ret) {
+                ASSERT_FALSE(ret.has_value());
+                called = true;
+            });
+        ASSERT_TRUE(res);
+        ASSERT_TRUE(called);
+        called = false;
+        res = broker->finish(
+            ticket_number,
+            [&](cbdc::parsec::broker::interface::finish_return_type ret) {
+                ASSERT_FALSE(ret.has_value());
+                called = true;
+            });
+        ASSERT_TRUE(res);
+        ASSERT_TRUE(called);
+    };
+
+    // Both keys are on one shard, so the ticket commits in one request
+    commit_ticket(keys[0]);
+    ASSERT_EQ(counting_shards[0]->m_prepare_commits, 1UL);
+    ASSERT_EQ(counting_shards[0]->m_prepares, 0UL);
+    ASSERT_EQ(counting_shards[0]->m_commits, 0UL);
+
+    // Keys on both shards need both phases
+    commit_ticket({keys[0][0], keys[1][0]});
+    for(const auto& shard : counting_shards) {
+        ASSERT_EQ(shard->m_prepares, 1UL);
+        ASSERT_EQ(shard->m_commits, 1UL);
+    }
+    ASSERT_EQ(counting_shards[0]->m_prepare_commits, 1UL);
+    ASSERT_EQ(counting_shards[1]->m_prepare_commits, 0UL);
+
+    // The committed values are visible to later tickets
+    auto ticket_number = begin_ticket(*broker);
+    for(const auto& key : keys[0]) {
+        auto res = broker->try_lock(ticket_number,
+                                    key,
+                                    cbdc::parsec::broker::lock_type::read,
+                                    [&](const auto& ret) {
+                                        ASSERT_EQ(std::get<cbdc::buffer>(ret),
+                                                  value);
+                                    });
+        ASSERT_TRUE(res);
+    }
+}
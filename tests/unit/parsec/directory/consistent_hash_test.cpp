@@ -0,0 +1,97 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "parsec/directory/consistent_hash.hpp"
+
+#include <gtest/gtest.h>
+#include <set>
+
+namespace {
+    auto make_key(uint64_t i) -> cbdc::buffer {
+        auto key = cbdc::buffer();
+        key.append("key", 3);
+        key.append(&i, sizeof(i));
+        return key;
+    }
+}
+
+TEST(consistent_hash_test, key_location_test) {
+    constexpr auto n_shards = 4;
+    auto directory = cbdc::parsec::directory::consistent_hash(n_shards);
+    for(uint64_t i = 0; i < 100; i++) {
+        auto key = make_key(i);
+        auto called = false;
+        auto res = directory.key_location(key, [&](uint64_t shard) {
+            ASSERT_LT(shard, n_shards);
+            ASSERT_EQ(shard, directory.locate(key));
+            called = true;
+        });
+        ASSERT_TRUE(res);
+        ASSERT_TRUE(called);
+    }
+}
+
+TEST(consistent_hash_test, balance_test) {
+    constexpr auto n_shards = 8;
+    constexpr auto n_keys = 80000;
+    auto directory = cbdc::parsec::directory::consistent_hash(n_shards);
+    auto counts = std::vector<size_t>(n_shards);
+    for(uint64_t i = 0; i < n_keys; i++) {
+        counts[directory.locate(make_key(i))]++;
+    }
+    constexpr auto expected = n_keys / n_shards;
+    for(auto count : counts) {
+        ASSERT_GT(count, expected / 2);
+        ASSERT_LT(count, expected * 3 / 2);
+    }
+}
+
+TEST(consistent_hash_test, add_shard_test) {
+    constexpr auto n_shards = 8;
+    constexpr auto n_keys = 80000;
+    auto before = cbdc::parsec::directory::consistent_hash(n_shards);
+    auto after = cbdc::parsec::directory::consistent_hash(n_shards + 1);
+    size_t moved{0};
+    for(uint64_t i = 0; i < n_keys; i++) {
+        auto key = make_key(i);
+        auto old_shard = before.locate(key);
+        auto new_shard = after.locate(key);
+        if(old_shard != new_shard) {
+            // Keys only move to the new shard
+            ASSERT_EQ(new_shard, n_shards);
+            moved++;
+        }
+    }
+    // About 1/9 of keys move, rather than almost all of them
+    ASSERT_GT(moved, 0UL);
+    ASSERT_LT(moved, 2 * n_keys / (n_shards + 1));
+}
+
+TEST(consistent_hash_test, prefix_test) {
+    constexpr auto n_shards = 16;
+    constexpr auto prefix_length = 20;
+    using cbdc::parsec::directory::consistent_hash;
+    auto directory
+        = consistent_hash(n_shards,
+                          consistent_hash::default_virtual_nodes,
+                          prefix_length);
+    auto shards = std::set<uint64_t>();
+    for(uint64_t a = 0; a < 32; a++) {
+        auto prefix = cbdc::buffer();
+        for(size_t i = 0; i < prefix_length / sizeof(a); i++) {
+            prefix.append(&a, sizeof(a));
+        }
+        prefix.extend(prefix_length - prefix.size());
+        auto shard = directory.locate(prefix);
+        shards.insert(shard);
+        for(uint64_t i = 0; i < 16; i++) {
+            auto key = prefix;
+            key.append(&i, sizeof(i));
+            ASSERT_EQ(directory.locate(key), shard);
+        }
+    }
+    // Different prefixes still spread across shards
+    ASSERT_GT(shards.size(), 1UL);
+}
@@ -5,8 +5,11 @@
 
 #include "parsec/runtime_locking_shard/impl.hpp"
 
+#include <atomic>
+#include <cstring>
 #include <future>
 #include <gtest/gtest.h>
+#include <thread>
 
 TEST(runtime_locking_shard_test, basic_test) {
     auto log = std::make_shared<cbdc::logging::log>(
@@ -723,3 +726,313 @@ TEST(runtime_locking_shard_test, upgrade_lock_test) {
         });
     ASSERT_TRUE(maybe_success);
 }
+
+TEST(runtime_locking_shard_test, try_lock_many_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::trace);
+    auto shard = cbdc::parsec::runtime_locking_shard::impl(log);
+
+    auto key0 = cbdc::buffer::from_hex("aa").value();
+    auto key1 = cbdc::buffer::from_hex("cc").value();
+    auto new_val = cbdc::buffer::from_hex("bb").value();
+
+    using cbdc::parsec::runtime_locking_shard::lock_type;
+    using values_type
+        = std::vector<cbdc::parsec::runtime_locking_shard::value_type>;
+    using try_lock_many_return_type = cbdc::parsec::runtime_locking_shard::
+        interface::try_lock_many_return_type;
+
+    auto maybe_success = shard.try_lock_many(
+        1,
+        0,
+        {{key0, lock_type::write}, {key1, lock_type::read}},
+        true,
+        [&](try_lock_many_return_type ret) {
+            ASSERT_TRUE(std::holds_alternative<values_type>(ret));
+            ASSERT_EQ(std::get<values_type>(ret),
+                      values_type({cbdc::buffer(), cbdc::buffer()}));
+        });
+    ASSERT_TRUE(maybe_success);
+
+    // The younger ticket waits for the write lock on key0 held by ticket 1
+    auto called = false;
+    maybe_success = shard.try_lock_many(
+        2,
+        0,
+        {{key1, lock_type::read}, {key0, lock_type::write}},
+        true,
+        [&](try_lock_many_return_type ret) {
+            ASSERT_TRUE(std::holds_alternative<values_type>(ret));
+            ASSERT_EQ(std::get<values_type>(ret),
+                      values_type({cbdc::buffer(), new_val}));
+            called = true;
+        });
+    ASSERT_TRUE(maybe_success);
+    ASSERT_FALSE(called);
+
+    maybe_success = shard.prepare(
+        1,
+        0,
+        {{key0, new_val}},
+        [](const std::optional<
+            cbdc::parsec::runtime_locking_shard::shard_error>& ret) {
+            ASSERT_FALSE(ret.has_value());
+        });
+    ASSERT_TRUE(maybe_success);
+
+    maybe_success = shard.commit(
+        1,
+        [](const std::optional<
+            cbdc::parsec::runtime_locking_shard::shard_error>& ret) {
+            ASSERT_FALSE(ret.has_value());
+        });
+    ASSERT_TRUE(maybe_success);
+    ASSERT_TRUE(called);
+
+    // Requests with a repeated key are rejected without queuing any lock
+    auto key2 = cbdc::buffer::from_hex("dd").value();
+    maybe_success = shard.try_lock_many(
+        2,
+        0,
+        {{key2, lock_type::read}, {key2, lock_type::write}},
+        false,
+        [&](try_lock_many_return_type ret) {
+            ASSERT_TRUE(std::holds_alternative<
+                        cbdc::parsec::runtime_locking_shard::shard_error>(
+                ret));
+            ASSERT_EQ(
+                std::get<cbdc::parsec::runtime_locking_shard::shard_error>(
+                    ret)
+                    .m_error_code,
+                cbdc::parsec::runtime_locking_shard::error_code::lock_queued);
+        });
+    ASSERT_TRUE(maybe_success);
+
+    maybe_success = shard.try_lock(
+        2,
+        0,
+        key2,
+        lock_type::write,
+        false,
+        [&](const cbdc::parsec::runtime_locking_shard::interface::
+                try_lock_return_type& ret) {
+            ASSERT_TRUE(std::holds_alternative<
+                        cbdc::parsec::runtime_locking_shard::value_type>(ret));
+        });
+    ASSERT_TRUE(maybe_success);
+}
+
+TEST(runtime_locking_shard_test, prepare_commit_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::trace);
+    auto shard = cbdc::parsec::runtime_locking_shard::impl(log);
+
+    auto key = cbdc::buffer::from_hex("aa").value();
+    auto key1 = cbdc::buffer::from_hex("cc").value();
+    auto new_val = cbdc::buffer::from_hex("bb").value();
+
+    auto maybe_success = shard.try_lock_many(
+        0,
+        0,
+        {{key, cbdc::parsec::runtime_locking_shard::lock_type::write},
+         {key1, cbdc::parsec::runtime_locking_shard::lock_type::read}},
+        true,
+        [&](const cbdc::parsec::runtime_locking_shard::interface::
+                try_lock_many_return_type& ret) {
+            ASSERT_TRUE(std::holds_alternative<
+                        std::vector<cbdc::parsec::runtime_locking_shard::
+                                        value_type>>(ret));
+        });
+    ASSERT_TRUE(maybe_success);
+
+    // Updates need write locks, so the ticket stays as it was
+    maybe_success = shard.prepare_commit(
+        0,
+        0,
+        {{key1, new_val}},
+        [](const std::optional<
+            cbdc::parsec::runtime_locking_shard::shard_error>& ret) {
+            ASSERT_TRUE(ret.has_value());
+            ASSERT_EQ(ret.value().m_error_code,
+                      cbdc::parsec::runtime_locking_shard::error_code::
+                          state_update_with_read_lock);
+        });
+    ASSERT_TRUE(maybe_success);
+
+    maybe_success = shard.prepare_commit(
+        0,
+        0,
+        {{key, new_val}},
+        [](const std::optional<
+            cbdc::parsec::runtime_locking_shard::shard_error>& ret) {
+            ASSERT_FALSE(ret.has_value());
+        });
+    ASSERT_TRUE(maybe_success);
+
+    maybe_success = shard.get_tickets(
+        0,
+        [&](const cbdc::parsec::runtime_locking_shard::interface::
+                get_tickets_return_type& ret) {
+            ASSERT_TRUE(std::holds_alternative<
+                        cbdc::parsec::runtime_locking_shard::interface::
+                            get_tickets_success_type>(ret));
+            auto tickets = std::get<cbdc::parsec::runtime_locking_shard::
+                                        interface::get_tickets_success_type>(
+                ret);
+            ASSERT_EQ(tickets.size(), 1UL);
+            ASSERT_EQ(
+                tickets[0],
+                cbdc::parsec::runtime_locking_shard::ticket_state::committed);
+        });
+    ASSERT_TRUE(maybe_success);
+
+    maybe_success = shard.try_lock(
+        1,
+        0,
+        key,
+        cbdc::parsec::runtime_locking_shard::lock_type::read,
+        true,
+        [&](cbdc::parsec::runtime_locking_shard::interface::
+                try_lock_return_type ret) {
+            ASSERT_TRUE(std::holds_alternative<
+                        cbdc::parsec::runtime_locking_shard::value_type>(ret));
+            ASSERT_EQ(
+                std::get<cbdc::parsec::runtime_locking_shard::value_type>(ret),
+                new_val);
+        });
+    ASSERT_TRUE(maybe_success);
+}
+
+TEST(runtime_locking_shard_test, concurrent_transfer_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    // Few stripes so transfers often span stripes other requests hold
+    static constexpr size_t stripe_count = 4;
+    auto shard = cbdc::parsec::runtime_locking_shard::impl(log, stripe_count);
+
+    static constexpr size_t n_keys = 16;
+    static constexpr size_t n_threads = 8;
+    static constexpr size_t n_transfers = 200;
+
+    using cbdc::parsec::runtime_locking_shard::lock_request_type;
+    using cbdc::parsec::runtime_locking_shard::lock_type;
+    using cbdc::parsec::runtime_locking_shard::shard_error;
+    using cbdc::parsec::runtime_locking_shard::state_update_type;
+    using values_type
+        = std::vector<cbdc::parsec::runtime_locking_shard::value_type>;
+    using try_lock_many_return_type = cbdc::parsec::runtime_locking_shard::
+        interface::try_lock_many_return_type;
+
+    auto keys = std::vector<cbdc::buffer>();
+    for(size_t i{0}; i < n_keys; i++) {
+        auto key = cbdc::buffer();
+        key.append(&i, sizeof(i));
+        keys.emplace_back(std::move(key));
+    }
+
+    auto to_balance = [](const cbdc::buffer& buf) {
+        int64_t balance{0};
+        if(buf.size() == sizeof(balance)) {
+            std::memcpy(&balance, buf.data(), sizeof(balance));
+        }
+        return balance;
+    };
+    auto from_balance = [](int64_t balance) {
+        auto buf = cbdc::buffer();
+        buf.append(&balance, sizeof(balance));
+        return buf;
+    };
+
+    auto lock_many = [&](uint64_t ticket_number,
+                         std::vector<lock_request_type> locks) {
+        auto res = std::make_shared<std::promise<try_lock_many_return_type>>();
+        auto fut = res->get_future();
+        shard.try_lock_many(ticket_number,
+                            0,
+                            std::move(locks),
+                            true,
+                            [res](try_lock_many_return_type ret) {
+                                res->set_value(std::move(ret));
+                            });
+        return fut.get();
+    };
+    auto call = [](auto&& fn) {
+        auto res = std::promise<std::optional<shard_error>>();
+        auto fut = res.get_future();
+        fn([&](std::optional<shard_error> ret) {
+            res.set_value(ret);
+        });
+        return fut.get();
+    };
+
+    auto next_ticket = std::atomic<uint64_t>{1};
+    auto threads = std::vector<std::thread>();
+    for(size_t t{0}; t < n_threads; t++) {
+        threads.emplace_back([&, t]() {
+            size_t done{0};
+            size_t i{0};
+            while(done < n_transfers) {
+                auto from = (t * 7 + i * 3) % n_keys;
+                auto to = (from + 1 + (t + i) % (n_keys - 1)) % n_keys;
+                i++;
+                auto ticket_number = next_ticket++;
+                auto ret = lock_many(
+                    ticket_number,
+                    {{keys[from], lock_type::write},
+                     {keys[to], lock_type::write}});
+                auto* values = std::get_if<values_type>(&ret);
+                auto err = std::optional<shard_error>();
+                if(values == nullptr) {
+                    err = std::get<shard_error>(ret);
+                } else {
+                    err = call([&](auto cb) {
+                        shard.prepare(
+                            ticket_number,
+                            0,
+                            state_update_type{
+                                {keys[from],
+                                 from_balance(to_balance((*values)[0]) - 1)},
+                                {keys[to],
+                                 from_balance(to_balance((*values)[1])
+                                              + 1)}},
+                            cb);
+                    });
+                }
+                if(err.has_value()) {
+                    ASSERT_EQ(err->m_error_code,
+                              cbdc::parsec::runtime_locking_shard::
+                                  error_code::wounded);
+                    ASSERT_FALSE(call([&](auto cb) {
+                                     shard.rollback(ticket_number, cb);
+                                 }).has_value());
+                    continue;
+                }
+                ASSERT_FALSE(call([&](auto cb) {
+                                 shard.commit(ticket_number, cb);
+                             }).has_value());
+                ASSERT_FALSE(call([&](auto cb) {
+                                 shard.finish(ticket_number, cb);
+                             }).has_value());
+                done++;
+            }
+        });
+    }
+    for(auto& thread : threads) {
+        thread.join();
+    }
+
+    auto locks = std::vector<lock_request_type>();
+    for(const auto& key : keys) {
+        locks.emplace_back(key, lock_type::read);
+    }
+    auto ret = lock_many(next_ticket++, std::move(locks));
+    ASSERT_TRUE(std::holds_alternative<values_type>(ret));
+    int64_t total{0};
+    int64_t moved{0};
+    for(const auto& value : std::get<values_type>(ret)) {
+        total += to_balance(value);
+        moved += std::abs(to_balance(value));
+    }
+    ASSERT_EQ(total, 0);
+    ASSERT_GT(moved, 0);
+}
@@ -6,9 +6,11 @@
 #include "util/common/hash.hpp"
 #include "util/common/logging.hpp"
 #include "util/raft/console_logger.hpp"
+#include "util/raft/log_entry_format.hpp"
 #include "util/raft/log_store.hpp"
 #include "util/raft/messages.hpp"
 #include "util/raft/node.hpp"
+#include "util/raft/segmented_log_store.hpp"
 #include "util/raft/serialization.hpp"
 #include "util/raft/state_manager.hpp"
 #include "util/raft/util.hpp"
@@ -17,6 +19,7 @@
 
 #include <filesystem>
 #include <gtest/gtest.h>
+#include <thread>
 
 class dummy_sm : public nuraft::state_machine {
   public:
@@ -77,6 +80,7 @@ class raft_test : public ::testing::Test {
   protected:
     void SetUp() override {
         std::filesystem::remove_all(m_db_dir);
+        std::filesystem::remove_all(std::string(m_db_dir) + "_segmented");
         std::filesystem::remove_all(m_config_file);
         std::filesystem::remove_all(m_state_file);
         for(size_t i{0}; i < 20; i++) {
@@ -102,6 +106,7 @@ class raft_test : public ::testing::Test {
 
     void TearDown() override {
         std::filesystem::remove_all(m_db_dir);
+        std::filesystem::remove_all(std::string(m_db_dir) + "_segmented");
         std::filesystem::remove_all(m_config_file);
         std::filesystem::remove_all(m_state_file);
         for(size_t i{0}; i < m_raft_endpoints.size(); i++) {
@@ -110,6 +115,8 @@ class raft_test : public ::testing::Test {
             std::filesystem::remove_all("test_raft_state_" + std::to_string(i)
                                         + ".dat");
             std::filesystem::remove_all("test_raft_log_" + std::to_string(i));
+            std::filesystem::remove_all("test_raft_log_" + std::to_string(i)
+                                        + "_segmented");
         }
         std::filesystem::remove_all(m_log_file);
     }
@@ -426,6 +433,38 @@ TEST_F(raft_test, test_state_manager_fail_logstore) {
     ASSERT_EQ(ls, nullptr);
 }
 
+TEST_F(raft_test, test_state_manager_switch_logstore) {
+    {
+        auto sm = cbdc::raft::state_manager(0,
+                                            m_db_dir,
+                                            m_config_file,
+                                            m_state_file,
+                                            m_raft_endpoints);
+        ASSERT_NE(sm.load_log_store(), nullptr);
+    }
+
+    // The segmented log store must not start empty over a LevelDB log
+    auto seg_sm = cbdc::raft::state_manager(0,
+                                            m_db_dir,
+                                            m_config_file,
+                                            m_state_file,
+                                            m_raft_endpoints,
+                                            true);
+    ASSERT_EQ(seg_sm.load_log_store(), nullptr);
+
+    std::filesystem::remove_all(m_db_dir);
+    ASSERT_NE(seg_sm.load_log_store(), nullptr);
+    ASSERT_TRUE(
+        std::filesystem::exists(std::string(m_db_dir) + "_segmented"));
+
+    auto sm = cbdc::raft::state_manager(0,
+                                        m_db_dir,
+                                        m_config_file,
+                                        m_state_file,
+                                        m_raft_endpoints);
+    ASSERT_EQ(sm.load_log_store(), nullptr);
+}
+
 TEST_F(raft_test, test_raft_serializer_basic) {
     auto new_log = nuraft::buffer::alloc(2);
     auto ser = cbdc::nuraft_serializer(*new_log);
@@ -625,6 +664,263 @@ TEST_F(raft_test, log_store_term_at) {
     }
 }
 
+TEST_F(raft_test, log_store_small_cache) {
+    // Most reads miss the cache and fall back to LevelDB
+    auto log_store = cbdc::raft::log_store(2);
+    ASSERT_TRUE(log_store.load(m_db_dir));
+
+    for(auto& entry : m_dummy_log_entries) {
+        log_store.append(entry);
+    }
+
+    auto log_range = log_store.log_entries(1, m_dummy_log_entries.size() + 1);
+    ASSERT_EQ(log_range->size(), m_dummy_log_entries.size());
+    for(size_t i{0}; i < m_dummy_log_entries.size(); i++) {
+        ASSERT_EQ((*log_range)[i]->get_term(),
+                  m_dummy_log_entries[i]->get_term());
+        ASSERT_EQ(log_store.term_at(i + 1),
+                  m_dummy_log_entries[i]->get_term());
+    }
+
+    // Compacted entries are not served from the cache
+    ASSERT_TRUE(log_store.compact(m_dummy_log_entries.size() - 1));
+    auto entry = log_store.entry_at(m_dummy_log_entries.size() - 1);
+    ASSERT_TRUE(entry->is_buf_null());
+}
+
+TEST_F(raft_test, log_store_concurrent_append) {
+    auto log_store = cbdc::raft::log_store();
+    ASSERT_TRUE(log_store.load(m_db_dir));
+
+    constexpr size_t n_threads = 4;
+    auto threads = std::vector<std::thread>();
+    for(size_t t{0}; t < n_threads; t++) {
+        threads.emplace_back([&]() {
+            for(auto entry : m_dummy_log_entries) {
+                log_store.append(entry);
+            }
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+
+    const auto n_entries = n_threads * m_dummy_log_entries.size();
+    ASSERT_EQ(log_store.next_slot(), n_entries + 1);
+    auto log_range = log_store.log_entries(1, n_entries + 1);
+    for(const auto& entry : *log_range) {
+        ASSERT_FALSE(entry->is_buf_null());
+    }
+}
+
+TEST_F(raft_test, log_entry_format_matches_nuraft) {
+    for(const auto& entry : m_dummy_log_entries) {
+        const auto expected = entry->serialize();
+        auto buf = std::vector<unsigned char>(
+            cbdc::raft::serialized_entry_size(*entry));
+        ASSERT_EQ(buf.size(), expected->size());
+        cbdc::raft::serialize_entry(*entry, buf.data());
+        ASSERT_EQ(
+            std::memcmp(buf.data(), expected->data_begin(), buf.size()),
+            0);
+
+        auto decoded = cbdc::raft::deserialize_entry(buf.data(), buf.size());
+        ASSERT_TRUE(decoded);
+        ASSERT_EQ(decoded->get_term(), entry->get_term());
+        ASSERT_EQ(decoded->get_val_type(), entry->get_val_type());
+        ASSERT_EQ(decoded->get_buf().size(), entry->get_buf().size());
+        ASSERT_EQ(std::memcmp(decoded->get_buf().data_begin(),
+                              entry->get_buf().data_begin(),
+                              entry->get_buf().size()),
+                  0);
+    }
+
+    auto short_buf = std::vector<unsigned char>(
+        cbdc::raft::log_entry_header_size - 1);
+    ASSERT_FALSE(
+        cbdc::raft::deserialize_entry(short_buf.data(), short_buf.size()));
+}
+
+TEST_F(raft_test, segmented_log_store_load_filled) {
+    {
+        auto log_store = cbdc::raft::segmented_log_store();
+        ASSERT_TRUE(log_store.load(m_db_dir));
+        ASSERT_EQ(log_store.next_slot(), 1UL);
+        ASSERT_TRUE(log_store.last_entry()->is_buf_null());
+
+        for(auto& entry : m_dummy_log_entries) {
+            log_store.append(entry);
+        }
+        ASSERT_TRUE(log_store.flush());
+    }
+    {
+        auto log_store2 = cbdc::raft::segmented_log_store();
+        ASSERT_TRUE(log_store2.load(m_db_dir));
+        ASSERT_EQ(log_store2.next_slot(), m_dummy_log_entries.size() + 1);
+        ASSERT_EQ(log_store2.start_index(), 1UL);
+
+        auto entry = log_store2.last_entry();
+        auto last_dummy_entry = m_dummy_log_entries.back();
+        ASSERT_EQ(entry->get_term(), last_dummy_entry->get_term());
+        ASSERT_EQ(std::memcmp(entry->serialize()->data_begin(),
+                              last_dummy_entry->serialize()->data_begin(),
+                              entry->serialize()->size()),
+                  0);
+    }
+}
+
+TEST_F(raft_test, segmented_log_store_small_segments) {
+    // Store each entry in its own segment and bypass the cache
+    auto log_store = cbdc::raft::segmented_log_store(1, 1);
+    ASSERT_TRUE(log_store.load(m_db_dir));
+
+    for(auto& entry : m_dummy_log_entries) {
+        log_store.append(entry);
+    }
+
+    auto log_range = log_store.log_entries(5, 10);
+    ASSERT_EQ(log_range->size(), 5UL);
+    size_t i{4};
+    for(const auto& entry : *log_range) {
+        ASSERT_EQ(entry->get_term(), m_dummy_log_entries[i]->get_term());
+        ASSERT_EQ(log_store.term_at(i + 1),
+                  m_dummy_log_entries[i]->get_term());
+        i++;
+    }
+
+    log_store.write_at(3, m_dummy_log_entries[2]);
+    ASSERT_EQ(log_store.next_slot(), 4UL);
+    ASSERT_TRUE(log_store.entry_at(4)->is_buf_null());
+
+    ASSERT_TRUE(log_store.compact(2));
+    ASSERT_EQ(log_store.start_index(), 3UL);
+    ASSERT_EQ(log_store.term_at(3), m_dummy_log_entries[2]->get_term());
+
+    auto log_store2 = cbdc::raft::segmented_log_store(1, 1);
+    ASSERT_TRUE(log_store2.load(m_db_dir));
+    ASSERT_EQ(log_store2.start_index(), 3UL);
+    ASSERT_EQ(log_store2.next_slot(), 4UL);
+}
+
+TEST_F(raft_test, segmented_log_store_pack_apply) {
+    constexpr size_t segment_size = 256;
+    auto log_store = cbdc::raft::segmented_log_store(segment_size);
+    ASSERT_TRUE(log_store.load(m_db_dir));
+
+    for(auto& entry : m_dummy_log_entries) {
+        log_store.append(entry);
+    }
+
+    // Packs are interchangeable with the LevelDB log store
+    auto pack = log_store.pack(4, 17);
+    {
+        auto db_log_store = cbdc::raft::log_store();
+        ASSERT_TRUE(db_log_store.load(std::string(m_db_dir) + "_leveldb"));
+        for(auto& entry : m_dummy_log_entries) {
+            db_log_store.append(entry);
+        }
+        auto db_pack = db_log_store.pack(4, 17);
+        ASSERT_EQ(pack->size(), db_pack->size());
+        ASSERT_EQ(std::memcmp(pack->data_begin(),
+                              db_pack->data_begin(),
+                              pack->size()),
+                  0);
+    }
+    std::filesystem::remove_all(std::string(m_db_dir) + "_leveldb");
+
+    log_store.write_at(3, m_dummy_log_entries[2]);
+    ASSERT_EQ(log_store.next_slot(), 4UL);
+
+    log_store.apply_pack(4, *pack);
+    ASSERT_EQ(log_store.next_slot(), m_dummy_log_entries.size() + 1);
+
+    auto log_range = log_store.log_entries(1, m_dummy_log_entries.size() + 1);
+    for(size_t i{0}; i < m_dummy_log_entries.size(); i++) {
+        ASSERT_EQ((*log_range)[i]->get_term(),
+                  m_dummy_log_entries[i]->get_term());
+    }
+
+    // Applying a pack beyond the end of the log replaces the log
+    log_store.apply_pack(100, *pack);
+    ASSERT_EQ(log_store.start_index(), 100UL);
+    ASSERT_EQ(log_store.next_slot(), 117UL);
+    ASSERT_EQ(log_store.term_at(116), m_dummy_log_entries.back()->get_term());
+}
+
+TEST_F(raft_test, segmented_log_store_compact_all) {
+    {
+        auto log_store = cbdc::raft::segmented_log_store();
+        ASSERT_TRUE(log_store.load(m_db_dir));
+
+        for(auto& entry : m_dummy_log_entries) {
+            log_store.append(entry);
+        }
+        ASSERT_TRUE(log_store.compact(m_dummy_log_entries.size() + 5));
+        ASSERT_EQ(log_store.next_slot(), m_dummy_log_entries.size() + 6);
+        ASSERT_EQ(log_store.append(m_dummy_log_entries[0]),
+                  m_dummy_log_entries.size() + 6);
+    }
+    {
+        auto log_store2 = cbdc::raft::segmented_log_store();
+        ASSERT_TRUE(log_store2.load(m_db_dir));
+        ASSERT_EQ(log_store2.start_index(), m_dummy_log_entries.size() + 6);
+        ASSERT_EQ(log_store2.next_slot(), m_dummy_log_entries.size() + 7);
+    }
+}
+
+TEST_F(raft_test, segmented_log_store_torn_write) {
+    {
+        auto log_store = cbdc::raft::segmented_log_store();
+        ASSERT_TRUE(log_store.load(m_db_dir));
+        for(auto& entry : m_dummy_log_entries) {
+            log_store.append(entry);
+        }
+    }
+
+    // Simulate a crash part-way through writing the last record
+    auto seg_file = std::string(m_db_dir) + "/00000000000000000001.seg";
+    std::filesystem::resize_file(seg_file,
+                                 std::filesystem::file_size(seg_file) - 1);
+
+    auto log_store2 = cbdc::raft::segmented_log_store();
+    ASSERT_TRUE(log_store2.load(m_db_dir));
+    ASSERT_EQ(log_store2.next_slot(), m_dummy_log_entries.size());
+    ASSERT_EQ(log_store2.append(m_dummy_log_entries.back()),
+              m_dummy_log_entries.size());
+    ASSERT_EQ(log_store2.term_at(m_dummy_log_entries.size()),
+              m_dummy_log_entries.back()->get_term());
+}
+
+TEST_F(raft_test, segmented_log_store_corrupt_record) {
+    {
+        // Store each entry in its own segment
+        auto log_store = cbdc::raft::segmented_log_store(1);
+        ASSERT_TRUE(log_store.load(m_db_dir));
+        for(auto& entry : m_dummy_log_entries) {
+            log_store.append(entry);
+        }
+    }
+
+    // Zero the fifth record, keeping its size
+    auto seg_file = std::string(m_db_dir) + "/00000000000000000005.seg";
+    const auto seg_size = std::filesystem::file_size(seg_file);
+    std::filesystem::resize_file(seg_file, 0);
+    std::filesystem::resize_file(seg_file, seg_size);
+
+    // The log ends before the damaged record
+    auto log_store2 = cbdc::raft::segmented_log_store(1);
+    ASSERT_TRUE(log_store2.load(m_db_dir));
+    ASSERT_EQ(log_store2.next_slot(), 5UL);
+    ASSERT_EQ(log_store2.term_at(4), m_dummy_log_entries[3]->get_term());
+    ASSERT_FALSE(std::filesystem::exists(std::string(m_db_dir)
+                                         + "/00000000000000000006.seg"));
+    ASSERT_EQ(log_store2.append(m_dummy_log_entries[4]), 5UL);
+
+    auto log_store3 = cbdc::raft::segmented_log_store(1);
+    ASSERT_TRUE(log_store3.load(m_db_dir));
+    ASSERT_EQ(log_store3.next_slot(), 6UL);
+}
+
 TEST_F(raft_test, console_logger_loglevel) {
     // TODO: split these tests into separate fixtures.
     {
@@ -167,6 +167,54 @@ TEST_F(sentinel_2pc_test, digest_valid_transaction_network) {
     ASSERT_EQ(resp.value().m_tx_status, cbdc::sentinel::tx_status::confirmed);
 }
 
+TEST_F(sentinel_2pc_test, digest_transaction_batch_network) {
+    m_ctl->init();
+    auto invalid_tx = m_valid_tx;
+    invalid_tx.m_inputs.clear();
+
+    auto client = cbdc::sentinel::rpc::client(
+        {{cbdc::network::localhost, m_sentinel_port}},
+        m_logger);
+    ASSERT_TRUE(client.init());
+    auto resp = client.execute_transactions({m_valid_tx, invalid_tx});
+    ASSERT_TRUE(resp.has_value());
+    ASSERT_EQ(resp->m_responses.size(), 2UL);
+
+    ASSERT_TRUE(resp->m_responses[0].has_value());
+    ASSERT_FALSE(resp->m_responses[0]->m_tx_error.has_value());
+    ASSERT_EQ(resp->m_responses[0]->m_tx_status,
+              cbdc::sentinel::tx_status::confirmed);
+
+    ASSERT_TRUE(resp->m_responses[1].has_value());
+    ASSERT_TRUE(resp->m_responses[1]->m_tx_error.has_value());
+    ASSERT_EQ(resp->m_responses[1]->m_tx_status,
+              cbdc::sentinel::tx_status::static_invalid);
+
+    auto empty_resp = client.execute_transactions({});
+    ASSERT_TRUE(empty_resp.has_value());
+    ASSERT_TRUE(empty_resp->m_responses.empty());
+}
+
+TEST_F(sentinel_2pc_test, digest_transaction_batch_too_large) {
+    auto opts = m_opts;
+    opts.m_sentinel_max_batch_size = 1;
+    m_ctl = std::make_unique<cbdc::sentinel_2pc::controller>(0,
+                                                             opts,
+                                                             m_logger);
+    ASSERT_TRUE(m_ctl->init());
+
+    auto client = cbdc::sentinel::rpc::client(
+        {{cbdc::network::localhost, m_sentinel_port}},
+        m_logger);
+    ASSERT_TRUE(client.init());
+    auto resp = client.execute_transactions({m_valid_tx, m_valid_tx});
+    ASSERT_FALSE(resp.has_value());
+
+    resp = client.execute_transactions({m_valid_tx});
+    ASSERT_TRUE(resp.has_value());
+    ASSERT_EQ(resp->m_responses.size(), 1UL);
+}
+
 TEST_F(sentinel_2pc_test, tx_validation_test) {
     ASSERT_TRUE(m_ctl->init());
     auto ctx = cbdc::transaction::compact_tx(m_valid_tx);
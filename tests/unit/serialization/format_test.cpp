@@ -8,6 +8,7 @@
 #include "util/serialization/buffer_serializer.hpp"
 #include "util/serialization/format.hpp"
 #include "util/serialization/size_serializer.hpp"
+#include "util/serialization/util.hpp"
 
 #include <gtest/gtest.h>
 #include <limits>
@@ -221,6 +222,95 @@ TEST_F(format_test, malformed_vectors_cannot_roundtrip) {
     EXPECT_FALSE(deser);
 }
 
+TEST_F(format_test, bulk_vectors_roundtrip) {
+    std::vector<cbdc::hash_t> v0{};
+    for(unsigned char i = 0; i < 10; ++i) {
+        cbdc::hash_t h{};
+        h.fill(i);
+        v0.push_back(h);
+    }
+
+    ser << v0;
+    EXPECT_TRUE(ser);
+    EXPECT_EQ(buf.size(), sizeof(uint64_t) + v0.size() * cbdc::hash_size);
+    EXPECT_EQ(cbdc::serialized_size(v0), buf.size());
+
+    std::vector<cbdc::hash_t> r0{};
+    deser >> r0;
+
+    EXPECT_TRUE(deser);
+    EXPECT_EQ(r0, v0);
+    ser.reset();
+    deser.reset();
+    EXPECT_TRUE(ser);
+
+    std::vector<std::byte> v1{std::byte{0x01}, std::byte{0xff}};
+    ser << v1;
+    EXPECT_TRUE(ser);
+
+    std::vector<std::byte> r1{};
+    deser >> r1;
+
+    EXPECT_TRUE(deser);
+    EXPECT_EQ(r1, v1);
+}
+
+TEST_F(format_test, truncated_bulk_vectors_keep_prefix) {
+    cbdc::hash_t h0{};
+    h0.fill(1);
+    cbdc::hash_t h1{};
+    h1.fill(2);
+
+    // manually serialize a vector declaring more elements than present
+    ser << uint64_t{5} << h0 << h1;
+    EXPECT_TRUE(ser);
+
+    std::vector<cbdc::hash_t> r0{};
+    deser >> r0;
+
+    EXPECT_FALSE(deser);
+    ASSERT_EQ(r0.size(), 2UL);
+    EXPECT_EQ(r0[0], h0);
+    EXPECT_EQ(r0[1], h1);
+}
+
+TEST_F(format_test, bool_vectors_are_packed) {
+    std::vector<bool> v0{};
+    ser << v0;
+    EXPECT_TRUE(ser);
+
+    std::vector<bool> r0{};
+    deser >> r0;
+    EXPECT_TRUE(deser);
+    EXPECT_TRUE(r0.empty());
+    ser.reset();
+    deser.reset();
+    EXPECT_TRUE(ser);
+
+    std::vector<bool> v1{};
+    for(size_t i = 0; i < 19; ++i) {
+        v1.push_back(i % 3 == 0);
+    }
+    ser << v1;
+    EXPECT_TRUE(ser);
+    EXPECT_EQ(cbdc::serialized_size(v1), sizeof(uint64_t) + 3);
+
+    std::vector<bool> r1{};
+    deser >> r1;
+    EXPECT_TRUE(deser);
+    EXPECT_EQ(r1, v1);
+    ser.reset();
+    deser.reset();
+    EXPECT_TRUE(ser);
+
+    // declare more elements than the packed bytes present
+    ser << uint64_t{64} << uint8_t{0xff};
+    std::vector<bool> r2{};
+    deser >> r2;
+    EXPECT_FALSE(deser);
+    EXPECT_TRUE(r2.empty());
+}
+
 TEST_F(format_test, wellformed_unordered_maps_roundtrip) {
     std::unordered_map<int16_t, uint64_t> m0{};
     ser << m0;
@@ -7,7 +7,9 @@
 #include "uhs/transaction/wallet.hpp"
 
 #include <filesystem>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <set>
 
 class WalletTest : public ::testing::Test {
   protected:
@@ -161,6 +163,37 @@ TEST_F(WalletMultiTxTest, too_many_outputs) {
     ASSERT_EQ(send_tx, std::nullopt);
 }
 
+TEST_F(WalletMultiTxTest, generate_transactions) {
+    auto balance = m_sender.balance();
+    auto txs = m_sender.generate_transactions(30, 2, 3, true, 4);
+    ASSERT_EQ(txs.size(), 30UL);
+    ASSERT_EQ(m_sender.count(), 40UL);
+
+    auto spent = std::set<cbdc::transaction::out_point>();
+    for(const auto& tx : txs) {
+        ASSERT_EQ(tx.m_inputs.size(), 2UL);
+        ASSERT_EQ(tx.m_outputs.size(), 3UL);
+        ASSERT_FALSE(cbdc::transaction::validation::check_tx(tx).has_value());
+        for(const auto& in : tx.m_inputs) {
+            ASSERT_TRUE(spent.insert(in.m_prevout).second);
+        }
+    }
+
+    // Only 20 more transactions can be funded
+    auto more = m_sender.generate_transactions(30, 2, 1, false, 8);
+    ASSERT_EQ(more.size(), 20UL);
+    ASSERT_EQ(m_sender.count(), 0UL);
+
+    for(const auto& tx : txs) {
+        m_sender.confirm_transaction(tx);
+    }
+    for(const auto& tx : more) {
+        m_sender.confirm_transaction(tx);
+    }
+    ASSERT_EQ(m_sender.balance(), balance);
+    ASSERT_EQ(m_sender.count(), 110UL);
+}
+
 TEST_F(WalletTest, spend_order) {
     cbdc::transaction::input in0;
     in0.m_prevout.m_tx_id = {'e'};
@@ -201,3 +234,163 @@ TEST_F(WalletTest, load_save) {
     ASSERT_EQ(m_wallet.balance(), new_wal.balance());
     ASSERT_EQ(m_wallet.count(), new_wal.count());
 }
+
+TEST_F(WalletTest, load_save_journal) {
+    m_wallet.save(m_wallet_file);
+    const auto snapshot_size = std::filesystem::file_size(m_wallet_file);
+
+    auto pubkey = m_wallet.generate_key();
+    auto tx = m_wallet.send_to(30, pubkey, true).value();
+    m_wallet.confirm_transaction(tx);
+    m_wallet.save(m_wallet_file);
+    const auto journal_size = std::filesystem::file_size(m_wallet_file);
+    ASSERT_GT(journal_size, snapshot_size);
+
+    // A torn record at the end of the journal is dropped on load
+    {
+        std::ofstream wal_file(m_wallet_file,
+                               std::ios::binary | std::ios::app);
+        wal_file.put(1);
+        wal_file.put(2);
+    }
+
+    auto new_wal = cbdc::transaction::wallet();
+    new_wal.load(m_wallet_file);
+    ASSERT_EQ(std::filesystem::file_size(m_wallet_file), journal_size);
+    ASSERT_EQ(new_wal.balance(), uint32_t{100});
+    ASSERT_EQ(new_wal.count(), m_wallet.count());
+
+    // The loaded wallet can spend the journaled outputs and keys
+    auto spend = new_wal.send_to(2, 1, pubkey, true);
+    ASSERT_TRUE(spend.has_value());
+    ASSERT_TRUE(new_wal.is_spendable(spend->m_inputs[0]));
+    ASSERT_TRUE(new_wal.is_spendable(spend->m_inputs[1]));
+    new_wal.confirm_transaction(spend.value());
+    new_wal.save(m_wallet_file);
+
+    auto third_wal = cbdc::transaction::wallet();
+    third_wal.load(m_wallet_file);
+    ASSERT_EQ(third_wal.balance(), uint32_t{100});
+    ASSERT_EQ(third_wal.count(), new_wal.count());
+}
+
+TEST_F(WalletTest, load_save_journal_untracked) {
+    auto store = cbdc::transaction::utxo_store();
+    store.track_changes(true);
+    cbdc::transaction::input in;
+    in.m_prevout_data.m_value = 1;
+    for(size_t i = 0; i < cbdc::transaction::utxo_store::min_tracked_changes;
+        i++) {
+        store.insert(in);
+        store.erase(in.m_prevout);
+    }
+    // Too many changes to keep, so tracking stopped
+    ASSERT_FALSE(store.take_changes().has_value());
+    store.track_changes(true);
+    ASSERT_TRUE(store.take_changes().value().empty());
+
+    m_wallet.save(m_wallet_file);
+    const auto snapshot_size = std::filesystem::file_size(m_wallet_file);
+    auto pubkey = m_wallet.generate_key();
+    for(size_t i = 0; i < cbdc::transaction::utxo_store::min_tracked_changes;
+        i++) {
+        auto tx = m_wallet.send_to(1, 1, pubkey, false).value();
+        m_wallet.confirm_transaction(tx);
+    }
+
+    // The save rewrites the snapshot, as the changes were not kept
+    m_wallet.save(m_wallet_file);
+    ASSERT_LT(std::filesystem::file_size(m_wallet_file), snapshot_size * 2);
+    auto new_wal = cbdc::transaction::wallet();
+    new_wal.load(m_wallet_file);
+    ASSERT_EQ(new_wal.balance(), m_wallet.balance());
+    ASSERT_EQ(new_wal.count(), m_wallet.count());
+}
+
+TEST_F(WalletTest, coin_selection) {
+    auto make_input = [](unsigned char id, uint64_t value) {
+        cbdc::transaction::input in;
+        in.m_prevout.m_tx_id = {id};
+        in.m_prevout_data.m_value = value;
+        return in;
+    };
+    using cbdc::transaction::coin_selection;
+    auto values = [](const std::vector<cbdc::transaction::input>& ins) {
+        auto ret = std::vector<uint64_t>();
+        for(const auto& in : ins) {
+            ret.push_back(in.m_prevout_data.m_value);
+        }
+        return ret;
+    };
+
+    auto store = cbdc::transaction::utxo_store();
+    auto fill = [&]() {
+        for(const auto& in : {make_input('a', 5),
+                              make_input('b', 40),
+                              make_input('c', 12),
+                              make_input('d', 30),
+                              make_input('e', 12)}) {
+            store.insert(in);
+        }
+    };
+    fill();
+    ASSERT_FALSE(store.insert(make_input('a', 5)));
+    ASSERT_EQ(store.size(), 5UL);
+    ASSERT_EQ(store.balance(), 99UL);
+    ASSERT_FALSE(store.select(100, coin_selection::fewest_inputs));
+    ASSERT_EQ(store.size(), 5UL);
+
+    using vals = std::vector<uint64_t>;
+    ASSERT_EQ(values(store.select(20, coin_selection::oldest_first).value()),
+              (vals{5, 40}));
+    ASSERT_EQ(values(store.select(12, coin_selection::exact_match).value()),
+              (vals{12}));
+    ASSERT_EQ(store.balance(), 42UL);
+    ASSERT_EQ(store.oldest(2)[0], make_input('d', 30));
+
+    store = cbdc::transaction::utxo_store();
+    fill();
+    ASSERT_EQ(values(store.select(13, coin_selection::exact_match).value()),
+              (vals{30}));
+    ASSERT_EQ(values(store.select(20, coin_selection::largest_first).value()),
+              (vals{40}));
+    ASSERT_EQ(values(store.select(20, coin_selection::largest_first).value()),
+              (vals{12, 12}));
+
+    store = cbdc::transaction::utxo_store();
+    fill();
+    ASSERT_EQ(values(store.select(50, coin_selection::fewest_inputs).value()),
+              (vals{40, 12}));
+    ASSERT_EQ(values(store.select(35, coin_selection::fewest_inputs).value()),
+              (vals{30, 5}));
+    ASSERT_EQ(store.size(), 1UL);
+}
+
+TEST_F(WalletTest, send_coin_selection) {
+    cbdc::transaction::input in0;
+    in0.m_prevout.m_tx_id = {'e'};
+    in0.m_prevout_data.m_value = 14;
+    cbdc::transaction::input in1;
+    in1.m_prevout.m_tx_id = {'p'};
+    in1.m_prevout_data.m_value = 22;
+    m_wallet.confirm_inputs({in0, in1});
+
+    cbdc::pubkey_t target_addr = {'a', 'b', 'c', 'd'};
+    auto tx = m_wallet.send_to(22,
+                               target_addr,
+                               false,
+                               cbdc::transaction::coin_selection::exact_match)
+                  .value();
+    ASSERT_EQ(tx.m_inputs.size(), 1UL);
+    ASSERT_EQ(tx.m_inputs[0], in1);
+    ASSERT_EQ(tx.m_outputs.size(), 1UL);
+
+    tx = m_wallet
+             .send_to(110,
+                      target_addr,
+                      false,
+                      cbdc::transaction::coin_selection::fewest_inputs)
+             .value();
+    ASSERT_EQ(tx.m_inputs.size(), 2UL);
+    ASSERT_EQ(m_wallet.balance(), 0UL);
+}
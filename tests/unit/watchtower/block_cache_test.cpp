@@ -82,3 +82,51 @@ TEST_F(BlockCacheTest, add_k_plus_1) {
 
     ASSERT_EQ(m_bc.best_block_height(), 47UL);
 }
+
+TEST_F(BlockCacheTest, spend_in_same_block) {
+    ASSERT_FALSE(m_bc.check_unspent({'d'}).has_value());
+    ASSERT_EQ(m_bc.check_spent({'d'}).value().first, 44UL);
+    ASSERT_EQ(m_bc.check_spent({'d'}).value().second, cbdc::hash_t{'E'});
+}
+
+TEST_F(BlockCacheTest, large_block) {
+    constexpr unsigned char n_txs = 200;
+    cbdc::atomizer::block b1;
+    b1.m_height = 45;
+    for(unsigned char i = 0; i < n_txs; i++) {
+        b1.m_transactions.push_back(
+            cbdc::test::simple_tx({'t', i}, {{'i', i}}, {{'o', i}}));
+    }
+    m_bc.push_block(std::move(b1));
+
+    for(unsigned char i = 0; i < n_txs; i++) {
+        ASSERT_EQ(m_bc.check_spent({'i', i}).value().second,
+                  cbdc::hash_t({'t', i}));
+        ASSERT_EQ(m_bc.check_unspent({'o', i}).value().second,
+                  cbdc::hash_t({'t', i}));
+        ASSERT_FALSE(m_bc.check_spent({'o', i}).has_value());
+        ASSERT_FALSE(m_bc.check_unspent({'x', i}).has_value());
+    }
+
+    // The block from the fixture is still indexed
+    ASSERT_EQ(m_bc.check_unspent({'G'}).value().first, 44UL);
+    ASSERT_EQ(m_bc.best_block_height(), 45UL);
+}
+
+TEST_F(BlockCacheTest, shared_index) {
+    cbdc::atomizer::block b1;
+    b1.m_height = 45;
+    b1.m_transactions.push_back(
+        cbdc::test::simple_tx({'L'}, {{'G'}}, {{'o'}}));
+    auto idx = std::make_shared<const cbdc::watchtower::block_index>(b1);
+    ASSERT_EQ(idx->height(), 45UL);
+
+    auto other = cbdc::watchtower::block_cache(1);
+    other.push_index(idx);
+    m_bc.push_index(idx);
+
+    ASSERT_EQ(other.check_spent({'G'}).value().second, cbdc::hash_t{'L'});
+    ASSERT_EQ(m_bc.check_spent({'G'}).value().second, cbdc::hash_t{'L'});
+    ASSERT_EQ(other.check_unspent({'o'}).value().first, 45UL);
+    ASSERT_FALSE(other.check_unspent({'E'}).has_value());
+}
@@ -5,6 +5,8 @@
 
 #include "uhs/atomizer/watchtower/watchtower.hpp"
 #include "util.hpp"
+#include "util/serialization/buffer_serializer.hpp"
+#include "util/serialization/util.hpp"
 
 #include <gtest/gtest.h>
 
@@ -154,3 +156,228 @@ TEST_F(WatchtowerTest, best_block_height) {
               (cbdc::watchtower::response{
                   cbdc::watchtower::best_block_height_response{44}}));
 }
+
+TEST_F(WatchtowerTest, batched_requests) {
+    constexpr size_t n_txs = 3000;
+    auto wt = cbdc::watchtower::watchtower{0, 0, 3};
+    cbdc::atomizer::block b0;
+    b0.m_height = m_best_height;
+    auto ids = cbdc::watchtower::tx_id_uhs_ids();
+    for(size_t i = 0; i < n_txs; i++) {
+        const auto hi = static_cast<unsigned char>(i >> 8U);
+        const auto lo = static_cast<unsigned char>(i);
+        b0.m_transactions.push_back(cbdc::test::simple_tx({'t', hi, lo},
+                                                          {{'i', hi, lo}},
+                                                          {{'o', hi, lo}}));
+        ids.emplace(cbdc::hash_t{'t', hi, lo},
+                    std::vector<cbdc::hash_t>{{'i', hi, lo},
+                                              {'o', hi, lo},
+                                              {'x', hi, lo}});
+    }
+    wt.add_block(std::move(b0));
+
+    // The second request repeats UHS IDs from the first
+    auto req0 = cbdc::watchtower::status_update_request{ids};
+    auto req1 = cbdc::watchtower::status_update_request{
+        {{{'t', 0, 1}, {{'i', 0, 1}}}, {{'t', 0, 2}, {{'i', 0, 1}}}}};
+    auto res = wt.handle_status_update_requests({req0, req1});
+    ASSERT_EQ(res.size(), 2UL);
+
+    const auto& chks0
+        = std::get<cbdc::watchtower::status_request_check_success>(
+              res[0]->payload())
+              .states();
+    ASSERT_EQ(chks0.size(), n_txs);
+    for(const auto& [tx_id, states] : chks0) {
+        const auto hi = tx_id[1];
+        const auto lo = tx_id[2];
+        ASSERT_EQ(states,
+                  (std::vector<cbdc::watchtower::status_update_state>{
+                      {cbdc::watchtower::search_status::spent,
+                       m_best_height,
+                       {'i', hi, lo}},
+                      {cbdc::watchtower::search_status::unspent,
+                       m_best_height,
+                       {'o', hi, lo}},
+                      {cbdc::watchtower::search_status::no_history,
+                       m_best_height,
+                       {'x', hi, lo}}}));
+    }
+
+    ASSERT_EQ(*res[1],
+              (cbdc::watchtower::response{
+                  cbdc::watchtower::status_request_check_success{
+                      {{{'t', 0, 1},
+                        {{cbdc::watchtower::search_status::spent,
+                          m_best_height,
+                          {'i', 0, 1}}}},
+                       {{'t', 0, 2},
+                        {{cbdc::watchtower::search_status::no_history,
+                          m_best_height,
+                          {'i', 0, 1}}}}}}}));
+
+    // Matches handling the request on its own
+    ASSERT_EQ(*res[1], *wt.handle_status_update_request(req1));
+}
+
+TEST_F(WatchtowerTest, subscribe_status_updates) {
+    std::vector<std::pair<uint64_t, cbdc::watchtower::response>> updates;
+    m_watchtower.set_status_update_handler(
+        [&](uint64_t subscriber,
+            std::unique_ptr<cbdc::watchtower::response>&& res) {
+            updates.emplace_back(subscriber, *res);
+        });
+
+    // Only tx 'L' has no history yet
+    m_watchtower.subscribe_status_updates(
+        7,
+        cbdc::watchtower::status_update_request{
+            {{{'L'}, {{'G'}, {'o'}}}, {{'E'}, {{'G'}}}}});
+    ASSERT_EQ(updates.size(), 1UL);
+    ASSERT_EQ(updates[0].first, 7UL);
+    ASSERT_EQ(
+        updates[0].second,
+        (cbdc::watchtower::response{
+            cbdc::watchtower::status_request_check_success{
+                {{{'L'},
+                  {{cbdc::watchtower::search_status::no_history,
+                    m_best_height,
+                    {'G'}},
+                   {cbdc::watchtower::search_status::no_history,
+                    m_best_height,
+                    {'o'}}}},
+                 {{'E'},
+                  {{cbdc::watchtower::search_status::unspent,
+                    m_best_height,
+                    {'G'}}}}}}}));
+
+    cbdc::atomizer::block b1;
+    b1.m_height = m_best_height + 1;
+    b1.m_transactions.push_back(
+        cbdc::test::simple_tx({'Q'}, {{'r'}}, {{'s'}}));
+    m_watchtower.add_block(std::move(b1));
+    ASSERT_EQ(updates.size(), 1UL);
+
+    cbdc::atomizer::block b2;
+    b2.m_height = m_best_height + 2;
+    b2.m_transactions.push_back(
+        cbdc::test::simple_tx({'L'}, {{'G'}}, {{'o'}}));
+    m_watchtower.add_block(std::move(b2));
+    ASSERT_EQ(updates.size(), 2UL);
+    ASSERT_EQ(updates[1].first, 7UL);
+    ASSERT_EQ(updates[1].second,
+              (cbdc::watchtower::response{
+                  cbdc::watchtower::status_request_check_success{
+                      {{{'L'},
+                        {{cbdc::watchtower::search_status::spent,
+                          m_best_height + 2,
+                          {'G'}},
+                         {cbdc::watchtower::search_status::unspent,
+                          m_best_height + 2,
+                          {'o'}}}}}}}));
+
+    // The subscription ended once the transaction was resolved
+    cbdc::atomizer::block b3;
+    b3.m_height = m_best_height + 3;
+    b3.m_transactions.push_back(
+        cbdc::test::simple_tx({'L'}, {{'v'}}, {{'w'}}));
+    m_watchtower.add_block(std::move(b3));
+    ASSERT_EQ(updates.size(), 2UL);
+}
+
+TEST_F(WatchtowerTest, subscribe_status_updates_error) {
+    std::vector<std::pair<uint64_t, cbdc::watchtower::response>> updates;
+    m_watchtower.set_status_update_handler(
+        [&](uint64_t subscriber,
+            std::unique_ptr<cbdc::watchtower::response>&& res) {
+            updates.emplace_back(subscriber, *res);
+        });
+
+    auto req = cbdc::watchtower::status_update_request{
+        {{{'t', 'x', 'a'}, {{'a'}}}}};
+    m_watchtower.subscribe_status_updates(1, req);
+    m_watchtower.subscribe_status_updates(2, req);
+    ASSERT_EQ(updates.size(), 2UL);
+
+    std::vector<cbdc::watchtower::tx_error> errs{cbdc::watchtower::tx_error{
+        {'t', 'x', 'a'},
+        cbdc::watchtower::tx_error_inputs_dne{
+            std::vector<cbdc::hash_t>{{'a'}}}}};
+    m_watchtower.add_errors(std::move(errs));
+
+    ASSERT_EQ(updates.size(), 4UL);
+    auto expected = cbdc::watchtower::response{
+        cbdc::watchtower::status_request_check_success{
+            {{{'t', 'x', 'a'},
+              {{cbdc::watchtower::search_status::invalid_input,
+                m_best_height,
+                {'a'}}}}}}};
+    ASSERT_EQ(updates[2].first, 1UL);
+    ASSERT_EQ(updates[2].second, expected);
+    ASSERT_EQ(updates[3].first, 2UL);
+    ASSERT_EQ(updates[3].second, expected);
+}
+
+TEST_F(WatchtowerTest, subscribe_status_updates_limits) {
+    // Two blocks cached, one subscription per subscriber
+    auto wt = cbdc::watchtower::watchtower{2, 0, 0, 1};
+    std::vector<std::pair<uint64_t, cbdc::watchtower::response>> updates;
+    wt.set_status_update_handler(
+        [&](uint64_t subscriber,
+            std::unique_ptr<cbdc::watchtower::response>&& res) {
+            updates.emplace_back(subscriber, *res);
+        });
+    auto add_block = [&](uint64_t height, std::vector<cbdc::hash_t> tx_ids) {
+        cbdc::atomizer::block blk;
+        blk.m_height = height;
+        for(const auto& tx_id : tx_ids) {
+            blk.m_transactions.push_back(
+                cbdc::test::simple_tx(tx_id, {{'p'}}, {{'q'}}));
+        }
+        wt.add_block(std::move(blk));
+    };
+    auto subscribe = [&](uint64_t subscriber, const cbdc::hash_t& tx_id) {
+        wt.subscribe_status_updates(
+            subscriber,
+            cbdc::watchtower::status_update_request{{{tx_id, {{'p'}}}}});
+    };
+    add_block(10, {});
+
+    // The second subscription of subscriber 1 exceeds the limit
+    subscribe(1, {'X'});
+    subscribe(1, {'Y'});
+    subscribe(2, {'X'});
+    ASSERT_EQ(updates.size(), 3UL);
+
+    // Subscriber 2 disconnected
+    wt.remove_subscribers([](uint64_t subscriber) {
+        return subscriber == 2;
+    });
+    add_block(11, {{'X'}, {'Y'}});
+    ASSERT_EQ(updates.size(), 4UL);
+    ASSERT_EQ(updates[3].first, 1UL);
+
+    // The subscription expires once the block cache no longer holds the
+    // block it was made at
+    subscribe(1, {'Z'});
+    add_block(12, {});
+    add_block(13, {});
+    add_block(14, {{'Z'}});
+    ASSERT_EQ(updates.size(), 5UL);
+
+    // Expired subscriptions no longer count towards the limit
+    subscribe(1, {'W'});
+    add_block(15, {{'W'}});
+    ASSERT_EQ(updates.size(), 7UL);
+    ASSERT_EQ(updates[6].first, 1UL);
+}
+
+TEST_F(WatchtowerTest, subscribe_request_serialization) {
+    auto req = cbdc::watchtower::request{
+        cbdc::watchtower::status_update_subscribe_request{
+            cbdc::watchtower::status_update_request{
+                {{{'t', 'x', 'a'}, {{'a'}, {'b'}}}}}}};
+    auto buf = cbdc::make_buffer(req);
+    auto deser = cbdc::buffer_serializer(buf);
+    ASSERT_EQ(cbdc::watchtower::request(deser), req);
+}
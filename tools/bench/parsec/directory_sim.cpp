@@ -0,0 +1,214 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "parsec/directory/consistent_hash.hpp"
+#include "parsec/directory/impl.hpp"
+#include "util/common/config.hpp"
+#include "util/common/logging.hpp"
+
+#include <functional>
+#include <random>
+#include <set>
+#include <unordered_set>
+
+namespace {
+    using key_type = cbdc::parsec::runtime_locking_shard::key_type;
+
+    /// Keys accessed by each ticket of a workload.
+    using workload_type = std::vector<std::vector<key_type>>;
+
+    /// Creates a directory for the given number of shards.
+    using factory_type = std::function<std::unique_ptr<
+        cbdc::parsec::directory::interface>(size_t)>;
+
+    constexpr size_t evm_address_size = 20;
+    constexpr size_t hash_size = 32;
+    constexpr size_t locality_prefix = evm_address_size;
+
+    auto random_bytes(std::mt19937_64& rng, size_t n) -> cbdc::buffer {
+        auto buf = cbdc::buffer();
+        for(size_t i{0}; i < n; i++) {
+            auto byte = static_cast<uint8_t>(rng());
+            buf.append(&byte, sizeof(byte));
+        }
+        return buf;
+    }
+
+    auto concat(const cbdc::buffer& a, const cbdc::buffer& b)
+        -> cbdc::buffer {
+        auto buf = a;
+        buf.append(b.data(), b.size());
+        return buf;
+    }
+
+    /// Lua payments as in lua_bench: each ticket reads the pay contract of
+    /// its wallet and updates the sending and receiving accounts.
+    auto lua_workload(std::mt19937_64& rng,
+                      size_t n_accounts,
+                      size_t n_tickets) -> workload_type {
+        auto accounts = std::vector<key_type>();
+        auto pay_keys = std::vector<key_type>();
+        for(size_t i{0}; i < n_accounts; i++) {
+            auto account = cbdc::buffer();
+            account.append("account_", 8);
+            account.append(random_bytes(rng, hash_size).data(), hash_size);
+            accounts.push_back(std::move(account));
+            auto pay_key = cbdc::buffer();
+            pay_key.append("pay", 3);
+            pay_key.append(&i, sizeof(i));
+            pay_keys.push_back(std::move(pay_key));
+        }
+
+        auto ret = workload_type();
+        auto dist = std::uniform_int_distribution<size_t>(0, n_accounts - 1);
+        for(size_t i{0}; i < n_tickets; i++) {
+            auto from = dist(rng);
+            auto to = dist(rng);
+            ret.push_back({pay_keys[from], accounts[from], accounts[to]});
+        }
+        return ret;
+    }
+
+    /// ERC20 transfers as in evm_bench: each ticket updates the sender's
+    /// account, reads the token contract's account and code, and updates
+    /// the balance slots of the sender and receiver in the contract's
+    /// storage.
+    auto erc20_workload(std::mt19937_64& rng,
+                        size_t n_accounts,
+                        size_t n_tickets) -> workload_type {
+        auto contract = random_bytes(rng, evm_address_size);
+        auto code_key = contract;
+        auto code_marker = uint8_t{1};
+        code_key.append(&code_marker, sizeof(code_marker));
+
+        auto accounts = std::vector<key_type>();
+        auto balance_slots = std::vector<key_type>();
+        for(size_t i{0}; i < n_accounts; i++) {
+            accounts.push_back(random_bytes(rng, evm_address_size));
+            balance_slots.push_back(
+                concat(contract, random_bytes(rng, hash_size)));
+        }
+
+        auto ret = workload_type();
+        auto dist = std::uniform_int_distribution<size_t>(0, n_accounts - 1);
+        for(size_t i{0}; i < n_tickets; i++) {
+            auto from = dist(rng);
+            auto to = dist(rng);
+            ret.push_back({accounts[from],
+                           contract,
+                           code_key,
+                           balance_slots[from],
+                           balance_slots[to]});
+        }
+        return ret;
+    }
+
+    auto locate(cbdc::parsec::directory::interface& dir, const key_type& key)
+        -> uint64_t {
+        auto ret = uint64_t{};
+        dir.key_location(key, [&](auto loc) {
+            ret = loc;
+        });
+        return ret;
+    }
+
+    /// Returns the fraction of tickets whose keys span more than one shard.
+    auto cross_shard_rate(cbdc::parsec::directory::interface& dir,
+                          const workload_type& workload) -> double {
+        size_t cross{0};
+        for(const auto& keys : workload) {
+            auto shards = std::set<uint64_t>();
+            for(const auto& key : keys) {
+                shards.insert(locate(dir, key));
+            }
+            if(shards.size() > 1) {
+                cross++;
+            }
+        }
+        return static_cast<double>(cross)
+             / static_cast<double>(workload.size());
+    }
+
+    /// Returns the fraction of distinct keys which change shards between
+    /// the two directories.
+    auto remap_rate(cbdc::parsec::directory::interface& before,
+                    cbdc::parsec::directory::interface& after,
+                    const workload_type& workload) -> double {
+        auto keys = std::unordered_set<
+            key_type,
+            cbdc::hashing::const_sip_hash<key_type>>();
+        for(const auto& ticket_keys : workload) {
+            keys.insert(ticket_keys.begin(), ticket_keys.end());
+        }
+        size_t moved{0};
+        for(const auto& key : keys) {
+            if(locate(before, key) != locate(after, key)) {
+                moved++;
+            }
+        }
+        return static_cast<double>(moved) / static_cast<double>(keys.size());
+    }
+}
+
+auto main(int argc, char** argv) -> int {
+    auto log
+        = std::make_shared<cbdc::logging::log>(cbdc::logging::log_level::info);
+
+    auto args = cbdc::config::get_args(argc, argv);
+    if(args.size() < 4) {
+        log->error("Usage:",
+                   args[0],
+                   "<n_shards> <n_accounts> <n_tickets>");
+        return 1;
+    }
+    auto n_shards = std::stoull(args[1]);
+    auto n_accounts = std::stoull(args[2]);
+    auto n_tickets = std::stoull(args[3]);
+    if(n_shards < 1 || n_accounts < 1 || n_tickets < 1) {
+        log->error("Arguments must be positive");
+        return 1;
+    }
+
+    static constexpr auto seed = 0x1337;
+    auto rng = std::mt19937_64(seed);
+    auto workloads = std::vector<std::pair<std::string, workload_type>>{
+        {"lua", lua_workload(rng, n_accounts, n_tickets)},
+        {"erc20", erc20_workload(rng, n_accounts, n_tickets)}};
+
+    auto directories = std::vector<std::pair<std::string, factory_type>>{
+        {"modulo",
+         [](size_t n) {
+             return std::make_unique<cbdc::parsec::directory::impl>(n);
+         }},
+        {"consistent_hash",
+         [](size_t n) {
+             return std::make_unique<
+                 cbdc::parsec::directory::consistent_hash>(n);
+         }},
+        {"consistent_hash_prefix",
+         [](size_t n) {
+             return std::make_unique<
+                 cbdc::parsec::directory::consistent_hash>(
+                 n,
+                 cbdc::parsec::directory::consistent_hash::
+                     default_virtual_nodes,
+                 locality_prefix);
+         }}};
+
+    for(const auto& [dir_name, factory] : directories) {
+        auto dir = factory(n_shards);
+        auto grown = factory(n_shards + 1);
+        for(const auto& [workload_name, workload] : workloads) {
+            log->info(dir_name,
+                      workload_name,
+                      "cross-shard ticket rate:",
+                      cross_shard_rate(*dir, workload),
+                      "keys moved adding a shard:",
+                      remap_rate(*dir, *grown, workload));
+        }
+    }
+
+    return 0;
+}
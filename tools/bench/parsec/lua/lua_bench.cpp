@@ -6,7 +6,6 @@
 #include "crypto/sha256.h"
 #include "parsec/agent/client.hpp"
 #include "parsec/broker/impl.hpp"
-#include "parsec/directory/impl.hpp"
 #include "parsec/runtime_locking_shard/client.hpp"
 #include "parsec/ticket_machine/client.hpp"
 #include "parsec/util.hpp"
@@ -67,8 +66,7 @@ auto main(int argc, char** argv) -> int {
     }
     log->trace("Connected to ticket machine");
 
-    auto directory
-        = std::make_shared<cbdc::parsec::directory::impl>(shards.size());
+    auto directory = cbdc::parsec::make_directory(*cfg, shards.size());
     auto broker = std::make_shared<cbdc::parsec::broker::impl>(
         std::numeric_limits<size_t>::max(),
         shards,
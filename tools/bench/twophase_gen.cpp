@@ -15,6 +15,7 @@
 #include "util/serialization/format.hpp"
 
 #include <csignal>
+#include <deque>
 #include <iostream>
 
 auto main(int argc, char** argv) -> int {
@@ -161,6 +162,12 @@ auto main(int argc, char** argv) -> int {
 
     constexpr auto send_amt = 5;
 
+    // Fixed-size transactions are generated in batches across all cores
+    static constexpr size_t fixed_txs_per_thread = 16;
+    const auto gen_threads
+        = std::max<size_t>(1, std::thread::hardware_concurrency());
+    auto fixed_txs = std::deque<cbdc::transaction::full_tx>();
+
     uint64_t gen_avg{};
     auto gen_thread = std::thread([&]() {
         while(running) {
@@ -196,10 +203,21 @@ auto main(int argc, char** argv) -> int {
                 // generate a fixed-size transaction.
                 auto gen_s = std::chrono::high_resolution_clock::now();
                 if(send_fixed) {
-                    tx = wallet.send_to(cfg.m_input_count,
-                                        cfg.m_output_count,
-                                        wallet.generate_key(),
-                                        true);
+                    if(fixed_txs.empty()) {
+                        auto batch = wallet.generate_transactions(
+                            gen_threads * fixed_txs_per_thread,
+                            cfg.m_input_count,
+                            cfg.m_output_count,
+                            true,
+                            gen_threads);
+                        std::move(batch.begin(),
+                                  batch.end(),
+                                  std::back_inserter(fixed_txs));
+                    }
+                    if(!fixed_txs.empty()) {
+                        tx = std::move(fixed_txs.front());
+                        fixed_txs.pop_front();
+                    }
                 } else {
                     // If using fixed TX mode, the fallback in/out count
                     // should be 2/2